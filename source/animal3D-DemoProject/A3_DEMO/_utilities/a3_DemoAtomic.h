@@ -0,0 +1,52 @@
+/*
+	animal3D SDK: Minimal 3D Animation Framework
+	Fractals Midterm: CPU fractal engines
+
+	a3_DemoAtomic.h
+	Atomic operations on longs shared by the threaded modules.
+
+	Every operation is sequentially consistent and works on a pointer to
+	a volatile long:
+		a3atomicLoad(p): value at 'p'
+		a3atomicStore(p, v): write 'v' to 'p'
+		a3atomicAdd(p, v): add 'v' to 'p'; returns the value before
+		a3atomicOr(p, v): set the bits of 'v' in 'p'; returns the value
+			before
+		a3atomicCompareSwap(p, c, v): write 'v' to 'p' if it holds 'c';
+			returns the value before either way
+		a3atomicFence(): full memory barrier
+	Include from source files only.
+*/
+
+#ifndef __ANIMAL3D_DEMOATOMIC_H
+#define __ANIMAL3D_DEMOATOMIC_H
+
+
+//-----------------------------------------------------------------------------
+
+#ifdef _WIN32
+#include <Windows.h>
+
+#define a3atomicLoad(p)					InterlockedCompareExchange((p), 0, 0)
+#define a3atomicStore(p, v)				InterlockedExchange((p), (v))
+#define a3atomicAdd(p, v)				InterlockedExchangeAdd((p), (v))
+#define a3atomicOr(p, v)				InterlockedOr((p), (v))
+#define a3atomicCompareSwap(p, c, v)	InterlockedCompareExchange((p), (v), (c))
+#define a3atomicFence()					MemoryBarrier()
+
+#else	// !_WIN32
+
+#define a3atomicLoad(p)					__atomic_load_n((p), __ATOMIC_SEQ_CST)
+#define a3atomicStore(p, v)				__atomic_store_n((p), (v), __ATOMIC_SEQ_CST)
+#define a3atomicAdd(p, v)				__atomic_fetch_add((p), (v), __ATOMIC_SEQ_CST)
+#define a3atomicOr(p, v)				__atomic_fetch_or((p), (v), __ATOMIC_SEQ_CST)
+#define a3atomicCompareSwap(p, c, v)	__sync_val_compare_and_swap((p), (c), (v))
+#define a3atomicFence()					__atomic_thread_fence(__ATOMIC_SEQ_CST)
+
+#endif	// _WIN32
+
+
+//-----------------------------------------------------------------------------
+
+
+#endif	// !__ANIMAL3D_DEMOATOMIC_H
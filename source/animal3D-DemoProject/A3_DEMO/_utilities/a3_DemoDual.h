@@ -0,0 +1,718 @@
+/*
+	animal3D SDK: Minimal 3D Animation Framework
+	Fractals Midterm: CPU fractal engines
+
+	a3_DemoDual.h
+	Forward-mode dual numbers for distance-field gradients.
+
+	A dual carries a value and its partial derivatives by x, y and z; every
+	operation applies the chain rule, so a distance function written with
+	these returns its gradient in the same pass. Values are computed with
+	exactly the operations of plain float code, so a dual evaluation gives
+	the same distance bit for bit. 'min' and 'max' keep the derivatives of
+	the operand they select, breaking ties the way the value does; 'abs'
+	and 'floor' are piecewise, and take the derivative of the piece the
+	value falls in ('floor' is flat, so 'mod' passes its input through).
+	There are scalar, SSE2, AVX2 and AVX-512 versions, the wide ones
+	holding 4, 8 or 16 lanes in each member.
+	Include from source files only, after "a3_DemoSIMD.h".
+*/
+
+#ifndef __ANIMAL3D_DEMODUAL_H
+#define __ANIMAL3D_DEMODUAL_H
+
+
+#include <math.h>
+
+
+//-----------------------------------------------------------------------------
+
+#ifdef _MSC_VER
+#define a3dual_inline	static __forceinline
+#else	// !_MSC_VER
+#define a3dual_inline	static inline __attribute__((always_inline))
+#endif	// _MSC_VER
+
+
+// value and gradient
+typedef struct a3_FractalDual
+{
+	float v, dx, dy, dz;
+} a3_FractalDual;
+
+
+a3dual_inline a3_FractalDual a3fractalDualConst(const float c)
+{
+	a3_FractalDual r;
+	r.v = c;
+	r.dx = r.dy = r.dz = 0.0f;
+	return r;
+}
+
+// coordinate 'axis' (0 to 2) with value 'c'
+a3dual_inline a3_FractalDual a3fractalDualVar(const float c, const unsigned int axis)
+{
+	a3_FractalDual r;
+	r.v = c;
+	r.dx = axis == 0 ? 1.0f : 0.0f;
+	r.dy = axis == 1 ? 1.0f : 0.0f;
+	r.dz = axis == 2 ? 1.0f : 0.0f;
+	return r;
+}
+
+a3dual_inline a3_FractalDual a3fractalDualAdd(const a3_FractalDual a, const a3_FractalDual b)
+{
+	a3_FractalDual r;
+	r.v = a.v + b.v;
+	r.dx = a.dx + b.dx;
+	r.dy = a.dy + b.dy;
+	r.dz = a.dz + b.dz;
+	return r;
+}
+
+a3dual_inline a3_FractalDual a3fractalDualSub(const a3_FractalDual a, const a3_FractalDual b)
+{
+	a3_FractalDual r;
+	r.v = a.v - b.v;
+	r.dx = a.dx - b.dx;
+	r.dy = a.dy - b.dy;
+	r.dz = a.dz - b.dz;
+	return r;
+}
+
+a3dual_inline a3_FractalDual a3fractalDualMul(const a3_FractalDual a, const a3_FractalDual b)
+{
+	a3_FractalDual r;
+	r.v = a.v * b.v;
+	r.dx = a.dx * b.v + a.v * b.dx;
+	r.dy = a.dy * b.v + a.v * b.dy;
+	r.dz = a.dz * b.v + a.v * b.dz;
+	return r;
+}
+
+// a + c
+a3dual_inline a3_FractalDual a3fractalDualAddC(const a3_FractalDual a, const float c)
+{
+	a3_FractalDual r = a;
+	r.v = a.v + c;
+	return r;
+}
+
+// c - a
+a3dual_inline a3_FractalDual a3fractalDualCSub(const float c, const a3_FractalDual a)
+{
+	a3_FractalDual r;
+	r.v = c - a.v;
+	r.dx = -a.dx;
+	r.dy = -a.dy;
+	r.dz = -a.dz;
+	return r;
+}
+
+// a * c
+a3dual_inline a3_FractalDual a3fractalDualMulC(const a3_FractalDual a, const float c)
+{
+	a3_FractalDual r;
+	r.v = a.v * c;
+	r.dx = a.dx * c;
+	r.dy = a.dy * c;
+	r.dz = a.dz * c;
+	return r;
+}
+
+// a / c
+a3dual_inline a3_FractalDual a3fractalDualDivC(const a3_FractalDual a, const float c)
+{
+	a3_FractalDual r;
+	r.v = a.v / c;
+	r.dx = a.dx / c;
+	r.dy = a.dy / c;
+	r.dz = a.dz / c;
+	return r;
+}
+
+a3dual_inline a3_FractalDual a3fractalDualAbs(const a3_FractalDual a)
+{
+	return a.v < 0.0f ? a3fractalDualMulC(a, -1.0f) : a;
+}
+
+a3dual_inline a3_FractalDual a3fractalDualMin(const a3_FractalDual a, const a3_FractalDual b)
+{
+	return a.v < b.v ? a : b;
+}
+
+a3dual_inline a3_FractalDual a3fractalDualMax(const a3_FractalDual a, const a3_FractalDual b)
+{
+	return a.v > b.v ? a : b;
+}
+
+// max(a, c)
+a3dual_inline a3_FractalDual a3fractalDualMaxC(const a3_FractalDual a, const float c)
+{
+	return a.v > c ? a : a3fractalDualConst(c);
+}
+
+// square root; flat at zero instead of infinite
+a3dual_inline a3_FractalDual a3fractalDualSqrt(const a3_FractalDual a)
+{
+	a3_FractalDual r;
+	float k;
+	r.v = sqrtf(a.v);
+	k = r.v > 0.0f ? 0.5f / r.v : 0.0f;
+	r.dx = a.dx * k;
+	r.dy = a.dy * k;
+	r.dz = a.dz * k;
+	return r;
+}
+
+// GLSL 'mod': a - c floor(a / c), with 1 / c exact
+a3dual_inline a3_FractalDual a3fractalDualMod(const a3_FractalDual a, const float c, const float cInv)
+{
+	a3_FractalDual r = a;
+	r.v = a.v - c * floorf(a.v * cInv);
+	return r;
+}
+
+
+//-----------------------------------------------------------------------------
+
+#if A3_FRACTAL_X86
+
+// SSE2: 4 lanes
+typedef struct a3_FractalDual4
+{
+	__m128 v, dx, dy, dz;
+} a3_FractalDual4;
+
+A3_FRACTAL_TARGET("sse2")
+a3dual_inline __m128 a3fractalDualSelect_sse2(const __m128 mask, const __m128 a, const __m128 b)
+{
+	return _mm_or_ps(_mm_and_ps(mask, a), _mm_andnot_ps(mask, b));
+}
+
+A3_FRACTAL_TARGET("sse2")
+a3dual_inline a3_FractalDual4 a3fractalDualBlend_sse2(const __m128 mask, const a3_FractalDual4 a, const a3_FractalDual4 b)
+{
+	a3_FractalDual4 r;
+	r.v = a3fractalDualSelect_sse2(mask, a.v, b.v);
+	r.dx = a3fractalDualSelect_sse2(mask, a.dx, b.dx);
+	r.dy = a3fractalDualSelect_sse2(mask, a.dy, b.dy);
+	r.dz = a3fractalDualSelect_sse2(mask, a.dz, b.dz);
+	return r;
+}
+
+A3_FRACTAL_TARGET("sse2")
+a3dual_inline a3_FractalDual4 a3fractalDualConst_sse2(const __m128 c)
+{
+	a3_FractalDual4 r;
+	r.v = c;
+	r.dx = r.dy = r.dz = _mm_setzero_ps();
+	return r;
+}
+
+A3_FRACTAL_TARGET("sse2")
+a3dual_inline a3_FractalDual4 a3fractalDualVar_sse2(const __m128 c, const unsigned int axis)
+{
+	const __m128 one = _mm_set1_ps(1.0f), zero = _mm_setzero_ps();
+	a3_FractalDual4 r;
+	r.v = c;
+	r.dx = axis == 0 ? one : zero;
+	r.dy = axis == 1 ? one : zero;
+	r.dz = axis == 2 ? one : zero;
+	return r;
+}
+
+A3_FRACTAL_TARGET("sse2")
+a3dual_inline a3_FractalDual4 a3fractalDualAdd_sse2(const a3_FractalDual4 a, const a3_FractalDual4 b)
+{
+	a3_FractalDual4 r;
+	r.v = _mm_add_ps(a.v, b.v);
+	r.dx = _mm_add_ps(a.dx, b.dx);
+	r.dy = _mm_add_ps(a.dy, b.dy);
+	r.dz = _mm_add_ps(a.dz, b.dz);
+	return r;
+}
+
+A3_FRACTAL_TARGET("sse2")
+a3dual_inline a3_FractalDual4 a3fractalDualSub_sse2(const a3_FractalDual4 a, const a3_FractalDual4 b)
+{
+	a3_FractalDual4 r;
+	r.v = _mm_sub_ps(a.v, b.v);
+	r.dx = _mm_sub_ps(a.dx, b.dx);
+	r.dy = _mm_sub_ps(a.dy, b.dy);
+	r.dz = _mm_sub_ps(a.dz, b.dz);
+	return r;
+}
+
+A3_FRACTAL_TARGET("sse2")
+a3dual_inline a3_FractalDual4 a3fractalDualMul_sse2(const a3_FractalDual4 a, const a3_FractalDual4 b)
+{
+	a3_FractalDual4 r;
+	r.v = _mm_mul_ps(a.v, b.v);
+	r.dx = _mm_add_ps(_mm_mul_ps(a.dx, b.v), _mm_mul_ps(a.v, b.dx));
+	r.dy = _mm_add_ps(_mm_mul_ps(a.dy, b.v), _mm_mul_ps(a.v, b.dy));
+	r.dz = _mm_add_ps(_mm_mul_ps(a.dz, b.v), _mm_mul_ps(a.v, b.dz));
+	return r;
+}
+
+A3_FRACTAL_TARGET("sse2")
+a3dual_inline a3_FractalDual4 a3fractalDualAddC_sse2(const a3_FractalDual4 a, const __m128 c)
+{
+	a3_FractalDual4 r = a;
+	r.v = _mm_add_ps(a.v, c);
+	return r;
+}
+
+A3_FRACTAL_TARGET("sse2")
+a3dual_inline a3_FractalDual4 a3fractalDualCSub_sse2(const __m128 c, const a3_FractalDual4 a)
+{
+	const __m128 zero = _mm_setzero_ps();
+	a3_FractalDual4 r;
+	r.v = _mm_sub_ps(c, a.v);
+	r.dx = _mm_sub_ps(zero, a.dx);
+	r.dy = _mm_sub_ps(zero, a.dy);
+	r.dz = _mm_sub_ps(zero, a.dz);
+	return r;
+}
+
+A3_FRACTAL_TARGET("sse2")
+a3dual_inline a3_FractalDual4 a3fractalDualMulC_sse2(const a3_FractalDual4 a, const __m128 c)
+{
+	a3_FractalDual4 r;
+	r.v = _mm_mul_ps(a.v, c);
+	r.dx = _mm_mul_ps(a.dx, c);
+	r.dy = _mm_mul_ps(a.dy, c);
+	r.dz = _mm_mul_ps(a.dz, c);
+	return r;
+}
+
+A3_FRACTAL_TARGET("sse2")
+a3dual_inline a3_FractalDual4 a3fractalDualDivC_sse2(const a3_FractalDual4 a, const __m128 c)
+{
+	a3_FractalDual4 r;
+	r.v = _mm_div_ps(a.v, c);
+	r.dx = _mm_div_ps(a.dx, c);
+	r.dy = _mm_div_ps(a.dy, c);
+	r.dz = _mm_div_ps(a.dz, c);
+	return r;
+}
+
+A3_FRACTAL_TARGET("sse2")
+a3dual_inline a3_FractalDual4 a3fractalDualAbs_sse2(const a3_FractalDual4 a)
+{
+	// flip the sign of every member where the value is negative
+	const __m128 flip = _mm_and_ps(_mm_cmplt_ps(a.v, _mm_setzero_ps()), _mm_set1_ps(-0.0f));
+	a3_FractalDual4 r;
+	r.v = _mm_xor_ps(a.v, flip);
+	r.dx = _mm_xor_ps(a.dx, flip);
+	r.dy = _mm_xor_ps(a.dy, flip);
+	r.dz = _mm_xor_ps(a.dz, flip);
+	return r;
+}
+
+A3_FRACTAL_TARGET("sse2")
+a3dual_inline a3_FractalDual4 a3fractalDualMin_sse2(const a3_FractalDual4 a, const a3_FractalDual4 b)
+{
+	return a3fractalDualBlend_sse2(_mm_cmplt_ps(a.v, b.v), a, b);
+}
+
+A3_FRACTAL_TARGET("sse2")
+a3dual_inline a3_FractalDual4 a3fractalDualMax_sse2(const a3_FractalDual4 a, const a3_FractalDual4 b)
+{
+	return a3fractalDualBlend_sse2(_mm_cmpgt_ps(a.v, b.v), a, b);
+}
+
+A3_FRACTAL_TARGET("sse2")
+a3dual_inline a3_FractalDual4 a3fractalDualMaxC_sse2(const a3_FractalDual4 a, const __m128 c)
+{
+	const __m128 keep = _mm_cmpgt_ps(a.v, c);
+	a3_FractalDual4 r;
+	r.v = a3fractalDualSelect_sse2(keep, a.v, c);
+	r.dx = _mm_and_ps(keep, a.dx);
+	r.dy = _mm_and_ps(keep, a.dy);
+	r.dz = _mm_and_ps(keep, a.dz);
+	return r;
+}
+
+A3_FRACTAL_TARGET("sse2")
+a3dual_inline a3_FractalDual4 a3fractalDualSqrt_sse2(const a3_FractalDual4 a)
+{
+	a3_FractalDual4 r;
+	__m128 k;
+	r.v = _mm_sqrt_ps(a.v);
+	k = _mm_and_ps(_mm_cmpgt_ps(r.v, _mm_setzero_ps()), _mm_div_ps(_mm_set1_ps(0.5f), r.v));
+	r.dx = _mm_mul_ps(a.dx, k);
+	r.dy = _mm_mul_ps(a.dy, k);
+	r.dz = _mm_mul_ps(a.dz, k);
+	return r;
+}
+
+A3_FRACTAL_TARGET("sse2")
+a3dual_inline a3_FractalDual4 a3fractalDualMod_sse2(const a3_FractalDual4 a, const float c, const float cInv)
+{
+	// SSE2 has no floor: truncate, then correct the negatives; exact
+	//	while |a / c| < 2^31
+	const __m128 h = _mm_mul_ps(a.v, _mm_set1_ps(cInv));
+	__m128 t = _mm_cvtepi32_ps(_mm_cvttps_epi32(h));
+	a3_FractalDual4 r = a;
+	t = _mm_sub_ps(t, _mm_and_ps(_mm_cmpgt_ps(t, h), _mm_set1_ps(1.0f)));
+	r.v = _mm_sub_ps(a.v, _mm_mul_ps(_mm_set1_ps(c), t));
+	return r;
+}
+
+
+// AVX2: 8 lanes
+typedef struct a3_FractalDual8
+{
+	__m256 v, dx, dy, dz;
+} a3_FractalDual8;
+
+A3_FRACTAL_TARGET("avx2")
+a3dual_inline a3_FractalDual8 a3fractalDualBlend_avx2(const __m256 mask, const a3_FractalDual8 a, const a3_FractalDual8 b)
+{
+	a3_FractalDual8 r;
+	r.v = _mm256_blendv_ps(b.v, a.v, mask);
+	r.dx = _mm256_blendv_ps(b.dx, a.dx, mask);
+	r.dy = _mm256_blendv_ps(b.dy, a.dy, mask);
+	r.dz = _mm256_blendv_ps(b.dz, a.dz, mask);
+	return r;
+}
+
+A3_FRACTAL_TARGET("avx2")
+a3dual_inline a3_FractalDual8 a3fractalDualConst_avx2(const __m256 c)
+{
+	a3_FractalDual8 r;
+	r.v = c;
+	r.dx = r.dy = r.dz = _mm256_setzero_ps();
+	return r;
+}
+
+A3_FRACTAL_TARGET("avx2")
+a3dual_inline a3_FractalDual8 a3fractalDualVar_avx2(const __m256 c, const unsigned int axis)
+{
+	const __m256 one = _mm256_set1_ps(1.0f), zero = _mm256_setzero_ps();
+	a3_FractalDual8 r;
+	r.v = c;
+	r.dx = axis == 0 ? one : zero;
+	r.dy = axis == 1 ? one : zero;
+	r.dz = axis == 2 ? one : zero;
+	return r;
+}
+
+A3_FRACTAL_TARGET("avx2")
+a3dual_inline a3_FractalDual8 a3fractalDualAdd_avx2(const a3_FractalDual8 a, const a3_FractalDual8 b)
+{
+	a3_FractalDual8 r;
+	r.v = _mm256_add_ps(a.v, b.v);
+	r.dx = _mm256_add_ps(a.dx, b.dx);
+	r.dy = _mm256_add_ps(a.dy, b.dy);
+	r.dz = _mm256_add_ps(a.dz, b.dz);
+	return r;
+}
+
+A3_FRACTAL_TARGET("avx2")
+a3dual_inline a3_FractalDual8 a3fractalDualSub_avx2(const a3_FractalDual8 a, const a3_FractalDual8 b)
+{
+	a3_FractalDual8 r;
+	r.v = _mm256_sub_ps(a.v, b.v);
+	r.dx = _mm256_sub_ps(a.dx, b.dx);
+	r.dy = _mm256_sub_ps(a.dy, b.dy);
+	r.dz = _mm256_sub_ps(a.dz, b.dz);
+	return r;
+}
+
+A3_FRACTAL_TARGET("avx2")
+a3dual_inline a3_FractalDual8 a3fractalDualMul_avx2(const a3_FractalDual8 a, const a3_FractalDual8 b)
+{
+	a3_FractalDual8 r;
+	r.v = _mm256_mul_ps(a.v, b.v);
+	r.dx = _mm256_add_ps(_mm256_mul_ps(a.dx, b.v), _mm256_mul_ps(a.v, b.dx));
+	r.dy = _mm256_add_ps(_mm256_mul_ps(a.dy, b.v), _mm256_mul_ps(a.v, b.dy));
+	r.dz = _mm256_add_ps(_mm256_mul_ps(a.dz, b.v), _mm256_mul_ps(a.v, b.dz));
+	return r;
+}
+
+A3_FRACTAL_TARGET("avx2")
+a3dual_inline a3_FractalDual8 a3fractalDualAddC_avx2(const a3_FractalDual8 a, const __m256 c)
+{
+	a3_FractalDual8 r = a;
+	r.v = _mm256_add_ps(a.v, c);
+	return r;
+}
+
+A3_FRACTAL_TARGET("avx2")
+a3dual_inline a3_FractalDual8 a3fractalDualCSub_avx2(const __m256 c, const a3_FractalDual8 a)
+{
+	const __m256 zero = _mm256_setzero_ps();
+	a3_FractalDual8 r;
+	r.v = _mm256_sub_ps(c, a.v);
+	r.dx = _mm256_sub_ps(zero, a.dx);
+	r.dy = _mm256_sub_ps(zero, a.dy);
+	r.dz = _mm256_sub_ps(zero, a.dz);
+	return r;
+}
+
+A3_FRACTAL_TARGET("avx2")
+a3dual_inline a3_FractalDual8 a3fractalDualMulC_avx2(const a3_FractalDual8 a, const __m256 c)
+{
+	a3_FractalDual8 r;
+	r.v = _mm256_mul_ps(a.v, c);
+	r.dx = _mm256_mul_ps(a.dx, c);
+	r.dy = _mm256_mul_ps(a.dy, c);
+	r.dz = _mm256_mul_ps(a.dz, c);
+	return r;
+}
+
+A3_FRACTAL_TARGET("avx2")
+a3dual_inline a3_FractalDual8 a3fractalDualDivC_avx2(const a3_FractalDual8 a, const __m256 c)
+{
+	a3_FractalDual8 r;
+	r.v = _mm256_div_ps(a.v, c);
+	r.dx = _mm256_div_ps(a.dx, c);
+	r.dy = _mm256_div_ps(a.dy, c);
+	r.dz = _mm256_div_ps(a.dz, c);
+	return r;
+}
+
+A3_FRACTAL_TARGET("avx2")
+a3dual_inline a3_FractalDual8 a3fractalDualAbs_avx2(const a3_FractalDual8 a)
+{
+	const __m256 flip = _mm256_and_ps(_mm256_cmp_ps(a.v, _mm256_setzero_ps(), _CMP_LT_OQ), _mm256_set1_ps(-0.0f));
+	a3_FractalDual8 r;
+	r.v = _mm256_xor_ps(a.v, flip);
+	r.dx = _mm256_xor_ps(a.dx, flip);
+	r.dy = _mm256_xor_ps(a.dy, flip);
+	r.dz = _mm256_xor_ps(a.dz, flip);
+	return r;
+}
+
+A3_FRACTAL_TARGET("avx2")
+a3dual_inline a3_FractalDual8 a3fractalDualMin_avx2(const a3_FractalDual8 a, const a3_FractalDual8 b)
+{
+	return a3fractalDualBlend_avx2(_mm256_cmp_ps(a.v, b.v, _CMP_LT_OQ), a, b);
+}
+
+A3_FRACTAL_TARGET("avx2")
+a3dual_inline a3_FractalDual8 a3fractalDualMax_avx2(const a3_FractalDual8 a, const a3_FractalDual8 b)
+{
+	return a3fractalDualBlend_avx2(_mm256_cmp_ps(a.v, b.v, _CMP_GT_OQ), a, b);
+}
+
+A3_FRACTAL_TARGET("avx2")
+a3dual_inline a3_FractalDual8 a3fractalDualMaxC_avx2(const a3_FractalDual8 a, const __m256 c)
+{
+	const __m256 keep = _mm256_cmp_ps(a.v, c, _CMP_GT_OQ);
+	a3_FractalDual8 r;
+	r.v = _mm256_blendv_ps(c, a.v, keep);
+	r.dx = _mm256_and_ps(keep, a.dx);
+	r.dy = _mm256_and_ps(keep, a.dy);
+	r.dz = _mm256_and_ps(keep, a.dz);
+	return r;
+}
+
+A3_FRACTAL_TARGET("avx2")
+a3dual_inline a3_FractalDual8 a3fractalDualSqrt_avx2(const a3_FractalDual8 a)
+{
+	a3_FractalDual8 r;
+	__m256 k;
+	r.v = _mm256_sqrt_ps(a.v);
+	k = _mm256_and_ps(_mm256_cmp_ps(r.v, _mm256_setzero_ps(), _CMP_GT_OQ), _mm256_div_ps(_mm256_set1_ps(0.5f), r.v));
+	r.dx = _mm256_mul_ps(a.dx, k);
+	r.dy = _mm256_mul_ps(a.dy, k);
+	r.dz = _mm256_mul_ps(a.dz, k);
+	return r;
+}
+
+A3_FRACTAL_TARGET("avx2")
+a3dual_inline a3_FractalDual8 a3fractalDualMod_avx2(const a3_FractalDual8 a, const float c, const float cInv)
+{
+	const __m256 t = _mm256_floor_ps(_mm256_mul_ps(a.v, _mm256_set1_ps(cInv)));
+	a3_FractalDual8 r = a;
+	r.v = _mm256_sub_ps(a.v, _mm256_mul_ps(_mm256_set1_ps(c), t));
+	return r;
+}
+
+
+#if A3_FRACTAL_AVX512
+
+// AVX-512: 16 lanes
+typedef struct a3_FractalDual16
+{
+	__m512 v, dx, dy, dz;
+} a3_FractalDual16;
+
+A3_FRACTAL_TARGET("avx512f")
+a3dual_inline a3_FractalDual16 a3fractalDualBlend_avx512(const __mmask16 mask, const a3_FractalDual16 a, const a3_FractalDual16 b)
+{
+	a3_FractalDual16 r;
+	r.v = _mm512_mask_mov_ps(b.v, mask, a.v);
+	r.dx = _mm512_mask_mov_ps(b.dx, mask, a.dx);
+	r.dy = _mm512_mask_mov_ps(b.dy, mask, a.dy);
+	r.dz = _mm512_mask_mov_ps(b.dz, mask, a.dz);
+	return r;
+}
+
+A3_FRACTAL_TARGET("avx512f")
+a3dual_inline a3_FractalDual16 a3fractalDualConst_avx512(const __m512 c)
+{
+	a3_FractalDual16 r;
+	r.v = c;
+	r.dx = r.dy = r.dz = _mm512_setzero_ps();
+	return r;
+}
+
+A3_FRACTAL_TARGET("avx512f")
+a3dual_inline a3_FractalDual16 a3fractalDualVar_avx512(const __m512 c, const unsigned int axis)
+{
+	const __m512 one = _mm512_set1_ps(1.0f), zero = _mm512_setzero_ps();
+	a3_FractalDual16 r;
+	r.v = c;
+	r.dx = axis == 0 ? one : zero;
+	r.dy = axis == 1 ? one : zero;
+	r.dz = axis == 2 ? one : zero;
+	return r;
+}
+
+A3_FRACTAL_TARGET("avx512f")
+a3dual_inline a3_FractalDual16 a3fractalDualAdd_avx512(const a3_FractalDual16 a, const a3_FractalDual16 b)
+{
+	a3_FractalDual16 r;
+	r.v = _mm512_add_ps(a.v, b.v);
+	r.dx = _mm512_add_ps(a.dx, b.dx);
+	r.dy = _mm512_add_ps(a.dy, b.dy);
+	r.dz = _mm512_add_ps(a.dz, b.dz);
+	return r;
+}
+
+A3_FRACTAL_TARGET("avx512f")
+a3dual_inline a3_FractalDual16 a3fractalDualSub_avx512(const a3_FractalDual16 a, const a3_FractalDual16 b)
+{
+	a3_FractalDual16 r;
+	r.v = _mm512_sub_ps(a.v, b.v);
+	r.dx = _mm512_sub_ps(a.dx, b.dx);
+	r.dy = _mm512_sub_ps(a.dy, b.dy);
+	r.dz = _mm512_sub_ps(a.dz, b.dz);
+	return r;
+}
+
+A3_FRACTAL_TARGET("avx512f")
+a3dual_inline a3_FractalDual16 a3fractalDualMul_avx512(const a3_FractalDual16 a, const a3_FractalDual16 b)
+{
+	a3_FractalDual16 r;
+	r.v = _mm512_mul_ps(a.v, b.v);
+	r.dx = _mm512_add_ps(_mm512_mul_ps(a.dx, b.v), _mm512_mul_ps(a.v, b.dx));
+	r.dy = _mm512_add_ps(_mm512_mul_ps(a.dy, b.v), _mm512_mul_ps(a.v, b.dy));
+	r.dz = _mm512_add_ps(_mm512_mul_ps(a.dz, b.v), _mm512_mul_ps(a.v, b.dz));
+	return r;
+}
+
+A3_FRACTAL_TARGET("avx512f")
+a3dual_inline a3_FractalDual16 a3fractalDualAddC_avx512(const a3_FractalDual16 a, const __m512 c)
+{
+	a3_FractalDual16 r = a;
+	r.v = _mm512_add_ps(a.v, c);
+	return r;
+}
+
+A3_FRACTAL_TARGET("avx512f")
+a3dual_inline a3_FractalDual16 a3fractalDualCSub_avx512(const __m512 c, const a3_FractalDual16 a)
+{
+	const __m512 zero = _mm512_setzero_ps();
+	a3_FractalDual16 r;
+	r.v = _mm512_sub_ps(c, a.v);
+	r.dx = _mm512_sub_ps(zero, a.dx);
+	r.dy = _mm512_sub_ps(zero, a.dy);
+	r.dz = _mm512_sub_ps(zero, a.dz);
+	return r;
+}
+
+A3_FRACTAL_TARGET("avx512f")
+a3dual_inline a3_FractalDual16 a3fractalDualMulC_avx512(const a3_FractalDual16 a, const __m512 c)
+{
+	a3_FractalDual16 r;
+	r.v = _mm512_mul_ps(a.v, c);
+	r.dx = _mm512_mul_ps(a.dx, c);
+	r.dy = _mm512_mul_ps(a.dy, c);
+	r.dz = _mm512_mul_ps(a.dz, c);
+	return r;
+}
+
+A3_FRACTAL_TARGET("avx512f")
+a3dual_inline a3_FractalDual16 a3fractalDualDivC_avx512(const a3_FractalDual16 a, const __m512 c)
+{
+	a3_FractalDual16 r;
+	r.v = _mm512_div_ps(a.v, c);
+	r.dx = _mm512_div_ps(a.dx, c);
+	r.dy = _mm512_div_ps(a.dy, c);
+	r.dz = _mm512_div_ps(a.dz, c);
+	return r;
+}
+
+A3_FRACTAL_TARGET("avx512f")
+a3dual_inline a3_FractalDual16 a3fractalDualAbs_avx512(const a3_FractalDual16 a)
+{
+	const __mmask16 flip = _mm512_cmp_ps_mask(a.v, _mm512_setzero_ps(), _CMP_LT_OQ);
+	const __m512 zero = _mm512_setzero_ps();
+	a3_FractalDual16 r;
+	r.v = _mm512_abs_ps(a.v);
+	r.dx = _mm512_mask_sub_ps(a.dx, flip, zero, a.dx);
+	r.dy = _mm512_mask_sub_ps(a.dy, flip, zero, a.dy);
+	r.dz = _mm512_mask_sub_ps(a.dz, flip, zero, a.dz);
+	return r;
+}
+
+A3_FRACTAL_TARGET("avx512f")
+a3dual_inline a3_FractalDual16 a3fractalDualMin_avx512(const a3_FractalDual16 a, const a3_FractalDual16 b)
+{
+	return a3fractalDualBlend_avx512(_mm512_cmp_ps_mask(a.v, b.v, _CMP_LT_OQ), a, b);
+}
+
+A3_FRACTAL_TARGET("avx512f")
+a3dual_inline a3_FractalDual16 a3fractalDualMax_avx512(const a3_FractalDual16 a, const a3_FractalDual16 b)
+{
+	return a3fractalDualBlend_avx512(_mm512_cmp_ps_mask(a.v, b.v, _CMP_GT_OQ), a, b);
+}
+
+A3_FRACTAL_TARGET("avx512f")
+a3dual_inline a3_FractalDual16 a3fractalDualMaxC_avx512(const a3_FractalDual16 a, const __m512 c)
+{
+	const __mmask16 keep = _mm512_cmp_ps_mask(a.v, c, _CMP_GT_OQ);
+	a3_FractalDual16 r;
+	r.v = _mm512_mask_mov_ps(c, keep, a.v);
+	r.dx = _mm512_maskz_mov_ps(keep, a.dx);
+	r.dy = _mm512_maskz_mov_ps(keep, a.dy);
+	r.dz = _mm512_maskz_mov_ps(keep, a.dz);
+	return r;
+}
+
+A3_FRACTAL_TARGET("avx512f")
+a3dual_inline a3_FractalDual16 a3fractalDualSqrt_avx512(const a3_FractalDual16 a)
+{
+	a3_FractalDual16 r;
+	__m512 k;
+	r.v = _mm512_sqrt_ps(a.v);
+	k = _mm512_maskz_div_ps(_mm512_cmp_ps_mask(r.v, _mm512_setzero_ps(), _CMP_GT_OQ), _mm512_set1_ps(0.5f), r.v);
+	r.dx = _mm512_mul_ps(a.dx, k);
+	r.dy = _mm512_mul_ps(a.dy, k);
+	r.dz = _mm512_mul_ps(a.dz, k);
+	return r;
+}
+
+A3_FRACTAL_TARGET("avx512f")
+a3dual_inline a3_FractalDual16 a3fractalDualMod_avx512(const a3_FractalDual16 a, const float c, const float cInv)
+{
+	const __m512 t = _mm512_roundscale_ps(_mm512_mul_ps(a.v, _mm512_set1_ps(cInv)), _MM_FROUND_TO_NEG_INF | _MM_FROUND_NO_EXC);
+	a3_FractalDual16 r = a;
+	r.v = _mm512_sub_ps(a.v, _mm512_mul_ps(_mm512_set1_ps(c), t));
+	return r;
+}
+
+#endif	// A3_FRACTAL_AVX512
+
+#endif	// A3_FRACTAL_X86
+
+
+//-----------------------------------------------------------------------------
+
+
+#endif	// !__ANIMAL3D_DEMODUAL_H
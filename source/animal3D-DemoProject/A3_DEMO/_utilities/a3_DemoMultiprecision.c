@@ -0,0 +1,1013 @@
+/*
+	animal3D SDK: Minimal 3D Animation Framework
+	Fractals Midterm: CPU fractal engines
+
+	a3_DemoMultiprecision.c
+	Extended-precision arithmetic implementation.
+
+	Double-double and quad-double follow Hida, Li and Bailey's QD library
+	(the "sloppy" add and the O(eps^3) multiply); every operation is built
+	from the exact two-sum and two-product transforms. Two-product uses
+	Dekker's split so it does not depend on a fused multiply-add.
+*/
+
+#include "a3_DemoMultiprecision.h"
+
+#include "animal3D/a3/a3macros.h"
+#include "animal3D/a3utility/a3_Timer.h"
+
+#include <math.h>
+#include <stdio.h>
+#include <string.h>
+
+
+//-----------------------------------------------------------------------------
+// error-free transforms
+
+static double a3mpTwoSum(const double a, const double b, double *err)
+{
+	const double s = a + b;
+	const double v = s - a;
+	*err = (a - (s - v)) + (b - v);
+	return s;
+}
+
+// requires |a| >= |b|
+static double a3mpQuickTwoSum(const double a, const double b, double *err)
+{
+	const double s = a + b;
+	*err = b - (s - a);
+	return s;
+}
+
+static double a3mpTwoProd(const double a, const double b, double *err)
+{
+	const double split = 134217729.0;	// 2^27 + 1
+	const double p = a * b;
+	double t, ah, al, bh, bl;
+	t = split * a;
+	ah = t - (t - a);
+	al = a - ah;
+	t = split * b;
+	bh = t - (t - b);
+	bl = b - bh;
+	*err = ((ah * bh - p) + ah * bl + al * bh) + al * bl;
+	return p;
+}
+
+// (a, b, c) <- sum of three, largest first
+static void a3mpThreeSum(double *a, double *b, double *c)
+{
+	double t1, t2, t3;
+	t1 = a3mpTwoSum(*a, *b, &t2);
+	*a = a3mpTwoSum(*c, t1, &t3);
+	*b = a3mpTwoSum(t2, t3, c);
+}
+
+// (a, b) <- sum of three, third term dropped
+static void a3mpThreeSum2(double *a, double *b, const double c)
+{
+	double t1, t2, t3;
+	t1 = a3mpTwoSum(*a, *b, &t2);
+	*a = a3mpTwoSum(c, t1, &t3);
+	*b = t2 + t3;
+}
+
+
+//-----------------------------------------------------------------------------
+// double-double
+
+a3_DoubleDouble a3ddSet(double hi, double lo)
+{
+	a3_DoubleDouble r;
+	r.hi = a3mpTwoSum(hi, lo, &r.lo);
+	return r;
+}
+
+a3_DoubleDouble a3ddAdd(a3_DoubleDouble a, a3_DoubleDouble b)
+{
+	a3_DoubleDouble r;
+	double s1, s2, t1, t2;
+	s1 = a3mpTwoSum(a.hi, b.hi, &s2);
+	t1 = a3mpTwoSum(a.lo, b.lo, &t2);
+	s2 += t1;
+	s1 = a3mpQuickTwoSum(s1, s2, &s2);
+	s2 += t2;
+	r.hi = a3mpQuickTwoSum(s1, s2, &r.lo);
+	return r;
+}
+
+a3_DoubleDouble a3ddSub(a3_DoubleDouble a, a3_DoubleDouble b)
+{
+	b.hi = -b.hi;
+	b.lo = -b.lo;
+	return a3ddAdd(a, b);
+}
+
+a3_DoubleDouble a3ddMul(a3_DoubleDouble a, a3_DoubleDouble b)
+{
+	a3_DoubleDouble r;
+	double p, e;
+	p = a3mpTwoProd(a.hi, b.hi, &e);
+	e += a.hi * b.lo + a.lo * b.hi;
+	r.hi = a3mpQuickTwoSum(p, e, &r.lo);
+	return r;
+}
+
+a3_DoubleDouble a3ddMulD(a3_DoubleDouble a, double b)
+{
+	a3_DoubleDouble r;
+	double p, e;
+	p = a3mpTwoProd(a.hi, b, &e);
+	e += a.lo * b;
+	r.hi = a3mpQuickTwoSum(p, e, &r.lo);
+	return r;
+}
+
+a3_DoubleDouble a3ddSqr(a3_DoubleDouble a)
+{
+	a3_DoubleDouble r;
+	double p, e;
+	p = a3mpTwoProd(a.hi, a.hi, &e);
+	e += 2.0 * a.hi * a.lo + a.lo * a.lo;
+	r.hi = a3mpQuickTwoSum(p, e, &r.lo);
+	return r;
+}
+
+double a3ddGetDouble(a3_DoubleDouble a)
+{
+	return (a.hi + a.lo);
+}
+
+
+//-----------------------------------------------------------------------------
+// quad-double
+
+// renormalize five overlapping terms into four
+static a3_QuadDouble a3qdRenorm(double c0, double c1, double c2, double c3, double c4)
+{
+	a3_QuadDouble r;
+	double s0, s1, s2 = 0.0, s3 = 0.0;
+
+	s0 = a3mpQuickTwoSum(c3, c4, &c4);
+	s0 = a3mpQuickTwoSum(c2, s0, &c3);
+	s0 = a3mpQuickTwoSum(c1, s0, &c2);
+	c0 = a3mpQuickTwoSum(c0, s0, &c1);
+
+	s0 = c0;
+	s1 = c1;
+	if (s1 != 0.0)
+	{
+		s1 = a3mpQuickTwoSum(s1, c2, &s2);
+		if (s2 != 0.0)
+		{
+			s2 = a3mpQuickTwoSum(s2, c3, &s3);
+			if (s3 != 0.0)
+				s3 += c4;
+			else
+				s2 += c4;
+		}
+		else
+		{
+			s1 = a3mpQuickTwoSum(s1, c3, &s2);
+			if (s2 != 0.0)
+				s2 = a3mpQuickTwoSum(s2, c4, &s3);
+			else
+				s1 = a3mpQuickTwoSum(s1, c4, &s2);
+		}
+	}
+	else
+	{
+		s0 = a3mpQuickTwoSum(s0, c2, &s1);
+		if (s1 != 0.0)
+		{
+			s1 = a3mpQuickTwoSum(s1, c3, &s2);
+			if (s2 != 0.0)
+				s2 = a3mpQuickTwoSum(s2, c4, &s3);
+			else
+				s1 = a3mpQuickTwoSum(s1, c4, &s2);
+		}
+		else
+		{
+			s0 = a3mpQuickTwoSum(s0, c3, &s1);
+			if (s1 != 0.0)
+				s1 = a3mpQuickTwoSum(s1, c4, &s2);
+			else
+				s0 = a3mpQuickTwoSum(s0, c4, &s1);
+		}
+	}
+
+	r.x[0] = s0;
+	r.x[1] = s1;
+	r.x[2] = s2;
+	r.x[3] = s3;
+	return r;
+}
+
+a3_QuadDouble a3qdSetDD(a3_DoubleDouble a)
+{
+	a3_QuadDouble r;
+	r.x[0] = a.hi;
+	r.x[1] = a.lo;
+	r.x[2] = r.x[3] = 0.0;
+	return r;
+}
+
+a3_QuadDouble a3qdAdd(a3_QuadDouble a, a3_QuadDouble b)
+{
+	double s0, s1, s2, s3, t0, t1, t2, t3;
+	s0 = a3mpTwoSum(a.x[0], b.x[0], &t0);
+	s1 = a3mpTwoSum(a.x[1], b.x[1], &t1);
+	s2 = a3mpTwoSum(a.x[2], b.x[2], &t2);
+	s3 = a3mpTwoSum(a.x[3], b.x[3], &t3);
+
+	s1 = a3mpTwoSum(s1, t0, &t0);
+	a3mpThreeSum(&s2, &t0, &t1);
+	a3mpThreeSum2(&s3, &t0, t2);
+	t0 = t0 + t1 + t3;
+	return a3qdRenorm(s0, s1, s2, s3, t0);
+}
+
+a3_QuadDouble a3qdSub(a3_QuadDouble a, a3_QuadDouble b)
+{
+	b.x[0] = -b.x[0];
+	b.x[1] = -b.x[1];
+	b.x[2] = -b.x[2];
+	b.x[3] = -b.x[3];
+	return a3qdAdd(a, b);
+}
+
+a3_QuadDouble a3qdMul(a3_QuadDouble a, a3_QuadDouble b)
+{
+	double p0, p1, p2, p3, p4, p5, q0, q1, q2, q3, q4, q5;
+	double s0, s1, s2, t0, t1;
+
+	p0 = a3mpTwoProd(a.x[0], b.x[0], &q0);
+	p1 = a3mpTwoProd(a.x[0], b.x[1], &q1);
+	p2 = a3mpTwoProd(a.x[1], b.x[0], &q2);
+	p3 = a3mpTwoProd(a.x[0], b.x[2], &q3);
+	p4 = a3mpTwoProd(a.x[1], b.x[1], &q4);
+	p5 = a3mpTwoProd(a.x[2], b.x[0], &q5);
+
+	// O(eps) terms
+	a3mpThreeSum(&p1, &p2, &q0);
+
+	// O(eps^2) terms: (p2, q1, q2) + (p3, p4, p5)
+	a3mpThreeSum(&p2, &q1, &q2);
+	a3mpThreeSum(&p3, &p4, &p5);
+	s0 = a3mpTwoSum(p2, p3, &t0);
+	s1 = a3mpTwoSum(q1, p4, &t1);
+	s2 = q2 + p5;
+	s1 = a3mpTwoSum(s1, t0, &t0);
+	s2 += (t0 + t1);
+
+	// O(eps^3) terms
+	s1 += a.x[0] * b.x[3] + a.x[1] * b.x[2] + a.x[2] * b.x[1] + a.x[3] * b.x[0] + q0 + q3 + q4 + q5;
+	return a3qdRenorm(p0, p1, s0, s1, s2);
+}
+
+a3_QuadDouble a3qdMulD(a3_QuadDouble a, double b)
+{
+	double p0, p1, p2, p3, q0, q1, q2, s1, s2, s3, s4;
+	p0 = a3mpTwoProd(a.x[0], b, &q0);
+	p1 = a3mpTwoProd(a.x[1], b, &q1);
+	p2 = a3mpTwoProd(a.x[2], b, &q2);
+	p3 = a.x[3] * b;
+
+	s1 = a3mpTwoSum(q0, p1, &s2);
+	a3mpThreeSum(&s2, &q1, &p2);
+	a3mpThreeSum2(&q1, &q2, p3);
+	s3 = q1;
+	s4 = q2 + p2;
+	return a3qdRenorm(p0, s1, s2, s3, s4);
+}
+
+a3_QuadDouble a3qdSqr(a3_QuadDouble a)
+{
+	return a3qdMul(a, a);
+}
+
+a3_DoubleDouble a3qdGetDD(a3_QuadDouble a)
+{
+	a3_DoubleDouble r;
+	r.hi = a3mpQuickTwoSum(a.x[0], a.x[1] + (a.x[2] + a.x[3]), &r.lo);
+	return r;
+}
+
+double a3qdGetDouble(a3_QuadDouble a)
+{
+	return (a.x[0] + (a.x[1] + (a.x[2] + a.x[3])));
+}
+
+
+//-----------------------------------------------------------------------------
+// limb arithmetic: little-endian magnitudes
+
+typedef unsigned long long a3_MPWide;
+
+// Karatsuba threshold in effect
+static unsigned int a3mpKaratsubaThreshold = a3mp_karatsubaThreshold;
+
+
+// r = a + b over n limbs; returns carry
+static unsigned int a3mpLimbAdd(unsigned int *r, const unsigned int *a, const unsigned int *b, const unsigned int n)
+{
+	a3_MPWide t = 0;
+	unsigned int i;
+	for (i = 0; i < n; ++i)
+	{
+		t += (a3_MPWide)a[i] + b[i];
+		r[i] = (unsigned int)t;
+		t >>= 32;
+	}
+	return (unsigned int)t;
+}
+
+// r = a - b over n limbs, a >= b; returns borrow
+static unsigned int a3mpLimbSub(unsigned int *r, const unsigned int *a, const unsigned int *b, const unsigned int n)
+{
+	a3_MPWide t;
+	unsigned int i, borrow = 0;
+	for (i = 0; i < n; ++i)
+	{
+		t = (a3_MPWide)a[i] - b[i] - borrow;
+		r[i] = (unsigned int)t;
+		borrow = (unsigned int)(t >> 63);
+	}
+	return borrow;
+}
+
+// r[0..n) -= b[0..m) with borrow propagated, m <= n
+static void a3mpLimbSubInPlace(unsigned int *r, const unsigned int *b, const unsigned int m, const unsigned int n)
+{
+	a3_MPWide t;
+	unsigned int i, borrow = 0;
+	for (i = 0; i < n && (i < m || borrow); ++i)
+	{
+		t = (a3_MPWide)r[i] - (i < m ? b[i] : 0) - borrow;
+		r[i] = (unsigned int)t;
+		borrow = (unsigned int)(t >> 63);
+	}
+}
+
+// r[0..n) += b[0..m) with carry propagated, m <= n
+static void a3mpLimbAddInPlace(unsigned int *r, const unsigned int *b, const unsigned int m, const unsigned int n)
+{
+	a3_MPWide t = 0;
+	unsigned int i;
+	for (i = 0; i < n && (i < m || t); ++i)
+	{
+		t += (a3_MPWide)r[i] + (i < m ? b[i] : 0);
+		r[i] = (unsigned int)t;
+		t >>= 32;
+	}
+}
+
+// compare magnitudes from the top
+static int a3mpLimbCompare(const unsigned int *a, const unsigned int *b, unsigned int n)
+{
+	while (n-- > 0)
+		if (a[n] != b[n])
+			return (a[n] > b[n] ? 1 : -1);
+	return 0;
+}
+
+// r[0..2n) = a * b, schoolbook
+static void a3mpLimbMulSchool(unsigned int *r, const unsigned int *a, const unsigned int *b, const unsigned int n)
+{
+	a3_MPWide t;
+	unsigned int i, j;
+	memset(r, 0, 2 * n * sizeof(unsigned int));
+	for (i = 0; i < n; ++i)
+	{
+		t = 0;
+		for (j = 0; j < n; ++j)
+		{
+			t += (a3_MPWide)a[i] * b[j] + r[i + j];
+			r[i + j] = (unsigned int)t;
+			t >>= 32;
+		}
+		r[i + n] = (unsigned int)t;
+	}
+}
+
+// r[0..2n) = a^2, schoolbook; cross products computed once and doubled
+static void a3mpLimbSqrSchool(unsigned int *r, const unsigned int *a, const unsigned int n)
+{
+	a3_MPWide t;
+	unsigned int i, j;
+	memset(r, 0, 2 * n * sizeof(unsigned int));
+	for (i = 0; i < n; ++i)
+	{
+		t = 0;
+		for (j = i + 1; j < n; ++j)
+		{
+			t += (a3_MPWide)a[i] * a[j] + r[i + j];
+			r[i + j] = (unsigned int)t;
+			t >>= 32;
+		}
+		r[i + n] = (unsigned int)t;
+	}
+
+	// double, then add the diagonal
+	for (i = 2 * n - 1; i > 0; --i)
+		r[i] = (r[i] << 1) | (r[i - 1] >> 31);
+	r[0] <<= 1;
+	for (i = 0, t = 0; i < n; ++i)
+	{
+		t += (a3_MPWide)a[i] * a[i] + r[2 * i];
+		r[2 * i] = (unsigned int)t;
+		t >>= 32;
+		t += r[2 * i + 1];
+		r[2 * i + 1] = (unsigned int)t;
+		t >>= 32;
+	}
+}
+
+// r[0..2n) = a * b (or a^2 if b is null), Karatsuba down to 'threshold'
+//	a = a1 B^m + a0, b = b1 B^m + b0
+//	a b = a1 b1 B^2m + ((a0 + a1)(b0 + b1) - a0 b0 - a1 b1) B^m + a0 b0
+static void a3mpLimbMulKaratsuba(unsigned int *r, const unsigned int *a, const unsigned int *b, const unsigned int n, const unsigned int threshold)
+{
+	unsigned int sa[a3mp_fixedLimbMax / 2 + 2], sb[a3mp_fixedLimbMax / 2 + 2];
+	unsigned int t[a3mp_fixedLimbMax + 4];
+	unsigned int m, h;
+
+	if (n < threshold || n < 4)
+	{
+		if (b)
+			a3mpLimbMulSchool(r, a, b, n);
+		else
+			a3mpLimbSqrSchool(r, a, n);
+		return;
+	}
+
+	m = n / 2;
+	h = n - m;
+
+	// low and high products straight into the result
+	a3mpLimbMulKaratsuba(r, a, b, m, threshold);
+	a3mpLimbMulKaratsuba(r + 2 * m, a + m, b ? b + m : 0, h, threshold);
+
+	// middle product from sums of halves, h + 1 limbs each
+	memset(sa, 0, (h + 1) * sizeof(unsigned int));
+	memcpy(sa, a + m, h * sizeof(unsigned int));
+	a3mpLimbAddInPlace(sa, a, m, h + 1);
+	if (b)
+	{
+		memset(sb, 0, (h + 1) * sizeof(unsigned int));
+		memcpy(sb, b + m, h * sizeof(unsigned int));
+		a3mpLimbAddInPlace(sb, b, m, h + 1);
+	}
+	a3mpLimbMulKaratsuba(t, sa, b ? sb : 0, h + 1, threshold);
+	a3mpLimbSubInPlace(t, r, 2 * m, 2 * h + 2);
+	a3mpLimbSubInPlace(t, r + 2 * m, 2 * h, 2 * h + 2);
+
+	// middle term fits below 2^(32 (n + h + 1)), add what overlaps
+	a3mpLimbAddInPlace(r + m, t, a3minimum(2 * h + 2, 2 * n - m), 2 * n - m);
+}
+
+// full product of magnitudes
+static void a3mpLimbProduct(unsigned int *r, const unsigned int *a, const unsigned int *b, const unsigned int n)
+{
+	a3mpLimbMulKaratsuba(r, a, b, n, a3mpKaratsubaThreshold);
+}
+
+
+//-----------------------------------------------------------------------------
+// fixed-point
+
+#define a3mp_limbScale		4294967296.0		// 2^32
+#define a3mp_limbScaleInv	(1.0 / 4294967296.0)
+#define a3mp_guardBits		64
+
+// clear sign of zero so equal values compare equal
+static void a3mpFixedNormalize(a3_MPFixed *a)
+{
+	unsigned int i;
+	if (a->negative)
+	{
+		for (i = 0; i < a->limbs && !a->limb[i]; ++i);
+		if (i == a->limbs)
+			a->negative = 0;
+	}
+}
+
+unsigned int a3mpFixedLimbsForSpacing(double spacing)
+{
+	double bits;
+	unsigned int limbs;
+	if (!(spacing > 0.0))
+		return a3mp_fixedLimbMax;
+	bits = -log2(spacing) + a3mp_guardBits;
+	limbs = bits > 0.0 ? (unsigned int)ceil(bits / 32.0) + 1 : 2;
+	return (limbs < 2 ? 2 : limbs > a3mp_fixedLimbMax ? a3mp_fixedLimbMax : limbs);
+}
+
+int a3mpFixedSetDouble(a3_MPFixed *out, unsigned int limbs, double value)
+{
+	double whole;
+	unsigned int i;
+	if (out && limbs >= 2 && limbs <= a3mp_fixedLimbMax && fabs(value) < a3mp_limbScale)
+	{
+		out->limbs = limbs;
+		out->negative = (value < 0.0);
+		value = fabs(value);
+		memset(out->limb, 0, limbs * sizeof(unsigned int));
+
+		// 53 bits span at most 3 limbs, so this loop is exact
+		whole = floor(value);
+		out->limb[limbs - 1] = (unsigned int)whole;
+		value -= whole;
+		for (i = limbs - 1; i-- > 0 && value > 0.0; )
+		{
+			value *= a3mp_limbScale;
+			whole = floor(value);
+			out->limb[i] = (unsigned int)whole;
+			value -= whole;
+		}
+		a3mpFixedNormalize(out);
+		return 1;
+	}
+	return -1;
+}
+
+int a3mpFixedSetDD(a3_MPFixed *out, unsigned int limbs, a3_DoubleDouble value)
+{
+	if (a3mpFixedSetDouble(out, limbs, value.hi) > 0)
+		return a3mpFixedAddDouble(out, out, value.lo);
+	return -1;
+}
+
+int a3mpFixedSetString(a3_MPFixed *out, unsigned int limbs, const char *str)
+{
+	const char *c, *fraction, *end;
+	unsigned int whole = 0;
+	int negative = 0;
+
+	if (out && str && limbs >= 2 && limbs <= a3mp_fixedLimbMax)
+	{
+		c = str;
+		while (*c == ' ' || *c == '\t')
+			++c;
+		if (*c == '-' || *c == '+')
+			negative = (*c++ == '-');
+		for (; *c >= '0' && *c <= '9'; ++c)
+			whole = whole * 10 + (unsigned int)(*c - '0');
+		fraction = end = c;
+		if (*c == '.')
+			for (fraction = end = ++c; *end >= '0' && *end <= '9'; ++end);
+
+		// Horner from the last digit: f = (d + f) / 10
+		out->limbs = limbs;
+		out->negative = 0;
+		memset(out->limb, 0, limbs * sizeof(unsigned int));
+		for (c = end; c-- > fraction; )
+		{
+			out->limb[limbs - 1] = (unsigned int)(*c - '0');
+			a3mpFixedDivInt(out, out, 10);
+		}
+		out->limb[limbs - 1] = whole;
+		out->negative = negative;
+		a3mpFixedNormalize(out);
+		return (int)(end - str);
+	}
+	return -1;
+}
+
+int a3mpFixedResize(a3_MPFixed *out, const a3_MPFixed *a, unsigned int limbs)
+{
+	unsigned int keep;
+	if (out && a && limbs >= 2 && limbs <= a3mp_fixedLimbMax)
+	{
+		// align integer limbs, keep the most significant fraction limbs
+		keep = a3minimum(limbs, a->limbs);
+		memmove(out->limb + limbs - keep, a->limb + a->limbs - keep, keep * sizeof(unsigned int));
+		memset(out->limb, 0, (limbs - keep) * sizeof(unsigned int));
+		out->negative = a->negative;
+		out->limbs = limbs;
+		a3mpFixedNormalize(out);
+		return 1;
+	}
+	return -1;
+}
+
+double a3mpFixedGetDouble(const a3_MPFixed *a)
+{
+	return a3ddGetDouble(a3mpFixedGetDD(a));
+}
+
+a3_DoubleDouble a3mpFixedGetDD(const a3_MPFixed *a)
+{
+	a3_DoubleDouble r = { 0.0, 0.0 }, limb;
+	double scale = 1.0;
+	unsigned int i, n;
+	if (a)
+	{
+		// the leading limb may hold a single bit, so 5 limbs are needed to
+		//	cover the 106 bits of a double-double
+		for (i = a->limbs, n = 0; i-- > 0 && n < 5; ++n, scale *= a3mp_limbScaleInv)
+		{
+			limb.hi = (double)a->limb[i] * scale;
+			limb.lo = 0.0;
+			r = a3ddAdd(r, limb);
+		}
+		if (a->negative)
+		{
+			r.hi = -r.hi;
+			r.lo = -r.lo;
+		}
+	}
+	return r;
+}
+
+a3_QuadDouble a3mpFixedGetQD(const a3_MPFixed *a)
+{
+	a3_QuadDouble r = { { 0.0, 0.0, 0.0, 0.0 } }, limb = { { 0.0, 0.0, 0.0, 0.0 } };
+	double scale = 1.0;
+	unsigned int i, n;
+	if (a)
+	{
+		// 8 limbs cover the 212 bits of a quad-double, even when the
+		//	leading limb holds a single bit
+		for (i = a->limbs, n = 0; i-- > 0 && n < 8; ++n, scale *= a3mp_limbScaleInv)
+		{
+			limb.x[0] = (double)a->limb[i] * scale;
+			r = a3qdAdd(r, limb);
+		}
+		if (a->negative)
+			r = a3qdMulD(r, -1.0);
+	}
+	return r;
+}
+
+int a3mpFixedEqual(const a3_MPFixed *a, const a3_MPFixed *b)
+{
+	if (a && b)
+		return (a->limbs == b->limbs && a->negative == b->negative &&
+			!memcmp(a->limb, b->limb, a->limbs * sizeof(unsigned int)));
+	return -1;
+}
+
+int a3mpFixedAdd(a3_MPFixed *out, const a3_MPFixed *a, const a3_MPFixed *b)
+{
+	const a3_MPFixed *t;
+	if (out && a && b && a->limbs == b->limbs)
+	{
+		if (a->negative == b->negative)
+		{
+			out->negative = a->negative;
+			a3mpLimbAdd(out->limb, a->limb, b->limb, a->limbs);
+		}
+		else
+		{
+			// subtract smaller magnitude from larger, take its sign
+			if (a3mpLimbCompare(a->limb, b->limb, a->limbs) < 0)
+			{
+				t = a;
+				a = b;
+				b = t;
+			}
+			out->negative = a->negative;
+			a3mpLimbSub(out->limb, a->limb, b->limb, a->limbs);
+		}
+		out->limbs = a->limbs;
+		a3mpFixedNormalize(out);
+		return 1;
+	}
+	return -1;
+}
+
+int a3mpFixedSub(a3_MPFixed *out, const a3_MPFixed *a, const a3_MPFixed *b)
+{
+	a3_MPFixed nb[1];
+	if (out && a && b && a->limbs == b->limbs)
+	{
+		nb->limbs = b->limbs;
+		nb->negative = !b->negative;
+		memcpy(nb->limb, b->limb, b->limbs * sizeof(unsigned int));
+		return a3mpFixedAdd(out, a, nb);
+	}
+	return -1;
+}
+
+int a3mpFixedMul(a3_MPFixed *out, const a3_MPFixed *a, const a3_MPFixed *b)
+{
+	unsigned int product[a3mp_fixedLimbMax * 2];
+	unsigned int n;
+	if (out && a && b && a->limbs == b->limbs)
+	{
+		// keep product limbs [n - 1, 2n - 1): one integer limb, n - 1 fraction
+		n = a->limbs;
+		a3mpLimbProduct(product, a->limb, b->limb, n);
+		out->negative = a->negative != b->negative;
+		out->limbs = n;
+		memcpy(out->limb, product + n - 1, n * sizeof(unsigned int));
+		a3mpFixedNormalize(out);
+		return 1;
+	}
+	return -1;
+}
+
+int a3mpFixedSqr(a3_MPFixed *out, const a3_MPFixed *a)
+{
+	unsigned int product[a3mp_fixedLimbMax * 2];
+	unsigned int n;
+	if (out && a)
+	{
+		n = a->limbs;
+		a3mpLimbProduct(product, a->limb, 0, n);
+		out->negative = 0;
+		out->limbs = n;
+		memcpy(out->limb, product + n - 1, n * sizeof(unsigned int));
+		return 1;
+	}
+	return -1;
+}
+
+int a3mpFixedMulInt(a3_MPFixed *out, const a3_MPFixed *a, unsigned int b)
+{
+	a3_MPWide t = 0;
+	unsigned int i;
+	if (out && a)
+	{
+		for (i = 0; i < a->limbs; ++i)
+		{
+			t += (a3_MPWide)a->limb[i] * b;
+			out->limb[i] = (unsigned int)t;
+			t >>= 32;
+		}
+		out->negative = a->negative;
+		out->limbs = a->limbs;
+		a3mpFixedNormalize(out);
+		return 1;
+	}
+	return -1;
+}
+
+int a3mpFixedDivInt(a3_MPFixed *out, const a3_MPFixed *a, unsigned int b)
+{
+	a3_MPWide t = 0;
+	unsigned int i;
+	if (out && a && b)
+	{
+		for (i = a->limbs; i-- > 0; )
+		{
+			t = (t << 32) | a->limb[i];
+			out->limb[i] = (unsigned int)(t / b);
+			t %= b;
+		}
+		out->negative = a->negative;
+		out->limbs = a->limbs;
+		a3mpFixedNormalize(out);
+		return 1;
+	}
+	return -1;
+}
+
+int a3mpFixedAddDouble(a3_MPFixed *out, const a3_MPFixed *a, double b)
+{
+	a3_MPFixed fb[1];
+	if (out && a && a3mpFixedSetDouble(fb, a->limbs, b) > 0)
+		return a3mpFixedAdd(out, a, fb);
+	return -1;
+}
+
+unsigned int a3mpSetKaratsubaThreshold(unsigned int limbs)
+{
+	const unsigned int previous = a3mpKaratsubaThreshold;
+	a3mpKaratsubaThreshold = limbs < 4 ? 4 : limbs;
+	return previous;
+}
+
+unsigned int a3mpGetKaratsubaThreshold()
+{
+	return a3mpKaratsubaThreshold;
+}
+
+
+//-----------------------------------------------------------------------------
+// benchmark
+
+// benchmark operations on one type
+enum a3_MPBenchmarkOp
+{
+	a3mp_benchMulSchool,
+	a3mp_benchMulKaratsuba,
+	a3mp_benchMul,
+	a3mp_benchSqr,
+	a3mp_benchAdd,
+	a3mp_benchOrbitStep,
+};
+
+// results are stored here so benchmark loops are not optimized away
+static volatile double a3mpBenchmarkSink;
+
+// run one operation 'count' times
+//	limbs: fixed-point limb count, or 0 for double-double, 1 for quad-double
+static void a3mpBenchmarkBatch(const unsigned int limbs, const int op, const unsigned int count)
+{
+	unsigned int product[a3mp_fixedLimbMax * 2];
+	a3_MPFixed x[1], y[1], cx[1], cy[1], x2[1], y2[1], xy[1];
+	a3_DoubleDouble dx, dy, dcx, dcy, dx2, dy2, dxy;
+	a3_QuadDouble qx, qy, qcx, qcy, qx2, qy2, qxy;
+	unsigned int i;
+
+	// a point inside the set keeps the orbit bounded for any count
+	if (limbs >= 2)
+	{
+		a3mpFixedSetDouble(cx, limbs, -0.0625);
+		a3mpFixedSetDouble(cy, limbs, 0.03125);
+		a3mpFixedAddDouble(cx, cx, 1.0e-30);
+		memset(product, 0, sizeof(product));
+		*x = *x2 = *y2 = *xy = *cx;
+		*y = *cy;
+		for (i = 0; i < count; ++i)
+		{
+			switch (op)
+			{
+			case a3mp_benchMulSchool:
+				a3mpLimbMulSchool(product, x->limb, y->limb, limbs);
+				break;
+			case a3mp_benchMulKaratsuba:
+				a3mpLimbMulKaratsuba(product, x->limb, y->limb, limbs, 4);
+				break;
+			case a3mp_benchMul:
+				a3mpFixedMul(xy, x, y);
+				break;
+			case a3mp_benchSqr:
+				a3mpFixedSqr(x2, x);
+				break;
+			case a3mp_benchAdd:
+				a3mpFixedAdd(xy, x, y);
+				break;
+			case a3mp_benchOrbitStep:
+				// z' = (3x^2 - y^2, 6xy) + c
+				a3mpFixedSqr(x2, x);
+				a3mpFixedSqr(y2, y);
+				a3mpFixedMul(xy, x, y);
+				a3mpFixedMulInt(x2, x2, 3);
+				a3mpFixedSub(x2, x2, y2);
+				a3mpFixedAdd(x, x2, cx);
+				a3mpFixedMulInt(xy, xy, 6);
+				a3mpFixedAdd(y, xy, cy);
+				break;
+			}
+		}
+		a3mpBenchmarkSink = (double)product[limbs] + a3mpFixedGetDouble(x) + a3mpFixedGetDouble(xy) + a3mpFixedGetDouble(x2);
+	}
+	else if (limbs == 0)
+	{
+		dcx = a3ddSet(-0.0625, 1.0e-30);
+		dcy = a3ddSet(0.03125, 0.0);
+		dx = dcx;
+		dy = dcy;
+		dxy = dx2 = dx;
+		for (i = 0; i < count; ++i)
+		{
+			switch (op)
+			{
+			case a3mp_benchMul:
+				dxy = a3ddMul(dx, dxy);
+				break;
+			case a3mp_benchSqr:
+				dx2 = a3ddSqr(dx2);
+				break;
+			case a3mp_benchAdd:
+				dxy = a3ddAdd(dx, dxy);
+				break;
+			case a3mp_benchOrbitStep:
+				dx2 = a3ddSqr(dx);
+				dy2 = a3ddSqr(dy);
+				dxy = a3ddMul(dx, dy);
+				dx = a3ddAdd(a3ddSub(a3ddMulD(dx2, 3.0), dy2), dcx);
+				dy = a3ddAdd(a3ddMulD(dxy, 6.0), dcy);
+				break;
+			}
+		}
+		a3mpBenchmarkSink = dx.hi + dxy.hi + dx2.hi;
+	}
+	else
+	{
+		qcx = a3qdSetDD(a3ddSet(-0.0625, 1.0e-30));
+		qcy = a3qdSetDD(a3ddSet(0.03125, 0.0));
+		qx = qcx;
+		qy = qcy;
+		qxy = qx2 = qx;
+		for (i = 0; i < count; ++i)
+		{
+			switch (op)
+			{
+			case a3mp_benchMul:
+				qxy = a3qdMul(qx, qxy);
+				break;
+			case a3mp_benchSqr:
+				qx2 = a3qdSqr(qx2);
+				break;
+			case a3mp_benchAdd:
+				qxy = a3qdAdd(qx, qxy);
+				break;
+			case a3mp_benchOrbitStep:
+				qx2 = a3qdSqr(qx);
+				qy2 = a3qdSqr(qy);
+				qxy = a3qdMul(qx, qy);
+				qx = a3qdAdd(a3qdSub(a3qdMulD(qx2, 3.0), qy2), qcx);
+				qy = a3qdAdd(a3qdMulD(qxy, 6.0), qcy);
+				break;
+			}
+		}
+		a3mpBenchmarkSink = qx.x[0] + qxy.x[0] + qx2.x[0];
+	}
+}
+
+// time one operation: grow the batch until it takes long enough
+static double a3mpBenchmarkTime(const unsigned int limbs, const int op, const double seconds)
+{
+	a3_Timer timer[1] = { 0 };
+	unsigned int count = 64;
+	double elapsed;
+	for (;;)
+	{
+		a3timerSet(timer, 0.0);
+		a3timerStart(timer);
+		a3mpBenchmarkBatch(limbs, op, count);
+		a3timerStop(timer);
+		elapsed = timer->currentTick;
+		if (elapsed >= seconds || count >= 0x40000000)
+			return (elapsed * 1.0e9 / (double)count);
+		count *= elapsed > seconds * 0.01 ? (unsigned int)(seconds / elapsed) + 1 : 16;
+	}
+}
+
+int a3mpBenchmarkRun(a3_MPBenchmark *results_out, unsigned int count, double seconds)
+{
+	a3_MPBenchmark *result = results_out;
+	unsigned int limbs, n = 0;
+
+	if (results_out && count)
+	{
+		if (seconds <= 0.0)
+			seconds = 0.01;
+
+		// double-double and quad-double
+		for (limbs = 0; limbs < 2 && n < count; ++limbs, ++n, ++result)
+		{
+			memset(result, 0, sizeof(a3_MPBenchmark));
+			result->name = limbs ? "quad-double" : "double-double";
+			result->digits = limbs ? 64.0 : 32.0;
+			result->mul = a3mpBenchmarkTime(limbs, a3mp_benchMul, seconds);
+			result->sqr = a3mpBenchmarkTime(limbs, a3mp_benchSqr, seconds);
+			result->add = a3mpBenchmarkTime(limbs, a3mp_benchAdd, seconds);
+			result->orbitStep = a3mpBenchmarkTime(limbs, a3mp_benchOrbitStep, seconds);
+		}
+
+		// fixed-point at 2, 3, 4, 6, 8, 12...
+		for (limbs = 2; limbs <= a3mp_fixedLimbMax && n < count; ++n, ++result)
+		{
+			result->name = "fixed";
+			result->limbs = limbs;
+			result->digits = (double)(32 * (limbs - 1)) * 0.30102999566398120;
+			result->mulSchool = a3mpBenchmarkTime(limbs, a3mp_benchMulSchool, seconds);
+			result->mulKaratsuba = a3mpBenchmarkTime(limbs, a3mp_benchMulKaratsuba, seconds);
+			result->mul = a3mpBenchmarkTime(limbs, a3mp_benchMul, seconds);
+			result->sqr = a3mpBenchmarkTime(limbs, a3mp_benchSqr, seconds);
+			result->add = a3mpBenchmarkTime(limbs, a3mp_benchAdd, seconds);
+			result->orbitStep = a3mpBenchmarkTime(limbs, a3mp_benchOrbitStep, seconds);
+
+			// alternate x1.5 and x1.333 to double every two entries
+			limbs = (limbs & (limbs - 1)) ? limbs / 3 * 4 : limbs / 2 * 3;
+		}
+		return (int)n;
+	}
+	return -1;
+}
+
+int a3mpBenchmarkPrint(const a3_MPBenchmark *results, unsigned int count)
+{
+	const a3_MPBenchmark *result = results, *previous = 0;
+	unsigned int i;
+
+	if (results)
+	{
+		printf("\n A3 Multiprecision benchmark (ns per op, Karatsuba above %u limbs):", a3mpKaratsubaThreshold);
+		printf("\n %-14s %5s %6s %10s %10s %10s %10s %10s %10s %12s",
+			"type", "limbs", "digits", "school", "karatsuba", "mul", "sqr", "add", "step", "step/decade");
+		for (i = 0; i < count; ++i, ++result)
+		{
+			printf("\n %-14s %5u %6.0f %10.1f %10.1f %10.1f %10.1f %10.1f %10.1f",
+				result->name, result->limbs, result->digits,
+				result->mulSchool, result->mulKaratsuba, result->mul, result->sqr, result->add, result->orbitStep);
+
+			// marginal cost of an extra decade of zoom between fixed sizes
+			if (previous && previous->limbs && result->limbs)
+				printf(" %12.2f", (result->orbitStep - previous->orbitStep) / (result->digits - previous->digits));
+			previous = result;
+		}
+		printf("\n");
+		return 1;
+	}
+	return -1;
+}
+
+
+//-----------------------------------------------------------------------------
@@ -0,0 +1,213 @@
+/*
+	animal3D SDK: Minimal 3D Animation Framework
+	Fractals Midterm: CPU fractal engines
+
+	a3_DemoMultiprecision.h
+	Self-contained extended-precision arithmetic for deep-zoom references.
+
+	Three types, in order of range:
+		double-double: unevaluated sum of 2 doubles, about 106 bits
+		quad-double: unevaluated sum of 4 doubles, about 212 bits
+		fixed-point: sign and magnitude in 32-bit limbs, one integer limb
+			and any number of fraction limbs up to 'a3mp_fixedLimbMax'
+	Fixed-point multiplication is schoolbook below a limb-count threshold
+	and Karatsuba above it; the threshold can be tuned at runtime using the
+	benchmark, which also shows what each extra decade of zoom costs.
+*/
+
+#ifndef __ANIMAL3D_DEMOMULTIPRECISION_H
+#define __ANIMAL3D_DEMOMULTIPRECISION_H
+
+
+//-----------------------------------------------------------------------------
+
+#ifdef __cplusplus
+extern "C"
+{
+#else	// !__cplusplus
+	typedef struct a3_DoubleDouble				a3_DoubleDouble;
+	typedef struct a3_QuadDouble				a3_QuadDouble;
+	typedef struct a3_MPFixed					a3_MPFixed;
+	typedef struct a3_MPBenchmark				a3_MPBenchmark;
+#endif	// __cplusplus
+
+
+//-----------------------------------------------------------------------------
+
+	// most limbs in a fixed-point number (integer limb included); 128
+	//	limbs hold 4064 fraction bits, good to about 1e-1200
+#define a3mp_fixedLimbMax				128
+
+	// default limb count at which multiplication switches to Karatsuba
+#define a3mp_karatsubaThreshold			24
+
+
+	// double-double: value is hi + lo, |lo| <= ulp(hi) / 2
+	struct a3_DoubleDouble
+	{
+		double hi, lo;
+	};
+
+	// quad-double: value is x[0] + x[1] + x[2] + x[3], non-overlapping
+	struct a3_QuadDouble
+	{
+		double x[4];
+	};
+
+	// fixed-point number
+	//	member limbs: limbs in use, including the integer limb
+	//	member negative: sign flag
+	//	member limb: magnitude, least significant first; the last limb in
+	//		use is the integer part, the rest are successive 2^-32 digits
+	struct a3_MPFixed
+	{
+		unsigned int limbs;
+		int negative;
+		unsigned int limb[a3mp_fixedLimbMax];
+	};
+
+
+	// benchmark result for one number type, times in nanoseconds
+	//	member name: type name
+	//	member limbs: fixed-point limbs, 0 for double-based types
+	//	member digits: decimal digits of precision
+	//	member mulSchool: multiply, schoolbook only
+	//	member mulKaratsuba: multiply, Karatsuba at every level possible
+	//	member mul: multiply at current threshold
+	//	member sqr: square at current threshold
+	//	member add: add
+	//	member orbitStep: one step of the Mandelbrot shader's map
+	struct a3_MPBenchmark
+	{
+		const char *name;
+		unsigned int limbs;
+		double digits;
+		double mulSchool, mulKaratsuba;
+		double mul, sqr, add;
+		double orbitStep;
+	};
+
+
+//-----------------------------------------------------------------------------
+// double-double
+
+	a3_DoubleDouble a3ddSet(double hi, double lo);
+	a3_DoubleDouble a3ddAdd(a3_DoubleDouble a, a3_DoubleDouble b);
+	a3_DoubleDouble a3ddSub(a3_DoubleDouble a, a3_DoubleDouble b);
+	a3_DoubleDouble a3ddMul(a3_DoubleDouble a, a3_DoubleDouble b);
+	a3_DoubleDouble a3ddMulD(a3_DoubleDouble a, double b);
+	a3_DoubleDouble a3ddSqr(a3_DoubleDouble a);
+	double a3ddGetDouble(a3_DoubleDouble a);
+
+
+//-----------------------------------------------------------------------------
+// quad-double
+
+	a3_QuadDouble a3qdSetDD(a3_DoubleDouble a);
+	a3_QuadDouble a3qdAdd(a3_QuadDouble a, a3_QuadDouble b);
+	a3_QuadDouble a3qdSub(a3_QuadDouble a, a3_QuadDouble b);
+	a3_QuadDouble a3qdMul(a3_QuadDouble a, a3_QuadDouble b);
+	a3_QuadDouble a3qdMulD(a3_QuadDouble a, double b);
+	a3_QuadDouble a3qdSqr(a3_QuadDouble a);
+	a3_DoubleDouble a3qdGetDD(a3_QuadDouble a);
+	double a3qdGetDouble(a3_QuadDouble a);
+
+
+//-----------------------------------------------------------------------------
+// fixed-point
+
+	// Get the limbs needed to resolve a spacing, with guard bits.
+	//	param spacing: smallest difference that must be represented
+	//	return: limb count, clamped to [2, a3mp_fixedLimbMax]
+	unsigned int a3mpFixedLimbsForSpacing(double spacing);
+
+	// Set from a double, rounding below the last limb toward zero.
+	//	param out: non-null pointer to number
+	//	param limbs: limb count in [2, a3mp_fixedLimbMax]
+	//	param value: value with magnitude below 2^32
+	//	return: 1 if success
+	//	return: -1 if invalid params
+	int a3mpFixedSetDouble(a3_MPFixed *out, unsigned int limbs, double value);
+
+	// Set from a double-double.
+	//	param out: non-null pointer to number
+	//	param limbs: limb count in [2, a3mp_fixedLimbMax]
+	//	param value: value with magnitude below 2^32
+	//	return: 1 if success
+	//	return: -1 if invalid params
+	int a3mpFixedSetDD(a3_MPFixed *out, unsigned int limbs, a3_DoubleDouble value);
+
+	// Set from a decimal string such as "-0.743643887037158704752191".
+	//	param out: non-null pointer to number
+	//	param limbs: limb count in [2, a3mp_fixedLimbMax]
+	//	param str: non-null decimal cstring
+	//	return: number of characters parsed if success
+	//	return: -1 if invalid params
+	int a3mpFixedSetString(a3_MPFixed *out, unsigned int limbs, const char *str);
+
+	// Copy with a different limb count, truncating or zero-extending.
+	//	param out: non-null pointer to result
+	//	param a: non-null pointer to number
+	//	param limbs: limb count in [2, a3mp_fixedLimbMax]
+	//	return: 1 if success
+	//	return: -1 if invalid params
+	int a3mpFixedResize(a3_MPFixed *out, const a3_MPFixed *a, unsigned int limbs);
+
+	// Convert to double, double-double and quad-double.
+	double a3mpFixedGetDouble(const a3_MPFixed *a);
+	a3_DoubleDouble a3mpFixedGetDD(const a3_MPFixed *a);
+	a3_QuadDouble a3mpFixedGetQD(const a3_MPFixed *a);
+
+	// Test whether two numbers are identical, limb count included.
+	//	return: 1 if equal, 0 if not, -1 if invalid params
+	int a3mpFixedEqual(const a3_MPFixed *a, const a3_MPFixed *b);
+
+	// Arithmetic; operands must have the same limb count and the result
+	//	may alias either. Products are truncated to the operand precision;
+	//	integer overflow past 2^32 wraps.
+	//	return: 1 if success
+	//	return: -1 if invalid params
+	int a3mpFixedAdd(a3_MPFixed *out, const a3_MPFixed *a, const a3_MPFixed *b);
+	int a3mpFixedSub(a3_MPFixed *out, const a3_MPFixed *a, const a3_MPFixed *b);
+	int a3mpFixedMul(a3_MPFixed *out, const a3_MPFixed *a, const a3_MPFixed *b);
+	int a3mpFixedSqr(a3_MPFixed *out, const a3_MPFixed *a);
+	int a3mpFixedMulInt(a3_MPFixed *out, const a3_MPFixed *a, unsigned int b);
+	int a3mpFixedDivInt(a3_MPFixed *out, const a3_MPFixed *a, unsigned int b);
+	int a3mpFixedAddDouble(a3_MPFixed *out, const a3_MPFixed *a, double b);
+
+	// Set the limb count at which multiplication switches to Karatsuba.
+	//	param limbs: threshold; at least 4
+	//	return: previous threshold
+	unsigned int a3mpSetKaratsubaThreshold(unsigned int limbs);
+	unsigned int a3mpGetKaratsubaThreshold();
+
+
+//-----------------------------------------------------------------------------
+// benchmark
+
+	// Time every type: double-double, quad-double, then fixed-point at
+	//	limb counts 2, 3, 4, 6, 8, 12... up to 'a3mp_fixedLimbMax'.
+	//	param results_out: non-null array of results
+	//	param count: capacity of results array
+	//	param seconds: approximate time spent on each measurement
+	//	return: number of results written if success
+	//	return: -1 if invalid params
+	int a3mpBenchmarkRun(a3_MPBenchmark *results_out, unsigned int count, double seconds);
+
+	// Print benchmark results as a table to the console.
+	//	param results: non-null array of results
+	//	param count: number of results
+	//	return: 1 if success
+	//	return: -1 if invalid params
+	int a3mpBenchmarkPrint(const a3_MPBenchmark *results, unsigned int count);
+
+
+//-----------------------------------------------------------------------------
+
+
+#ifdef __cplusplus
+}
+#endif	// __cplusplus
+
+
+#endif	// !__ANIMAL3D_DEMOMULTIPRECISION_H
@@ -0,0 +1,53 @@
+/*
+	animal3D SDK: Minimal 3D Animation Framework
+	Fractals Midterm: CPU fractal engines
+
+	a3_DemoSIMD.h
+	Instruction set configuration shared by the SIMD kernels.
+
+	Kernels for every instruction set are compiled into one binary and
+	picked at runtime, so each one is marked with the target it needs:
+		A3_FRACTAL_X86: nonzero if x86 intrinsics are available
+		A3_FRACTAL_AVX512: nonzero if AVX-512 kernels can be compiled
+		A3_FRACTAL_TARGET(isa): function attribute enabling 'isa'
+	Include from source files only.
+*/
+
+#ifndef __ANIMAL3D_DEMOSIMD_H
+#define __ANIMAL3D_DEMOSIMD_H
+
+
+//-----------------------------------------------------------------------------
+
+#if (defined _M_X64 || defined _M_IX86 || defined __x86_64__ || defined __i386__)
+#define A3_FRACTAL_X86		1
+#include <immintrin.h>
+#ifdef _MSC_VER
+#include <intrin.h>
+#define A3_FRACTAL_TARGET(isa)
+// AVX-512 intrinsics first appeared in Visual Studio 2017 (15.3)
+#if (_MSC_VER >= 1911)
+#define A3_FRACTAL_AVX512	1
+#else	// !(_MSC_VER >= 1911)
+#define A3_FRACTAL_AVX512	0
+#endif	// (_MSC_VER >= 1911)
+#else	// !_MSC_VER
+// GCC contracts mul/add intrinsics into FMA on targets that have it; keep 
+//	every instruction set rounding the same way
+#ifdef __clang__
+#define A3_FRACTAL_TARGET(isa)	__attribute__((target(isa)))
+#else	// !__clang__
+#define A3_FRACTAL_TARGET(isa)	__attribute__((target(isa), optimize("fp-contract=off")))
+#endif	// __clang__
+#define A3_FRACTAL_AVX512	1
+#endif	// _MSC_VER
+#else	// !x86
+#define A3_FRACTAL_X86		0
+#define A3_FRACTAL_AVX512	0
+#endif	// x86
+
+
+//-----------------------------------------------------------------------------
+
+
+#endif	// !__ANIMAL3D_DEMOSIMD_H
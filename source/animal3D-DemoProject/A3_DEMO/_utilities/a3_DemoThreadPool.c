@@ -0,0 +1,643 @@
+/*
+	animal3D SDK: Minimal 3D Animation Framework
+	Fractals Midterm: CPU fractal engines
+
+	a3_DemoThreadPool.c
+	Work-stealing thread pool implementation.
+*/
+
+#include "a3_DemoThreadPool.h"
+#include "a3_DemoAtomic.h"
+
+#include "animal3D/a3utility/a3_Thread.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+
+#define a3poolMin(a, b)		((a) < (b) ? (a) : (b))
+
+
+//-----------------------------------------------------------------------------
+// platform primitives: lock, condition
+
+#ifdef _WIN32
+#include <Windows.h>
+
+typedef SRWLOCK				a3_PoolLock;
+typedef CONDITION_VARIABLE	a3_PoolCondition;
+
+#define a3poolThreadLocal		__declspec(thread)
+
+static void a3poolLockInit(a3_PoolLock *lock) { InitializeSRWLock(lock); }
+static void a3poolLockTerm(a3_PoolLock *lock) { (void)lock; }
+static void a3poolLock(a3_PoolLock *lock) { AcquireSRWLockExclusive(lock); }
+static void a3poolUnlock(a3_PoolLock *lock) { ReleaseSRWLockExclusive(lock); }
+static void a3poolConditionInit(a3_PoolCondition *cond) { InitializeConditionVariable(cond); }
+static void a3poolConditionTerm(a3_PoolCondition *cond) { (void)cond; }
+static void a3poolConditionWait(a3_PoolCondition *cond, a3_PoolLock *lock) { SleepConditionVariableSRW(cond, lock, INFINITE, 0); }
+static void a3poolConditionWakeAll(a3_PoolCondition *cond) { WakeAllConditionVariable(cond); }
+
+#else	// !_WIN32
+#include <pthread.h>
+#include <unistd.h>
+
+typedef pthread_mutex_t		a3_PoolLock;
+typedef pthread_cond_t		a3_PoolCondition;
+
+#define a3poolThreadLocal		__thread
+
+static void a3poolLockInit(a3_PoolLock *lock) { pthread_mutex_init(lock, 0); }
+static void a3poolLockTerm(a3_PoolLock *lock) { pthread_mutex_destroy(lock); }
+static void a3poolLock(a3_PoolLock *lock) { pthread_mutex_lock(lock); }
+static void a3poolUnlock(a3_PoolLock *lock) { pthread_mutex_unlock(lock); }
+static void a3poolConditionInit(a3_PoolCondition *cond) { pthread_cond_init(cond, 0); }
+static void a3poolConditionTerm(a3_PoolCondition *cond) { pthread_cond_destroy(cond); }
+static void a3poolConditionWait(a3_PoolCondition *cond, a3_PoolLock *lock) { pthread_cond_wait(cond, lock); }
+static void a3poolConditionWakeAll(a3_PoolCondition *cond) { pthread_cond_broadcast(cond); }
+
+#endif	// _WIN32
+
+
+//-----------------------------------------------------------------------------
+// internal structures
+
+typedef struct a3_PoolTask		a3_PoolTask;
+typedef struct a3_PoolDeque		a3_PoolDeque;
+typedef struct a3_PoolWorker	a3_PoolWorker;
+
+
+// queued task
+struct a3_PoolTask
+{
+	a3_threadpoolfunc func;
+	void *args;
+	a3_ThreadPoolGroup *group;
+	unsigned int x0, y0, x1, y1;
+};
+
+// double-ended task queue; 'top' and 'bottom' only ever increase, and
+//	the ring is indexed by masking them with the power-of-two capacity
+struct a3_PoolDeque
+{
+	a3_PoolLock lock[1];
+	a3_PoolTask *task;
+	unsigned int capacity, top, bottom;
+};
+
+// worker thread and its deque
+struct a3_PoolWorker
+{
+	a3_Thread thread[1];
+	a3_PoolDeque deque[1];
+	a3_ThreadPool *pool;
+	unsigned int index, seed;
+	char name[32];
+};
+
+// pool
+struct a3_ThreadPool
+{
+	a3_PoolLock lock[1];
+	a3_PoolCondition signal[1];
+	a3_PoolWorker *worker;
+	unsigned int workerCount;
+	unsigned int nextDeque;
+	volatile long queued;
+	volatile long quit;
+	volatile long helping;
+	volatile long executed, stolen, helped;
+};
+
+
+// worker running on this thread, if any
+static a3poolThreadLocal a3_PoolWorker *a3poolCurrentWorker = 0;
+
+// pool this non-worker thread holds the helper slot of, if any
+static a3poolThreadLocal a3_ThreadPool *a3poolCurrentHelper = 0;
+
+
+//-----------------------------------------------------------------------------
+// deque
+
+static int a3poolDequeInit(a3_PoolDeque *deque, unsigned int capacity)
+{
+	deque->task = (a3_PoolTask *)malloc(capacity * sizeof(a3_PoolTask));
+	deque->capacity = capacity;
+	deque->top = deque->bottom = 0;
+	a3poolLockInit(deque->lock);
+	return (deque->task != 0);
+}
+
+static void a3poolDequeTerm(a3_PoolDeque *deque)
+{
+	a3poolLockTerm(deque->lock);
+	free(deque->task);
+	deque->task = 0;
+}
+
+// make room for 'count' more tasks, doubling the ring as often as
+//	needed; call with the deque locked
+static int a3poolDequeReserve(a3_PoolDeque *deque, unsigned int count)
+{
+	a3_PoolTask *grown;
+	unsigned int held = deque->bottom - deque->top, capacity = deque->capacity, i;
+	while (capacity - held < count)
+	{
+		if (capacity > 0x7fffffffu / sizeof(a3_PoolTask))
+			return 0;
+		capacity *= 2;
+	}
+	if (capacity != deque->capacity)
+	{
+		// unroll ring into the larger buffer
+		grown = (a3_PoolTask *)malloc(capacity * sizeof(a3_PoolTask));
+		if (!grown)
+			return 0;
+		for (i = 0; i < held; ++i)
+			grown[i] = deque->task[(deque->top + i) & (deque->capacity - 1)];
+		free(deque->task);
+		deque->task = grown;
+		deque->capacity = capacity;
+		deque->top = 0;
+		deque->bottom = held;
+	}
+	return 1;
+}
+
+// owner end: push into reserved room; call with the deque locked
+static void a3poolDequePush(a3_PoolDeque *deque, const a3_PoolTask *task)
+{
+	deque->task[deque->bottom & (deque->capacity - 1)] = *task;
+	++deque->bottom;
+}
+
+// owner end: pop newest
+static int a3poolDequePop(a3_PoolDeque *deque, a3_PoolTask *task_out)
+{
+	int result = 0;
+	a3poolLock(deque->lock);
+	if (deque->bottom != deque->top)
+	{
+		--deque->bottom;
+		*task_out = deque->task[deque->bottom & (deque->capacity - 1)];
+		result = 1;
+	}
+	a3poolUnlock(deque->lock);
+	return result;
+}
+
+// thief end: steal oldest
+static int a3poolDequeSteal(a3_PoolDeque *deque, a3_PoolTask *task_out)
+{
+	int result = 0;
+	a3poolLock(deque->lock);
+	if (deque->bottom != deque->top)
+	{
+		*task_out = deque->task[deque->top & (deque->capacity - 1)];
+		++deque->top;
+		result = 1;
+	}
+	a3poolUnlock(deque->lock);
+	return result;
+}
+
+
+//-----------------------------------------------------------------------------
+// scheduling
+
+// find work: own deque first, then steal starting from a random victim
+//	self: calling worker, or null for a non-worker thread
+static int a3poolFindTask(a3_ThreadPool *pool, a3_PoolWorker *self, a3_PoolTask *task_out)
+{
+	unsigned int i, victim, start;
+
+	if (a3atomicLoad(&pool->queued) <= 0)
+		return 0;
+
+	if (self && a3poolDequePop(self->deque, task_out))
+	{
+		a3atomicAdd(&pool->queued, -1);
+		return 1;
+	}
+
+	// xorshift victim selection spreads thieves over the pool
+	if (self)
+	{
+		self->seed ^= self->seed << 13;
+		self->seed ^= self->seed >> 17;
+		self->seed ^= self->seed << 5;
+		start = self->seed;
+	}
+	else
+		start = pool->nextDeque;
+	for (i = 0; i < pool->workerCount; ++i)
+	{
+		victim = (start + i) % pool->workerCount;
+		if (pool->worker + victim != self && a3poolDequeSteal(pool->worker[victim].deque, task_out))
+		{
+			a3atomicAdd(&pool->queued, -1);
+			a3atomicAdd(self ? &pool->stolen : &pool->helped, 1);
+			return 1;
+		}
+	}
+	return 0;
+}
+
+// take tasks out of a group; the last ones out wake waiters
+static void a3poolRetire(a3_ThreadPool *pool, a3_ThreadPoolGroup *group, long count)
+{
+	if (group && a3atomicAdd(&group->pending, -count) == count)
+	{
+		a3poolLock(pool->lock);
+		a3poolConditionWakeAll(pool->signal);
+		a3poolUnlock(pool->lock);
+	}
+}
+
+// run a task and retire it from its group
+static void a3poolRunTask(a3_ThreadPool *pool, const a3_PoolTask *task, unsigned int workerIndex)
+{
+	task->func(task->args, task->x0, task->y0, task->x1, task->y1, workerIndex);
+	a3atomicAdd(&pool->executed, 1);
+	a3poolRetire(pool, task->group, 1);
+}
+
+// queue a batch of tasks and wake sleeping workers once
+//	tasks are dealt to deques in contiguous runs so each worker starts on a
+//	coherent region; runs are pushed back to front so owners pop them in order
+//	the target deques are locked in index order and have room made before
+//	any task is pushed, so the batch is queued whole or not at all
+//	returns 1 if queued, 0 if a deque could not grow
+static int a3poolEnqueue(a3_ThreadPool *pool, const a3_PoolTask *task, unsigned int count)
+{
+	a3_PoolWorker *self = a3poolCurrentWorker;
+	a3_PoolDeque *deque;
+	unsigned int i, w, begin, end;
+
+	if (self && self->pool == pool)
+	{
+		// nested submit: keep work local, others will steal it
+		a3poolLock(self->deque->lock);
+		if (!a3poolDequeReserve(self->deque, count))
+		{
+			a3poolUnlock(self->deque->lock);
+			return 0;
+		}
+		for (i = count; i > 0; --i)
+			a3poolDequePush(self->deque, task + i - 1);
+		a3poolUnlock(self->deque->lock);
+	}
+	else
+	{
+		for (w = 0; w < pool->workerCount; ++w)
+			a3poolLock(pool->worker[w].deque->lock);
+		for (w = 0; w < pool->workerCount; ++w)
+		{
+			begin = (unsigned int)((unsigned long long)count * w / pool->workerCount);
+			end = (unsigned int)((unsigned long long)count * (w + 1) / pool->workerCount);
+			if (!a3poolDequeReserve(pool->worker[(w + pool->nextDeque) % pool->workerCount].deque, end - begin))
+			{
+				for (w = 0; w < pool->workerCount; ++w)
+					a3poolUnlock(pool->worker[w].deque->lock);
+				return 0;
+			}
+		}
+		for (w = 0; w < pool->workerCount; ++w)
+		{
+			begin = (unsigned int)((unsigned long long)count * w / pool->workerCount);
+			end = (unsigned int)((unsigned long long)count * (w + 1) / pool->workerCount);
+			deque = pool->worker[(w + pool->nextDeque) % pool->workerCount].deque;
+			for (i = end; i > begin; --i)
+				a3poolDequePush(deque, task + i - 1);
+		}
+		pool->nextDeque = (pool->nextDeque + 1) % pool->workerCount;
+		for (w = 0; w < pool->workerCount; ++w)
+			a3poolUnlock(pool->worker[w].deque->lock);
+	}
+
+	a3atomicAdd(&pool->queued, (long)count);
+	a3poolLock(pool->lock);
+	a3poolConditionWakeAll(pool->signal);
+	a3poolUnlock(pool->lock);
+	return 1;
+}
+
+
+// worker main loop
+static long a3poolWorkerMain(void *args)
+{
+	a3_PoolWorker *self = (a3_PoolWorker *)args;
+	a3_ThreadPool *pool = self->pool;
+	a3_PoolTask task;
+
+	a3poolCurrentWorker = self;
+	for (;;)
+	{
+		if (a3poolFindTask(pool, self, &task))
+		{
+			a3poolRunTask(pool, &task, self->index);
+			continue;
+		}
+
+		// nothing anywhere: sleep until work arrives or pool stops
+		a3poolLock(pool->lock);
+		while (a3atomicLoad(&pool->queued) <= 0 && !a3atomicLoad(&pool->quit))
+			a3poolConditionWait(pool->signal, pool->lock);
+		if (a3atomicLoad(&pool->queued) <= 0 && a3atomicLoad(&pool->quit))
+		{
+			a3poolUnlock(pool->lock);
+			break;
+		}
+		a3poolUnlock(pool->lock);
+	}
+	a3poolCurrentWorker = 0;
+	return 0;
+}
+
+
+//-----------------------------------------------------------------------------
+
+unsigned int a3threadPoolHardwareThreads()
+{
+#ifdef _WIN32
+	SYSTEM_INFO info;
+	GetSystemInfo(&info);
+	return (info.dwNumberOfProcessors > 0 ? (unsigned int)info.dwNumberOfProcessors : 1);
+#else	// !_WIN32
+	const long count = sysconf(_SC_NPROCESSORS_ONLN);
+	return (count > 0 ? (unsigned int)count : 1);
+#endif	// _WIN32
+}
+
+int a3threadPoolCreate(a3_ThreadPool **pool_out, unsigned int workerCount)
+{
+	a3_ThreadPool *pool;
+	a3_PoolWorker *worker;
+	unsigned int i, launched = 0;
+
+	if (pool_out)
+	{
+		if (!*pool_out)
+		{
+			if (!workerCount)
+				workerCount = a3threadPoolHardwareThreads();
+
+			pool = (a3_ThreadPool *)malloc(sizeof(a3_ThreadPool));
+			if (!pool)
+				return 0;
+			memset(pool, 0, sizeof(a3_ThreadPool));
+			pool->worker = (a3_PoolWorker *)malloc(workerCount * sizeof(a3_PoolWorker));
+			if (!pool->worker)
+			{
+				free(pool);
+				return 0;
+			}
+			memset(pool->worker, 0, workerCount * sizeof(a3_PoolWorker));
+			pool->workerCount = workerCount;
+			a3poolLockInit(pool->lock);
+			a3poolConditionInit(pool->signal);
+
+			// deques must all exist before any worker can steal
+			for (i = 0, worker = pool->worker; i < workerCount; ++i, ++worker)
+			{
+				worker->pool = pool;
+				worker->index = i;
+				worker->seed = 0x9e3779b9u * (i + 1);
+				strcpy(worker->name, "a3 pool worker");
+				if (!a3poolDequeInit(worker->deque, 64))
+					break;
+			}
+			if (i == workerCount)
+				for (worker = pool->worker; launched < workerCount; ++launched, ++worker)
+					if (a3threadLaunch(worker->thread, a3poolWorkerMain, worker, worker->name) != 1)
+						break;
+			if (launched == workerCount)
+			{
+				*pool_out = pool;
+				return (int)workerCount;
+			}
+
+			// unwind: stop the workers that started, then release every
+			//	deque whose init ran, failed or not
+			a3poolLock(pool->lock);
+			pool->quit = 1;
+			a3poolConditionWakeAll(pool->signal);
+			a3poolUnlock(pool->lock);
+			while (launched > 0)
+				a3threadWait(pool->worker[--launched].thread);
+			for (i = a3poolMin(i + 1, workerCount); i > 0; --i)
+				a3poolDequeTerm(pool->worker[i - 1].deque);
+			a3poolConditionTerm(pool->signal);
+			a3poolLockTerm(pool->lock);
+			free(pool->worker);
+			free(pool);
+			return 0;
+		}
+		return 0;
+	}
+	return -1;
+}
+
+int a3threadPoolRelease(a3_ThreadPool **pool)
+{
+	a3_ThreadPool *p;
+	unsigned int i;
+
+	if (pool && *pool)
+	{
+		p = *pool;
+		a3poolLock(p->lock);
+		p->quit = 1;
+		a3poolConditionWakeAll(p->signal);
+		a3poolUnlock(p->lock);
+
+		for (i = 0; i < p->workerCount; ++i)
+			a3threadWait(p->worker[i].thread);
+		for (i = 0; i < p->workerCount; ++i)
+			a3poolDequeTerm(p->worker[i].deque);
+
+		a3poolConditionTerm(p->signal);
+		a3poolLockTerm(p->lock);
+		free(p->worker);
+		free(p);
+		*pool = 0;
+		return 1;
+	}
+	return -1;
+}
+
+unsigned int a3threadPoolGetWorkerCount(const a3_ThreadPool *pool)
+{
+	return (pool ? pool->workerCount : 0);
+}
+
+int a3threadPoolGetStats(const a3_ThreadPool *pool, a3_ThreadPoolStats *stats_out)
+{
+	if (pool && stats_out)
+	{
+		stats_out->workerCount = pool->workerCount;
+		stats_out->executed = pool->executed;
+		stats_out->stolen = pool->stolen;
+		stats_out->helped = pool->helped;
+		return 1;
+	}
+	return -1;
+}
+
+int a3threadPoolGroupInit(a3_ThreadPoolGroup *group)
+{
+	if (group)
+	{
+		group->pending = 0;
+		return 1;
+	}
+	return -1;
+}
+
+int a3threadPoolSubmit(a3_ThreadPool *pool_opt, a3_ThreadPoolGroup *group_opt, a3_threadpoolfunc func, void *args_opt, unsigned int x0, unsigned int y0, unsigned int x1, unsigned int y1)
+{
+	a3_PoolTask task;
+
+	if (func)
+	{
+		if (!pool_opt)
+		{
+			func(args_opt, x0, y0, x1, y1, 0);
+			return 1;
+		}
+
+		task.func = func;
+		task.args = args_opt;
+		task.group = group_opt;
+		task.x0 = x0;
+		task.y0 = y0;
+		task.x1 = x1;
+		task.y1 = y1;
+		if (group_opt)
+			a3atomicAdd(&group_opt->pending, 1);
+		if (!a3poolEnqueue(pool_opt, &task, 1))
+		{
+			a3poolRetire(pool_opt, group_opt, 1);
+			return 0;
+		}
+		return 1;
+	}
+	return -1;
+}
+
+int a3threadPoolParallelFor2D(a3_ThreadPool *pool_opt, a3_ThreadPoolGroup *group_opt, a3_threadpoolfunc func, void *args_opt, unsigned int width, unsigned int height, unsigned int tileWidth, unsigned int tileHeight)
+{
+	a3_ThreadPoolGroup localGroup[1];
+	a3_ThreadPoolGroup *group;
+	a3_PoolTask *task;
+	unsigned int tilesX, tilesY, count, i, x, y;
+
+	if (func)
+	{
+		if (!width || !height)
+			return 0;
+		if (!tileWidth || tileWidth > width)
+			tileWidth = width;
+		if (!tileHeight || tileHeight > height)
+			tileHeight = height;
+		tilesX = (width + tileWidth - 1) / tileWidth;
+		tilesY = (height + tileHeight - 1) / tileHeight;
+		count = tilesX * tilesY;
+
+		// no pool: run tiles in order on this thread
+		if (!pool_opt)
+		{
+			for (y = 0; y < height; y += tileHeight)
+				for (x = 0; x < width; x += tileWidth)
+					func(args_opt, x, y, a3poolMin(x + tileWidth, width), a3poolMin(y + tileHeight, height), 0);
+			return (int)count;
+		}
+
+		task = (a3_PoolTask *)malloc(count * sizeof(a3_PoolTask));
+		if (!task)
+			return -1;
+
+		group = group_opt ? group_opt : localGroup;
+		if (!group_opt)
+			a3threadPoolGroupInit(localGroup);
+		for (i = 0, y = 0; y < height; y += tileHeight)
+			for (x = 0; x < width; x += tileWidth, ++i)
+			{
+				task[i].func = func;
+				task[i].args = args_opt;
+				task[i].group = group;
+				task[i].x0 = x;
+				task[i].y0 = y;
+				task[i].x1 = a3poolMin(x + tileWidth, width);
+				task[i].y1 = a3poolMin(y + tileHeight, height);
+			}
+		a3atomicAdd(&group->pending, (long)count);
+		if (!a3poolEnqueue(pool_opt, task, count))
+		{
+			a3poolRetire(pool_opt, group, (long)count);
+			free(task);
+			return -1;
+		}
+		free(task);
+
+		if (!group_opt)
+			a3threadPoolWait(pool_opt, localGroup);
+		return (int)count;
+	}
+	return -1;
+}
+
+int a3threadPoolWait(a3_ThreadPool *pool_opt, a3_ThreadPoolGroup *group)
+{
+	a3_PoolWorker *self;
+	a3_PoolTask task;
+	int helper, claimed = 0;
+
+	if (group)
+	{
+		if (!pool_opt)
+			return 1;
+
+		self = a3poolCurrentWorker;
+		if (self && self->pool != pool_opt)
+			self = 0;
+
+		// workers always help; of the other threads, only the one holding
+		//	the slot after the workers does, so per-worker scratch indexed
+		//	by that slot is never shared; the rest block
+		helper = (self || a3poolCurrentHelper == pool_opt);
+		if (!helper && a3atomicCompareSwap(&pool_opt->helping, 0, 1) == 0)
+		{
+			a3poolCurrentHelper = pool_opt;
+			helper = claimed = 1;
+		}
+
+		while (a3atomicLoad(&group->pending) > 0)
+		{
+			// help instead of blocking
+			if (helper && a3poolFindTask(pool_opt, self, &task))
+			{
+				a3poolRunTask(pool_opt, &task, self ? self->index : pool_opt->workerCount);
+				continue;
+			}
+
+			// the group's remaining tasks are running elsewhere
+			a3poolLock(pool_opt->lock);
+			while (a3atomicLoad(&group->pending) > 0 && (!helper || a3atomicLoad(&pool_opt->queued) <= 0))
+				a3poolConditionWait(pool_opt->signal, pool_opt->lock);
+			a3poolUnlock(pool_opt->lock);
+		}
+
+		if (claimed)
+		{
+			a3poolCurrentHelper = 0;
+			a3atomicCompareSwap(&pool_opt->helping, 1, 0);
+		}
+		return 1;
+	}
+	return -1;
+}
+
+
+//-----------------------------------------------------------------------------
@@ -0,0 +1,146 @@
+/*
+	animal3D SDK: Minimal 3D Animation Framework
+	Fractals Midterm: CPU fractal engines
+
+	a3_DemoThreadPool.h
+	Persistent work-stealing thread pool built on a3_Thread.
+
+	Each worker owns a deque of tasks: the owner pushes and pops at the
+	bottom, idle workers steal from the top of someone else's deque. A 2D
+	parallel-for splits a range into tiles and deals contiguous runs of
+	tiles to each worker; uneven tiles are then balanced by stealing. Tasks
+	are counted in groups that any thread can wait on; the waiting thread
+	runs queued tasks while it waits. Of the threads that are not workers,
+	one at a time does so; others waiting meanwhile just block.
+
+	Workers run code from this library; stop the pool before the library
+	is unloaded or hotloaded.
+*/
+
+#ifndef __ANIMAL3D_DEMOTHREADPOOL_H
+#define __ANIMAL3D_DEMOTHREADPOOL_H
+
+
+//-----------------------------------------------------------------------------
+
+#ifdef __cplusplus
+extern "C"
+{
+#else	// !__cplusplus
+	typedef struct a3_ThreadPool			a3_ThreadPool;
+	typedef struct a3_ThreadPoolGroup		a3_ThreadPoolGroup;
+	typedef struct a3_ThreadPoolStats		a3_ThreadPoolStats;
+#endif	// __cplusplus
+
+
+//-----------------------------------------------------------------------------
+
+	// pool task function:
+	//	-> param args: pointer passed on submit
+	//	-> params x0, y0, x1, y1: half-open range of this task
+	//	-> param workerIndex: index of thread running the task, in the
+	//		range [0, worker count]; the last index is the non-worker thread
+	//		running tasks while waiting on a group, never two at once
+	typedef void(*a3_threadpoolfunc)(void *args, unsigned int x0, unsigned int y0, unsigned int x1, unsigned int y1, unsigned int workerIndex);
+
+
+	// group of tasks that can be waited on
+	//	member pending: number of submitted tasks not yet finished
+	struct a3_ThreadPoolGroup
+	{
+		volatile long pending;
+	};
+
+
+	// pool counters since creation
+	//	member workerCount: number of worker threads
+	//	member executed: tasks run by all threads
+	//	member stolen: tasks run by a thread that did not own them
+	//	member helped: tasks run by non-worker threads while waiting
+	struct a3_ThreadPoolStats
+	{
+		unsigned int workerCount;
+		long executed, stolen, helped;
+	};
+
+
+//-----------------------------------------------------------------------------
+
+	// Get the number of hardware threads.
+	//	return: number of logical processors (at least 1)
+	unsigned int a3threadPoolHardwareThreads();
+
+	// Create and start a pool.
+	//	param pool_out: non-null pointer to pool pointer; must be null
+	//	param workerCount: number of workers; 0 uses one per hardware thread
+	//	return: number of workers started if success
+	//	return: 0 if fail (already created or out of memory)
+	//	return: -1 if invalid params
+	int a3threadPoolCreate(a3_ThreadPool **pool_out, unsigned int workerCount);
+
+	// Stop workers and release a pool; queued tasks are run first.
+	//	param pool: non-null pointer to pool pointer; reset to null
+	//	return: 1 if success
+	//	return: -1 if invalid params
+	int a3threadPoolRelease(a3_ThreadPool **pool);
+
+	// Get the number of workers in a pool.
+	//	param pool: pointer to pool; null is a pool of zero workers
+	//	return: number of workers
+	unsigned int a3threadPoolGetWorkerCount(const a3_ThreadPool *pool);
+
+	// Get pool counters.
+	//	param pool: non-null pointer to pool
+	//	param stats_out: non-null pointer to stats
+	//	return: 1 if success
+	//	return: -1 if invalid params
+	int a3threadPoolGetStats(const a3_ThreadPool *pool, a3_ThreadPoolStats *stats_out);
+
+	// Initialize a group before its first use.
+	//	param group: non-null pointer to group
+	//	return: 1 if success
+	//	return: -1 if invalid params
+	int a3threadPoolGroupInit(a3_ThreadPoolGroup *group);
+
+	// Submit one task covering a range; runs immediately if pool is null.
+	//	param pool_opt: optional pool
+	//	param group_opt: optional group to count the task in
+	//	param func: non-null task function
+	//	param args_opt: optional argument passed to the task
+	//	params x0, y0, x1, y1: range passed to the task
+	//	return: 1 if success
+	//	return: 0 if fail (could not be queued; the task has not run)
+	//	return: -1 if invalid params
+	int a3threadPoolSubmit(a3_ThreadPool *pool_opt, a3_ThreadPoolGroup *group_opt, a3_threadpoolfunc func, void *args_opt, unsigned int x0, unsigned int y0, unsigned int x1, unsigned int y1);
+
+	// Split a 2D range into tiles and run one task per tile.
+	//	param pool_opt: optional pool; tiles run on this thread if null
+	//	param group_opt: optional group; if null, returns when all tiles
+	//		are done, otherwise returns immediately
+	//	param func: non-null task function
+	//	param args_opt: optional argument passed to every task
+	//	params width, height: range is [0, width) x [0, height)
+	//	params tileWidth, tileHeight: tile size; 0 means the whole axis
+	//	return: number of tiles submitted if success
+	//	return: -1 if invalid params, or the tiles could not be allocated
+	//		or queued; no task has run
+	int a3threadPoolParallelFor2D(a3_ThreadPool *pool_opt, a3_ThreadPoolGroup *group_opt, a3_threadpoolfunc func, void *args_opt, unsigned int width, unsigned int height, unsigned int tileWidth, unsigned int tileHeight);
+
+	// Wait for every task in a group, running queued tasks meanwhile if
+	//	this thread is a worker or no other non-worker thread is doing so.
+	//	param pool_opt: pool the group's tasks were submitted to
+	//	param group: non-null pointer to group
+	//	return: 1 if success
+	//	return: -1 if invalid params
+	int a3threadPoolWait(a3_ThreadPool *pool_opt, a3_ThreadPoolGroup *group);
+
+
+//-----------------------------------------------------------------------------
+
+
+#ifdef __cplusplus
+}
+#endif	// __cplusplus
+
+
+#endif	// !__ANIMAL3D_DEMOTHREADPOOL_H
@@ -0,0 +1,714 @@
+/*
+	animal3D SDK: Minimal 3D Animation Framework
+	Fractals Midterm: CPU fractal engines
+
+	a3_DemoFractalAntialias.c
+	Adaptive supersampling implementation.
+
+	The shader's map is conjugate to w^2 + C, with w = (3 x, sqrt(3) y)
+	and C = (3 cx, sqrt(3) cy), so the derivative of the orbit over C is
+	complex and obeys dw' = 2 w dw + 1 from dw = 1. At escape the distance
+	from C to the set, in C's units, is about |w| log|w| / (2 |dw|): half
+	of log|w| over the length of its gradient, which is dw / w. Taken back
+	to the plane the gradient's axes scale by 3 and sqrt(3), which gives
+	the distance in plane units without leaving single precision.
+
+	The kernels run z exactly as the escape-time kernels do, so the center
+	sample of every pixel matches them; the derivative only rides along.
+	It doubles the arithmetic of an iteration, and interior pixels, which
+	take the most iterations, never need it, so the first pass runs
+	without it and the escaped pixels that their neighbours do not already
+	flag run again with it, gathered into full spans; they are usually a
+	few percent of the first pass's iterations. Samples of supersampled
+	pixels are gathered the same way, with their own coordinates on both
+	axes, so a pixel's whole grid fills a packet.
+*/
+
+#include "a3_DemoFractalAntialias.h"
+#include "a3_DemoFractalInterior.h"
+#include "_utilities/a3_DemoSIMD.h"
+
+#include "animal3D/a3/a3macros.h"
+
+#include <math.h>
+#include <stdlib.h>
+
+
+//-----------------------------------------------------------------------------
+
+#ifdef _MSC_VER
+#define a3antialias_inline	static __forceinline
+#else	// !_MSC_VER
+#define a3antialias_inline	static inline __attribute__((always_inline))
+#endif	// _MSC_VER
+
+// samples handed to a kernel at once; multiple of the widest packet and
+//	of no less than the largest grid
+#define a3antialias_span		64
+
+// tile edge for pooled renders
+#define a3antialias_tile		32
+
+// conjugation scale of the imaginary axis, and twice it
+#define a3antialias_sqrt3		1.7320508f
+#define a3antialias_sqrt3x2		3.4641016f
+
+
+// kernel: iterate 'count' samples, each with its own coordinate
+//	writes the escape iteration (or cap), the squared magnitude at escape
+//	and, for the kernels that carry the derivative, the distance estimate
+typedef void(*a3_FractalAntialiasSpanFunc)(const float *cx, const float *cy, const unsigned int count, const unsigned int cap, unsigned int *iter_out, float *mag_out, float *dist_out);
+
+
+// one frame; counters are per thread, merged after the frame
+typedef struct a3_AntialiasPass
+{
+	const a3_FractalAntialiasDesc *desc;
+	a3_FractalAntialiasSpanFunc escape, estimate;
+	unsigned int lanes, grid, spread;
+	float limit;
+	double left, bottom, dx, dy;
+	unsigned int *iter;
+	float *smooth;
+	a3_FractalAntialiasStats *counters;
+} a3_AntialiasPass;
+
+
+//-----------------------------------------------------------------------------
+// kernels
+
+// distance estimate from the escaped point and the derivative over C
+static float a3antialiasDistance(const float zx, const float zy, const float dwx, const float dwy)
+{
+	const float wx = 3.0f * zx, wy = a3antialias_sqrt3 * zy;
+	const float w2 = wx * wx + wy * wy;
+	const float qx = (dwx * wx + dwy * wy) / w2, qy = (dwy * wx - dwx * wy) / w2;
+	const float d = 0.25f * logf(w2) / sqrtf(9.0f * qx * qx + 3.0f * qy * qy);
+
+	// a derivative that overflowed is at the boundary
+	return (d >= 0.0f ? d : 0.0f);
+}
+
+
+// scalar fallback
+a3antialias_inline void a3fractalAntialiasSpanT_scalar(const float *cx, const float *cy, const unsigned int count, const unsigned int cap, unsigned int *iter_out, float *mag_out, float *dist_out, const int derivative)
+{
+	unsigned int i, iter;
+	float zx, zy, nzx, mag, dwx, dwy, ndwx;
+	for (i = 0; i < count; ++i)
+	{
+		zx = cx[i];
+		zy = cy[i];
+		dwx = 1.0f;
+		dwy = 0.0f;
+		iter_out[i] = cap;
+		mag_out[i] = 0.0f;
+		if (derivative)
+			dist_out[i] = 0.0f;
+		for (iter = 0; iter < cap; ++iter)
+		{
+			if (derivative)
+			{
+				ndwx = 6.0f * zx * dwx - a3antialias_sqrt3x2 * zy * dwy + 1.0f;
+				dwy = 6.0f * zx * dwy + a3antialias_sqrt3x2 * zy * dwx;
+				dwx = ndwx;
+			}
+			nzx = 3.0f * zx * zx - zy * zy + cx[i];
+			zy = 6.0f * zx * zy + cy[i];
+			zx = nzx;
+			mag = zx * zx + zy * zy;
+			if (mag > a3fractal_bailout)
+			{
+				iter_out[i] = iter;
+				mag_out[i] = mag;
+				if (derivative)
+					dist_out[i] = a3antialiasDistance(zx, zy, dwx, dwy);
+				break;
+			}
+		}
+	}
+}
+
+
+// distances of a packet from its latched state
+a3antialias_inline void a3antialiasStoreDistance(const float *zx, const float *zy, const float *dwx, const float *dwy, const unsigned int lanes, const unsigned int cap, const unsigned int *iter, float *dist_out)
+{
+	unsigned int j;
+	for (j = 0; j < lanes; ++j)
+		dist_out[j] = iter[j] < cap ? a3antialiasDistance(zx[j], zy[j], dwx[j], dwy[j]) : 0.0f;
+}
+
+
+#if A3_FRACTAL_X86
+
+// SSE2: 4 samples per instruction
+A3_FRACTAL_TARGET("sse2")
+a3antialias_inline __m128 a3antialiasSelect_sse2(const __m128 mask, const __m128 a, const __m128 b)
+{
+	return _mm_or_ps(_mm_and_ps(mask, a), _mm_andnot_ps(mask, b));
+}
+
+A3_FRACTAL_TARGET("sse2")
+a3antialias_inline void a3fractalAntialiasSpanT_sse2(const float *cx, const float *cy, const unsigned int count, const unsigned int cap, unsigned int *iter_out, float *mag_out, float *dist_out, const int derivative)
+{
+	const __m128 one = _mm_set1_ps(1.0f), three = _mm_set1_ps(3.0f), six = _mm_set1_ps(6.0f);
+	const __m128 root3x2 = _mm_set1_ps(a3antialias_sqrt3x2);
+	const __m128 bailout = _mm_set1_ps(a3fractal_bailout);
+	__m128 vcx, vcy, zx, zy, nzx, mag, escaped, done, magLatch;
+	__m128 dwx, dwy, ndwx, zxLatch, zyLatch, dwxLatch, dwyLatch;
+	__m128i iterLatch, iterNow;
+	float zxStore[4], zyStore[4], dwxStore[4], dwyStore[4];
+	unsigned int i, iter;
+
+	for (i = 0; i < count; i += 4)
+	{
+		vcx = _mm_loadu_ps(cx + i);
+		vcy = _mm_loadu_ps(cy + i);
+		zx = vcx;
+		zy = vcy;
+		dwx = one;
+		dwy = _mm_setzero_ps();
+		zxLatch = zyLatch = dwxLatch = dwyLatch = _mm_setzero_ps();
+		done = _mm_setzero_ps();
+		magLatch = _mm_setzero_ps();
+		iterLatch = _mm_set1_epi32((int)cap);
+		for (iter = 0; iter < cap; ++iter)
+		{
+			if (derivative)
+			{
+				ndwx = _mm_add_ps(_mm_sub_ps(_mm_mul_ps(_mm_mul_ps(six, zx), dwx), _mm_mul_ps(_mm_mul_ps(root3x2, zy), dwy)), one);
+				dwy = _mm_add_ps(_mm_mul_ps(_mm_mul_ps(six, zx), dwy), _mm_mul_ps(_mm_mul_ps(root3x2, zy), dwx));
+				dwx = ndwx;
+			}
+			nzx = _mm_add_ps(_mm_sub_ps(_mm_mul_ps(_mm_mul_ps(three, zx), zx), _mm_mul_ps(zy, zy)), vcx);
+			zy = _mm_add_ps(_mm_mul_ps(_mm_mul_ps(six, zx), zy), vcy);
+			zx = nzx;
+			mag = _mm_add_ps(_mm_mul_ps(zx, zx), _mm_mul_ps(zy, zy));
+
+			// lanes escaping on this iteration latch their results
+			escaped = _mm_andnot_ps(done, _mm_cmpgt_ps(mag, bailout));
+			iterNow = _mm_set1_epi32((int)iter);
+			iterLatch = _mm_or_si128(_mm_and_si128(_mm_castps_si128(escaped), iterNow), _mm_andnot_si128(_mm_castps_si128(escaped), iterLatch));
+			magLatch = a3antialiasSelect_sse2(escaped, mag, magLatch);
+			if (derivative)
+			{
+				zxLatch = a3antialiasSelect_sse2(escaped, zx, zxLatch);
+				zyLatch = a3antialiasSelect_sse2(escaped, zy, zyLatch);
+				dwxLatch = a3antialiasSelect_sse2(escaped, dwx, dwxLatch);
+				dwyLatch = a3antialiasSelect_sse2(escaped, dwy, dwyLatch);
+			}
+			done = _mm_or_ps(done, escaped);
+			if (_mm_movemask_ps(done) == 0xf)
+				break;
+		}
+		_mm_storeu_si128((__m128i *)(iter_out + i), iterLatch);
+		_mm_storeu_ps(mag_out + i, magLatch);
+		if (derivative)
+		{
+			_mm_storeu_ps(zxStore, zxLatch);
+			_mm_storeu_ps(zyStore, zyLatch);
+			_mm_storeu_ps(dwxStore, dwxLatch);
+			_mm_storeu_ps(dwyStore, dwyLatch);
+			a3antialiasStoreDistance(zxStore, zyStore, dwxStore, dwyStore, 4, cap, iter_out + i, dist_out + i);
+		}
+	}
+}
+
+
+// AVX2: 8 samples per instruction
+A3_FRACTAL_TARGET("avx2")
+a3antialias_inline void a3fractalAntialiasSpanT_avx2(const float *cx, const float *cy, const unsigned int count, const unsigned int cap, unsigned int *iter_out, float *mag_out, float *dist_out, const int derivative)
+{
+	const __m256 one = _mm256_set1_ps(1.0f), three = _mm256_set1_ps(3.0f), six = _mm256_set1_ps(6.0f);
+	const __m256 root3x2 = _mm256_set1_ps(a3antialias_sqrt3x2);
+	const __m256 bailout = _mm256_set1_ps(a3fractal_bailout);
+	__m256 vcx, vcy, zx, zy, nzx, mag, escaped, done, magLatch;
+	__m256 dwx, dwy, ndwx, zxLatch, zyLatch, dwxLatch, dwyLatch;
+	__m256i iterLatch;
+	float zxStore[8], zyStore[8], dwxStore[8], dwyStore[8];
+	unsigned int i, iter;
+
+	for (i = 0; i < count; i += 8)
+	{
+		vcx = _mm256_loadu_ps(cx + i);
+		vcy = _mm256_loadu_ps(cy + i);
+		zx = vcx;
+		zy = vcy;
+		dwx = one;
+		dwy = _mm256_setzero_ps();
+		zxLatch = zyLatch = dwxLatch = dwyLatch = _mm256_setzero_ps();
+		done = _mm256_setzero_ps();
+		magLatch = _mm256_setzero_ps();
+		iterLatch = _mm256_set1_epi32((int)cap);
+		for (iter = 0; iter < cap; ++iter)
+		{
+			if (derivative)
+			{
+				ndwx = _mm256_add_ps(_mm256_sub_ps(_mm256_mul_ps(_mm256_mul_ps(six, zx), dwx), _mm256_mul_ps(_mm256_mul_ps(root3x2, zy), dwy)), one);
+				dwy = _mm256_add_ps(_mm256_mul_ps(_mm256_mul_ps(six, zx), dwy), _mm256_mul_ps(_mm256_mul_ps(root3x2, zy), dwx));
+				dwx = ndwx;
+			}
+			nzx = _mm256_add_ps(_mm256_sub_ps(_mm256_mul_ps(_mm256_mul_ps(three, zx), zx), _mm256_mul_ps(zy, zy)), vcx);
+			zy = _mm256_add_ps(_mm256_mul_ps(_mm256_mul_ps(six, zx), zy), vcy);
+			zx = nzx;
+			mag = _mm256_add_ps(_mm256_mul_ps(zx, zx), _mm256_mul_ps(zy, zy));
+
+			escaped = _mm256_andnot_ps(done, _mm256_cmp_ps(mag, bailout, _CMP_GT_OQ));
+			iterLatch = _mm256_castps_si256(_mm256_blendv_ps(_mm256_castsi256_ps(iterLatch), _mm256_castsi256_ps(_mm256_set1_epi32((int)iter)), escaped));
+			magLatch = _mm256_blendv_ps(magLatch, mag, escaped);
+			if (derivative)
+			{
+				zxLatch = _mm256_blendv_ps(zxLatch, zx, escaped);
+				zyLatch = _mm256_blendv_ps(zyLatch, zy, escaped);
+				dwxLatch = _mm256_blendv_ps(dwxLatch, dwx, escaped);
+				dwyLatch = _mm256_blendv_ps(dwyLatch, dwy, escaped);
+			}
+			done = _mm256_or_ps(done, escaped);
+			if (_mm256_movemask_ps(done) == 0xff)
+				break;
+		}
+		_mm256_storeu_si256((__m256i *)(iter_out + i), iterLatch);
+		_mm256_storeu_ps(mag_out + i, magLatch);
+		if (derivative)
+		{
+			_mm256_storeu_ps(zxStore, zxLatch);
+			_mm256_storeu_ps(zyStore, zyLatch);
+			_mm256_storeu_ps(dwxStore, dwxLatch);
+			_mm256_storeu_ps(dwyStore, dwyLatch);
+			a3antialiasStoreDistance(zxStore, zyStore, dwxStore, dwyStore, 8, cap, iter_out + i, dist_out + i);
+		}
+	}
+}
+
+
+#if A3_FRACTAL_AVX512
+
+// AVX-512: 16 samples per instruction
+A3_FRACTAL_TARGET("avx512f")
+a3antialias_inline void a3fractalAntialiasSpanT_avx512(const float *cx, const float *cy, const unsigned int count, const unsigned int cap, unsigned int *iter_out, float *mag_out, float *dist_out, const int derivative)
+{
+	const __m512 one = _mm512_set1_ps(1.0f), three = _mm512_set1_ps(3.0f), six = _mm512_set1_ps(6.0f);
+	const __m512 root3x2 = _mm512_set1_ps(a3antialias_sqrt3x2);
+	const __m512 bailout = _mm512_set1_ps(a3fractal_bailout);
+	__m512 vcx, vcy, zx, zy, nzx, mag, magLatch;
+	__m512 dwx, dwy, ndwx, zxLatch, zyLatch, dwxLatch, dwyLatch;
+	__m512i iterLatch;
+	__mmask16 escaped, done;
+	float zxStore[16], zyStore[16], dwxStore[16], dwyStore[16];
+	unsigned int i, iter;
+
+	for (i = 0; i < count; i += 16)
+	{
+		vcx = _mm512_loadu_ps(cx + i);
+		vcy = _mm512_loadu_ps(cy + i);
+		zx = vcx;
+		zy = vcy;
+		dwx = one;
+		dwy = _mm512_setzero_ps();
+		zxLatch = zyLatch = dwxLatch = dwyLatch = _mm512_setzero_ps();
+		done = 0;
+		magLatch = _mm512_setzero_ps();
+		iterLatch = _mm512_set1_epi32((int)cap);
+		for (iter = 0; iter < cap; ++iter)
+		{
+			if (derivative)
+			{
+				ndwx = _mm512_add_ps(_mm512_sub_ps(_mm512_mul_ps(_mm512_mul_ps(six, zx), dwx), _mm512_mul_ps(_mm512_mul_ps(root3x2, zy), dwy)), one);
+				dwy = _mm512_add_ps(_mm512_mul_ps(_mm512_mul_ps(six, zx), dwy), _mm512_mul_ps(_mm512_mul_ps(root3x2, zy), dwx));
+				dwx = ndwx;
+			}
+			nzx = _mm512_add_ps(_mm512_sub_ps(_mm512_mul_ps(_mm512_mul_ps(three, zx), zx), _mm512_mul_ps(zy, zy)), vcx);
+			zy = _mm512_add_ps(_mm512_mul_ps(_mm512_mul_ps(six, zx), zy), vcy);
+			zx = nzx;
+			mag = _mm512_add_ps(_mm512_mul_ps(zx, zx), _mm512_mul_ps(zy, zy));
+
+			escaped = _mm512_mask_cmp_ps_mask((__mmask16)~done, mag, bailout, _CMP_GT_OQ);
+			iterLatch = _mm512_mask_mov_epi32(iterLatch, escaped, _mm512_set1_epi32((int)iter));
+			magLatch = _mm512_mask_mov_ps(magLatch, escaped, mag);
+			if (derivative)
+			{
+				zxLatch = _mm512_mask_mov_ps(zxLatch, escaped, zx);
+				zyLatch = _mm512_mask_mov_ps(zyLatch, escaped, zy);
+				dwxLatch = _mm512_mask_mov_ps(dwxLatch, escaped, dwx);
+				dwyLatch = _mm512_mask_mov_ps(dwyLatch, escaped, dwy);
+			}
+			done = (__mmask16)(done | escaped);
+			if (done == 0xffff)
+				break;
+		}
+		_mm512_storeu_si512((void *)(iter_out + i), iterLatch);
+		_mm512_storeu_ps(mag_out + i, magLatch);
+		if (derivative)
+		{
+			_mm512_storeu_ps(zxStore, zxLatch);
+			_mm512_storeu_ps(zyStore, zyLatch);
+			_mm512_storeu_ps(dwxStore, dwxLatch);
+			_mm512_storeu_ps(dwyStore, dwyLatch);
+			a3antialiasStoreDistance(zxStore, zyStore, dwxStore, dwyStore, 16, cap, iter_out + i, dist_out + i);
+		}
+	}
+}
+
+#endif	// A3_FRACTAL_AVX512
+
+#endif	// A3_FRACTAL_X86
+
+
+// kernels per instruction set, without and with the derivative: the
+//	template with the flag fixed, so samples that need no distance pay
+//	for z alone
+#define A3_ANTIALIAS_KERNEL(target, isa, name, derivative)	\
+target	\
+static void a3fractalAntialiasSpan_##isa##_##name(const float *cx, const float *cy, const unsigned int count, const unsigned int cap, unsigned int *iter_out, float *mag_out, float *dist_out)	\
+{	\
+	a3fractalAntialiasSpanT_##isa(cx, cy, count, cap, iter_out, mag_out, dist_out, derivative);	\
+}
+#define A3_ANTIALIAS_KERNELS(target, isa)	\
+A3_ANTIALIAS_KERNEL(target, isa, escape, 0)	\
+A3_ANTIALIAS_KERNEL(target, isa, estimate, 1)
+#define A3_ANTIALIAS_KERNEL_ROW(isa)	\
+	{ a3fractalAntialiasSpan_##isa##_escape, a3fractalAntialiasSpan_##isa##_estimate }
+
+#define a3antialias_untargeted
+A3_ANTIALIAS_KERNELS(a3antialias_untargeted, scalar)
+#if A3_FRACTAL_X86
+A3_ANTIALIAS_KERNELS(A3_FRACTAL_TARGET("sse2"), sse2)
+A3_ANTIALIAS_KERNELS(A3_FRACTAL_TARGET("avx2"), avx2)
+#if A3_FRACTAL_AVX512
+A3_ANTIALIAS_KERNELS(A3_FRACTAL_TARGET("avx512f"), avx512)
+#endif	// A3_FRACTAL_AVX512
+#endif	// A3_FRACTAL_X86
+
+// kernel table, indexed by instruction set, then without or with the
+//	derivative
+static const a3_FractalAntialiasSpanFunc a3fractalAntialiasSpanFuncs[a3fractal_isaCount][2] = {
+	A3_ANTIALIAS_KERNEL_ROW(scalar),
+#if A3_FRACTAL_X86
+	A3_ANTIALIAS_KERNEL_ROW(sse2),
+	A3_ANTIALIAS_KERNEL_ROW(avx2),
+#if A3_FRACTAL_AVX512
+	A3_ANTIALIAS_KERNEL_ROW(avx512),
+#else	// !A3_FRACTAL_AVX512
+	A3_ANTIALIAS_KERNEL_ROW(avx2),
+#endif	// A3_FRACTAL_AVX512
+#else	// !A3_FRACTAL_X86
+	A3_ANTIALIAS_KERNEL_ROW(scalar),
+	A3_ANTIALIAS_KERNEL_ROW(scalar),
+	A3_ANTIALIAS_KERNEL_ROW(scalar),
+#endif	// A3_FRACTAL_X86
+};
+
+#undef a3antialias_untargeted
+#undef A3_ANTIALIAS_KERNEL_ROW
+#undef A3_ANTIALIAS_KERNELS
+#undef A3_ANTIALIAS_KERNEL
+
+
+//-----------------------------------------------------------------------------
+// render
+
+// first pass: one sample per pixel at its center
+static void a3fractalAntialiasCenterTask(void *args, unsigned int x0, unsigned int y0, unsigned int x1, unsigned int y1, unsigned int workerIndex)
+{
+	const a3_AntialiasPass *pass = (const a3_AntialiasPass *)args;
+	const a3_FractalAntialiasDesc *desc = pass->desc;
+	const unsigned int cap = desc->iterations, lanes = pass->lanes;
+	a3_FractalAntialiasStats *stats = pass->counters + workerIndex;
+	float cx[a3antialias_span], cy[a3antialias_span], mag[a3antialias_span];
+	unsigned int iter[a3antialias_span];
+	unsigned int x, y, i, n, padded, index;
+	float rowY;
+
+	for (y = y0; y < y1; ++y)
+	{
+		rowY = (float)(pass->bottom + ((double)y + 0.5) * pass->dy);
+		for (x = x0; x < x1; x += n)
+		{
+			// fill span, padding to a whole packet with the last pixel
+			n = a3minimum(a3antialias_span, x1 - x);
+			padded = (n + lanes - 1) / lanes * lanes;
+			for (i = 0; i < n; ++i)
+			{
+				cx[i] = (float)(pass->left + ((double)(x + i) + 0.5) * pass->dx);
+				cy[i] = rowY;
+			}
+			for (; i < padded; ++i)
+			{
+				cx[i] = cx[n - 1];
+				cy[i] = rowY;
+			}
+			pass->escape(cx, cy, padded, cap, iter, mag, 0);
+
+			index = y * desc->width + x;
+			for (i = 0; i < n; ++i, ++index)
+			{
+				stats->iterations += a3minimum(iter[i] + 1, cap);
+				pass->iter[index] = iter[i];
+				pass->smooth[index] = iter[i] < cap
+					? (float)iter[i] - 1.0f - log2f(log2f(mag[i]))
+					: a3fractal_interior;
+			}
+		}
+	}
+	stats->samples += (x1 - x0) * (y1 - y0);
+}
+
+
+// estimate the distances of a batch of escaped pixels from their centers
+static void a3fractalAntialiasEstimate(const a3_AntialiasPass *pass, const unsigned int *pending, const unsigned int *slot, const unsigned int n, float *distance, a3_FractalAntialiasStats *stats)
+{
+	const a3_FractalAntialiasDesc *desc = pass->desc;
+	const unsigned int w = desc->width, cap = desc->iterations, lanes = pass->lanes;
+	float cx[a3antialias_span], cy[a3antialias_span], mag[a3antialias_span], dist[a3antialias_span];
+	unsigned int iter[a3antialias_span];
+	unsigned int i, padded, index;
+
+	// same coordinates as the first pass, so the same orbits; batches are
+	//	never empty, and the last pixel pads the packet
+	padded = (n + lanes - 1) / lanes * lanes;
+	for (i = 0; i < padded; ++i)
+	{
+		index = pending[a3minimum(i, n - 1)];
+		cx[i] = (float)(pass->left + ((double)(index % w) + 0.5) * pass->dx);
+		cy[i] = (float)(pass->bottom + ((double)(index / w) + 0.5) * pass->dy);
+	}
+	pass->estimate(cx, cy, padded, cap, iter, mag, dist);
+
+	for (i = 0; i < n; ++i)
+	{
+		stats->iterations += a3minimum(iter[i] + 1, cap);
+		distance[slot[i]] = dist[i];
+	}
+}
+
+
+// supersample a batch of pixels, each grid filling whole packets; samples
+//	in the main cardioid or the period-2 bulb are interior without
+//	iterating, which near the set's largest edges is half of them
+static void a3fractalAntialiasBatch(const a3_AntialiasPass *pass, const unsigned int *pending, const unsigned int n, a3_FractalAntialiasStats *stats)
+{
+	const a3_FractalAntialiasDesc *desc = pass->desc;
+	const unsigned int w = desc->width, cap = desc->iterations, lanes = pass->lanes;
+	const unsigned int grid = pass->grid, count = grid * grid;
+	const double step = 1.0 / (double)grid;
+	float cx[a3antialias_span], cy[a3antialias_span], mag[a3antialias_span];
+	unsigned int iter[a3antialias_span], lane[a3antialias_span];
+	unsigned int sum[4];
+	unsigned char rgba[4], black[4];
+	const unsigned char *color;
+	unsigned int i, j, k, m, x, y, padded;
+	double sx, sy;
+
+	for (i = 0, k = 0, m = 0; i < n; ++i)
+	{
+		x = pending[i] % w;
+		y = pending[i] / w;
+		for (j = 0; j < count; ++j, ++k)
+		{
+			sx = pass->left + ((double)x + ((double)(j % grid) + 0.5) * step) * pass->dx;
+			sy = pass->bottom + ((double)y + ((double)(j / grid) + 0.5) * step) * pass->dy;
+			if (a3fractalInBulb(sx, sy))
+				lane[k] = a3antialias_span;
+			else
+			{
+				cx[m] = (float)sx;
+				cy[m] = (float)sy;
+				lane[k] = m++;
+			}
+		}
+	}
+	if (m)
+	{
+		padded = (m + lanes - 1) / lanes * lanes;
+		for (i = m; i < padded; ++i)
+		{
+			cx[i] = cx[m - 1];
+			cy[i] = cy[m - 1];
+		}
+		pass->escape(cx, cy, padded, cap, iter, mag, 0);
+		for (i = 0; i < m; ++i)
+			stats->iterations += a3minimum(iter[i] + 1, cap);
+	}
+
+	// average the samples' colors; interior ones are all the same
+	a3fractalShade(a3fractal_interior, black);
+	for (i = 0, k = 0; i < n; ++i)
+	{
+		sum[0] = sum[1] = sum[2] = sum[3] = 0;
+		for (j = 0; j < count; ++j, ++k)
+		{
+			m = lane[k];
+			color = black;
+			if (m < a3antialias_span && iter[m] < cap)
+			{
+				a3fractalShade((float)iter[m] - 1.0f - log2f(log2f(mag[m])), rgba);
+				color = rgba;
+			}
+			sum[0] += color[0];
+			sum[1] += color[1];
+			sum[2] += color[2];
+			sum[3] += color[3];
+		}
+		for (j = 0; j < 4; ++j)
+			desc->rgba_out[pending[i] * 4 + j] = (unsigned char)((sum[j] + count / 2) / count);
+	}
+	stats->supersampled += n;
+	stats->samples += n * count;
+}
+
+
+// second pass: flag the pixels that need more samples, supersample them
+//	and shade the rest
+static void a3fractalAntialiasSampleTask(void *args, unsigned int x0, unsigned int y0, unsigned int x1, unsigned int y1, unsigned int workerIndex)
+{
+	const a3_AntialiasPass *pass = (const a3_AntialiasPass *)args;
+	const a3_FractalAntialiasDesc *desc = pass->desc;
+	const unsigned int w = desc->width, h = desc->height, cap = desc->iterations;
+	const unsigned int batch = a3antialias_span / (pass->grid * pass->grid);
+	a3_FractalAntialiasStats *stats = pass->counters + workerIndex;
+	float distance[a3antialias_tile * a3antialias_tile];
+	unsigned char flagged[a3antialias_tile * a3antialias_tile];
+	unsigned int pending[a3antialias_span], slot[a3antialias_span];
+	unsigned int x, y, n, index, local, center, other;
+	unsigned int nx0, nx1, ny0, ny1, ix, iy;
+	int interior;
+
+	// flag by neighbours first; only the escaped pixels they leave need a
+	//	distance, and interior ones, which cost the most, never do, so the
+	//	derivative is carried for those alone, gathered into full spans
+	for (y = y0, n = 0, local = 0; y < y1; ++y)
+		for (x = x0, index = y * w + x0; x < x1; ++x, ++index, ++local)
+		{
+			center = pass->iter[index];
+			interior = center >= cap;
+			flagged[local] = 0;
+			distance[local] = 0.0f;
+			if (pass->grid > 1)
+			{
+				nx0 = x ? x - 1 : x;
+				nx1 = a3minimum(x + 2, w);
+				ny0 = y ? y - 1 : y;
+				ny1 = a3minimum(y + 2, h);
+				for (iy = ny0; iy < ny1 && !flagged[local]; ++iy)
+					for (ix = nx0; ix < nx1 && !flagged[local]; ++ix)
+					{
+						other = pass->iter[iy * w + ix];
+						if ((other >= cap) != interior)
+							flagged[local] = 1;
+						else if (!interior && (other > center ? other - center : center - other) >= pass->spread)
+							flagged[local] = 1;
+					}
+			}
+			if (!interior && ((pass->grid > 1 && !flagged[local]) || desc->distance_out_opt))
+			{
+				pending[n] = index;
+				slot[n++] = local;
+				if (n == a3antialias_span)
+				{
+					a3fractalAntialiasEstimate(pass, pending, slot, n, distance, stats);
+					n = 0;
+				}
+			}
+		}
+	if (n)
+		a3fractalAntialiasEstimate(pass, pending, slot, n, distance, stats);
+
+	// then by distance
+	for (y = y0, n = 0, local = 0; y < y1; ++y)
+		for (x = x0, index = y * w + x0; x < x1; ++x, ++index, ++local)
+		{
+			if (desc->distance_out_opt)
+				desc->distance_out_opt[index] = distance[local];
+			if (pass->grid > 1 && !flagged[local] && pass->iter[index] < cap && distance[local] < pass->limit)
+			{
+				flagged[local] = 1;
+				++stats->nearBoundary;
+			}
+			if (!flagged[local])
+				a3fractalShade(pass->smooth[index], desc->rgba_out + index * 4);
+			else
+			{
+				pending[n++] = index;
+				if (n == batch)
+				{
+					a3fractalAntialiasBatch(pass, pending, n, stats);
+					n = 0;
+				}
+			}
+		}
+	if (n)
+		a3fractalAntialiasBatch(pass, pending, n, stats);
+}
+
+
+int a3fractalAntialiasRender(const a3_FractalAntialiasDesc *desc, a3_ThreadPool *pool_opt, a3_FractalAntialiasStats *stats_out_opt)
+{
+	a3_FractalAntialiasStats stats = { 0 };
+	a3_AntialiasPass pass[1];
+	a3_FractalISA isa, best;
+	unsigned int *iter = 0;
+	float *smooth = 0;
+	unsigned int workers, pixels, i;
+
+	if (desc && desc->width && desc->height && desc->rgba_out && desc->samples <= a3fractal_antialiasSamplesMax)
+	{
+		// the caller's buffers hold the first pass where given
+		pixels = desc->width * desc->height;
+		workers = a3threadPoolGetWorkerCount(pool_opt) + 1;
+		pass->counters = (a3_FractalAntialiasStats *)calloc(workers, sizeof(a3_FractalAntialiasStats));
+		if (!desc->iter_out_opt)
+			iter = (unsigned int *)malloc(pixels * sizeof(unsigned int));
+		if (!desc->smooth_out_opt)
+			smooth = (float *)malloc(pixels * sizeof(float));
+		if (!pass->counters || (!iter && !desc->iter_out_opt) || (!smooth && !desc->smooth_out_opt))
+		{
+			free(pass->counters);
+			free(iter);
+			free(smooth);
+			return 0;
+		}
+
+		best = a3fractalDetectISA();
+		isa = desc->isa;
+		if (isa == a3fractal_isaAuto || isa > best)
+			isa = best;
+		pass->escape = a3fractalAntialiasSpanFuncs[isa][0];
+		pass->estimate = a3fractalAntialiasSpanFuncs[isa][1];
+		pass->lanes = a3fractalGetISALanes(isa);
+
+		pass->desc = desc;
+		pass->grid = desc->samples ? desc->samples : a3fractal_antialiasSamples;
+		pass->spread = desc->spread ? desc->spread : a3fractal_antialiasSpread;
+		pass->dx = desc->view.width / (double)desc->width;
+		pass->dy = desc->view.height / (double)desc->height;
+		pass->left = desc->view.centerX - 0.5 * desc->view.width;
+		pass->bottom = desc->view.centerY - 0.5 * desc->view.height;
+		pass->limit = (desc->threshold > 0.0f ? desc->threshold : 1.0f) * (float)a3maximum(pass->dx, pass->dy);
+		pass->iter = desc->iter_out_opt ? desc->iter_out_opt : iter;
+		pass->smooth = desc->smooth_out_opt ? desc->smooth_out_opt : smooth;
+
+		// the second pass reads the first's neighbours, so it waits for all
+		if (a3threadPoolParallelFor2D(pool_opt, 0, a3fractalAntialiasCenterTask, pass, desc->width, desc->height, a3antialias_tile, a3antialias_tile) < 0 ||
+			a3threadPoolParallelFor2D(pool_opt, 0, a3fractalAntialiasSampleTask, pass, desc->width, desc->height, a3antialias_tile, a3antialias_tile) < 0)
+			pixels = 0;
+
+		for (i = 0; i < workers && pixels; ++i)
+		{
+			stats.supersampled += pass->counters[i].supersampled;
+			stats.nearBoundary += pass->counters[i].nearBoundary;
+			stats.samples += pass->counters[i].samples;
+			stats.iterations += pass->counters[i].iterations;
+		}
+		if (stats_out_opt && pixels)
+			*stats_out_opt = stats;
+
+		free(pass->counters);
+		free(iter);
+		free(smooth);
+		return (int)pixels;
+	}
+	return -1;
+}
+
+
+//-----------------------------------------------------------------------------
@@ -0,0 +1,128 @@
+/*
+	animal3D SDK: Minimal 3D Animation Framework
+	Fractals Midterm: CPU fractal engines
+
+	a3_DemoFractalAntialias.h
+	Adaptive supersampling of the Mandelbrot shader.
+
+	Supersampling every pixel of an escape-time image costs as many times
+	one sample as there are samples, but only the pixels that straddle the
+	set's boundary, or the thin filaments around it, alias; the smooth
+	iteration count is already continuous everywhere else.
+
+	The first pass takes one sample per pixel, the same sample and the same
+	iteration count as the escape-time engine. A pixel is then supersampled
+	if the iteration counts of its neighbours differ from its own by
+	enough that the palette changes faster than the pixels do, or if its
+	distance to the set is under a pixel across, so a filament may pass
+	through it; the distance is estimated by carrying the derivative of
+	the orbit alongside z. The other pixels keep their one sample.
+
+	For posters most pixels are far from the boundary, so the image costs
+	little more than one sample per pixel while its edges get the full
+	grid of samples.
+*/
+
+#ifndef __ANIMAL3D_DEMOFRACTALANTIALIAS_H
+#define __ANIMAL3D_DEMOFRACTALANTIALIAS_H
+
+
+#include "a3_DemoFractalEscape.h"
+
+
+//-----------------------------------------------------------------------------
+
+#ifdef __cplusplus
+extern "C"
+{
+#else	// !__cplusplus
+	typedef struct a3_FractalAntialiasDesc		a3_FractalAntialiasDesc;
+	typedef struct a3_FractalAntialiasStats		a3_FractalAntialiasStats;
+#endif	// __cplusplus
+
+
+//-----------------------------------------------------------------------------
+
+	// default and largest grid edge of a supersampled pixel; the default
+	//	is 4 x 4 = 16 samples
+#define a3fractal_antialiasSamples		4
+#define a3fractal_antialiasSamplesMax	8
+
+	// default iteration difference between neighbours that supersamples
+#define a3fractal_antialiasSpread		4
+
+
+	// adaptive render description
+	//	member view: window into the complex plane
+	//	members width, height: image dimensions in pixels
+	//	member iterations: iteration cap, same meaning as 'uIter'
+	//	member isa: instruction set to use; auto picks at runtime
+	//	member samples: grid edge of a supersampled pixel, up to
+	//		'a3fractal_antialiasSamplesMax'; 0 uses default, 1 never
+	//		supersamples
+	//	member threshold: distance estimate, in pixel widths, under which
+	//		a pixel is supersampled; 0 means 1
+	//	member spread: difference of escape iterations with any of the 8
+	//		neighbours at or over which a pixel is supersampled; 0 uses
+	//		default; a neighbour that never escapes when the pixel does,
+	//		or the other way around, always counts
+	//	members smooth_out_opt, iter_out_opt: optional outputs of the
+	//		pixel's center sample, same as the escape-time engine
+	//	member distance_out_opt: optional distance estimate per pixel, in
+	//		plane units; interior pixels store 0
+	//	member rgba_out: non-null 8-bit RGBA color per pixel, the average
+	//		of its samples' colors
+	// all buffers are row-major, row 0 at the bottom (texcoord v = 0)
+	struct a3_FractalAntialiasDesc
+	{
+		a3_FractalView view;
+		unsigned int width, height;
+		unsigned int iterations;
+		a3_FractalISA isa;
+		unsigned int samples;
+		float threshold;
+		unsigned int spread;
+		float *smooth_out_opt;
+		unsigned int *iter_out_opt;
+		float *distance_out_opt;
+		unsigned char *rgba_out;
+	};
+
+
+	// per-frame counters
+	//	member supersampled: pixels supersampled
+	//	member nearBoundary: of those, pixels flagged by the distance
+	//		estimate alone; the rest were flagged by their neighbours
+	//	member samples: samples taken, counting the first pass
+	//	member iterations: sample iterations performed, counting the
+	//		distance estimates
+	struct a3_FractalAntialiasStats
+	{
+		unsigned int supersampled;
+		unsigned int nearBoundary;
+		unsigned long long samples;
+		unsigned long long iterations;
+	};
+
+
+//-----------------------------------------------------------------------------
+
+	// Render an image, supersampling only the pixels that need it.
+	//	param desc: non-null pointer to render description
+	//	param pool_opt: optional pool; renders on this thread if null
+	//	param stats_out_opt: optional pointer to frame counters
+	//	return: number of pixels rendered if success
+	//	return: 0 if fail (out of memory)
+	//	return: -1 if invalid params
+	int a3fractalAntialiasRender(const a3_FractalAntialiasDesc *desc, a3_ThreadPool *pool_opt, a3_FractalAntialiasStats *stats_out_opt);
+
+
+//-----------------------------------------------------------------------------
+
+
+#ifdef __cplusplus
+}
+#endif	// __cplusplus
+
+
+#endif	// !__ANIMAL3D_DEMOFRACTALANTIALIAS_H
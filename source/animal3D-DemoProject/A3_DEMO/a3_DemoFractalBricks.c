@@ -0,0 +1,465 @@
+/*
+	animal3D SDK: Minimal 3D Animation Framework
+	Fractals Midterm: CPU fractal engines
+
+	a3_DemoFractalBricks.c
+	Sparse brick cache implementation.
+*/
+
+#include "a3_DemoFractalBricks.h"
+#include "_utilities/a3_DemoAtomic.h"
+
+#include "animal3D/a3/a3macros.h"
+
+#include <math.h>
+#include <stdlib.h>
+
+
+//-----------------------------------------------------------------------------
+// platform primitives: lock
+
+#ifdef _WIN32
+#include <Windows.h>
+
+typedef SRWLOCK				a3_BrickLock;
+
+static void a3brickLockInit(a3_BrickLock *lock) { InitializeSRWLock(lock); }
+static void a3brickLockTerm(a3_BrickLock *lock) { (void)lock; }
+static void a3brickLock(a3_BrickLock *lock) { AcquireSRWLockExclusive(lock); }
+static void a3brickUnlock(a3_BrickLock *lock) { ReleaseSRWLockExclusive(lock); }
+
+#else	// !_WIN32
+#include <pthread.h>
+
+typedef pthread_mutex_t		a3_BrickLock;
+
+static void a3brickLockInit(a3_BrickLock *lock) { pthread_mutex_init(lock, 0); }
+static void a3brickLockTerm(a3_BrickLock *lock) { pthread_mutex_destroy(lock); }
+static void a3brickLock(a3_BrickLock *lock) { pthread_mutex_lock(lock); }
+static void a3brickUnlock(a3_BrickLock *lock) { pthread_mutex_unlock(lock); }
+
+#endif	// _WIN32
+
+
+//-----------------------------------------------------------------------------
+// internal structures
+
+// sample intervals along a brick edge; neighbors share their face samples
+#define a3brick_span		(a3fractal_brickEdge - 1)
+
+// quantized samples cover distances up to this many intervals; beyond
+//	it they saturate, which still bounds the distance from below
+#define a3brick_range		(float)a3fractal_brickEdge
+
+// coarse grid states; non-negative states are the slot holding samples;
+//	a starved brick is near a surface but found no slot, and keeps asking
+#define a3brick_unknown		-1
+#define a3brick_coarse		-2
+#define a3brick_baking		-3
+#define a3brick_starved		-4
+
+// slots compared per eviction, starting from a rotating cursor
+#define a3brick_window		64
+
+// slot holding no brick
+#define a3brick_none		0xffffffffu
+
+
+struct a3_FractalBrickCache
+{
+	a3_FractalBrickDesc desc;
+	float spacing, invSpacing, quantum, invQuantum, margin, halfDiagonal, lipschitz;
+	unsigned int grid[3], cellCount, slotCount, resident, cursor;
+
+	// coarse grid: state, and field at the center for coarse bricks
+	volatile long *cellState;
+	float *cellCenter;
+
+	// sampled bricks: samples, a version that is odd while they are
+	//	written, the cell held, and the clock at last use
+	signed char *samples;
+	volatile long *slotVersion;
+	unsigned int *slotCell;
+	volatile long *slotUsed;
+
+	volatile long clock;
+	a3_BrickLock lock[1];
+};
+
+
+//-----------------------------------------------------------------------------
+// baking
+
+// position of the first sample of a brick
+static void a3fractalBrickOrigin(const a3_FractalBrickCache *cache, const unsigned int cell, float *origin_out)
+{
+	const unsigned int bx = cell % cache->grid[0];
+	const unsigned int by = cell / cache->grid[0] % cache->grid[1];
+	const unsigned int bz = cell / cache->grid[0] / cache->grid[1];
+	const float edge = cache->spacing * (float)a3brick_span;
+	origin_out[0] = cache->desc.boundsMin[0] + (float)bx * edge;
+	origin_out[1] = cache->desc.boundsMin[1] + (float)by * edge;
+	origin_out[2] = cache->desc.boundsMin[2] + (float)bz * edge;
+}
+
+// evaluate and quantize every sample of a brick, rounding down
+static void a3fractalBrickBake(const a3_FractalBrickCache *cache, const unsigned int cell, signed char *samples_out)
+{
+	float origin[3], q;
+	unsigned int i, j, k;
+	a3fractalBrickOrigin(cache, cell, origin);
+	for (k = 0; k < a3fractal_brickEdge; ++k)
+		for (j = 0; j < a3fractal_brickEdge; ++j)
+			for (i = 0; i < a3fractal_brickEdge; ++i)
+			{
+				q = floorf(cache->desc.field(cache->desc.user,
+					origin[0] + (float)i * cache->spacing,
+					origin[1] + (float)j * cache->spacing,
+					origin[2] + (float)k * cache->spacing) * cache->invQuantum);
+				q = a3maximum(q, -127.0f);
+				q = a3minimum(q, 127.0f);
+				*(samples_out++) = (signed char)q;
+			}
+}
+
+// pick a slot for a new brick, evicting the least recently used of a
+//	window of slots if the pool is full; call with the lock held
+static unsigned int a3fractalBrickClaim(a3_FractalBrickCache *cache, a3_FractalBrickStats *stats_opt)
+{
+	unsigned int slot = a3brick_none, i, s;
+	long age, oldest = -1, now;
+	if (cache->resident < cache->slotCount)
+		return cache->resident++;
+	if (!cache->slotCount)
+		return slot;
+
+	now = cache->clock;
+	for (i = 0; i < a3brick_window && i < cache->slotCount; ++i)
+	{
+		s = (cache->cursor + i) % cache->slotCount;
+		if (cache->slotVersion[s] & 1)
+			continue;
+		age = now - cache->slotUsed[s];
+		if (age > oldest)
+		{
+			oldest = age;
+			slot = s;
+		}
+	}
+	cache->cursor = (cache->cursor + a3brick_window) % cache->slotCount;
+	if (slot != a3brick_none && cache->slotCell[slot] != a3brick_none)
+	{
+		a3atomicStore(cache->cellState + cache->slotCell[slot], a3brick_unknown);
+		if (stats_opt)
+			++stats_opt->evicted;
+	}
+	return slot;
+}
+
+// bake a brick into the slot claimed for it; call with the lock held,
+//	which is released before baking
+static void a3fractalBrickFill(a3_FractalBrickCache *cache, const unsigned int cell, const unsigned int slot)
+{
+	a3atomicAdd(cache->slotVersion + slot, 1);
+	cache->slotCell[slot] = cell;
+	cache->slotUsed[slot] = ++cache->clock;
+	a3atomicStore(cache->cellState + cell, a3brick_baking);
+	a3brickUnlock(cache->lock);
+
+	a3fractalBrickBake(cache, cell, cache->samples + slot * a3fractal_brickBytes);
+	a3atomicAdd(cache->slotVersion + slot, 1);
+	a3atomicStore(cache->cellState + cell, (long)slot);
+}
+
+
+//-----------------------------------------------------------------------------
+
+int a3fractalBrickCacheCreate(a3_FractalBrickCache **cache_out, const a3_FractalBrickDesc *desc)
+{
+	a3_FractalBrickCache *cache;
+	float extent, edge;
+	unsigned int k, i;
+	unsigned long long cells, slots;
+
+	if (cache_out && desc && desc->field && desc->spacing > 0.0f)
+	{
+		if (*cache_out)
+			return 0;
+		for (k = 0; k < 3; ++k)
+			if (!(desc->boundsMax[k] > desc->boundsMin[k]))
+				return -1;
+
+		cache = (a3_FractalBrickCache *)calloc(1, sizeof(a3_FractalBrickCache));
+		if (!cache)
+			return 0;
+		cache->desc = *desc;
+		cache->spacing = desc->spacing;
+		cache->invSpacing = 1.0f / desc->spacing;
+		cache->lipschitz = desc->lipschitz > 0.0f ? desc->lipschitz : 1.0f;
+		cache->quantum = a3brick_range * desc->spacing / 127.0f;
+		cache->invQuantum = 1.0f / cache->quantum;
+
+		// a point is at most a cell diagonal from every corner it is
+		//	interpolated from, and a brick center half a brick diagonal from
+		//	any point in the brick
+		cache->margin = cache->lipschitz * desc->spacing * 1.7320508f;
+		cache->halfDiagonal = 0.5f * (float)a3brick_span * desc->spacing * 1.7320508f;
+
+		// the grid covers the bounds, rounded up to whole bricks
+		edge = desc->spacing * (float)a3brick_span;
+		for (k = 0, cells = 1; k < 3; ++k)
+		{
+			extent = desc->boundsMax[k] - desc->boundsMin[k];
+			cache->grid[k] = a3maximum((unsigned int)ceilf(extent / edge), 1u);
+			cache->desc.boundsMax[k] = desc->boundsMin[k] + (float)cache->grid[k] * edge;
+			cells *= cache->grid[k];
+		}
+		slots = desc->budget / a3fractal_brickBytes;
+		slots = a3minimum(slots, cells);
+		if (cells > 0x7fffffffu)
+		{
+			free(cache);
+			return -1;
+		}
+		cache->cellCount = (unsigned int)cells;
+		cache->slotCount = (unsigned int)slots;
+
+		cache->cellState = (volatile long *)malloc((size_t)cells * sizeof(long));
+		cache->cellCenter = (float *)calloc((size_t)cells, sizeof(float));
+		cache->samples = (signed char *)malloc((size_t)(slots * a3fractal_brickBytes + 1));
+		cache->slotVersion = (volatile long *)calloc((size_t)(slots + 1), sizeof(long));
+		cache->slotCell = (unsigned int *)malloc((size_t)(slots + 1) * sizeof(unsigned int));
+		cache->slotUsed = (volatile long *)calloc((size_t)(slots + 1), sizeof(long));
+		if (!cache->cellState || !cache->cellCenter || !cache->samples || !cache->slotVersion || !cache->slotCell || !cache->slotUsed)
+		{
+			free((void *)cache->cellState);
+			free(cache->cellCenter);
+			free(cache->samples);
+			free((void *)cache->slotVersion);
+			free(cache->slotCell);
+			free((void *)cache->slotUsed);
+			free(cache);
+			return 0;
+		}
+		for (i = 0; i < cache->cellCount; ++i)
+			cache->cellState[i] = a3brick_unknown;
+		for (i = 0; i < cache->slotCount; ++i)
+			cache->slotCell[i] = a3brick_none;
+		a3brickLockInit(cache->lock);
+
+		*cache_out = cache;
+		return (int)cache->slotCount;
+	}
+	return -1;
+}
+
+int a3fractalBrickCacheRelease(a3_FractalBrickCache **cache)
+{
+	if (cache)
+	{
+		if (*cache)
+		{
+			a3brickLockTerm((*cache)->lock);
+			free((void *)(*cache)->cellState);
+			free((*cache)->cellCenter);
+			free((*cache)->samples);
+			free((void *)(*cache)->slotVersion);
+			free((*cache)->slotCell);
+			free((void *)(*cache)->slotUsed);
+			free(*cache);
+			*cache = 0;
+		}
+		return 1;
+	}
+	return -1;
+}
+
+int a3fractalBrickCacheSample(a3_FractalBrickCache *cache, float x, float y, float z, float *bound_out, a3_FractalBrickStats *stats_opt)
+{
+	const signed char *s;
+	float u[3], f[3], origin[3], c, dx, dy, dz, bound;
+	unsigned int b[3], l[3], k, cell, slot;
+	long state, version, now;
+	int baked = 0;
+
+	if (cache && bound_out)
+	{
+		// nothing is known outside the grid
+		u[0] = (x - cache->desc.boundsMin[0]) * cache->invSpacing;
+		u[1] = (y - cache->desc.boundsMin[1]) * cache->invSpacing;
+		u[2] = (z - cache->desc.boundsMin[2]) * cache->invSpacing;
+		if (u[0] < 0.0f || u[1] < 0.0f || u[2] < 0.0f
+			|| u[0] >= (float)(cache->grid[0] * a3brick_span)
+			|| u[1] >= (float)(cache->grid[1] * a3brick_span)
+			|| u[2] >= (float)(cache->grid[2] * a3brick_span))
+			return 0;
+		if (stats_opt)
+			++stats_opt->lookups;
+		for (k = 0; k < 3; ++k)
+		{
+			b[k] = a3minimum((unsigned int)u[k] / a3brick_span, cache->grid[k] - 1);
+			u[k] -= (float)(b[k] * a3brick_span);
+		}
+		cell = (b[2] * cache->grid[1] + b[1]) * cache->grid[0] + b[0];
+
+		for (;;)
+		{
+			state = a3atomicLoad(cache->cellState + cell);
+
+			// far from any surface, or no slot yet: the center bounds the
+			//	whole brick
+			if (state == a3brick_coarse || state == a3brick_starved)
+			{
+				a3fractalBrickOrigin(cache, cell, origin);
+				c = 0.5f * (float)a3brick_span * cache->spacing;
+				dx = x - origin[0] - c;
+				dy = y - origin[1] - c;
+				dz = z - origin[2] - c;
+				bound = cache->cellCenter[cell] - cache->lipschitz * sqrtf(dx * dx + dy * dy + dz * dz);
+
+				// a starved brick asks for a slot again wherever the center
+				//	is no use, so it is sampled once one can be had
+				if (state == a3brick_starved && !baked && bound <= cache->margin)
+				{
+					a3brickLock(cache->lock);
+					slot = a3brick_none;
+					if (cache->cellState[cell] == a3brick_starved)
+						slot = a3fractalBrickClaim(cache, stats_opt);
+					if (slot != a3brick_none)
+					{
+						if (stats_opt)
+							++stats_opt->baked;
+						baked = 1;
+						a3fractalBrickFill(cache, cell, slot);
+						continue;
+					}
+					a3brickUnlock(cache->lock);
+				}
+				*bound_out = bound;
+				if (stats_opt && !baked)
+					++stats_opt->hits;
+				return 1;
+			}
+
+			// sampled: interpolate, then check the slot was not rewritten
+			//	while it was read
+			if (state >= 0)
+			{
+				slot = (unsigned int)state;
+				version = a3atomicLoad(cache->slotVersion + slot);
+				if ((version & 1) || cache->slotCell[slot] != cell)
+					break;
+				for (k = 0; k < 3; ++k)
+				{
+					l[k] = a3minimum((unsigned int)u[k], a3brick_span - 1);
+					f[k] = u[k] - (float)l[k];
+				}
+				s = cache->samples + slot * a3fractal_brickBytes
+					+ (l[2] * a3fractal_brickEdge + l[1]) * a3fractal_brickEdge + l[0];
+				bound =
+					(((float)s[0] * (1.0f - f[0]) + (float)s[1] * f[0]) * (1.0f - f[1])
+					+ ((float)s[a3fractal_brickEdge] * (1.0f - f[0]) + (float)s[a3fractal_brickEdge + 1] * f[0]) * f[1]) * (1.0f - f[2])
+					+ (((float)s[a3fractal_brickEdge * a3fractal_brickEdge] * (1.0f - f[0]) + (float)s[a3fractal_brickEdge * a3fractal_brickEdge + 1] * f[0]) * (1.0f - f[1])
+					+ ((float)s[a3fractal_brickEdge * a3fractal_brickEdge + a3fractal_brickEdge] * (1.0f - f[0]) + (float)s[a3fractal_brickEdge * a3fractal_brickEdge + a3fractal_brickEdge + 1] * f[0]) * f[1]) * f[2];
+				a3atomicFence();
+				if (a3atomicLoad(cache->slotVersion + slot) != version)
+					break;
+
+				// the clock only moves on a bake, so most uses store nothing
+				now = cache->clock;
+				if (cache->slotUsed[slot] != now)
+					cache->slotUsed[slot] = now;
+				*bound_out = bound * cache->quantum - cache->margin;
+				if (stats_opt && !baked)
+					++stats_opt->hits;
+				return 1;
+			}
+			if (state == a3brick_baking)
+				break;
+
+			// first lookup since the brick was created or evicted: the
+			//	center decides whether a surface can pass through it
+			if (stats_opt && !baked)
+				++stats_opt->baked;
+			baked = 1;
+			a3fractalBrickOrigin(cache, cell, origin);
+			c = 0.5f * (float)a3brick_span * cache->spacing;
+			c = cache->desc.field(cache->desc.user, origin[0] + c, origin[1] + c, origin[2] + c);
+
+			a3brickLock(cache->lock);
+			if (cache->cellState[cell] != a3brick_unknown)
+			{
+				a3brickUnlock(cache->lock);
+				continue;
+			}
+			cache->cellCenter[cell] = c;
+
+			// no surface, or no room ever: the center is all there is
+			if (fabsf(c) > cache->lipschitz * cache->halfDiagonal || !cache->slotCount)
+			{
+				a3atomicStore(cache->cellState + cell, a3brick_coarse);
+				a3brickUnlock(cache->lock);
+				continue;
+			}
+			slot = a3fractalBrickClaim(cache, stats_opt);
+			if (slot == a3brick_none)
+			{
+				a3atomicStore(cache->cellState + cell, a3brick_starved);
+				a3brickUnlock(cache->lock);
+				continue;
+			}
+			a3fractalBrickFill(cache, cell, slot);
+		}
+
+		if (stats_opt)
+			++stats_opt->failed;
+		return 0;
+	}
+	return -1;
+}
+
+float a3fractalBrickCacheGetMargin(const a3_FractalBrickCache *cache)
+{
+	if (cache)
+		return cache->margin;
+	return 0.0f;
+}
+
+int a3fractalBrickCacheGetUsage(a3_FractalBrickCache *cache, unsigned int *resident_out_opt, unsigned long long *bytes_out_opt)
+{
+	unsigned int resident;
+	if (cache)
+	{
+		a3brickLock(cache->lock);
+		resident = cache->resident;
+		a3brickUnlock(cache->lock);
+		if (resident_out_opt)
+			*resident_out_opt = resident;
+		if (bytes_out_opt)
+			*bytes_out_opt = (unsigned long long)resident * a3fractal_brickBytes
+				+ (unsigned long long)cache->cellCount * (sizeof(long) + sizeof(float));
+		return 1;
+	}
+	return -1;
+}
+
+int a3fractalBrickCacheClear(a3_FractalBrickCache *cache)
+{
+	unsigned int i;
+	if (cache)
+	{
+		a3brickLock(cache->lock);
+		for (i = 0; i < cache->cellCount; ++i)
+			cache->cellState[i] = a3brick_unknown;
+		for (i = 0; i < cache->slotCount; ++i)
+			cache->slotCell[i] = a3brick_none;
+		cache->resident = 0;
+		cache->cursor = 0;
+		a3brickUnlock(cache->lock);
+		return 1;
+	}
+	return -1;
+}
+
+
+//-----------------------------------------------------------------------------
@@ -0,0 +1,152 @@
+/*
+	animal3D SDK: Minimal 3D Animation Framework
+	Fractals Midterm: CPU fractal engines
+
+	a3_DemoFractalBricks.h
+	Sparse brick cache for static distance fields.
+
+	A static scene's distance field is the same every frame, but a march
+	evaluates it from scratch at every step. The cache bakes it lazily
+	into a sparse brick map: the field's bounds are split into a coarse
+	grid of bricks of 8x8x8 samples, and the first lookup in a brick
+	evaluates its center; a brick that is far from the surface keeps only
+	that value, one that is near it gets all its samples evaluated and
+	quantized to 8 bits. Lookups return a lower bound on the distance,
+	interpolated from the samples less the most interpolation can be
+	off by, so a march can step by it safely and evaluate the field
+	itself only where the bound gets small.
+
+	Sampled bricks live in a fixed pool sized by a memory budget; when it
+	is full the least recently used brick is evicted and baked again on
+	its next lookup. A brick near the surface that finds no slot free,
+	every one it could evict being baked, keeps its center and asks
+	again on the next lookup the center cannot answer. Lookups do not
+	lock: a brick being baked or evicted while it is read makes the
+	lookup fail, and the caller evaluates the field instead.
+*/
+
+#ifndef __ANIMAL3D_DEMOFRACTALBRICKS_H
+#define __ANIMAL3D_DEMOFRACTALBRICKS_H
+
+
+//-----------------------------------------------------------------------------
+
+#ifdef __cplusplus
+extern "C"
+{
+#else	// !__cplusplus
+	typedef struct a3_FractalBrickCache			a3_FractalBrickCache;
+	typedef struct a3_FractalBrickDesc			a3_FractalBrickDesc;
+	typedef struct a3_FractalBrickStats			a3_FractalBrickStats;
+#endif	// __cplusplus
+
+
+//-----------------------------------------------------------------------------
+
+	// samples along each edge of a brick, and bytes per sampled brick
+#define a3fractal_brickEdge			8
+#define a3fractal_brickBytes		(a3fractal_brickEdge * a3fractal_brickEdge * a3fractal_brickEdge)
+
+
+	// distance field function:
+	//	-> param user: pointer given in the description
+	//	-> params x, y, z: point
+	//	-> return: distance estimate at the point
+	typedef float(*a3_fractalbrickfunc)(void *user, float x, float y, float z);
+
+
+	// brick cache description
+	//	member field: non-null distance field to cache
+	//	member user: optional pointer passed to the field
+	//	members boundsMin, boundsMax: box to cache the field in, rounded
+	//		up to whole bricks; lookups outside it get no bound
+	//	member spacing: distance between samples
+	//	member lipschitz: largest rate at which the field changes, which
+	//		scales the interpolation margin; 0 means 1
+	//	member budget: bytes of sampled bricks to keep at most
+	struct a3_FractalBrickDesc
+	{
+		a3_fractalbrickfunc field;
+		void *user;
+		float boundsMin[3], boundsMax[3];
+		float spacing;
+		float lipschitz;
+		unsigned long long budget;
+	};
+
+
+	// lookup counters, kept by the caller, added to
+	//	member lookups: bounds asked for inside the bounds
+	//	member hits: lookups answered without evaluating the field
+	//	member baked: lookups that evaluated a brick center or baked a brick
+	//	member evicted: bricks evicted to make room
+	//	member failed: lookups that found their brick being baked or evicted
+	struct a3_FractalBrickStats
+	{
+		unsigned long long lookups;
+		unsigned long long hits;
+		unsigned long long baked;
+		unsigned long long evicted;
+		unsigned long long failed;
+	};
+
+
+//-----------------------------------------------------------------------------
+
+	// Create an empty cache.
+	//	param cache_out: non-null pointer to cache pointer; must be null
+	//	param desc: non-null pointer to description
+	//	return: number of bricks the budget holds if success
+	//	return: 0 if fail (already created or out of memory)
+	//	return: -1 if invalid params
+	int a3fractalBrickCacheCreate(a3_FractalBrickCache **cache_out, const a3_FractalBrickDesc *desc);
+
+	// Release a cache.
+	//	param cache: non-null pointer to cache pointer; reset to null
+	//	return: 1 if success
+	//	return: -1 if invalid params
+	int a3fractalBrickCacheRelease(a3_FractalBrickCache **cache);
+
+	// Get a lower bound on the field's distance at a point, baking its
+	//	brick if it is not cached; safe to call from several threads.
+	//	param cache: non-null pointer to cache
+	//	params x, y, z: point
+	//	param bound_out: non-null pointer to bound; the field is at least
+	//		this at the point, for points outside surfaces
+	//	param stats_opt: optional pointer to counters, added to
+	//	return: 1 if success
+	//	return: 0 if no bound (outside the bounds or brick busy); evaluate
+	//		the field instead
+	//	return: -1 if invalid params
+	int a3fractalBrickCacheSample(a3_FractalBrickCache *cache, float x, float y, float z, float *bound_out, a3_FractalBrickStats *stats_opt);
+
+	// Get the distance below which bounds are no better than the field.
+	//	param cache: non-null pointer to cache
+	//	return: interpolation margin, or 0 if invalid params
+	float a3fractalBrickCacheGetMargin(const a3_FractalBrickCache *cache);
+
+	// Get the cache's memory use.
+	//	param cache: non-null pointer to cache
+	//	param resident_out_opt: optional pointer to sampled bricks held
+	//	param bytes_out_opt: optional pointer to bytes in use: sampled
+	//		bricks and the coarse grid
+	//	return: 1 if success
+	//	return: -1 if invalid params
+	int a3fractalBrickCacheGetUsage(a3_FractalBrickCache *cache, unsigned int *resident_out_opt, unsigned long long *bytes_out_opt);
+
+	// Drop every brick, e.g. after the field has changed.
+	//	param cache: non-null pointer to cache; no lookups may be running
+	//	return: 1 if success
+	//	return: -1 if invalid params
+	int a3fractalBrickCacheClear(a3_FractalBrickCache *cache);
+
+
+//-----------------------------------------------------------------------------
+
+
+#ifdef __cplusplus
+}
+#endif	// __cplusplus
+
+
+#endif	// !__ANIMAL3D_DEMOFRACTALBRICKS_H
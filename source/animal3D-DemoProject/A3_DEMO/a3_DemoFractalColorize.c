@@ -0,0 +1,1188 @@
+/*
+	animal3D SDK: Minimal 3D Animation Framework
+	Fractals Midterm: CPU fractal engines
+
+	a3_DemoFractalColorize.c
+	Field persistence and palette implementation.
+
+	Every instruction set runs the same arithmetic in the same order, with
+	no fused multiply-add, so all of them give the same colors. The sine
+	in the value curve is the one step with no instruction behind it: the
+	angle is reduced to a half turn, folded to a quarter turn and fed to
+	an odd polynomial through x^11, which is within a few parts in 10^8 of
+	the true sine; the scalar code uses the same polynomial rather than
+	'sinf', so its colors match the packets', and match the shader's to a
+	level at most.
+
+	A ramp is sampled like a repeating, clamped, linearly filtered texture:
+	u wraps, v is held to the middle of the first and last rows, and the
+	four texels around the sample are blended. AVX2 and AVX-512 gather
+	the texels in one instruction per corner; SSE2 has no gather and
+	loads them one lane at a time.
+
+	Equalization bins counts by iteration. A smooth count sits between
+	four and a half under its escape iteration and three under, so bins
+	start a few iterations below 0 and end at the cap. Each worker counts
+	into its own histogram; the merge and the prefix sum then run over
+	blocks of bins in parallel, each block summing its bins across the
+	workers and scanning them, and the blocks' totals, a handful, are
+	scanned on one thread. Each bin ends up with the equalized count at
+	its start and its slope across it, and a pixel takes the start plus
+	its fraction of the slope, so the mapping is continuous through the
+	bins and costs a gather of two floats per pixel.
+*/
+
+#include "a3_DemoFractalColorize.h"
+#include "_utilities/a3_DemoSIMD.h"
+
+#include "animal3D/a3/a3macros.h"
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+
+//-----------------------------------------------------------------------------
+
+#ifdef _MSC_VER
+#define a3colorize_inline	static __forceinline
+#else	// !_MSC_VER
+#define a3colorize_inline	static inline __attribute__((always_inline))
+#endif	// _MSC_VER
+
+// pixels handed to a kernel at once; multiple of the widest packet
+#define a3colorize_span			64
+
+// rows per pooled task
+#define a3colorize_rows			16
+
+// equalization bins below iteration 0, and bins per prefix sum block
+#define a3colorize_binOffset	8
+#define a3colorize_binBlock		4096
+
+// field file tag and version
+#define a3colorize_magic		0x46463341u	// "A3FF"
+#define a3colorize_version		1u
+
+// sine reduction and Taylor coefficients through x^11
+#define a3colorize_pi			3.14159265f
+#define a3colorize_2pi			6.28318531f
+#define a3colorize_inv2pi		0.159154943f
+#define a3colorize_sin3			-1.66666667e-1f
+#define a3colorize_sin5			8.33333333e-3f
+#define a3colorize_sin7			-1.98412698e-4f
+#define a3colorize_sin9			2.75573192e-6f
+#define a3colorize_sin11		-2.50521084e-8f
+
+// shader hue offsets of the red, green and blue channels
+#define a3colorize_k0			1.0f
+#define a3colorize_k1			0.666666667f
+#define a3colorize_k2			0.333333333f
+
+
+// kernel: colorize 'count' pixels, a multiple of the packet
+typedef void(*a3_FractalColorizeSpanFunc)(const a3_FractalPalette *palette, const float *smooth, const unsigned char *id, const unsigned int count, unsigned char *rgba_out);
+
+// kernel: equalize 'count' counts, a multiple of the packet, through the
+//	bins' starts and slopes
+typedef void(*a3_FractalEqualizeSpanFunc)(const float *start, const float *slope, const unsigned int bins, const float *smooth, const unsigned int count, float *equalized_out);
+
+
+// one pooled colorize
+typedef struct a3_ColorizePass
+{
+	const a3_FractalPalette *palette;
+	const a3_FractalField *field;
+	unsigned char *rgba;
+	a3_FractalISA isa;
+} a3_ColorizePass;
+
+
+// one equalized colorize; histograms are per worker, sums per block
+typedef struct a3_EqualizePass
+{
+	const a3_FractalPalette *palette;
+	const a3_FractalField *field;
+	unsigned char *rgba;
+	float *equalized;
+	a3_FractalColorizeSpanFunc colorize;
+	a3_FractalEqualizeSpanFunc map;
+	unsigned int lanes, bins, workers;
+	unsigned int *hist;
+	unsigned long long *sum, *blockSum;
+	double scale;
+	float *start, *slope;
+} a3_EqualizePass;
+
+
+// ids of fields that have none
+static const unsigned char a3colorizeZeroId[a3colorize_span] = { 0 };
+
+
+// file header, written field by field
+typedef struct a3_ColorizeHeader
+{
+	unsigned int magic, version;
+	unsigned int width, height;
+	unsigned int iterations, roots;
+	double view[4];
+} a3_ColorizeHeader;
+
+// header bytes in the file
+#define a3colorize_headerBytes	(6 * sizeof(unsigned int) + 4 * sizeof(double))
+
+
+//-----------------------------------------------------------------------------
+// kernels
+
+// sine from the polynomial the packets use
+static float a3colorizeSin(const float x)
+{
+	float t = x * a3colorize_inv2pi, y, a, y2, p;
+	t = t - floorf(t + 0.5f);
+	y = t * a3colorize_2pi;
+	a = fabsf(y);
+	a = a < a3colorize_pi - a ? a : a3colorize_pi - a;
+	y = y < 0.0f ? -a : a;
+	y2 = y * y;
+	p = a3colorize_sin11;
+	p = p * y2 + a3colorize_sin9;
+	p = p * y2 + a3colorize_sin7;
+	p = p * y2 + a3colorize_sin5;
+	p = p * y2 + a3colorize_sin3;
+	p = p * y2 + 1.0f;
+	return (p * y);
+}
+
+
+// scalar fallback
+a3colorize_inline void a3fractalColorizeSpanT_scalar(const a3_FractalPalette *palette, const float *smooth, const unsigned char *id, const unsigned int count, unsigned char *rgba_out, const int ramp)
+{
+	const float k[3] = { a3colorize_k0, a3colorize_k1, a3colorize_k2 };
+	const float w = (float)palette->rampWidth, h = (float)palette->rampHeight;
+	const unsigned char *t00, *t10, *t01, *t11;
+	float s, f, hue, v, t, m, c, u, fx, fy, x0, x1, y0, y1, wx, wy, a, b;
+	unsigned int i, j;
+
+	for (i = 0; i < count; ++i, rgba_out += 4)
+	{
+		s = smooth[i];
+		f = (float)id[i];
+		if (a3fractalIsInterior(s) || id[i] == a3fractal_fieldNoId)
+			memcpy(rgba_out, palette->interior, 4);
+		else if (!ramp)
+		{
+			hue = palette->hueOffset + palette->hueScale * s + palette->hueId * f;
+			v = palette->valueBase + palette->valueAmplitude * (1.0f + a3colorizeSin(palette->valueFrequency * s));
+			for (j = 0; j < 3; ++j)
+			{
+				t = hue + k[j];
+				m = fabsf((t - floorf(t)) * 6.0f - 3.0f);
+				m = a3clamp(0.0f, 4.0f, m - 1.0f);
+				c = v * (1.0f + (m - 1.0f) * palette->saturation);
+				c = a3clamp(0.0f, 1.0f, c);
+				rgba_out[j] = (unsigned char)(c * 255.0f + 0.5f);
+			}
+			rgba_out[3] = 255;
+		}
+		else
+		{
+			// repeat along u, clamp v to the texel centers
+			u = palette->rampOffset + palette->rampScale * s;
+			u = u - floorf(u);
+			u = a3clamp(0.0f, 1.0f, u);
+			fx = u * w - 0.5f;
+			x0 = floorf(fx);
+			wx = fx - x0;
+			x0 = x0 < 0.0f ? x0 + w : x0;
+			x1 = x0 + 1.0f;
+			x1 = x1 < w ? x1 : 0.0f;
+			fy = (palette->rampV + palette->rampVId * f) * h - 0.5f;
+			fy = a3clamp(0.0f, h - 1.0f, fy);
+			y0 = floorf(fy);
+			wy = fy - y0;
+			y1 = a3minimum(y0 + 1.0f, h - 1.0f);
+			t00 = palette->ramp + (unsigned int)(y0 * w + x0) * 4;
+			t10 = palette->ramp + (unsigned int)(y0 * w + x1) * 4;
+			t01 = palette->ramp + (unsigned int)(y1 * w + x0) * 4;
+			t11 = palette->ramp + (unsigned int)(y1 * w + x1) * 4;
+			for (j = 0; j < 4; ++j)
+			{
+				a = (float)t00[j] + ((float)t10[j] - (float)t00[j]) * wx;
+				b = (float)t01[j] + ((float)t11[j] - (float)t01[j]) * wx;
+				c = a + (b - a) * wy;
+				rgba_out[j] = (unsigned char)(c + 0.5f);
+			}
+		}
+	}
+}
+
+
+#if A3_FRACTAL_X86
+
+// SSE2: 4 pixels per instruction
+A3_FRACTAL_TARGET("sse2")
+a3colorize_inline __m128 a3colorizeSelect_sse2(const __m128 mask, const __m128 a, const __m128 b)
+{
+	return _mm_or_ps(_mm_and_ps(mask, a), _mm_andnot_ps(mask, b));
+}
+
+// no rounding instruction before SSE4.1: truncate, then step down where
+//	that rounded up; exact over the int range
+A3_FRACTAL_TARGET("sse2")
+a3colorize_inline __m128 a3colorizeFloor_sse2(const __m128 x)
+{
+	const __m128 t = _mm_cvtepi32_ps(_mm_cvttps_epi32(x));
+	return _mm_sub_ps(t, _mm_and_ps(_mm_cmpgt_ps(t, x), _mm_set1_ps(1.0f)));
+}
+
+A3_FRACTAL_TARGET("sse2")
+a3colorize_inline __m128 a3colorizeSin_sse2(const __m128 x)
+{
+	const __m128 sign = _mm_set1_ps(-0.0f), pi = _mm_set1_ps(a3colorize_pi);
+	__m128 t, y, a, y2, p;
+	t = _mm_mul_ps(x, _mm_set1_ps(a3colorize_inv2pi));
+	t = _mm_sub_ps(t, a3colorizeFloor_sse2(_mm_add_ps(t, _mm_set1_ps(0.5f))));
+	y = _mm_mul_ps(t, _mm_set1_ps(a3colorize_2pi));
+	a = _mm_andnot_ps(sign, y);
+	a = _mm_min_ps(a, _mm_sub_ps(pi, a));
+	y = _mm_or_ps(a, _mm_and_ps(sign, y));
+	y2 = _mm_mul_ps(y, y);
+	p = _mm_set1_ps(a3colorize_sin11);
+	p = _mm_add_ps(_mm_mul_ps(p, y2), _mm_set1_ps(a3colorize_sin9));
+	p = _mm_add_ps(_mm_mul_ps(p, y2), _mm_set1_ps(a3colorize_sin7));
+	p = _mm_add_ps(_mm_mul_ps(p, y2), _mm_set1_ps(a3colorize_sin5));
+	p = _mm_add_ps(_mm_mul_ps(p, y2), _mm_set1_ps(a3colorize_sin3));
+	p = _mm_add_ps(_mm_mul_ps(p, y2), _mm_set1_ps(1.0f));
+	return _mm_mul_ps(p, y);
+}
+
+// one channel of the HSV curve, shifted into its byte
+A3_FRACTAL_TARGET("sse2")
+a3colorize_inline __m128i a3colorizeChannel_sse2(const __m128 hue, const __m128 v, const __m128 sat, const float k, const int shift)
+{
+	const __m128 one = _mm_set1_ps(1.0f), zero = _mm_setzero_ps();
+	__m128 t, m, c;
+	t = _mm_add_ps(hue, _mm_set1_ps(k));
+	t = _mm_sub_ps(t, a3colorizeFloor_sse2(t));
+	m = _mm_sub_ps(_mm_mul_ps(t, _mm_set1_ps(6.0f)), _mm_set1_ps(3.0f));
+	m = _mm_andnot_ps(_mm_set1_ps(-0.0f), m);
+	m = _mm_min_ps(_mm_max_ps(_mm_sub_ps(m, one), zero), _mm_set1_ps(4.0f));
+	c = _mm_mul_ps(v, _mm_add_ps(one, _mm_mul_ps(_mm_sub_ps(m, one), sat)));
+	c = _mm_min_ps(_mm_max_ps(c, zero), one);
+	return _mm_slli_epi32(_mm_cvttps_epi32(_mm_add_ps(_mm_mul_ps(c, _mm_set1_ps(255.0f)), _mm_set1_ps(0.5f))), shift);
+}
+
+// one channel of four blended texels, shifted into its byte
+A3_FRACTAL_TARGET("sse2")
+a3colorize_inline __m128i a3colorizeBlend_sse2(const __m128i t00, const __m128i t10, const __m128i t01, const __m128i t11, const __m128 wx, const __m128 wy, const int shift)
+{
+	const __m128i byte = _mm_set1_epi32(0xff);
+	const __m128 c00 = _mm_cvtepi32_ps(_mm_and_si128(_mm_srli_epi32(t00, shift), byte));
+	const __m128 c10 = _mm_cvtepi32_ps(_mm_and_si128(_mm_srli_epi32(t10, shift), byte));
+	const __m128 c01 = _mm_cvtepi32_ps(_mm_and_si128(_mm_srli_epi32(t01, shift), byte));
+	const __m128 c11 = _mm_cvtepi32_ps(_mm_and_si128(_mm_srli_epi32(t11, shift), byte));
+	const __m128 a = _mm_add_ps(c00, _mm_mul_ps(_mm_sub_ps(c10, c00), wx));
+	const __m128 b = _mm_add_ps(c01, _mm_mul_ps(_mm_sub_ps(c11, c01), wx));
+	const __m128 c = _mm_add_ps(a, _mm_mul_ps(_mm_sub_ps(b, a), wy));
+	return _mm_slli_epi32(_mm_cvttps_epi32(_mm_add_ps(c, _mm_set1_ps(0.5f))), shift);
+}
+
+// texels of four lanes, one load at a time
+A3_FRACTAL_TARGET("sse2")
+a3colorize_inline __m128i a3colorizeFetch_sse2(const unsigned char *ramp, const __m128 index)
+{
+	int lane[4];
+	unsigned int texel[4], j;
+	_mm_storeu_si128((__m128i *)lane, _mm_cvttps_epi32(index));
+	for (j = 0; j < 4; ++j)
+		memcpy(texel + j, ramp + lane[j] * 4, 4);
+	return _mm_loadu_si128((const __m128i *)texel);
+}
+
+A3_FRACTAL_TARGET("sse2")
+a3colorize_inline void a3fractalColorizeSpanT_sse2(const a3_FractalPalette *palette, const float *smooth, const unsigned char *id, const unsigned int count, unsigned char *rgba_out, const int ramp)
+{
+	const __m128 one = _mm_set1_ps(1.0f), zero = _mm_setzero_ps();
+	const __m128 w = _mm_set1_ps((float)palette->rampWidth), h = _mm_set1_ps((float)palette->rampHeight);
+	const __m128i interiorColor = _mm_set1_epi32((int)(palette->interior[0] | palette->interior[1] << 8 | palette->interior[2] << 16 | (unsigned int)palette->interior[3] << 24));
+	__m128 s, f, interior, hue, v, u, fx, fy, x0, x1, y0, y1, wx, wy;
+	__m128i idi, color, t00, t10, t01, t11;
+	int packed;
+	unsigned int i;
+
+	for (i = 0; i < count; i += 4)
+	{
+		memcpy(&packed, id + i, 4);
+		idi = _mm_unpacklo_epi16(_mm_unpacklo_epi8(_mm_cvtsi32_si128(packed), _mm_setzero_si128()), _mm_setzero_si128());
+		s = _mm_loadu_ps(smooth + i);
+		f = _mm_cvtepi32_ps(idi);
+
+		// interior lanes run as count 0, then take the interior color
+		interior = _mm_or_ps(_mm_cmple_ps(s, _mm_set1_ps(a3fractal_interior)), _mm_castsi128_ps(_mm_cmpeq_epi32(idi, _mm_set1_epi32(a3fractal_fieldNoId))));
+		s = _mm_andnot_ps(interior, s);
+		if (!ramp)
+		{
+			hue = _mm_add_ps(_mm_add_ps(_mm_set1_ps(palette->hueOffset), _mm_mul_ps(_mm_set1_ps(palette->hueScale), s)), _mm_mul_ps(_mm_set1_ps(palette->hueId), f));
+			v = _mm_add_ps(_mm_set1_ps(palette->valueBase), _mm_mul_ps(_mm_set1_ps(palette->valueAmplitude), _mm_add_ps(one, a3colorizeSin_sse2(_mm_mul_ps(_mm_set1_ps(palette->valueFrequency), s)))));
+			color = _mm_or_si128(a3colorizeChannel_sse2(hue, v, _mm_set1_ps(palette->saturation), a3colorize_k0, 0), a3colorizeChannel_sse2(hue, v, _mm_set1_ps(palette->saturation), a3colorize_k1, 8));
+			color = _mm_or_si128(color, a3colorizeChannel_sse2(hue, v, _mm_set1_ps(palette->saturation), a3colorize_k2, 16));
+			color = _mm_or_si128(color, _mm_set1_epi32((int)0xff000000));
+		}
+		else
+		{
+			u = _mm_add_ps(_mm_set1_ps(palette->rampOffset), _mm_mul_ps(_mm_set1_ps(palette->rampScale), s));
+			u = _mm_sub_ps(u, a3colorizeFloor_sse2(u));
+			u = _mm_min_ps(_mm_max_ps(u, zero), one);
+			fx = _mm_sub_ps(_mm_mul_ps(u, w), _mm_set1_ps(0.5f));
+			x0 = a3colorizeFloor_sse2(fx);
+			wx = _mm_sub_ps(fx, x0);
+			x0 = a3colorizeSelect_sse2(_mm_cmplt_ps(x0, zero), _mm_add_ps(x0, w), x0);
+			x1 = _mm_add_ps(x0, one);
+			x1 = _mm_and_ps(_mm_cmplt_ps(x1, w), x1);
+			fy = _mm_sub_ps(_mm_mul_ps(_mm_add_ps(_mm_set1_ps(palette->rampV), _mm_mul_ps(_mm_set1_ps(palette->rampVId), f)), h), _mm_set1_ps(0.5f));
+			fy = _mm_min_ps(_mm_max_ps(fy, zero), _mm_sub_ps(h, one));
+			y0 = a3colorizeFloor_sse2(fy);
+			wy = _mm_sub_ps(fy, y0);
+			y1 = _mm_min_ps(_mm_add_ps(y0, one), _mm_sub_ps(h, one));
+			t00 = a3colorizeFetch_sse2(palette->ramp, _mm_add_ps(_mm_mul_ps(y0, w), x0));
+			t10 = a3colorizeFetch_sse2(palette->ramp, _mm_add_ps(_mm_mul_ps(y0, w), x1));
+			t01 = a3colorizeFetch_sse2(palette->ramp, _mm_add_ps(_mm_mul_ps(y1, w), x0));
+			t11 = a3colorizeFetch_sse2(palette->ramp, _mm_add_ps(_mm_mul_ps(y1, w), x1));
+			color = _mm_or_si128(a3colorizeBlend_sse2(t00, t10, t01, t11, wx, wy, 0), a3colorizeBlend_sse2(t00, t10, t01, t11, wx, wy, 8));
+			color = _mm_or_si128(color, a3colorizeBlend_sse2(t00, t10, t01, t11, wx, wy, 16));
+			color = _mm_or_si128(color, a3colorizeBlend_sse2(t00, t10, t01, t11, wx, wy, 24));
+		}
+		color = _mm_castps_si128(a3colorizeSelect_sse2(interior, _mm_castsi128_ps(interiorColor), _mm_castsi128_ps(color)));
+		_mm_storeu_si128((__m128i *)(rgba_out + i * 4), color);
+	}
+}
+
+
+// AVX2: 8 pixels per instruction
+A3_FRACTAL_TARGET("avx2")
+a3colorize_inline __m256 a3colorizeSin_avx2(const __m256 x)
+{
+	const __m256 sign = _mm256_set1_ps(-0.0f), pi = _mm256_set1_ps(a3colorize_pi);
+	__m256 t, y, a, y2, p;
+	t = _mm256_mul_ps(x, _mm256_set1_ps(a3colorize_inv2pi));
+	t = _mm256_sub_ps(t, _mm256_floor_ps(_mm256_add_ps(t, _mm256_set1_ps(0.5f))));
+	y = _mm256_mul_ps(t, _mm256_set1_ps(a3colorize_2pi));
+	a = _mm256_andnot_ps(sign, y);
+	a = _mm256_min_ps(a, _mm256_sub_ps(pi, a));
+	y = _mm256_or_ps(a, _mm256_and_ps(sign, y));
+	y2 = _mm256_mul_ps(y, y);
+	p = _mm256_set1_ps(a3colorize_sin11);
+	p = _mm256_add_ps(_mm256_mul_ps(p, y2), _mm256_set1_ps(a3colorize_sin9));
+	p = _mm256_add_ps(_mm256_mul_ps(p, y2), _mm256_set1_ps(a3colorize_sin7));
+	p = _mm256_add_ps(_mm256_mul_ps(p, y2), _mm256_set1_ps(a3colorize_sin5));
+	p = _mm256_add_ps(_mm256_mul_ps(p, y2), _mm256_set1_ps(a3colorize_sin3));
+	p = _mm256_add_ps(_mm256_mul_ps(p, y2), _mm256_set1_ps(1.0f));
+	return _mm256_mul_ps(p, y);
+}
+
+A3_FRACTAL_TARGET("avx2")
+a3colorize_inline __m256i a3colorizeChannel_avx2(const __m256 hue, const __m256 v, const __m256 sat, const float k, const int shift)
+{
+	const __m256 one = _mm256_set1_ps(1.0f), zero = _mm256_setzero_ps();
+	__m256 t, m, c;
+	t = _mm256_add_ps(hue, _mm256_set1_ps(k));
+	t = _mm256_sub_ps(t, _mm256_floor_ps(t));
+	m = _mm256_sub_ps(_mm256_mul_ps(t, _mm256_set1_ps(6.0f)), _mm256_set1_ps(3.0f));
+	m = _mm256_andnot_ps(_mm256_set1_ps(-0.0f), m);
+	m = _mm256_min_ps(_mm256_max_ps(_mm256_sub_ps(m, one), zero), _mm256_set1_ps(4.0f));
+	c = _mm256_mul_ps(v, _mm256_add_ps(one, _mm256_mul_ps(_mm256_sub_ps(m, one), sat)));
+	c = _mm256_min_ps(_mm256_max_ps(c, zero), one);
+	return _mm256_slli_epi32(_mm256_cvttps_epi32(_mm256_add_ps(_mm256_mul_ps(c, _mm256_set1_ps(255.0f)), _mm256_set1_ps(0.5f))), shift);
+}
+
+A3_FRACTAL_TARGET("avx2")
+a3colorize_inline __m256i a3colorizeBlend_avx2(const __m256i t00, const __m256i t10, const __m256i t01, const __m256i t11, const __m256 wx, const __m256 wy, const int shift)
+{
+	const __m256i byte = _mm256_set1_epi32(0xff);
+	const __m256 c00 = _mm256_cvtepi32_ps(_mm256_and_si256(_mm256_srli_epi32(t00, shift), byte));
+	const __m256 c10 = _mm256_cvtepi32_ps(_mm256_and_si256(_mm256_srli_epi32(t10, shift), byte));
+	const __m256 c01 = _mm256_cvtepi32_ps(_mm256_and_si256(_mm256_srli_epi32(t01, shift), byte));
+	const __m256 c11 = _mm256_cvtepi32_ps(_mm256_and_si256(_mm256_srli_epi32(t11, shift), byte));
+	const __m256 a = _mm256_add_ps(c00, _mm256_mul_ps(_mm256_sub_ps(c10, c00), wx));
+	const __m256 b = _mm256_add_ps(c01, _mm256_mul_ps(_mm256_sub_ps(c11, c01), wx));
+	const __m256 c = _mm256_add_ps(a, _mm256_mul_ps(_mm256_sub_ps(b, a), wy));
+	return _mm256_slli_epi32(_mm256_cvttps_epi32(_mm256_add_ps(c, _mm256_set1_ps(0.5f))), shift);
+}
+
+A3_FRACTAL_TARGET("avx2")
+a3colorize_inline void a3fractalColorizeSpanT_avx2(const a3_FractalPalette *palette, const float *smooth, const unsigned char *id, const unsigned int count, unsigned char *rgba_out, const int ramp)
+{
+	const __m256 one = _mm256_set1_ps(1.0f), zero = _mm256_setzero_ps();
+	const __m256 w = _mm256_set1_ps((float)palette->rampWidth), h = _mm256_set1_ps((float)palette->rampHeight);
+	const __m256i interiorColor = _mm256_set1_epi32((int)(palette->interior[0] | palette->interior[1] << 8 | palette->interior[2] << 16 | (unsigned int)palette->interior[3] << 24));
+	const int *texels = (const int *)palette->ramp;
+	__m256 s, f, interior, hue, v, u, fx, fy, x0, x1, y0, y1, wx, wy;
+	__m256i idi, color, t00, t10, t01, t11;
+	unsigned int i;
+
+	for (i = 0; i < count; i += 8)
+	{
+		idi = _mm256_cvtepu8_epi32(_mm_loadl_epi64((const __m128i *)(id + i)));
+		s = _mm256_loadu_ps(smooth + i);
+		f = _mm256_cvtepi32_ps(idi);
+		interior = _mm256_or_ps(_mm256_cmp_ps(s, _mm256_set1_ps(a3fractal_interior), _CMP_LE_OQ), _mm256_castsi256_ps(_mm256_cmpeq_epi32(idi, _mm256_set1_epi32(a3fractal_fieldNoId))));
+		s = _mm256_andnot_ps(interior, s);
+		if (!ramp)
+		{
+			hue = _mm256_add_ps(_mm256_add_ps(_mm256_set1_ps(palette->hueOffset), _mm256_mul_ps(_mm256_set1_ps(palette->hueScale), s)), _mm256_mul_ps(_mm256_set1_ps(palette->hueId), f));
+			v = _mm256_add_ps(_mm256_set1_ps(palette->valueBase), _mm256_mul_ps(_mm256_set1_ps(palette->valueAmplitude), _mm256_add_ps(one, a3colorizeSin_avx2(_mm256_mul_ps(_mm256_set1_ps(palette->valueFrequency), s)))));
+			color = _mm256_or_si256(a3colorizeChannel_avx2(hue, v, _mm256_set1_ps(palette->saturation), a3colorize_k0, 0), a3colorizeChannel_avx2(hue, v, _mm256_set1_ps(palette->saturation), a3colorize_k1, 8));
+			color = _mm256_or_si256(color, a3colorizeChannel_avx2(hue, v, _mm256_set1_ps(palette->saturation), a3colorize_k2, 16));
+			color = _mm256_or_si256(color, _mm256_set1_epi32((int)0xff000000));
+		}
+		else
+		{
+			u = _mm256_add_ps(_mm256_set1_ps(palette->rampOffset), _mm256_mul_ps(_mm256_set1_ps(palette->rampScale), s));
+			u = _mm256_sub_ps(u, _mm256_floor_ps(u));
+			u = _mm256_min_ps(_mm256_max_ps(u, zero), one);
+			fx = _mm256_sub_ps(_mm256_mul_ps(u, w), _mm256_set1_ps(0.5f));
+			x0 = _mm256_floor_ps(fx);
+			wx = _mm256_sub_ps(fx, x0);
+			x0 = _mm256_blendv_ps(x0, _mm256_add_ps(x0, w), _mm256_cmp_ps(x0, zero, _CMP_LT_OQ));
+			x1 = _mm256_add_ps(x0, one);
+			x1 = _mm256_and_ps(_mm256_cmp_ps(x1, w, _CMP_LT_OQ), x1);
+			fy = _mm256_sub_ps(_mm256_mul_ps(_mm256_add_ps(_mm256_set1_ps(palette->rampV), _mm256_mul_ps(_mm256_set1_ps(palette->rampVId), f)), h), _mm256_set1_ps(0.5f));
+			fy = _mm256_min_ps(_mm256_max_ps(fy, zero), _mm256_sub_ps(h, one));
+			y0 = _mm256_floor_ps(fy);
+			wy = _mm256_sub_ps(fy, y0);
+			y1 = _mm256_min_ps(_mm256_add_ps(y0, one), _mm256_sub_ps(h, one));
+			t00 = _mm256_i32gather_epi32(texels, _mm256_cvttps_epi32(_mm256_add_ps(_mm256_mul_ps(y0, w), x0)), 4);
+			t10 = _mm256_i32gather_epi32(texels, _mm256_cvttps_epi32(_mm256_add_ps(_mm256_mul_ps(y0, w), x1)), 4);
+			t01 = _mm256_i32gather_epi32(texels, _mm256_cvttps_epi32(_mm256_add_ps(_mm256_mul_ps(y1, w), x0)), 4);
+			t11 = _mm256_i32gather_epi32(texels, _mm256_cvttps_epi32(_mm256_add_ps(_mm256_mul_ps(y1, w), x1)), 4);
+			color = _mm256_or_si256(a3colorizeBlend_avx2(t00, t10, t01, t11, wx, wy, 0), a3colorizeBlend_avx2(t00, t10, t01, t11, wx, wy, 8));
+			color = _mm256_or_si256(color, a3colorizeBlend_avx2(t00, t10, t01, t11, wx, wy, 16));
+			color = _mm256_or_si256(color, a3colorizeBlend_avx2(t00, t10, t01, t11, wx, wy, 24));
+		}
+		color = _mm256_castps_si256(_mm256_blendv_ps(_mm256_castsi256_ps(color), _mm256_castsi256_ps(interiorColor), interior));
+		_mm256_storeu_si256((__m256i *)(rgba_out + i * 4), color);
+	}
+}
+
+
+#if A3_FRACTAL_AVX512
+
+// AVX-512: 16 pixels per instruction; foundation only, so sign bits are
+//	masked as integers
+A3_FRACTAL_TARGET("avx512f")
+a3colorize_inline __m512 a3colorizeAbs_avx512(const __m512 x)
+{
+	return _mm512_castsi512_ps(_mm512_and_si512(_mm512_castps_si512(x), _mm512_set1_epi32(0x7fffffff)));
+}
+
+A3_FRACTAL_TARGET("avx512f")
+a3colorize_inline __m512 a3colorizeSin_avx512(const __m512 x)
+{
+	const __m512 pi = _mm512_set1_ps(a3colorize_pi);
+	__m512 t, y, a, y2, p;
+	t = _mm512_mul_ps(x, _mm512_set1_ps(a3colorize_inv2pi));
+	t = _mm512_sub_ps(t, _mm512_floor_ps(_mm512_add_ps(t, _mm512_set1_ps(0.5f))));
+	y = _mm512_mul_ps(t, _mm512_set1_ps(a3colorize_2pi));
+	a = a3colorizeAbs_avx512(y);
+	a = _mm512_min_ps(a, _mm512_sub_ps(pi, a));
+	y = _mm512_castsi512_ps(_mm512_or_si512(_mm512_castps_si512(a), _mm512_and_si512(_mm512_castps_si512(y), _mm512_set1_epi32((int)0x80000000))));
+	y2 = _mm512_mul_ps(y, y);
+	p = _mm512_set1_ps(a3colorize_sin11);
+	p = _mm512_add_ps(_mm512_mul_ps(p, y2), _mm512_set1_ps(a3colorize_sin9));
+	p = _mm512_add_ps(_mm512_mul_ps(p, y2), _mm512_set1_ps(a3colorize_sin7));
+	p = _mm512_add_ps(_mm512_mul_ps(p, y2), _mm512_set1_ps(a3colorize_sin5));
+	p = _mm512_add_ps(_mm512_mul_ps(p, y2), _mm512_set1_ps(a3colorize_sin3));
+	p = _mm512_add_ps(_mm512_mul_ps(p, y2), _mm512_set1_ps(1.0f));
+	return _mm512_mul_ps(p, y);
+}
+
+A3_FRACTAL_TARGET("avx512f")
+a3colorize_inline __m512i a3colorizeChannel_avx512(const __m512 hue, const __m512 v, const __m512 sat, const float k, const unsigned int shift)
+{
+	const __m512 one = _mm512_set1_ps(1.0f), zero = _mm512_setzero_ps();
+	__m512 t, m, c;
+	t = _mm512_add_ps(hue, _mm512_set1_ps(k));
+	t = _mm512_sub_ps(t, _mm512_floor_ps(t));
+	m = _mm512_sub_ps(_mm512_mul_ps(t, _mm512_set1_ps(6.0f)), _mm512_set1_ps(3.0f));
+	m = a3colorizeAbs_avx512(m);
+	m = _mm512_min_ps(_mm512_max_ps(_mm512_sub_ps(m, one), zero), _mm512_set1_ps(4.0f));
+	c = _mm512_mul_ps(v, _mm512_add_ps(one, _mm512_mul_ps(_mm512_sub_ps(m, one), sat)));
+	c = _mm512_min_ps(_mm512_max_ps(c, zero), one);
+	return _mm512_slli_epi32(_mm512_cvttps_epi32(_mm512_add_ps(_mm512_mul_ps(c, _mm512_set1_ps(255.0f)), _mm512_set1_ps(0.5f))), shift);
+}
+
+A3_FRACTAL_TARGET("avx512f")
+a3colorize_inline __m512i a3colorizeBlend_avx512(const __m512i t00, const __m512i t10, const __m512i t01, const __m512i t11, const __m512 wx, const __m512 wy, const unsigned int shift)
+{
+	const __m512i byte = _mm512_set1_epi32(0xff);
+	const __m512 c00 = _mm512_cvtepi32_ps(_mm512_and_si512(_mm512_srli_epi32(t00, shift), byte));
+	const __m512 c10 = _mm512_cvtepi32_ps(_mm512_and_si512(_mm512_srli_epi32(t10, shift), byte));
+	const __m512 c01 = _mm512_cvtepi32_ps(_mm512_and_si512(_mm512_srli_epi32(t01, shift), byte));
+	const __m512 c11 = _mm512_cvtepi32_ps(_mm512_and_si512(_mm512_srli_epi32(t11, shift), byte));
+	const __m512 a = _mm512_add_ps(c00, _mm512_mul_ps(_mm512_sub_ps(c10, c00), wx));
+	const __m512 b = _mm512_add_ps(c01, _mm512_mul_ps(_mm512_sub_ps(c11, c01), wx));
+	const __m512 c = _mm512_add_ps(a, _mm512_mul_ps(_mm512_sub_ps(b, a), wy));
+	return _mm512_slli_epi32(_mm512_cvttps_epi32(_mm512_add_ps(c, _mm512_set1_ps(0.5f))), shift);
+}
+
+A3_FRACTAL_TARGET("avx512f")
+a3colorize_inline void a3fractalColorizeSpanT_avx512(const a3_FractalPalette *palette, const float *smooth, const unsigned char *id, const unsigned int count, unsigned char *rgba_out, const int ramp)
+{
+	const __m512 one = _mm512_set1_ps(1.0f), zero = _mm512_setzero_ps();
+	const __m512 w = _mm512_set1_ps((float)palette->rampWidth), h = _mm512_set1_ps((float)palette->rampHeight);
+	const __m512i interiorColor = _mm512_set1_epi32((int)(palette->interior[0] | palette->interior[1] << 8 | palette->interior[2] << 16 | (unsigned int)palette->interior[3] << 24));
+	__m512 s, f, hue, v, u, fx, fy, x0, x1, y0, y1, wx, wy;
+	__m512i idi, color, t00, t10, t01, t11;
+	__mmask16 interior;
+	unsigned int i;
+
+	for (i = 0; i < count; i += 16)
+	{
+		idi = _mm512_cvtepu8_epi32(_mm_loadu_si128((const __m128i *)(id + i)));
+		s = _mm512_loadu_ps(smooth + i);
+		f = _mm512_cvtepi32_ps(idi);
+		interior = (__mmask16)(_mm512_cmp_ps_mask(s, _mm512_set1_ps(a3fractal_interior), _CMP_LE_OQ) | _mm512_cmpeq_epi32_mask(idi, _mm512_set1_epi32(a3fractal_fieldNoId)));
+		s = _mm512_mask_mov_ps(s, interior, zero);
+		if (!ramp)
+		{
+			hue = _mm512_add_ps(_mm512_add_ps(_mm512_set1_ps(palette->hueOffset), _mm512_mul_ps(_mm512_set1_ps(palette->hueScale), s)), _mm512_mul_ps(_mm512_set1_ps(palette->hueId), f));
+			v = _mm512_add_ps(_mm512_set1_ps(palette->valueBase), _mm512_mul_ps(_mm512_set1_ps(palette->valueAmplitude), _mm512_add_ps(one, a3colorizeSin_avx512(_mm512_mul_ps(_mm512_set1_ps(palette->valueFrequency), s)))));
+			color = _mm512_or_si512(a3colorizeChannel_avx512(hue, v, _mm512_set1_ps(palette->saturation), a3colorize_k0, 0), a3colorizeChannel_avx512(hue, v, _mm512_set1_ps(palette->saturation), a3colorize_k1, 8));
+			color = _mm512_or_si512(color, a3colorizeChannel_avx512(hue, v, _mm512_set1_ps(palette->saturation), a3colorize_k2, 16));
+			color = _mm512_or_si512(color, _mm512_set1_epi32((int)0xff000000));
+		}
+		else
+		{
+			u = _mm512_add_ps(_mm512_set1_ps(palette->rampOffset), _mm512_mul_ps(_mm512_set1_ps(palette->rampScale), s));
+			u = _mm512_sub_ps(u, _mm512_floor_ps(u));
+			u = _mm512_min_ps(_mm512_max_ps(u, zero), one);
+			fx = _mm512_sub_ps(_mm512_mul_ps(u, w), _mm512_set1_ps(0.5f));
+			x0 = _mm512_floor_ps(fx);
+			wx = _mm512_sub_ps(fx, x0);
+			x0 = _mm512_mask_add_ps(x0, _mm512_cmp_ps_mask(x0, zero, _CMP_LT_OQ), x0, w);
+			x1 = _mm512_add_ps(x0, one);
+			x1 = _mm512_maskz_mov_ps(_mm512_cmp_ps_mask(x1, w, _CMP_LT_OQ), x1);
+			fy = _mm512_sub_ps(_mm512_mul_ps(_mm512_add_ps(_mm512_set1_ps(palette->rampV), _mm512_mul_ps(_mm512_set1_ps(palette->rampVId), f)), h), _mm512_set1_ps(0.5f));
+			fy = _mm512_min_ps(_mm512_max_ps(fy, zero), _mm512_sub_ps(h, one));
+			y0 = _mm512_floor_ps(fy);
+			wy = _mm512_sub_ps(fy, y0);
+			y1 = _mm512_min_ps(_mm512_add_ps(y0, one), _mm512_sub_ps(h, one));
+			t00 = _mm512_i32gather_epi32(_mm512_cvttps_epi32(_mm512_add_ps(_mm512_mul_ps(y0, w), x0)), palette->ramp, 4);
+			t10 = _mm512_i32gather_epi32(_mm512_cvttps_epi32(_mm512_add_ps(_mm512_mul_ps(y0, w), x1)), palette->ramp, 4);
+			t01 = _mm512_i32gather_epi32(_mm512_cvttps_epi32(_mm512_add_ps(_mm512_mul_ps(y1, w), x0)), palette->ramp, 4);
+			t11 = _mm512_i32gather_epi32(_mm512_cvttps_epi32(_mm512_add_ps(_mm512_mul_ps(y1, w), x1)), palette->ramp, 4);
+			color = _mm512_or_si512(a3colorizeBlend_avx512(t00, t10, t01, t11, wx, wy, 0), a3colorizeBlend_avx512(t00, t10, t01, t11, wx, wy, 8));
+			color = _mm512_or_si512(color, a3colorizeBlend_avx512(t00, t10, t01, t11, wx, wy, 16));
+			color = _mm512_or_si512(color, a3colorizeBlend_avx512(t00, t10, t01, t11, wx, wy, 24));
+		}
+		color = _mm512_mask_mov_epi32(color, interior, interiorColor);
+		_mm512_storeu_si512((void *)(rgba_out + i * 4), color);
+	}
+}
+
+#endif	// A3_FRACTAL_AVX512
+
+#endif	// A3_FRACTAL_X86
+
+
+// kernels per instruction set, for curves and for ramps
+#define A3_COLORIZE_KERNEL(target, isa, name, ramp)	\
+target	\
+static void a3fractalColorizeSpan_##isa##_##name(const a3_FractalPalette *palette, const float *smooth, const unsigned char *id, const unsigned int count, unsigned char *rgba_out)	\
+{	\
+	a3fractalColorizeSpanT_##isa(palette, smooth, id, count, rgba_out, ramp);	\
+}
+#define A3_COLORIZE_KERNELS(target, isa)	\
+A3_COLORIZE_KERNEL(target, isa, hsv, 0)	\
+A3_COLORIZE_KERNEL(target, isa, ramp, 1)
+#define A3_COLORIZE_KERNEL_ROW(isa)	\
+	{ a3fractalColorizeSpan_##isa##_hsv, a3fractalColorizeSpan_##isa##_ramp }
+
+#define a3colorize_untargeted
+A3_COLORIZE_KERNELS(a3colorize_untargeted, scalar)
+#if A3_FRACTAL_X86
+A3_COLORIZE_KERNELS(A3_FRACTAL_TARGET("sse2"), sse2)
+A3_COLORIZE_KERNELS(A3_FRACTAL_TARGET("avx2"), avx2)
+#if A3_FRACTAL_AVX512
+A3_COLORIZE_KERNELS(A3_FRACTAL_TARGET("avx512f"), avx512)
+#endif	// A3_FRACTAL_AVX512
+#endif	// A3_FRACTAL_X86
+
+// kernel table, indexed by instruction set, then palette type
+static const a3_FractalColorizeSpanFunc a3fractalColorizeSpanFuncs[a3fractal_isaCount][2] = {
+	A3_COLORIZE_KERNEL_ROW(scalar),
+#if A3_FRACTAL_X86
+	A3_COLORIZE_KERNEL_ROW(sse2),
+	A3_COLORIZE_KERNEL_ROW(avx2),
+#if A3_FRACTAL_AVX512
+	A3_COLORIZE_KERNEL_ROW(avx512),
+#else	// !A3_FRACTAL_AVX512
+	A3_COLORIZE_KERNEL_ROW(avx2),
+#endif	// A3_FRACTAL_AVX512
+#else	// !A3_FRACTAL_X86
+	A3_COLORIZE_KERNEL_ROW(scalar),
+	A3_COLORIZE_KERNEL_ROW(scalar),
+	A3_COLORIZE_KERNEL_ROW(scalar),
+#endif	// A3_FRACTAL_X86
+};
+
+#undef a3colorize_untargeted
+#undef A3_COLORIZE_KERNEL_ROW
+#undef A3_COLORIZE_KERNELS
+#undef A3_COLORIZE_KERNEL
+
+
+// equalize: scalar fallback
+static void a3fractalEqualizeSpan_scalar(const float *start, const float *slope, const unsigned int bins, const float *smooth, const unsigned int count, float *equalized_out)
+{
+	const float last = (float)(bins - 1);
+	float s, b, f;
+	unsigned int i, index;
+
+	for (i = 0; i < count; ++i)
+	{
+		s = smooth[i];
+		if (a3fractalIsInterior(s))
+			equalized_out[i] = s;
+		else
+		{
+			b = floorf(s);
+			f = s - b;
+			b = a3clamp(0.0f, last, b + (float)a3colorize_binOffset);
+			index = (unsigned int)b;
+			equalized_out[i] = start[index] + f * slope[index];
+		}
+	}
+}
+
+
+#if A3_FRACTAL_X86
+
+// equalize: SSE2, bins loaded one lane at a time
+A3_FRACTAL_TARGET("sse2")
+static void a3fractalEqualizeSpan_sse2(const float *start, const float *slope, const unsigned int bins, const float *smooth, const unsigned int count, float *equalized_out)
+{
+	const __m128 last = _mm_set1_ps((float)(bins - 1)), offset = _mm_set1_ps((float)a3colorize_binOffset);
+	__m128 s, b, f, interior;
+	float binStart[4], binSlope[4];
+	int lane[4];
+	unsigned int i, j;
+
+	for (i = 0; i < count; i += 4)
+	{
+		s = _mm_loadu_ps(smooth + i);
+		interior = _mm_cmple_ps(s, _mm_set1_ps(a3fractal_interior));
+		b = a3colorizeFloor_sse2(s);
+		f = _mm_sub_ps(s, b);
+		b = _mm_min_ps(_mm_max_ps(_mm_add_ps(b, offset), _mm_setzero_ps()), last);
+		_mm_storeu_si128((__m128i *)lane, _mm_cvttps_epi32(b));
+		for (j = 0; j < 4; ++j)
+		{
+			binStart[j] = start[lane[j]];
+			binSlope[j] = slope[lane[j]];
+		}
+		f = _mm_add_ps(_mm_loadu_ps(binStart), _mm_mul_ps(f, _mm_loadu_ps(binSlope)));
+		_mm_storeu_ps(equalized_out + i, a3colorizeSelect_sse2(interior, s, f));
+	}
+}
+
+// equalize: AVX2
+A3_FRACTAL_TARGET("avx2")
+static void a3fractalEqualizeSpan_avx2(const float *start, const float *slope, const unsigned int bins, const float *smooth, const unsigned int count, float *equalized_out)
+{
+	const __m256 last = _mm256_set1_ps((float)(bins - 1)), offset = _mm256_set1_ps((float)a3colorize_binOffset);
+	__m256 s, b, f, interior;
+	__m256i index;
+	unsigned int i;
+
+	for (i = 0; i < count; i += 8)
+	{
+		s = _mm256_loadu_ps(smooth + i);
+		interior = _mm256_cmp_ps(s, _mm256_set1_ps(a3fractal_interior), _CMP_LE_OQ);
+		b = _mm256_floor_ps(s);
+		f = _mm256_sub_ps(s, b);
+		b = _mm256_min_ps(_mm256_max_ps(_mm256_add_ps(b, offset), _mm256_setzero_ps()), last);
+		index = _mm256_cvttps_epi32(b);
+		f = _mm256_add_ps(_mm256_i32gather_ps(start, index, 4), _mm256_mul_ps(f, _mm256_i32gather_ps(slope, index, 4)));
+		_mm256_storeu_ps(equalized_out + i, _mm256_blendv_ps(f, s, interior));
+	}
+}
+
+#if A3_FRACTAL_AVX512
+
+// equalize: AVX-512
+A3_FRACTAL_TARGET("avx512f")
+static void a3fractalEqualizeSpan_avx512(const float *start, const float *slope, const unsigned int bins, const float *smooth, const unsigned int count, float *equalized_out)
+{
+	const __m512 last = _mm512_set1_ps((float)(bins - 1)), offset = _mm512_set1_ps((float)a3colorize_binOffset);
+	__m512 s, b, f;
+	__m512i index;
+	__mmask16 interior;
+	unsigned int i;
+
+	for (i = 0; i < count; i += 16)
+	{
+		s = _mm512_loadu_ps(smooth + i);
+		interior = _mm512_cmp_ps_mask(s, _mm512_set1_ps(a3fractal_interior), _CMP_LE_OQ);
+		b = _mm512_floor_ps(s);
+		f = _mm512_sub_ps(s, b);
+		b = _mm512_min_ps(_mm512_max_ps(_mm512_add_ps(b, offset), _mm512_setzero_ps()), last);
+		index = _mm512_cvttps_epi32(b);
+		f = _mm512_add_ps(_mm512_i32gather_ps(index, start, 4), _mm512_mul_ps(f, _mm512_i32gather_ps(index, slope, 4)));
+		_mm512_storeu_ps(equalized_out + i, _mm512_mask_mov_ps(f, interior, s));
+	}
+}
+
+#endif	// A3_FRACTAL_AVX512
+
+#endif	// A3_FRACTAL_X86
+
+
+// equalize kernel table, indexed by instruction set
+static const a3_FractalEqualizeSpanFunc a3fractalEqualizeSpanFuncs[a3fractal_isaCount] = {
+	a3fractalEqualizeSpan_scalar,
+#if A3_FRACTAL_X86
+	a3fractalEqualizeSpan_sse2,
+	a3fractalEqualizeSpan_avx2,
+#if A3_FRACTAL_AVX512
+	a3fractalEqualizeSpan_avx512,
+#else	// !A3_FRACTAL_AVX512
+	a3fractalEqualizeSpan_avx2,
+#endif	// A3_FRACTAL_AVX512
+#else	// !A3_FRACTAL_X86
+	a3fractalEqualizeSpan_scalar,
+	a3fractalEqualizeSpan_scalar,
+	a3fractalEqualizeSpan_scalar,
+#endif	// A3_FRACTAL_X86
+};
+
+
+//-----------------------------------------------------------------------------
+// field
+
+// header members one at a time; the struct may be padded, so it is never
+//	read or written whole
+static int a3colorizeWriteHeader(const a3_ColorizeHeader *header, FILE *fp)
+{
+	return (fwrite(&header->magic, sizeof(header->magic), 1, fp) == 1 &&
+		fwrite(&header->version, sizeof(header->version), 1, fp) == 1 &&
+		fwrite(&header->width, sizeof(header->width), 1, fp) == 1 &&
+		fwrite(&header->height, sizeof(header->height), 1, fp) == 1 &&
+		fwrite(&header->iterations, sizeof(header->iterations), 1, fp) == 1 &&
+		fwrite(&header->roots, sizeof(header->roots), 1, fp) == 1 &&
+		fwrite(header->view, sizeof(header->view[0]), 4, fp) == 4);
+}
+
+static int a3colorizeReadHeader(a3_ColorizeHeader *header, FILE *fp)
+{
+	return (fread(&header->magic, sizeof(header->magic), 1, fp) == 1 &&
+		fread(&header->version, sizeof(header->version), 1, fp) == 1 &&
+		fread(&header->width, sizeof(header->width), 1, fp) == 1 &&
+		fread(&header->height, sizeof(header->height), 1, fp) == 1 &&
+		fread(&header->iterations, sizeof(header->iterations), 1, fp) == 1 &&
+		fread(&header->roots, sizeof(header->roots), 1, fp) == 1 &&
+		fread(header->view, sizeof(header->view[0]), 4, fp) == 4);
+}
+
+int a3fractalFieldCreate(a3_FractalField **field_out, unsigned int width, unsigned int height, unsigned int roots)
+{
+	a3_FractalField *field;
+	unsigned int pixels;
+	size_t size;
+
+	if (field_out && width && height && width <= a3fractal_fieldPixelsMax / height && roots < a3fractal_fieldNoId)
+	{
+		if (!*field_out)
+		{
+			// one block: header, counts, then ids
+			pixels = width * height;
+			size = sizeof(a3_FractalField) + pixels * sizeof(float) + (roots ? pixels : 0);
+			field = (a3_FractalField *)calloc(1, size);
+			if (field)
+			{
+				field->width = width;
+				field->height = height;
+				field->roots = roots;
+				field->smooth = (float *)(field + 1);
+				field->id = roots ? (unsigned char *)(field->smooth + pixels) : 0;
+				*field_out = field;
+				return (int)pixels;
+			}
+		}
+		return 0;
+	}
+	return -1;
+}
+
+int a3fractalFieldRelease(a3_FractalField **field)
+{
+	if (field)
+	{
+		free(*field);
+		*field = 0;
+		return 1;
+	}
+	return -1;
+}
+
+int a3fractalFieldSave(const a3_FractalField *field, const char *filePath)
+{
+	a3_ColorizeHeader header;
+	FILE *fp;
+	unsigned int pixels;
+	size_t written;
+
+	if (field && filePath && *filePath)
+	{
+		header.magic = a3colorize_magic;
+		header.version = a3colorize_version;
+		header.width = field->width;
+		header.height = field->height;
+		header.iterations = field->iterations;
+		header.roots = field->id ? field->roots : 0;
+		header.view[0] = field->view.centerX;
+		header.view[1] = field->view.centerY;
+		header.view[2] = field->view.width;
+		header.view[3] = field->view.height;
+		pixels = field->width * field->height;
+
+		fp = fopen(filePath, "wb");
+		if (fp)
+		{
+			written = a3colorizeWriteHeader(&header, fp) ? a3colorize_headerBytes : 0;
+			written += fwrite(field->smooth, sizeof(float), pixels, fp) * sizeof(float);
+			if (header.roots)
+				written += fwrite(field->id, 1, pixels, fp);
+			if (fclose(fp) == 0 && written == a3colorize_headerBytes + pixels * (sizeof(float) + (header.roots ? 1 : 0)))
+				return (int)written;
+		}
+		return 0;
+	}
+	return -1;
+}
+
+int a3fractalFieldLoad(a3_FractalField **field_out, const char *filePath)
+{
+	a3_ColorizeHeader header;
+	a3_FractalField *field = 0;
+	FILE *fp;
+	unsigned int pixels;
+	int result = 0;
+
+	if (field_out && filePath && *filePath)
+	{
+		if (!*field_out)
+		{
+			fp = fopen(filePath, "rb");
+			if (fp)
+			{
+				if (a3colorizeReadHeader(&header, fp) &&
+					header.magic == a3colorize_magic && header.version == a3colorize_version &&
+					a3fractalFieldCreate(&field, header.width, header.height, header.roots) > 0)
+				{
+					pixels = header.width * header.height;
+					if (fread(field->smooth, sizeof(float), pixels, fp) == pixels && (!field->id || fread(field->id, 1, pixels, fp) == pixels))
+					{
+						field->view.centerX = header.view[0];
+						field->view.centerY = header.view[1];
+						field->view.width = header.view[2];
+						field->view.height = header.view[3];
+						field->iterations = header.iterations;
+						*field_out = field;
+						result = (int)pixels;
+					}
+					else
+						a3fractalFieldRelease(&field);
+				}
+				fclose(fp);
+			}
+		}
+		return result;
+	}
+	return -1;
+}
+
+
+//-----------------------------------------------------------------------------
+// palette
+
+int a3fractalPaletteSetShader(a3_FractalPalette *palette)
+{
+	if (palette)
+	{
+		memset(palette, 0, sizeof(a3_FractalPalette));
+		palette->type = a3fractal_paletteHSV;
+		palette->hueOffset = 0.95f;
+		palette->hueScale = 0.12f;
+		palette->saturation = 1.0f;
+		palette->valueBase = 0.2f;
+		palette->valueAmplitude = 0.4f;
+		palette->valueFrequency = 0.3f;
+		palette->interior[3] = 255;
+		return 1;
+	}
+	return -1;
+}
+
+int a3fractalPaletteSetRamp(a3_FractalPalette *palette, const unsigned char *rgba, unsigned int width, unsigned int height)
+{
+	if (palette && rgba && width && height)
+	{
+		memset(palette, 0, sizeof(a3_FractalPalette));
+		palette->type = a3fractal_paletteRamp;
+		palette->ramp = rgba;
+		palette->rampWidth = width;
+		palette->rampHeight = height;
+		palette->rampScale = 1.0f / 32.0f;
+		palette->rampV = 0.5f;
+		palette->interior[3] = 255;
+		return 1;
+	}
+	return -1;
+}
+
+
+//-----------------------------------------------------------------------------
+// colorize
+
+int a3fractalColorize(const a3_FractalPalette *palette, const float *smooth, const unsigned char *id_opt, unsigned int count, unsigned char *rgba_out, a3_FractalISA isa)
+{
+	float smoothPad[a3colorize_span];
+	unsigned char idPad[a3colorize_span], rgbaPad[a3colorize_span * 4];
+	unsigned int i, n, padded, lanes;
+	a3_FractalISA best;
+	a3_FractalColorizeSpanFunc span;
+
+	if (palette && smooth && rgba_out && (palette->type != a3fractal_paletteRamp || (palette->ramp && palette->rampWidth && palette->rampHeight)))
+	{
+		best = a3fractalDetectISA();
+		if (isa == a3fractal_isaAuto || isa > best)
+			isa = best;
+		span = a3fractalColorizeSpanFuncs[isa][palette->type == a3fractal_paletteRamp];
+		lanes = a3fractalGetISALanes(isa);
+
+		// whole packets straight from the caller's arrays, then the tail
+		//	padded with its last pixel
+		padded = count / lanes * lanes;
+		for (i = 0; i < padded; i += n)
+		{
+			n = a3minimum(a3colorize_span, padded - i);
+			span(palette, smooth + i, id_opt ? id_opt + i : a3colorizeZeroId, n, rgba_out + i * 4);
+		}
+		if (i < count)
+		{
+			n = count - i;
+			memcpy(smoothPad, smooth + i, n * sizeof(float));
+			memcpy(idPad, id_opt ? id_opt + i : a3colorizeZeroId, n);
+			for (padded = n; padded < lanes; ++padded)
+			{
+				smoothPad[padded] = smoothPad[n - 1];
+				idPad[padded] = idPad[n - 1];
+			}
+			span(palette, smoothPad, idPad, lanes, rgbaPad);
+			memcpy(rgba_out + i * 4, rgbaPad, n * 4);
+		}
+		return (int)count;
+	}
+	return -1;
+}
+
+static void a3fractalColorizeTask(void *args, unsigned int x0, unsigned int y0, unsigned int x1, unsigned int y1, unsigned int workerIndex)
+{
+	const a3_ColorizePass *pass = (const a3_ColorizePass *)args;
+	const a3_FractalField *field = pass->field;
+	unsigned int y, index;
+
+	for (y = y0; y < y1; ++y)
+	{
+		index = y * field->width + x0;
+		a3fractalColorize(pass->palette, field->smooth + index, field->id ? field->id + index : 0, x1 - x0, pass->rgba + index * 4, pass->isa);
+	}
+}
+
+int a3fractalColorizeField(const a3_FractalPalette *palette, const a3_FractalField *field, unsigned char *rgba_out, a3_FractalISA isa, a3_ThreadPool *pool_opt)
+{
+	a3_ColorizePass pass[1];
+
+	if (palette && field && field->smooth && rgba_out && (palette->type != a3fractal_paletteRamp || (palette->ramp && palette->rampWidth && palette->rampHeight)))
+	{
+		// whole rows per task, so spans stay long
+		pass->palette = palette;
+		pass->field = field;
+		pass->rgba = rgba_out;
+		pass->isa = isa;
+		if (a3threadPoolParallelFor2D(pool_opt, 0, a3fractalColorizeTask, pass, field->width, field->height, field->width, a3colorize_rows) < 0)
+			return 0;
+		return (int)(field->width * field->height);
+	}
+	return -1;
+}
+
+
+//-----------------------------------------------------------------------------
+// equalize
+
+// count a worker's share of the histogram
+static void a3fractalEqualizeCountTask(void *args, unsigned int x0, unsigned int y0, unsigned int x1, unsigned int y1, unsigned int workerIndex)
+{
+	const a3_EqualizePass *pass = (const a3_EqualizePass *)args;
+	const a3_FractalField *field = pass->field;
+	const float last = (float)(pass->bins - 1);
+	unsigned int *hist = pass->hist + workerIndex * pass->bins;
+	const float *smooth;
+	unsigned int x, y;
+	float b;
+
+	for (y = y0; y < y1; ++y)
+	{
+		smooth = field->smooth + y * field->width;
+		for (x = x0; x < x1; ++x)
+			if (!a3fractalIsInterior(smooth[x]))
+			{
+				b = floorf(smooth[x]) + (float)a3colorize_binOffset;
+				++hist[(unsigned int)a3clamp(0.0f, last, b)];
+			}
+	}
+}
+
+// merge a block of bins across the workers and scan it
+static void a3fractalEqualizeSumTask(void *args, unsigned int x0, unsigned int y0, unsigned int x1, unsigned int y1, unsigned int workerIndex)
+{
+	const a3_EqualizePass *pass = (const a3_EqualizePass *)args;
+	unsigned long long total = 0, count;
+	unsigned int b, w;
+
+	for (b = x0; b < x1; ++b)
+	{
+		for (w = 0, count = 0; w < pass->workers; ++w)
+			count += pass->hist[w * pass->bins + b];
+		pass->sum[b] = total;
+		total += count;
+	}
+	pass->blockSum[x0 / a3colorize_binBlock] = total;
+}
+
+// offset a block by the blocks before it and turn its sums into starts
+//	and slopes
+static void a3fractalEqualizeScaleTask(void *args, unsigned int x0, unsigned int y0, unsigned int x1, unsigned int y1, unsigned int workerIndex)
+{
+	const a3_EqualizePass *pass = (const a3_EqualizePass *)args;
+	const unsigned long long offset = pass->blockSum[x0 / a3colorize_binBlock];
+	const unsigned long long blockEnd = pass->blockSum[x0 / a3colorize_binBlock + 1];
+	unsigned long long next;
+	unsigned int b;
+
+	for (b = x0; b < x1; ++b)
+	{
+		next = b + 1 < x1 ? offset + pass->sum[b + 1] : blockEnd;
+		pass->start[b] = (float)((double)(offset + pass->sum[b]) * pass->scale);
+		pass->slope[b] = (float)((double)(next - offset - pass->sum[b]) * pass->scale);
+	}
+}
+
+// map rows through the bins and the palette, packet by packet
+static void a3fractalEqualizeMapTask(void *args, unsigned int x0, unsigned int y0, unsigned int x1, unsigned int y1, unsigned int workerIndex)
+{
+	const a3_EqualizePass *pass = (const a3_EqualizePass *)args;
+	const a3_FractalField *field = pass->field;
+	const unsigned int lanes = pass->lanes;
+	float smooth[a3colorize_span], equalized[a3colorize_span];
+	unsigned char id[a3colorize_span], rgba[a3colorize_span * 4];
+	unsigned int x, y, i, n, padded, index;
+
+	for (y = y0; y < y1; ++y)
+	{
+		for (x = x0; x < x1; x += n)
+		{
+			// fill span, padding to a whole packet with the last pixel
+			n = a3minimum(a3colorize_span, x1 - x);
+			padded = (n + lanes - 1) / lanes * lanes;
+			index = y * field->width + x;
+			memcpy(smooth, field->smooth + index, n * sizeof(float));
+			memcpy(id, field->id ? field->id + index : a3colorizeZeroId, n);
+			for (i = n; i < padded; ++i)
+			{
+				smooth[i] = smooth[n - 1];
+				id[i] = id[n - 1];
+			}
+			pass->map(pass->start, pass->slope, pass->bins, smooth, padded, equalized);
+			pass->colorize(pass->palette, equalized, id, padded, rgba);
+			memcpy(pass->rgba + index * 4, rgba, n * 4);
+			if (pass->equalized)
+				memcpy(pass->equalized + index, equalized, n * sizeof(float));
+		}
+	}
+}
+
+int a3fractalColorizeEqualized(const a3_FractalPalette *palette, const a3_FractalField *field, float range, unsigned char *rgba_out, float *equalized_out_opt, a3_FractalISA isa, a3_ThreadPool *pool_opt)
+{
+	a3_EqualizePass pass[1];
+	a3_FractalISA best;
+	unsigned int blocks, b;
+	unsigned long long total, count;
+	int result = 0;
+
+	if (palette && field && field->smooth && field->iterations && rgba_out && range >= 0.0f && (palette->type != a3fractal_paletteRamp || (palette->ramp && palette->rampWidth && palette->rampHeight)))
+	{
+		// bins for every iteration, histograms for every worker, sums for
+		//	every bin and block, and one more block total for the end
+		pass->bins = field->iterations + a3colorize_binOffset;
+		pass->workers = a3threadPoolGetWorkerCount(pool_opt) + 1;
+		blocks = (pass->bins + a3colorize_binBlock - 1) / a3colorize_binBlock;
+		pass->hist = (unsigned int *)calloc(pass->workers * pass->bins, sizeof(unsigned int));
+		pass->sum = (unsigned long long *)malloc((pass->bins + blocks + 1) * sizeof(unsigned long long));
+		pass->start = (float *)malloc(pass->bins * 2 * sizeof(float));
+		if (!pass->hist || !pass->sum || !pass->start)
+		{
+			free(pass->hist);
+			free(pass->sum);
+			free(pass->start);
+			return 0;
+		}
+		pass->blockSum = pass->sum + pass->bins;
+		pass->slope = pass->start + pass->bins;
+
+		best = a3fractalDetectISA();
+		if (isa == a3fractal_isaAuto || isa > best)
+			isa = best;
+		pass->colorize = a3fractalColorizeSpanFuncs[isa][palette->type == a3fractal_paletteRamp];
+		pass->map = a3fractalEqualizeSpanFuncs[isa];
+		pass->lanes = a3fractalGetISALanes(isa);
+		pass->palette = palette;
+		pass->field = field;
+		pass->rgba = rgba_out;
+		pass->equalized = equalized_out_opt;
+
+		// count, then merge and scan blocks; every step reads the last
+		//	one's results, so a step that could not be queued ends it
+		if (a3threadPoolParallelFor2D(pool_opt, 0, a3fractalEqualizeCountTask, pass, field->width, field->height, field->width, a3colorize_rows) >= 0 &&
+			a3threadPoolParallelFor2D(pool_opt, 0, a3fractalEqualizeSumTask, pass, pass->bins, 1, a3colorize_binBlock, 1) >= 0)
+		{
+			// scan the block totals in place, leaving the grand total last
+			for (b = 0, total = 0; b < blocks; ++b)
+			{
+				count = pass->blockSum[b];
+				pass->blockSum[b] = total;
+				total += count;
+			}
+			pass->blockSum[blocks] = total;
+
+			// finish the sums and map
+			pass->scale = total ? (double)(range > 0.0f ? range : a3fractal_equalizeRange) / (double)total : 0.0;
+			if (a3threadPoolParallelFor2D(pool_opt, 0, a3fractalEqualizeScaleTask, pass, pass->bins, 1, a3colorize_binBlock, 1) >= 0 &&
+				a3threadPoolParallelFor2D(pool_opt, 0, a3fractalEqualizeMapTask, pass, field->width, field->height, field->width, a3colorize_rows) >= 0)
+				result = (int)(field->width * field->height);
+		}
+
+		free(pass->hist);
+		free(pass->sum);
+		free(pass->start);
+		return result;
+	}
+	return -1;
+}
+
+
+//-----------------------------------------------------------------------------
@@ -0,0 +1,225 @@
+/*
+	animal3D SDK: Minimal 3D Animation Framework
+	Fractals Midterm: CPU fractal engines
+
+	a3_DemoFractalColorize.h
+	Persisted smooth-iteration fields and palettes applied to them.
+
+	The shaders turn the iteration count into color in the same breath as
+	they compute it: the HSV constants of the Mandelbrot shader and the
+	ramp texture both sit in the fragment output, so trying another
+	palette means running every orbit again. The count itself does not
+	depend on the palette, so here it is kept instead: a field holds the
+	smooth iteration count of every pixel, as the engines already write
+	it, and for Newton fractals the basin each pixel converged to. A field
+	can be saved next to the image and loaded back later.
+
+	A palette maps a field to color afterwards: either the shader's HSV
+	curve, with any of its constants changed, or a ramp image sampled the
+	way the demo samples 'tex_ramp', repeating along the count, clamped
+	and bilinear. Basins shift the hue or move down the ramp. Colorizing
+	is a few dozen instructions per pixel, run 1, 4, 8 or 16 pixels at a
+	time with scalar code, SSE2, AVX2 or AVX-512 and across the pool, so
+	a new palette costs milliseconds where the render cost seconds.
+
+	Deep zooms spend most of their pixels in a narrow band of counts near
+	the cap, which any palette spread over the counts shows as one color.
+	Histogram equalization spreads the palette over the pixels instead:
+	each count is replaced by the share of escaped pixels with a lower
+	one. The histogram is counted per worker, merged and summed across
+	the pool in blocks of bins, then mapped in the same packets that
+	colorize, so the whole mode stays as parallel as the render.
+*/
+
+#ifndef __ANIMAL3D_DEMOFRACTALCOLORIZE_H
+#define __ANIMAL3D_DEMOFRACTALCOLORIZE_H
+
+
+#include "a3_DemoFractalEscape.h"
+
+
+//-----------------------------------------------------------------------------
+
+#ifdef __cplusplus
+extern "C"
+{
+#else	// !__cplusplus
+	typedef struct a3_FractalField			a3_FractalField;
+	typedef struct a3_FractalPalette		a3_FractalPalette;
+	typedef enum a3_FractalPaletteType		a3_FractalPaletteType;
+#endif	// __cplusplus
+
+
+//-----------------------------------------------------------------------------
+
+	// id stored for pixels with no basin, same as 'a3fractal_newtonNoRoot';
+	//	they take the interior color
+#define a3fractal_fieldNoId				0xff
+
+	// most pixels in a field, so that a saved field's size in bytes, ids
+	//	included, fits in an int
+#define a3fractal_fieldPixelsMax		400000000u
+
+	// default count an equalized field is spread over; the shader's
+	//	palette turns its hue 7.68 times across it
+#define a3fractal_equalizeRange			64.0f
+
+
+	// per-pixel results kept from a render
+	//	member view: window the field was rendered for
+	//	members width, height: dimensions in pixels
+	//	member iterations: iteration cap it was rendered with
+	//	member roots: number of basins, 0 if the field has no ids
+	//	member smooth: smooth iteration count per pixel, as the engines'
+	//		'smooth_out_opt'; 'a3fractal_interior' never escaped
+	//	member id: root or basin per pixel, as the Newton engines'
+	//		'root_out_opt', or null if 'roots' is 0
+	// both buffers are row-major, row 0 at the bottom (texcoord v = 0)
+	struct a3_FractalField
+	{
+		a3_FractalView view;
+		unsigned int width, height;
+		unsigned int iterations;
+		unsigned int roots;
+		float *smooth;
+		unsigned char *id;
+	};
+
+
+	// how a palette turns a count into color
+	enum a3_FractalPaletteType
+	{
+		a3fractal_paletteHSV,		// hue and value curves, as the shader
+		a3fractal_paletteRamp,		// ramp image, as 'tex_ramp'
+	};
+
+
+	// palette
+	//	member type: curves or ramp
+	//	members hueOffset, hueScale, hueId: hue is offset + scale * count +
+	//		id * hueId, in turns
+	//	member saturation: saturation, 0 to 1
+	//	members valueBase, valueAmplitude, valueFrequency: value is base +
+	//		amplitude * (1 + sin(frequency * count))
+	//	member ramp: RGBA8 texels of the ramp, row-major, row 0 at v = 0;
+	//		not copied, must outlive the palette's use
+	//	members rampWidth, rampHeight: ramp dimensions
+	//	members rampOffset, rampScale: u is offset + scale * count,
+	//		repeating
+	//	members rampV, rampVId: v is rampV + id * rampVId, clamped
+	//	member interior: color of pixels that never escape or converge
+	struct a3_FractalPalette
+	{
+		a3_FractalPaletteType type;
+		float hueOffset, hueScale, hueId;
+		float saturation;
+		float valueBase, valueAmplitude, valueFrequency;
+		const unsigned char *ramp;
+		unsigned int rampWidth, rampHeight;
+		float rampOffset, rampScale;
+		float rampV, rampVId;
+		unsigned char interior[4];
+	};
+
+
+//-----------------------------------------------------------------------------
+
+	// Create a field; its view and iteration cap are left for the caller.
+	//	param field_out: non-null pointer to field pointer; must be null
+	//	params width, height: dimensions in pixels; their product is at
+	//		most 'a3fractal_fieldPixelsMax'
+	//	param roots: number of basins; 0 allocates no ids
+	//	return: number of pixels if success
+	//	return: 0 if fail (already created or out of memory)
+	//	return: -1 if invalid params
+	int a3fractalFieldCreate(a3_FractalField **field_out, unsigned int width, unsigned int height, unsigned int roots);
+
+	// Release a field.
+	//	param field: non-null pointer to field pointer; reset to null
+	//	return: 1 if success
+	//	return: -1 if invalid params
+	int a3fractalFieldRelease(a3_FractalField **field);
+
+	// Save a field to a binary file, in native byte order.
+	//	param field: non-null pointer to field
+	//	param filePath: non-null, non-empty path
+	//	return: number of bytes written if success
+	//	return: 0 if fail (file could not be written)
+	//	return: -1 if invalid params
+	int a3fractalFieldSave(const a3_FractalField *field, const char *filePath);
+
+	// Load a field saved by 'a3fractalFieldSave'.
+	//	param field_out: non-null pointer to field pointer; must be null
+	//	param filePath: non-null, non-empty path
+	//	return: number of pixels if success
+	//	return: 0 if fail (already created, file missing, truncated or
+	//		not a field, or out of memory)
+	//	return: -1 if invalid params
+	int a3fractalFieldLoad(a3_FractalField **field_out, const char *filePath);
+
+	// Set a palette to the Mandelbrot shader's; colorizing with it gives
+	//	'a3fractalShade', up to one level from a sine approximation.
+	//	param palette: non-null pointer to palette
+	//	return: 1 if success
+	//	return: -1 if invalid params
+	int a3fractalPaletteSetShader(a3_FractalPalette *palette);
+
+	// Set a palette to a ramp image, sampled across its middle row once
+	//	every 32 iterations; the interior is black.
+	//	param palette: non-null pointer to palette
+	//	param rgba: non-null pointer to RGBA8 texels, kept by pointer
+	//	params width, height: ramp dimensions
+	//	return: 1 if success
+	//	return: -1 if invalid params
+	int a3fractalPaletteSetRamp(a3_FractalPalette *palette, const unsigned char *rgba, unsigned int width, unsigned int height);
+
+	// Colorize an array of counts.
+	//	param palette: non-null pointer to palette
+	//	param smooth: non-null pointer to 'count' smooth iteration counts
+	//	param id_opt: optional pointer to 'count' ids; all 0 if null
+	//	param count: number of pixels
+	//	param rgba_out: non-null pointer to 'count' RGBA8 colors
+	//	param isa: instruction set to use; auto picks at runtime
+	//	return: number of pixels colorized if success
+	//	return: -1 if invalid params
+	int a3fractalColorize(const a3_FractalPalette *palette, const float *smooth, const unsigned char *id_opt, unsigned int count, unsigned char *rgba_out, a3_FractalISA isa);
+
+	// Colorize a whole field, rows spread across the pool.
+	//	param palette: non-null pointer to palette
+	//	param field: non-null pointer to field
+	//	param rgba_out: non-null pointer to one RGBA8 color per pixel
+	//	param isa: instruction set to use; auto picks at runtime
+	//	param pool_opt: optional pool; colorizes on this thread if null
+	//	return: number of pixels colorized if success
+	//	return: 0 if fail (out of memory)
+	//	return: -1 if invalid params
+	int a3fractalColorizeField(const a3_FractalPalette *palette, const a3_FractalField *field, unsigned char *rgba_out, a3_FractalISA isa, a3_ThreadPool *pool_opt);
+
+	// Colorize a whole field by histogram equalization: every count is
+	//	replaced by the share of escaped pixels below it, times a range,
+	//	interpolated within its iteration so bands stay smooth, and the
+	//	result goes through the palette.
+	//	param palette: non-null pointer to palette
+	//	param field: non-null pointer to field with its iteration cap set
+	//	param range: count the equalized field spans, from 0; 0 uses
+	//		default
+	//	param rgba_out: non-null pointer to one RGBA8 color per pixel
+	//	param equalized_out_opt: optional equalized count per pixel;
+	//		interior pixels keep 'a3fractal_interior'
+	//	param isa: instruction set to use; auto picks at runtime
+	//	param pool_opt: optional pool; colorizes on this thread if null
+	//	return: number of pixels colorized if success
+	//	return: 0 if fail (out of memory)
+	//	return: -1 if invalid params
+	int a3fractalColorizeEqualized(const a3_FractalPalette *palette, const a3_FractalField *field, float range, unsigned char *rgba_out, float *equalized_out_opt, a3_FractalISA isa, a3_ThreadPool *pool_opt);
+
+
+//-----------------------------------------------------------------------------
+
+
+#ifdef __cplusplus
+}
+#endif	// __cplusplus
+
+
+#endif	// !__ANIMAL3D_DEMOFRACTALCOLORIZE_H
@@ -0,0 +1,674 @@
+/*
+	animal3D SDK: Minimal 3D Animation Framework
+	Fractals Midterm: CPU fractal engines
+
+	a3_DemoFractalEscape.c
+	CPU escape-time engine implementation.
+
+	The per-pixel loop mirrors the shader exactly, in single precision:
+		z = c
+		for (iter = 0; iter < uIter; ++iter)
+			z = (3 x^2 - y^2, 6 x y) + c
+			if (|z|^2 > 16) -> smooth = (iter - 1) - log2(log2(|z|^2)), stop
+	SIMD kernels iterate a packet of pixels until every lane has escaped or
+	the cap is reached; lanes that escape early are masked out and their
+	iteration and magnitude are latched. No fused multiply-add is used, so
+	every instruction set produces bit-identical iteration counts.
+
+	Double-precision kernels run the same loop with half the lanes per
+	instruction; they are what keeps the image intact once the pixel
+	spacing approaches single-precision resolution.
+*/
+
+#include "a3_DemoFractalEscape.h"
+#include "_utilities/a3_DemoSIMD.h"
+
+#include "animal3D/a3/a3macros.h"
+
+#include <math.h>
+#include <string.h>
+
+
+//-----------------------------------------------------------------------------
+
+// pixels handed to a kernel at once; multiple of the widest packet
+#define a3fractal_span		64
+
+// default tile edge for pooled renders; small enough to spread the slow
+//	interior regions over all workers, large enough to amortize dispatch
+#define a3fractal_tile		32
+
+
+// kernel: iterate 'count' pixels on one row
+//	writes the escape iteration (or cap) and the squared magnitude at escape
+typedef void(*a3_FractalEscapeSpanFunc)(const float *cx, const float cy, const unsigned int count, const unsigned int cap, unsigned int *iter_out, float *mag_out);
+typedef void(*a3_FractalEscapeSpanFuncD)(const double *cx, const double cy, const unsigned int count, const unsigned int cap, unsigned int *iter_out, float *mag_out);
+
+
+//-----------------------------------------------------------------------------
+// kernels
+
+// scalar fallback
+static void a3fractalEscapeSpan_scalar(const float *cx, const float cy, const unsigned int count, const unsigned int cap, unsigned int *iter_out, float *mag_out)
+{
+	unsigned int i, iter;
+	float zx, zy, nzx, mag;
+	for (i = 0; i < count; ++i)
+	{
+		zx = cx[i];
+		zy = cy;
+		iter_out[i] = cap;
+		mag_out[i] = 0.0f;
+		for (iter = 0; iter < cap; ++iter)
+		{
+			nzx = 3.0f * zx * zx - zy * zy + cx[i];
+			zy = 6.0f * zx * zy + cy;
+			zx = nzx;
+			mag = zx * zx + zy * zy;
+			if (mag > a3fractal_bailout)
+			{
+				iter_out[i] = iter;
+				mag_out[i] = mag;
+				break;
+			}
+		}
+	}
+}
+
+
+#if A3_FRACTAL_X86
+
+// SSE2: 4 pixels per instruction
+A3_FRACTAL_TARGET("sse2")
+static void a3fractalEscapeSpan_sse2(const float *cx, const float cy, const unsigned int count, const unsigned int cap, unsigned int *iter_out, float *mag_out)
+{
+	const __m128 three = _mm_set1_ps(3.0f), six = _mm_set1_ps(6.0f);
+	const __m128 bailout = _mm_set1_ps(a3fractal_bailout);
+	const __m128 vcy = _mm_set1_ps(cy);
+	__m128 vcx, zx, zy, nzx, mag, escaped, done, magLatch;
+	__m128i iterLatch, iterNow;
+	unsigned int i, iter;
+
+	for (i = 0; i < count; i += 4)
+	{
+		vcx = _mm_loadu_ps(cx + i);
+		zx = vcx;
+		zy = vcy;
+		done = _mm_setzero_ps();
+		magLatch = _mm_setzero_ps();
+		iterLatch = _mm_set1_epi32((int)cap);
+		for (iter = 0; iter < cap; ++iter)
+		{
+			nzx = _mm_add_ps(_mm_sub_ps(_mm_mul_ps(_mm_mul_ps(three, zx), zx), _mm_mul_ps(zy, zy)), vcx);
+			zy = _mm_add_ps(_mm_mul_ps(_mm_mul_ps(six, zx), zy), vcy);
+			zx = nzx;
+			mag = _mm_add_ps(_mm_mul_ps(zx, zx), _mm_mul_ps(zy, zy));
+
+			// lanes escaping on this iteration latch their results
+			escaped = _mm_andnot_ps(done, _mm_cmpgt_ps(mag, bailout));
+			iterNow = _mm_set1_epi32((int)iter);
+			iterLatch = _mm_or_si128(_mm_and_si128(_mm_castps_si128(escaped), iterNow), _mm_andnot_si128(_mm_castps_si128(escaped), iterLatch));
+			magLatch = _mm_or_ps(_mm_and_ps(escaped, mag), _mm_andnot_ps(escaped, magLatch));
+			done = _mm_or_ps(done, escaped);
+			if (_mm_movemask_ps(done) == 0xf)
+				break;
+		}
+		_mm_storeu_si128((__m128i *)(iter_out + i), iterLatch);
+		_mm_storeu_ps(mag_out + i, magLatch);
+	}
+}
+
+
+// AVX2: 8 pixels per instruction
+A3_FRACTAL_TARGET("avx2")
+static void a3fractalEscapeSpan_avx2(const float *cx, const float cy, const unsigned int count, const unsigned int cap, unsigned int *iter_out, float *mag_out)
+{
+	const __m256 three = _mm256_set1_ps(3.0f), six = _mm256_set1_ps(6.0f);
+	const __m256 bailout = _mm256_set1_ps(a3fractal_bailout);
+	const __m256 vcy = _mm256_set1_ps(cy);
+	__m256 vcx, zx, zy, nzx, mag, escaped, done, magLatch;
+	__m256i iterLatch;
+	unsigned int i, iter;
+
+	for (i = 0; i < count; i += 8)
+	{
+		vcx = _mm256_loadu_ps(cx + i);
+		zx = vcx;
+		zy = vcy;
+		done = _mm256_setzero_ps();
+		magLatch = _mm256_setzero_ps();
+		iterLatch = _mm256_set1_epi32((int)cap);
+		for (iter = 0; iter < cap; ++iter)
+		{
+			nzx = _mm256_add_ps(_mm256_sub_ps(_mm256_mul_ps(_mm256_mul_ps(three, zx), zx), _mm256_mul_ps(zy, zy)), vcx);
+			zy = _mm256_add_ps(_mm256_mul_ps(_mm256_mul_ps(six, zx), zy), vcy);
+			zx = nzx;
+			mag = _mm256_add_ps(_mm256_mul_ps(zx, zx), _mm256_mul_ps(zy, zy));
+
+			escaped = _mm256_andnot_ps(done, _mm256_cmp_ps(mag, bailout, _CMP_GT_OQ));
+			iterLatch = _mm256_castps_si256(_mm256_blendv_ps(_mm256_castsi256_ps(iterLatch), _mm256_castsi256_ps(_mm256_set1_epi32((int)iter)), escaped));
+			magLatch = _mm256_blendv_ps(magLatch, mag, escaped);
+			done = _mm256_or_ps(done, escaped);
+			if (_mm256_movemask_ps(done) == 0xff)
+				break;
+		}
+		_mm256_storeu_si256((__m256i *)(iter_out + i), iterLatch);
+		_mm256_storeu_ps(mag_out + i, magLatch);
+	}
+}
+
+
+#if A3_FRACTAL_AVX512
+
+// AVX-512: 16 pixels per instruction
+A3_FRACTAL_TARGET("avx512f")
+static void a3fractalEscapeSpan_avx512(const float *cx, const float cy, const unsigned int count, const unsigned int cap, unsigned int *iter_out, float *mag_out)
+{
+	const __m512 three = _mm512_set1_ps(3.0f), six = _mm512_set1_ps(6.0f);
+	const __m512 bailout = _mm512_set1_ps(a3fractal_bailout);
+	const __m512 vcy = _mm512_set1_ps(cy);
+	__m512 vcx, zx, zy, nzx, mag, magLatch;
+	__m512i iterLatch;
+	__mmask16 escaped, done;
+	unsigned int i, iter;
+
+	for (i = 0; i < count; i += 16)
+	{
+		vcx = _mm512_loadu_ps(cx + i);
+		zx = vcx;
+		zy = vcy;
+		done = 0;
+		magLatch = _mm512_setzero_ps();
+		iterLatch = _mm512_set1_epi32((int)cap);
+		for (iter = 0; iter < cap; ++iter)
+		{
+			nzx = _mm512_add_ps(_mm512_sub_ps(_mm512_mul_ps(_mm512_mul_ps(three, zx), zx), _mm512_mul_ps(zy, zy)), vcx);
+			zy = _mm512_add_ps(_mm512_mul_ps(_mm512_mul_ps(six, zx), zy), vcy);
+			zx = nzx;
+			mag = _mm512_add_ps(_mm512_mul_ps(zx, zx), _mm512_mul_ps(zy, zy));
+
+			escaped = _mm512_mask_cmp_ps_mask((__mmask16)~done, mag, bailout, _CMP_GT_OQ);
+			iterLatch = _mm512_mask_mov_epi32(iterLatch, escaped, _mm512_set1_epi32((int)iter));
+			magLatch = _mm512_mask_mov_ps(magLatch, escaped, mag);
+			done = (__mmask16)(done | escaped);
+			if (done == 0xffff)
+				break;
+		}
+		_mm512_storeu_si512((void *)(iter_out + i), iterLatch);
+		_mm512_storeu_ps(mag_out + i, magLatch);
+	}
+}
+
+#endif	// A3_FRACTAL_AVX512
+
+#endif	// A3_FRACTAL_X86
+
+
+// kernel table, indexed by instruction set
+static const a3_FractalEscapeSpanFunc a3fractalEscapeSpanFuncs[a3fractal_isaCount] = {
+	a3fractalEscapeSpan_scalar,
+#if A3_FRACTAL_X86
+	a3fractalEscapeSpan_sse2,
+	a3fractalEscapeSpan_avx2,
+#if A3_FRACTAL_AVX512
+	a3fractalEscapeSpan_avx512,
+#else	// !A3_FRACTAL_AVX512
+	a3fractalEscapeSpan_avx2,
+#endif	// A3_FRACTAL_AVX512
+#else	// !A3_FRACTAL_X86
+	a3fractalEscapeSpan_scalar,
+	a3fractalEscapeSpan_scalar,
+	a3fractalEscapeSpan_scalar,
+#endif	// A3_FRACTAL_X86
+};
+
+
+//-----------------------------------------------------------------------------
+// double-precision kernels
+
+// scalar fallback
+static void a3fractalEscapeSpanD_scalar(const double *cx, const double cy, const unsigned int count, const unsigned int cap, unsigned int *iter_out, float *mag_out)
+{
+	unsigned int i, iter;
+	double zx, zy, nzx, mag;
+	for (i = 0; i < count; ++i)
+	{
+		zx = cx[i];
+		zy = cy;
+		iter_out[i] = cap;
+		mag_out[i] = 0.0f;
+		for (iter = 0; iter < cap; ++iter)
+		{
+			nzx = 3.0 * zx * zx - zy * zy + cx[i];
+			zy = 6.0 * zx * zy + cy;
+			zx = nzx;
+			mag = zx * zx + zy * zy;
+			if (mag > a3fractal_bailout)
+			{
+				iter_out[i] = iter;
+				mag_out[i] = (float)mag;
+				break;
+			}
+		}
+	}
+}
+
+
+#if A3_FRACTAL_X86
+
+// latched iterations are kept as doubles (exact below 2^53) so they blend
+//	like the other lanes; converted when the packet is stored
+static void a3fractalEscapeStoreD(const double *iterLatch, const double *magLatch, const unsigned int lanes, unsigned int *iter_out, float *mag_out)
+{
+	unsigned int i;
+	for (i = 0; i < lanes; ++i)
+	{
+		iter_out[i] = (unsigned int)iterLatch[i];
+		mag_out[i] = (float)magLatch[i];
+	}
+}
+
+// SSE2: 2 pixels per instruction
+A3_FRACTAL_TARGET("sse2")
+static void a3fractalEscapeSpanD_sse2(const double *cx, const double cy, const unsigned int count, const unsigned int cap, unsigned int *iter_out, float *mag_out)
+{
+	const __m128d three = _mm_set1_pd(3.0), six = _mm_set1_pd(6.0);
+	const __m128d bailout = _mm_set1_pd(a3fractal_bailout);
+	const __m128d vcy = _mm_set1_pd(cy);
+	__m128d vcx, zx, zy, nzx, mag, escaped, done, magLatch, iterLatch;
+	double iterStore[2], magStore[2];
+	unsigned int i, iter;
+
+	for (i = 0; i < count; i += 2)
+	{
+		vcx = _mm_loadu_pd(cx + i);
+		zx = vcx;
+		zy = vcy;
+		done = _mm_setzero_pd();
+		magLatch = _mm_setzero_pd();
+		iterLatch = _mm_set1_pd((double)cap);
+		for (iter = 0; iter < cap; ++iter)
+		{
+			nzx = _mm_add_pd(_mm_sub_pd(_mm_mul_pd(_mm_mul_pd(three, zx), zx), _mm_mul_pd(zy, zy)), vcx);
+			zy = _mm_add_pd(_mm_mul_pd(_mm_mul_pd(six, zx), zy), vcy);
+			zx = nzx;
+			mag = _mm_add_pd(_mm_mul_pd(zx, zx), _mm_mul_pd(zy, zy));
+
+			escaped = _mm_andnot_pd(done, _mm_cmpgt_pd(mag, bailout));
+			iterLatch = _mm_or_pd(_mm_and_pd(escaped, _mm_set1_pd((double)iter)), _mm_andnot_pd(escaped, iterLatch));
+			magLatch = _mm_or_pd(_mm_and_pd(escaped, mag), _mm_andnot_pd(escaped, magLatch));
+			done = _mm_or_pd(done, escaped);
+			if (_mm_movemask_pd(done) == 0x3)
+				break;
+		}
+		_mm_storeu_pd(iterStore, iterLatch);
+		_mm_storeu_pd(magStore, magLatch);
+		a3fractalEscapeStoreD(iterStore, magStore, 2, iter_out + i, mag_out + i);
+	}
+}
+
+
+// AVX2: 4 pixels per instruction
+A3_FRACTAL_TARGET("avx2")
+static void a3fractalEscapeSpanD_avx2(const double *cx, const double cy, const unsigned int count, const unsigned int cap, unsigned int *iter_out, float *mag_out)
+{
+	const __m256d three = _mm256_set1_pd(3.0), six = _mm256_set1_pd(6.0);
+	const __m256d bailout = _mm256_set1_pd(a3fractal_bailout);
+	const __m256d vcy = _mm256_set1_pd(cy);
+	__m256d vcx, zx, zy, nzx, mag, escaped, done, magLatch, iterLatch;
+	double iterStore[4], magStore[4];
+	unsigned int i, iter;
+
+	for (i = 0; i < count; i += 4)
+	{
+		vcx = _mm256_loadu_pd(cx + i);
+		zx = vcx;
+		zy = vcy;
+		done = _mm256_setzero_pd();
+		magLatch = _mm256_setzero_pd();
+		iterLatch = _mm256_set1_pd((double)cap);
+		for (iter = 0; iter < cap; ++iter)
+		{
+			nzx = _mm256_add_pd(_mm256_sub_pd(_mm256_mul_pd(_mm256_mul_pd(three, zx), zx), _mm256_mul_pd(zy, zy)), vcx);
+			zy = _mm256_add_pd(_mm256_mul_pd(_mm256_mul_pd(six, zx), zy), vcy);
+			zx = nzx;
+			mag = _mm256_add_pd(_mm256_mul_pd(zx, zx), _mm256_mul_pd(zy, zy));
+
+			escaped = _mm256_andnot_pd(done, _mm256_cmp_pd(mag, bailout, _CMP_GT_OQ));
+			iterLatch = _mm256_blendv_pd(iterLatch, _mm256_set1_pd((double)iter), escaped);
+			magLatch = _mm256_blendv_pd(magLatch, mag, escaped);
+			done = _mm256_or_pd(done, escaped);
+			if (_mm256_movemask_pd(done) == 0xf)
+				break;
+		}
+		_mm256_storeu_pd(iterStore, iterLatch);
+		_mm256_storeu_pd(magStore, magLatch);
+		a3fractalEscapeStoreD(iterStore, magStore, 4, iter_out + i, mag_out + i);
+	}
+}
+
+
+#if A3_FRACTAL_AVX512
+
+// AVX-512: 8 pixels per instruction
+A3_FRACTAL_TARGET("avx512f")
+static void a3fractalEscapeSpanD_avx512(const double *cx, const double cy, const unsigned int count, const unsigned int cap, unsigned int *iter_out, float *mag_out)
+{
+	const __m512d three = _mm512_set1_pd(3.0), six = _mm512_set1_pd(6.0);
+	const __m512d bailout = _mm512_set1_pd(a3fractal_bailout);
+	const __m512d vcy = _mm512_set1_pd(cy);
+	__m512d vcx, zx, zy, nzx, mag, magLatch, iterLatch;
+	__mmask8 escaped, done;
+	double iterStore[8], magStore[8];
+	unsigned int i, iter;
+
+	for (i = 0; i < count; i += 8)
+	{
+		vcx = _mm512_loadu_pd(cx + i);
+		zx = vcx;
+		zy = vcy;
+		done = 0;
+		magLatch = _mm512_setzero_pd();
+		iterLatch = _mm512_set1_pd((double)cap);
+		for (iter = 0; iter < cap; ++iter)
+		{
+			nzx = _mm512_add_pd(_mm512_sub_pd(_mm512_mul_pd(_mm512_mul_pd(three, zx), zx), _mm512_mul_pd(zy, zy)), vcx);
+			zy = _mm512_add_pd(_mm512_mul_pd(_mm512_mul_pd(six, zx), zy), vcy);
+			zx = nzx;
+			mag = _mm512_add_pd(_mm512_mul_pd(zx, zx), _mm512_mul_pd(zy, zy));
+
+			escaped = _mm512_mask_cmp_pd_mask((__mmask8)~done, mag, bailout, _CMP_GT_OQ);
+			iterLatch = _mm512_mask_mov_pd(iterLatch, escaped, _mm512_set1_pd((double)iter));
+			magLatch = _mm512_mask_mov_pd(magLatch, escaped, mag);
+			done = (__mmask8)(done | escaped);
+			if (done == 0xff)
+				break;
+		}
+		_mm512_storeu_pd(iterStore, iterLatch);
+		_mm512_storeu_pd(magStore, magLatch);
+		a3fractalEscapeStoreD(iterStore, magStore, 8, iter_out + i, mag_out + i);
+	}
+}
+
+#endif	// A3_FRACTAL_AVX512
+
+#endif	// A3_FRACTAL_X86
+
+
+// double-precision kernel table, indexed by instruction set
+static const a3_FractalEscapeSpanFuncD a3fractalEscapeSpanFuncsD[a3fractal_isaCount] = {
+	a3fractalEscapeSpanD_scalar,
+#if A3_FRACTAL_X86
+	a3fractalEscapeSpanD_sse2,
+	a3fractalEscapeSpanD_avx2,
+#if A3_FRACTAL_AVX512
+	a3fractalEscapeSpanD_avx512,
+#else	// !A3_FRACTAL_AVX512
+	a3fractalEscapeSpanD_avx2,
+#endif	// A3_FRACTAL_AVX512
+#else	// !A3_FRACTAL_X86
+	a3fractalEscapeSpanD_scalar,
+	a3fractalEscapeSpanD_scalar,
+	a3fractalEscapeSpanD_scalar,
+#endif	// A3_FRACTAL_X86
+};
+
+
+//-----------------------------------------------------------------------------
+// instruction set detection
+
+static a3_FractalISA a3fractalDetectISAInternal()
+{
+#if A3_FRACTAL_X86
+#ifdef _MSC_VER
+	int info[4], idMax;
+	int sse2 = 0, avx2 = 0, avx512 = 0, ymmOS = 0, zmmOS = 0;
+	unsigned long long xcr0;
+
+	__cpuid(info, 0);
+	idMax = info[0];
+	if (idMax >= 1)
+	{
+		__cpuid(info, 1);
+		sse2 = (info[3] >> 26) & 1;
+
+		// OS must save the wide registers: OSXSAVE and AVX, then XCR0
+		if (((info[2] >> 27) & 1) && ((info[2] >> 28) & 1))
+		{
+			xcr0 = _xgetbv(0);
+			ymmOS = (xcr0 & 0x06) == 0x06;
+			zmmOS = (xcr0 & 0xe6) == 0xe6;
+		}
+	}
+	if (idMax >= 7)
+	{
+		__cpuidex(info, 7, 0);
+		avx2 = ymmOS && ((info[1] >> 5) & 1);
+		avx512 = zmmOS && ((info[1] >> 16) & 1);
+	}
+
+	if (avx512 && A3_FRACTAL_AVX512)
+		return a3fractal_isaAVX512;
+	if (avx2)
+		return a3fractal_isaAVX2;
+	if (sse2)
+		return a3fractal_isaSSE2;
+#else	// !_MSC_VER
+	__builtin_cpu_init();
+	if (__builtin_cpu_supports("avx512f"))
+		return a3fractal_isaAVX512;
+	if (__builtin_cpu_supports("avx2"))
+		return a3fractal_isaAVX2;
+	if (__builtin_cpu_supports("sse2"))
+		return a3fractal_isaSSE2;
+#endif	// _MSC_VER
+#endif	// A3_FRACTAL_X86
+	return a3fractal_isaScalar;
+}
+
+
+a3_FractalISA a3fractalDetectISA()
+{
+	// cpuid is not free; detect once
+	static a3_FractalISA detected = a3fractal_isaAuto;
+	if (detected == a3fractal_isaAuto)
+		detected = a3fractalDetectISAInternal();
+	return detected;
+}
+
+const char *a3fractalGetISAName(a3_FractalISA isa)
+{
+	static const char *names[a3fractal_isaCount] = {
+		"scalar", "SSE2", "AVX2", "AVX-512",
+	};
+	if (isa == a3fractal_isaAuto)
+		isa = a3fractalDetectISA();
+	if (isa >= a3fractal_isaScalar && isa < a3fractal_isaCount)
+		return names[isa];
+	return "unknown";
+}
+
+unsigned int a3fractalGetISALanes(a3_FractalISA isa)
+{
+	static const unsigned int lanes[a3fractal_isaCount] = {
+		1, 4, 8, 16,
+	};
+	if (isa == a3fractal_isaAuto)
+		isa = a3fractalDetectISA();
+	if (isa >= a3fractal_isaScalar && isa < a3fractal_isaCount)
+		return lanes[isa];
+	return 1;
+}
+
+
+//-----------------------------------------------------------------------------
+// view
+
+int a3fractalViewSetDefault(a3_FractalView *view_out)
+{
+	if (view_out)
+	{
+		view_out->centerX = view_out->centerY = 0.0;
+		view_out->width = view_out->height = 1.0;
+		return 1;
+	}
+	return -1;
+}
+
+int a3fractalViewPixelCoord(const a3_FractalView *view, unsigned int width, unsigned int height, double x, double y, double *cx_out, double *cy_out)
+{
+	if (view && width && height && cx_out && cy_out)
+	{
+		*cx_out = view->centerX + view->width * ((x + 0.5) / (double)width - 0.5);
+		*cy_out = view->centerY + view->height * ((y + 0.5) / (double)height - 0.5);
+		return 1;
+	}
+	return -1;
+}
+
+
+//-----------------------------------------------------------------------------
+// shading
+
+// GLSL fract
+static float a3fractalFract(const float x)
+{
+	return (x - floorf(x));
+}
+
+void a3fractalShade(float smooth, unsigned char *rgba_out)
+{
+	// shader default color: HSV (1, 1, 0) -> black
+	float h = 1.0f, s = 1.0f, v = 0.0f;
+	float k[3] = { 1.0f, 2.0f / 3.0f, 1.0f / 3.0f }, m, c;
+	unsigned int i;
+
+	if (!a3fractalIsInterior(smooth))
+	{
+		h = 0.95f + 0.12f * smooth;
+		v = 0.2f + 0.4f * (1.0f + sinf(0.3f * smooth));
+	}
+
+	// HSV to RGB exactly as the shader, then clamped like the framebuffer
+	for (i = 0; i < 3; ++i)
+	{
+		m = fabsf(a3fractalFract(h + k[i]) * 6.0f - 3.0f);
+		m = a3clamp(0.0f, 4.0f, m - 1.0f);
+		c = v * (1.0f + (m - 1.0f) * s);
+		c = a3clamp(0.0f, 1.0f, c);
+		rgba_out[i] = (unsigned char)(c * 255.0f + 0.5f);
+	}
+	rgba_out[3] = 255;
+}
+
+
+//-----------------------------------------------------------------------------
+// render
+
+int a3fractalEscapeRenderRect(const a3_FractalEscapeDesc *desc, unsigned int x0, unsigned int y0, unsigned int x1, unsigned int y1)
+{
+	float cx[a3fractal_span], mag[a3fractal_span];
+	double cxD[a3fractal_span];
+	unsigned int iter[a3fractal_span];
+	float smooth;
+	double left, bottom, dx, dy, cy;
+	unsigned int x, y, i, n, padded, lanes, index;
+	a3_FractalISA isa, best;
+	a3_FractalEscapeSpanFunc span;
+	a3_FractalEscapeSpanFuncD spanD;
+
+	if (desc && desc->width && desc->height)
+	{
+		x1 = a3minimum(x1, desc->width);
+		y1 = a3minimum(y1, desc->height);
+		if (x0 >= x1 || y0 >= y1)
+			return 0;
+
+		// never run an instruction set the machine does not have
+		best = a3fractalDetectISA();
+		isa = desc->isa;
+		if (isa == a3fractal_isaAuto || isa > best)
+			isa = best;
+		span = a3fractalEscapeSpanFuncs[isa];
+		spanD = a3fractalEscapeSpanFuncsD[isa];
+		lanes = a3fractalGetISALanes(isa);
+		if (desc->precision == a3fractal_precisionDouble && lanes > 1)
+			lanes /= 2;
+
+		dx = desc->view.width / (double)desc->width;
+		dy = desc->view.height / (double)desc->height;
+		left = desc->view.centerX - 0.5 * desc->view.width;
+		bottom = desc->view.centerY - 0.5 * desc->view.height;
+
+		for (y = y0; y < y1; ++y)
+		{
+			cy = bottom + ((double)((int)y + desc->offsetY) + 0.5) * dy;
+			for (x = x0; x < x1; x += n)
+			{
+				// fill span, padding to a whole packet with the last pixel
+				n = a3minimum(a3fractal_span, x1 - x);
+				padded = (n + lanes - 1) / lanes * lanes;
+				if (desc->precision == a3fractal_precisionDouble)
+				{
+					for (i = 0; i < n; ++i)
+						cxD[i] = left + ((double)((int)(x + i) + desc->offsetX) + 0.5) * dx;
+					for (; i < padded; ++i)
+						cxD[i] = cxD[n - 1];
+					spanD(cxD, cy, padded, desc->iterations, iter, mag);
+				}
+				else
+				{
+					for (i = 0; i < n; ++i)
+						cx[i] = (float)(left + ((double)((int)(x + i) + desc->offsetX) + 0.5) * dx);
+					for (; i < padded; ++i)
+						cx[i] = cx[n - 1];
+					span(cx, (float)cy, padded, desc->iterations, iter, mag);
+				}
+
+				// outputs
+				index = y * desc->width + x;
+				for (i = 0; i < n; ++i, ++index)
+				{
+					smooth = iter[i] < desc->iterations
+						? (float)iter[i] - 1.0f - log2f(log2f(mag[i]))
+						: a3fractal_interior;
+					if (desc->smooth_out_opt)
+						desc->smooth_out_opt[index] = smooth;
+					if (desc->iter_out_opt)
+						desc->iter_out_opt[index] = iter[i];
+					if (desc->rgba_out_opt)
+						a3fractalShade(smooth, desc->rgba_out_opt + index * 4);
+				}
+			}
+		}
+		return (int)((x1 - x0) * (y1 - y0));
+	}
+	return -1;
+}
+
+int a3fractalEscapeRender(const a3_FractalEscapeDesc *desc)
+{
+	if (desc)
+		return a3fractalEscapeRenderRect(desc, 0, 0, desc->width, desc->height);
+	return -1;
+}
+
+static void a3fractalEscapeRenderTask(void *args, unsigned int x0, unsigned int y0, unsigned int x1, unsigned int y1, unsigned int workerIndex)
+{
+	a3fractalEscapeRenderRect((const a3_FractalEscapeDesc *)args, x0, y0, x1, y1);
+}
+
+int a3fractalEscapeRenderTiled(const a3_FractalEscapeDesc *desc, a3_ThreadPool *pool_opt, unsigned int tileSize)
+{
+	if (desc)
+	{
+		if (!tileSize)
+			tileSize = a3fractal_tile;
+		if (a3threadPoolParallelFor2D(pool_opt, 0, a3fractalEscapeRenderTask, (void *)desc, desc->width, desc->height, tileSize, tileSize) >= 0)
+			return (int)(desc->width * desc->height);
+	}
+	return -1;
+}
+
+
+//-----------------------------------------------------------------------------
@@ -0,0 +1,174 @@
+/*
+	animal3D SDK: Minimal 3D Animation Framework
+	Fractals Midterm: CPU fractal engines
+
+	a3_DemoFractalEscape.h
+	CPU escape-time engine for the Mandelbrot shader.
+
+	Produces the same image as "drawMandlebrot_fs4x.glsl": same iteration
+	formula, same 'uIter' semantics, bailout of 16, smooth iteration count
+	and HSV palette; pixels are evaluated 4, 8 or 16 at a time using SSE2,
+	AVX2 or AVX-512, selected at runtime, with a scalar fallback.
+	Single precision matches the shader; double precision takes half as
+	many pixels per instruction and holds up about 8 decades deeper.
+*/
+
+#ifndef __ANIMAL3D_DEMOFRACTALESCAPE_H
+#define __ANIMAL3D_DEMOFRACTALESCAPE_H
+
+
+#include "_utilities/a3_DemoThreadPool.h"
+
+
+//-----------------------------------------------------------------------------
+
+#ifdef __cplusplus
+extern "C"
+{
+#else	// !__cplusplus
+	typedef struct a3_FractalView			a3_FractalView;
+	typedef struct a3_FractalEscapeDesc		a3_FractalEscapeDesc;
+	typedef enum a3_FractalISA				a3_FractalISA;
+	typedef enum a3_FractalEscapePrecision	a3_FractalEscapePrecision;
+#endif	// __cplusplus
+
+
+//-----------------------------------------------------------------------------
+
+	// escape-time constants matching the shader
+	//	bailout: squared magnitude that counts as escaped
+	//	interior: smooth value stored for pixels that never escape
+#define a3fractal_bailout		16.0f
+#define a3fractal_interior		(-1.0e30f)
+#define a3fractalIsInterior(r)	((r) <= a3fractal_interior)
+
+
+	// instruction set used to evaluate pixels
+	enum a3_FractalISA
+	{
+		a3fractal_isaAuto = -1,	// pick the best one available at runtime
+		a3fractal_isaScalar,	// 1 pixel per instruction
+		a3fractal_isaSSE2,		// 4 pixels per instruction
+		a3fractal_isaAVX2,		// 8 pixels per instruction
+		a3fractal_isaAVX512,	// 16 pixels per instruction
+		a3fractal_isaCount
+	};
+
+
+	// arithmetic used to iterate pixels
+	enum a3_FractalEscapePrecision
+	{
+		a3fractal_precisionSingle,		// float, same as the shader
+		a3fractal_precisionDouble,		// double, half the lanes
+	};
+
+
+	// window into the complex plane
+	//	members centerX, centerY: plane coordinate at the center of the image
+	//	members width, height: plane extent covered by the whole image
+	// the shader's view is center (0, 0), extent (1, 1), i.e. 'texcoord - 0.5'
+	struct a3_FractalView
+	{
+		double centerX, centerY;
+		double width, height;
+	};
+
+
+	// escape-time render description
+	//	member view: window into the complex plane
+	//	members width, height: image dimensions in pixels
+	//	member iterations: iteration cap, same meaning as 'uIter'
+	//	member isa: instruction set to use; auto picks at runtime
+	//	member precision: arithmetic to iterate with
+	//	members offsetX, offsetY: pixel offset of this image within a larger
+	//		pixel lattice over the same view; pixel (x, y) is evaluated at
+	//		lattice pixel (x + offsetX, y + offsetY); usually 0
+	//	member smooth_out_opt: optional smooth iteration value per pixel;
+	//		interior pixels store 'a3fractal_interior'
+	//	member iter_out_opt: optional escape iteration per pixel (the loop
+	//		index that escaped); interior pixels store 'iterations'
+	//	member rgba_out_opt: optional 8-bit RGBA color per pixel
+	// all buffers are row-major, row 0 at the bottom (texcoord v = 0)
+	struct a3_FractalEscapeDesc
+	{
+		a3_FractalView view;
+		unsigned int width, height;
+		unsigned int iterations;
+		a3_FractalISA isa;
+		a3_FractalEscapePrecision precision;
+		int offsetX, offsetY;
+		float *smooth_out_opt;
+		unsigned int *iter_out_opt;
+		unsigned char *rgba_out_opt;
+	};
+
+
+//-----------------------------------------------------------------------------
+
+	// Set view to the one used by the shader.
+	//	param view_out: non-null pointer to view
+	//	return: 1 if success
+	//	return: -1 if invalid param
+	int a3fractalViewSetDefault(a3_FractalView *view_out);
+
+	// Get the plane coordinate of a pixel center.
+	//	param view: non-null pointer to view
+	//	params width, height: image dimensions
+	//	params x, y: pixel coordinates
+	//	params cx_out, cy_out: non-null pointers to plane coordinate
+	//	return: 1 if success
+	//	return: -1 if invalid params
+	int a3fractalViewPixelCoord(const a3_FractalView *view, unsigned int width, unsigned int height, double x, double y, double *cx_out, double *cy_out);
+
+	// Detect the best instruction set supported by this machine and build.
+	//	return: best available instruction set (never auto)
+	a3_FractalISA a3fractalDetectISA();
+
+	// Get a readable name of an instruction set.
+	//	param isa: instruction set
+	//	return: name cstring
+	const char *a3fractalGetISAName(a3_FractalISA isa);
+
+	// Get the number of pixels evaluated per instruction.
+	//	param isa: instruction set
+	//	return: number of lanes
+	unsigned int a3fractalGetISALanes(a3_FractalISA isa);
+
+	// Convert a smooth iteration value to color using the shader's palette.
+	//	param smooth: smooth iteration value or 'a3fractal_interior'
+	//	param rgba_out: non-null pointer to 4 bytes
+	void a3fractalShade(float smooth, unsigned char *rgba_out);
+
+	// Render a rectangle of the image.
+	//	param desc: non-null pointer to render description
+	//	params x0, y0: first pixel in rectangle
+	//	params x1, y1: one past last pixel in rectangle (clamped to image)
+	//	return: number of pixels rendered if success
+	//	return: -1 if invalid params
+	int a3fractalEscapeRenderRect(const a3_FractalEscapeDesc *desc, unsigned int x0, unsigned int y0, unsigned int x1, unsigned int y1);
+
+	// Render the whole image.
+	//	param desc: non-null pointer to render description
+	//	return: number of pixels rendered if success
+	//	return: -1 if invalid params
+	int a3fractalEscapeRender(const a3_FractalEscapeDesc *desc);
+
+	// Render the whole image as tiles spread over a thread pool.
+	//	param desc: non-null pointer to render description
+	//	param pool_opt: optional pool; renders on this thread if null
+	//	param tileSize: tile edge in pixels; 0 picks a default
+	//	return: number of pixels rendered if success
+	//	return: -1 if invalid params, or the tiles could not be queued;
+	//		no pixel has been rendered
+	int a3fractalEscapeRenderTiled(const a3_FractalEscapeDesc *desc, a3_ThreadPool *pool_opt, unsigned int tileSize);
+
+
+//-----------------------------------------------------------------------------
+
+
+#ifdef __cplusplus
+}
+#endif	// __cplusplus
+
+
+#endif	// !__ANIMAL3D_DEMOFRACTALESCAPE_H
@@ -0,0 +1,599 @@
+/*
+	animal3D SDK: Minimal 3D Animation Framework
+	Fractals Midterm: CPU fractal engines
+
+	a3_DemoFractalInterior.c
+	Interior-detecting renderer implementation.
+
+	Pixels iterate in double precision in the shader's coordinates, in the
+	same packets and with the same instructions as the double-precision
+	escape-time kernels, so escaping pixels get the same iteration counts;
+	the checks only ever end interior pixels. Pixels inside the cardioid
+	or bulb never enter a packet.
+
+	Conjugated, c maps to c' = (3 cx, sqrt(3) cy), which is where the
+	cardioid and bulb formulas of z^2 + c are evaluated, and the orbit
+	derivative obeys dw' = 2 w dw, so its squared magnitude grows by
+	|2 w|^2 = 12 (3 x^2 + y^2) a step: a product of two terms the step
+	computes anyway. Periodicity compares the orbit with a saved point
+	that is replaced whenever the distance since the last save reaches a
+	power of two (Brent), so cycles of any length are found within twice
+	their length plus the time to reach them; lanes start together, so
+	the whole packet saves at once.
+
+	Most exterior pixels escape within a few dozen iterations, and the
+	checks cannot end them anyway, so they start only after a delay;
+	before it, packets run exactly as the escape-time kernels do.
+*/
+
+#include "a3_DemoFractalInterior.h"
+#include "_utilities/a3_DemoSIMD.h"
+
+#include "animal3D/a3/a3macros.h"
+
+#include <math.h>
+#include <stdlib.h>
+
+
+//-----------------------------------------------------------------------------
+
+// conjugation scale of the imaginary axis
+#define a3interior_sqrt3	1.7320508075688772
+
+// pixels handed to a kernel at once; multiple of the widest packet
+#define a3interior_span		64
+
+// iterations run before the checks start
+#define a3interior_delay	64
+
+
+// one frame; counters are per thread, merged after the frame
+//	members tolerance, limit: check thresholds; 0 if the check is off
+//	member delay: iteration the checks start at; the cap if none are on
+typedef struct a3_InteriorPass
+{
+	const a3_FractalInteriorDesc *desc;
+	double tolerance, limit;
+	unsigned int delay;
+	a3_FractalISA isa;
+	a3_FractalInteriorStats *counters;
+} a3_InteriorPass;
+
+
+// kernel: iterate 'count' pixels on one row
+//	writes the escape iteration (or cap) and the squared magnitude at
+//	escape; checks start at iteration 'delay', and a pixel one ended gets
+//	the iteration it was caught at and the check's flag in 'caught_out',
+//	0 otherwise
+typedef void(*a3_InteriorSpanFunc)(const double *cx, const double cy, const unsigned int count, const unsigned int delay, const a3_InteriorPass *pass, unsigned int *iter_out, float *mag_out, unsigned char *caught_out);
+
+
+//-----------------------------------------------------------------------------
+
+int a3fractalInBulb(double cx, double cy)
+{
+	const double u = 3.0 * cx, v = a3interior_sqrt3 * cy;
+	const double v2 = v * v, p = u - 0.25;
+	const double q = p * p + v2;
+
+	// main cardioid, then the disk of the period-2 bulb
+	return (q * (q + p) <= 0.25 * v2 || (u + 1.0) * (u + 1.0) + v2 <= 0.0625);
+}
+
+
+//-----------------------------------------------------------------------------
+// kernels
+
+// scalar fallback
+static void a3fractalInteriorSpan_scalar(const double *cx, const double cy, const unsigned int count, const unsigned int delay, const a3_InteriorPass *pass, unsigned int *iter_out, float *mag_out, unsigned char *caught_out)
+{
+	const unsigned int cap = pass->desc->iterations;
+	const double tolerance = pass->tolerance, limit = pass->limit;
+	double zx, zy, nzx, mag, xx, yy, px, py, d2;
+	unsigned int i, iter, power, lambda;
+
+	for (i = 0; i < count; ++i)
+	{
+		zx = cx[i];
+		zy = cy;
+		px = py = d2 = 0.0;
+		power = lambda = 0;
+		iter_out[i] = cap;
+		mag_out[i] = 0.0f;
+		caught_out[i] = 0;
+		for (iter = 0; iter < cap; ++iter)
+		{
+			if (iter == delay)
+			{
+				px = zx;
+				py = zy;
+				d2 = 1.0;
+				power = 1;
+			}
+
+			xx = 3.0 * zx * zx;
+			yy = zy * zy;
+			nzx = xx - yy + cx[i];
+			zy = 6.0 * zx * zy + cy;
+			zx = nzx;
+			mag = zx * zx + zy * zy;
+			if (mag > a3fractal_bailout)
+			{
+				iter_out[i] = iter;
+				mag_out[i] = (float)mag;
+				break;
+			}
+
+			if (iter >= delay)
+			{
+				// derivative at the point before the step
+				d2 = d2 * (12.0 * (xx + yy));
+				if (d2 < limit)
+					caught_out[i] = a3fractal_interiorDerivative;
+				else if (fabs(zx - px) + fabs(zy - py) < tolerance)
+					caught_out[i] = a3fractal_interiorPeriodicity;
+				if (caught_out[i])
+				{
+					iter_out[i] = iter;
+					break;
+				}
+				if (++lambda == power)
+				{
+					px = zx;
+					py = zy;
+					power <<= 1;
+					lambda = 0;
+				}
+			}
+		}
+	}
+}
+
+
+#if A3_FRACTAL_X86
+
+// latched iterations are kept as doubles (exact below 2^53) so they blend
+//	like the other lanes; converted when the packet is stored
+static void a3fractalInteriorStore(const double *iterLatch, const double *magLatch, const int derivative, const int periodicity, const unsigned int lanes, unsigned int *iter_out, float *mag_out, unsigned char *caught_out)
+{
+	unsigned int i;
+	for (i = 0; i < lanes; ++i)
+	{
+		iter_out[i] = (unsigned int)iterLatch[i];
+		mag_out[i] = (float)magLatch[i];
+		caught_out[i] = (unsigned char)(((derivative >> i) & 1) ? a3fractal_interiorDerivative
+			: ((periodicity >> i) & 1) ? a3fractal_interiorPeriodicity : 0);
+	}
+}
+
+// SSE2: 2 pixels per instruction
+A3_FRACTAL_TARGET("sse2")
+static void a3fractalInteriorSpan_sse2(const double *cx, const double cy, const unsigned int count, const unsigned int delay, const a3_InteriorPass *pass, unsigned int *iter_out, float *mag_out, unsigned char *caught_out)
+{
+	const unsigned int cap = pass->desc->iterations;
+	const __m128d three = _mm_set1_pd(3.0), six = _mm_set1_pd(6.0), twelve = _mm_set1_pd(12.0);
+	const __m128d bailout = _mm_set1_pd(a3fractal_bailout);
+	const __m128d tolerance = _mm_set1_pd(pass->tolerance), limit = _mm_set1_pd(pass->limit);
+	const __m128d sign = _mm_set1_pd(-0.0);
+	const __m128d vcy = _mm_set1_pd(cy);
+	__m128d vcx, zx, zy, nzx, mag, xx, yy, px, py, d2, dist;
+	__m128d escaped, hit, caught, done, magLatch, iterLatch, derivative, periodicity;
+	double iterStore[2], magStore[2];
+	unsigned int i, iter, power, lambda;
+
+	for (i = 0; i < count; i += 2)
+	{
+		vcx = _mm_loadu_pd(cx + i);
+		zx = vcx;
+		zy = vcy;
+		px = py = d2 = _mm_setzero_pd();
+		power = lambda = 0;
+		done = derivative = periodicity = _mm_setzero_pd();
+		magLatch = _mm_setzero_pd();
+		iterLatch = _mm_set1_pd((double)cap);
+		for (iter = 0; iter < cap; ++iter)
+		{
+			if (iter == delay)
+			{
+				px = zx;
+				py = zy;
+				d2 = _mm_set1_pd(1.0);
+				power = 1;
+			}
+
+			xx = _mm_mul_pd(_mm_mul_pd(three, zx), zx);
+			yy = _mm_mul_pd(zy, zy);
+			nzx = _mm_add_pd(_mm_sub_pd(xx, yy), vcx);
+			zy = _mm_add_pd(_mm_mul_pd(_mm_mul_pd(six, zx), zy), vcy);
+			zx = nzx;
+			mag = _mm_add_pd(_mm_mul_pd(zx, zx), _mm_mul_pd(zy, zy));
+
+			escaped = _mm_andnot_pd(done, _mm_cmpgt_pd(mag, bailout));
+			iterLatch = _mm_or_pd(_mm_and_pd(escaped, _mm_set1_pd((double)iter)), _mm_andnot_pd(escaped, iterLatch));
+			magLatch = _mm_or_pd(_mm_and_pd(escaped, mag), _mm_andnot_pd(escaped, magLatch));
+			done = _mm_or_pd(done, escaped);
+
+			if (iter >= delay)
+			{
+				d2 = _mm_mul_pd(d2, _mm_mul_pd(twelve, _mm_add_pd(xx, yy)));
+				dist = _mm_add_pd(_mm_andnot_pd(sign, _mm_sub_pd(zx, px)), _mm_andnot_pd(sign, _mm_sub_pd(zy, py)));
+				hit = _mm_andnot_pd(done, _mm_cmplt_pd(d2, limit));
+				derivative = _mm_or_pd(derivative, hit);
+				caught = hit;
+				hit = _mm_andnot_pd(_mm_or_pd(done, hit), _mm_cmplt_pd(dist, tolerance));
+				periodicity = _mm_or_pd(periodicity, hit);
+				caught = _mm_or_pd(caught, hit);
+				iterLatch = _mm_or_pd(_mm_and_pd(caught, _mm_set1_pd((double)iter)), _mm_andnot_pd(caught, iterLatch));
+				done = _mm_or_pd(done, caught);
+				if (++lambda == power)
+				{
+					px = zx;
+					py = zy;
+					power <<= 1;
+					lambda = 0;
+				}
+			}
+			if (_mm_movemask_pd(done) == 0x3)
+				break;
+		}
+		_mm_storeu_pd(iterStore, iterLatch);
+		_mm_storeu_pd(magStore, magLatch);
+		a3fractalInteriorStore(iterStore, magStore, _mm_movemask_pd(derivative), _mm_movemask_pd(periodicity), 2, iter_out + i, mag_out + i, caught_out + i);
+	}
+}
+
+
+// AVX2: 4 pixels per instruction
+A3_FRACTAL_TARGET("avx2")
+static void a3fractalInteriorSpan_avx2(const double *cx, const double cy, const unsigned int count, const unsigned int delay, const a3_InteriorPass *pass, unsigned int *iter_out, float *mag_out, unsigned char *caught_out)
+{
+	const unsigned int cap = pass->desc->iterations;
+	const __m256d three = _mm256_set1_pd(3.0), six = _mm256_set1_pd(6.0), twelve = _mm256_set1_pd(12.0);
+	const __m256d bailout = _mm256_set1_pd(a3fractal_bailout);
+	const __m256d tolerance = _mm256_set1_pd(pass->tolerance), limit = _mm256_set1_pd(pass->limit);
+	const __m256d sign = _mm256_set1_pd(-0.0);
+	const __m256d vcy = _mm256_set1_pd(cy);
+	__m256d vcx, zx, zy, nzx, mag, xx, yy, px, py, d2, dist;
+	__m256d escaped, hit, caught, done, magLatch, iterLatch, derivative, periodicity;
+	double iterStore[4], magStore[4];
+	unsigned int i, iter, power, lambda;
+
+	for (i = 0; i < count; i += 4)
+	{
+		vcx = _mm256_loadu_pd(cx + i);
+		zx = vcx;
+		zy = vcy;
+		px = py = d2 = _mm256_setzero_pd();
+		power = lambda = 0;
+		done = derivative = periodicity = _mm256_setzero_pd();
+		magLatch = _mm256_setzero_pd();
+		iterLatch = _mm256_set1_pd((double)cap);
+		for (iter = 0; iter < cap; ++iter)
+		{
+			if (iter == delay)
+			{
+				px = zx;
+				py = zy;
+				d2 = _mm256_set1_pd(1.0);
+				power = 1;
+			}
+
+			xx = _mm256_mul_pd(_mm256_mul_pd(three, zx), zx);
+			yy = _mm256_mul_pd(zy, zy);
+			nzx = _mm256_add_pd(_mm256_sub_pd(xx, yy), vcx);
+			zy = _mm256_add_pd(_mm256_mul_pd(_mm256_mul_pd(six, zx), zy), vcy);
+			zx = nzx;
+			mag = _mm256_add_pd(_mm256_mul_pd(zx, zx), _mm256_mul_pd(zy, zy));
+
+			escaped = _mm256_andnot_pd(done, _mm256_cmp_pd(mag, bailout, _CMP_GT_OQ));
+			iterLatch = _mm256_blendv_pd(iterLatch, _mm256_set1_pd((double)iter), escaped);
+			magLatch = _mm256_blendv_pd(magLatch, mag, escaped);
+			done = _mm256_or_pd(done, escaped);
+
+			if (iter >= delay)
+			{
+				d2 = _mm256_mul_pd(d2, _mm256_mul_pd(twelve, _mm256_add_pd(xx, yy)));
+				dist = _mm256_add_pd(_mm256_andnot_pd(sign, _mm256_sub_pd(zx, px)), _mm256_andnot_pd(sign, _mm256_sub_pd(zy, py)));
+				hit = _mm256_andnot_pd(done, _mm256_cmp_pd(d2, limit, _CMP_LT_OQ));
+				derivative = _mm256_or_pd(derivative, hit);
+				caught = hit;
+				hit = _mm256_andnot_pd(_mm256_or_pd(done, hit), _mm256_cmp_pd(dist, tolerance, _CMP_LT_OQ));
+				periodicity = _mm256_or_pd(periodicity, hit);
+				caught = _mm256_or_pd(caught, hit);
+				iterLatch = _mm256_blendv_pd(iterLatch, _mm256_set1_pd((double)iter), caught);
+				done = _mm256_or_pd(done, caught);
+				if (++lambda == power)
+				{
+					px = zx;
+					py = zy;
+					power <<= 1;
+					lambda = 0;
+				}
+			}
+			if (_mm256_movemask_pd(done) == 0xf)
+				break;
+		}
+		_mm256_storeu_pd(iterStore, iterLatch);
+		_mm256_storeu_pd(magStore, magLatch);
+		a3fractalInteriorStore(iterStore, magStore, _mm256_movemask_pd(derivative), _mm256_movemask_pd(periodicity), 4, iter_out + i, mag_out + i, caught_out + i);
+	}
+}
+
+
+#if A3_FRACTAL_AVX512
+
+// AVX-512: 8 pixels per instruction
+A3_FRACTAL_TARGET("avx512f")
+static void a3fractalInteriorSpan_avx512(const double *cx, const double cy, const unsigned int count, const unsigned int delay, const a3_InteriorPass *pass, unsigned int *iter_out, float *mag_out, unsigned char *caught_out)
+{
+	const unsigned int cap = pass->desc->iterations;
+	const __m512d three = _mm512_set1_pd(3.0), six = _mm512_set1_pd(6.0), twelve = _mm512_set1_pd(12.0);
+	const __m512d bailout = _mm512_set1_pd(a3fractal_bailout);
+	const __m512d tolerance = _mm512_set1_pd(pass->tolerance), limit = _mm512_set1_pd(pass->limit);
+	const __m512d vcy = _mm512_set1_pd(cy);
+	__m512d vcx, zx, zy, nzx, mag, xx, yy, px, py, d2, dist, magLatch, iterLatch;
+	__mmask8 escaped, hit, caught, done, derivative, periodicity;
+	double iterStore[8], magStore[8];
+	unsigned int i, iter, power, lambda;
+
+	for (i = 0; i < count; i += 8)
+	{
+		vcx = _mm512_loadu_pd(cx + i);
+		zx = vcx;
+		zy = vcy;
+		px = py = d2 = _mm512_setzero_pd();
+		power = lambda = 0;
+		done = derivative = periodicity = 0;
+		magLatch = _mm512_setzero_pd();
+		iterLatch = _mm512_set1_pd((double)cap);
+		for (iter = 0; iter < cap; ++iter)
+		{
+			if (iter == delay)
+			{
+				px = zx;
+				py = zy;
+				d2 = _mm512_set1_pd(1.0);
+				power = 1;
+			}
+
+			xx = _mm512_mul_pd(_mm512_mul_pd(three, zx), zx);
+			yy = _mm512_mul_pd(zy, zy);
+			nzx = _mm512_add_pd(_mm512_sub_pd(xx, yy), vcx);
+			zy = _mm512_add_pd(_mm512_mul_pd(_mm512_mul_pd(six, zx), zy), vcy);
+			zx = nzx;
+			mag = _mm512_add_pd(_mm512_mul_pd(zx, zx), _mm512_mul_pd(zy, zy));
+
+			escaped = _mm512_mask_cmp_pd_mask((__mmask8)~done, mag, bailout, _CMP_GT_OQ);
+			iterLatch = _mm512_mask_mov_pd(iterLatch, escaped, _mm512_set1_pd((double)iter));
+			magLatch = _mm512_mask_mov_pd(magLatch, escaped, mag);
+			done = (__mmask8)(done | escaped);
+
+			if (iter >= delay)
+			{
+				d2 = _mm512_mul_pd(d2, _mm512_mul_pd(twelve, _mm512_add_pd(xx, yy)));
+				dist = _mm512_add_pd(_mm512_abs_pd(_mm512_sub_pd(zx, px)), _mm512_abs_pd(_mm512_sub_pd(zy, py)));
+				hit = _mm512_mask_cmp_pd_mask((__mmask8)~done, d2, limit, _CMP_LT_OQ);
+				derivative = (__mmask8)(derivative | hit);
+				caught = hit;
+				hit = _mm512_mask_cmp_pd_mask((__mmask8)~(done | hit), dist, tolerance, _CMP_LT_OQ);
+				periodicity = (__mmask8)(periodicity | hit);
+				caught = (__mmask8)(caught | hit);
+				iterLatch = _mm512_mask_mov_pd(iterLatch, caught, _mm512_set1_pd((double)iter));
+				done = (__mmask8)(done | caught);
+				if (++lambda == power)
+				{
+					px = zx;
+					py = zy;
+					power <<= 1;
+					lambda = 0;
+				}
+			}
+			if (done == 0xff)
+				break;
+		}
+		_mm512_storeu_pd(iterStore, iterLatch);
+		_mm512_storeu_pd(magStore, magLatch);
+		a3fractalInteriorStore(iterStore, magStore, derivative, periodicity, 8, iter_out + i, mag_out + i, caught_out + i);
+	}
+}
+
+#endif	// A3_FRACTAL_AVX512
+
+#endif	// A3_FRACTAL_X86
+
+
+// kernel table, indexed by instruction set
+static const a3_InteriorSpanFunc a3fractalInteriorSpanFuncs[a3fractal_isaCount] = {
+	a3fractalInteriorSpan_scalar,
+#if A3_FRACTAL_X86
+	a3fractalInteriorSpan_sse2,
+	a3fractalInteriorSpan_avx2,
+#if A3_FRACTAL_AVX512
+	a3fractalInteriorSpan_avx512,
+#else	// !A3_FRACTAL_AVX512
+	a3fractalInteriorSpan_avx2,
+#endif	// A3_FRACTAL_AVX512
+#else	// !A3_FRACTAL_X86
+	a3fractalInteriorSpan_scalar,
+	a3fractalInteriorSpan_scalar,
+	a3fractalInteriorSpan_scalar,
+#endif	// A3_FRACTAL_X86
+};
+
+
+//-----------------------------------------------------------------------------
+// render
+
+static void a3fractalInteriorTask(void *args, unsigned int x0, unsigned int y0, unsigned int x1, unsigned int y1, unsigned int workerIndex)
+{
+	const a3_InteriorPass *pass = (const a3_InteriorPass *)args;
+	const a3_FractalInteriorDesc *desc = pass->desc;
+	const a3_InteriorSpanFunc span = a3fractalInteriorSpanFuncs[pass->isa];
+	const unsigned int cap = desc->iterations, checks = desc->checks;
+	const double dx = desc->view.width / (double)desc->width;
+	const double dy = desc->view.height / (double)desc->height;
+	const double left = desc->view.centerX - 0.5 * desc->view.width;
+	const double bottom = desc->view.centerY - 0.5 * desc->view.height;
+	double cx[a3interior_span], cy;
+	unsigned int pixel[a3interior_span], iter[a3interior_span];
+	float mag[a3interior_span];
+	unsigned char caught[a3interior_span];
+	a3_FractalInteriorStats stats = { 0 };
+	unsigned int x, y, i, n, padded, lanes, index, it;
+	unsigned int delay = pass->delay, found;
+	float smooth;
+
+	lanes = a3fractalGetISALanes(pass->isa);
+	if (lanes > 1)
+		lanes /= 2;
+
+	for (y = y0; y < y1; ++y)
+	{
+		// the checks only pay where there is interior to end; a row keeps
+		//	them only if the tile's previous row had an interior pixel
+		cy = bottom + ((double)y + 0.5) * dy;
+		found = 0;
+		for (x = x0; x < x1; )
+		{
+			// gather pixels outside the closed-form regions; those inside
+			//	are written as they are found
+			for (n = 0; x < x1 && n < a3interior_span; ++x)
+			{
+				cx[n] = left + ((double)x + 0.5) * dx;
+				if ((checks & a3fractal_interiorBulb) && a3fractalInBulb(cx[n], cy))
+				{
+					++stats.bulb;
+					++stats.interior;
+					++found;
+					stats.skipped += cap;
+					index = y * desc->width + x;
+					if (desc->smooth_out_opt)
+						desc->smooth_out_opt[index] = a3fractal_interior;
+					if (desc->iter_out_opt)
+						desc->iter_out_opt[index] = cap;
+					if (desc->rgba_out_opt)
+						a3fractalShade(a3fractal_interior, desc->rgba_out_opt + index * 4);
+				}
+				else
+					pixel[n++] = x;
+			}
+			if (!n)
+				continue;
+
+			// pad to a whole packet with the last pixel
+			padded = (n + lanes - 1) / lanes * lanes;
+			for (i = n; i < padded; ++i)
+				cx[i] = cx[n - 1];
+			span(cx, cy, padded, delay, pass, iter, mag, caught);
+
+			// outputs
+			for (i = 0; i < n; ++i)
+			{
+				it = iter[i];
+				if (caught[i])
+				{
+					if (caught[i] == a3fractal_interiorDerivative)
+						++stats.derivative;
+					else
+						++stats.periodicity;
+					stats.iterations += it + 1;
+					stats.skipped += cap - it;
+					it = cap;
+				}
+				else
+					stats.iterations += it < cap ? it + 1 : cap;
+				if (it >= cap)
+				{
+					++stats.interior;
+					++found;
+				}
+
+				smooth = it < cap
+					? (float)((double)it - 1.0 - log2(log2((double)mag[i])))
+					: a3fractal_interior;
+				index = y * desc->width + pixel[i];
+				if (desc->smooth_out_opt)
+					desc->smooth_out_opt[index] = smooth;
+				if (desc->iter_out_opt)
+					desc->iter_out_opt[index] = it;
+				if (desc->rgba_out_opt)
+					a3fractalShade(smooth, desc->rgba_out_opt + index * 4);
+			}
+		}
+		delay = found ? pass->delay : cap;
+	}
+
+	pass->counters[workerIndex].interior += stats.interior;
+	pass->counters[workerIndex].bulb += stats.bulb;
+	pass->counters[workerIndex].periodicity += stats.periodicity;
+	pass->counters[workerIndex].derivative += stats.derivative;
+	pass->counters[workerIndex].iterations += stats.iterations;
+	pass->counters[workerIndex].skipped += stats.skipped;
+}
+
+int a3fractalInteriorRender(const a3_FractalInteriorDesc *desc, a3_ThreadPool *pool_opt, a3_FractalInteriorStats *stats_out_opt)
+{
+	a3_FractalInteriorStats stats = { 0 };
+	a3_InteriorPass pass[1];
+	a3_FractalISA best;
+	double spacing;
+	unsigned int workers, i;
+
+	if (desc && desc->width && desc->height)
+	{
+		workers = a3threadPoolGetWorkerCount(pool_opt) + 1;
+		pass->counters = (a3_FractalInteriorStats *)calloc(workers, sizeof(a3_FractalInteriorStats));
+		if (!pass->counters)
+			return 0;
+
+		// never run an instruction set the machine does not have
+		best = a3fractalDetectISA();
+		pass->isa = desc->isa;
+		if (pass->isa == a3fractal_isaAuto || pass->isa > best)
+			pass->isa = best;
+
+		// a repeat must be far tighter than a pixel to mean anything; a
+		//	check that is off gets a threshold nothing falls below
+		spacing = a3minimum(desc->view.width / (double)desc->width, desc->view.height / (double)desc->height);
+		pass->desc = desc;
+		pass->tolerance = 0.0;
+		pass->limit = 0.0;
+		pass->delay = desc->iterations;
+		if (desc->checks & a3fractal_interiorPeriodicity)
+		{
+			pass->tolerance = desc->periodTolerance > 0.0 ? desc->periodTolerance : a3fractal_periodTolerance;
+			pass->tolerance = a3minimum(pass->tolerance, 1.0e-4 * spacing);
+			pass->delay = a3minimum(desc->iterations, a3interior_delay);
+		}
+		if (desc->checks & a3fractal_interiorDerivative)
+		{
+			pass->limit = desc->derivativeLimit > 0.0 ? desc->derivativeLimit : a3fractal_derivativeLimit;
+			pass->delay = a3minimum(desc->iterations, a3interior_delay);
+		}
+
+		if (a3threadPoolParallelFor2D(pool_opt, 0, a3fractalInteriorTask, pass, desc->width, desc->height, 32, 32) < 0)
+		{
+			free(pass->counters);
+			return 0;
+		}
+
+		for (i = 0; i < workers; ++i)
+		{
+			stats.interior += pass->counters[i].interior;
+			stats.bulb += pass->counters[i].bulb;
+			stats.periodicity += pass->counters[i].periodicity;
+			stats.derivative += pass->counters[i].derivative;
+			stats.iterations += pass->counters[i].iterations;
+			stats.skipped += pass->counters[i].skipped;
+		}
+		if (stats_out_opt)
+			*stats_out_opt = stats;
+
+		free(pass->counters);
+		return (int)(desc->width * desc->height);
+	}
+	return -1;
+}
+
+
+//-----------------------------------------------------------------------------
@@ -0,0 +1,124 @@
+/*
+	animal3D SDK: Minimal 3D Animation Framework
+	Fractals Midterm: CPU fractal engines
+
+	a3_DemoFractalInterior.h
+	Escape-time renderer with interior detection for the Mandelbrot shader.
+
+	Interior pixels never escape, so a plain loop spends the full 'uIter'
+	iterations on each of them. Three independent checks end those loops
+	early; each can be switched off and each counts what it caught:
+		bulb: closed-form test for the main cardioid and period-2 bulb
+		periodicity: Brent-style cycle check against a saved orbit point
+		derivative: orbit derivative shrinking toward an attracting cycle
+	The closed forms apply because the shader's map is conjugate to
+	z^2 + c under u = 3x, v = sqrt(3)y.
+*/
+
+#ifndef __ANIMAL3D_DEMOFRACTALINTERIOR_H
+#define __ANIMAL3D_DEMOFRACTALINTERIOR_H
+
+
+#include "a3_DemoFractalEscape.h"
+
+
+//-----------------------------------------------------------------------------
+
+#ifdef __cplusplus
+extern "C"
+{
+#else	// !__cplusplus
+	typedef struct a3_FractalInteriorDesc		a3_FractalInteriorDesc;
+	typedef struct a3_FractalInteriorStats		a3_FractalInteriorStats;
+	typedef enum a3_FractalInteriorFlag			a3_FractalInteriorFlag;
+#endif	// __cplusplus
+
+
+//-----------------------------------------------------------------------------
+
+	// default periodicity tolerance: largest orbit distance, in plane
+	//	units, that counts as a repeat; also capped below pixel spacing
+#define a3fractal_periodTolerance		1.0e-10
+
+	// default derivative limit: squared orbit derivative below which the
+	//	orbit is taken to be captured by an attracting cycle
+#define a3fractal_derivativeLimit		1.0e-24
+
+
+	// interior checks, combined as flags
+	enum a3_FractalInteriorFlag
+	{
+		a3fractal_interiorNone = 0x0,
+		a3fractal_interiorBulb = 0x1,			// cardioid and period-2 bulb
+		a3fractal_interiorPeriodicity = 0x2,	// Brent cycle detection
+		a3fractal_interiorDerivative = 0x4,		// attracting-cycle derivative
+		a3fractal_interiorAll = 0x7,
+	};
+
+
+	// interior-detecting render description
+	//	member view: window into the complex plane
+	//	members width, height: image dimensions in pixels
+	//	member iterations: iteration cap, same meaning as 'uIter'
+	//	member isa: instruction set to use; auto picks at runtime
+	//	member checks: interior check flags
+	//	member periodTolerance: periodicity tolerance; 0 uses default
+	//	member derivativeLimit: derivative limit; 0 uses default
+	//	members smooth_out_opt, iter_out_opt, rgba_out_opt: optional
+	//		outputs, same layout and meaning as the escape-time engine
+	struct a3_FractalInteriorDesc
+	{
+		a3_FractalView view;
+		unsigned int width, height;
+		unsigned int iterations;
+		a3_FractalISA isa;
+		unsigned int checks;
+		double periodTolerance;
+		double derivativeLimit;
+		float *smooth_out_opt;
+		unsigned int *iter_out_opt;
+		unsigned char *rgba_out_opt;
+	};
+
+
+	// per-frame counters
+	//	member interior: pixels output as interior
+	//	members bulb, periodicity, derivative: pixels caught by each check
+	//	member iterations: pixel iterations performed
+	//	member skipped: iterations interior pixels would have run to the
+	//		cap without the checks
+	struct a3_FractalInteriorStats
+	{
+		unsigned int interior;
+		unsigned int bulb, periodicity, derivative;
+		unsigned long long iterations;
+		unsigned long long skipped;
+	};
+
+
+//-----------------------------------------------------------------------------
+
+	// Test a plane point against the closed-form interior regions.
+	//	params cx, cy: plane coordinate
+	//	return: 1 if inside the main cardioid or period-2 bulb, 0 if not
+	int a3fractalInBulb(double cx, double cy);
+
+	// Render an image, ending interior pixels early.
+	//	param desc: non-null pointer to render description
+	//	param pool_opt: optional pool; renders on this thread if null
+	//	param stats_out_opt: optional pointer to frame counters
+	//	return: number of pixels rendered if success
+	//	return: 0 if fail (out of memory)
+	//	return: -1 if invalid params
+	int a3fractalInteriorRender(const a3_FractalInteriorDesc *desc, a3_ThreadPool *pool_opt, a3_FractalInteriorStats *stats_out_opt);
+
+
+//-----------------------------------------------------------------------------
+
+
+#ifdef __cplusplus
+}
+#endif	// __cplusplus
+
+
+#endif	// !__ANIMAL3D_DEMOFRACTALINTERIOR_H
@@ -0,0 +1,196 @@
+/*
+	animal3D SDK: Minimal 3D Animation Framework
+	Fractals Midterm: CPU fractal engines
+
+	a3_DemoFractalLadder.c
+	Automatic precision ladder implementation.
+
+	The SIMD tiers hand the view to the escape-time engine with its center
+	rounded to double, which is exact to well below their spacing limits.
+	The double-double tier iterates each pixel directly at 106 bits, which
+	needs no reference and cannot glitch; it is slower per pixel than
+	perturbation but has no per-frame setup. Past its limit the view goes
+	to the perturbation renderer, whose reference picks its own arithmetic.
+*/
+
+#include "a3_DemoFractalLadder.h"
+
+#include "animal3D/a3/a3macros.h"
+
+#include <math.h>
+
+
+//-----------------------------------------------------------------------------
+// double-double tier
+
+// render a rectangle, one pixel at a time
+static void a3fractalLadderTaskDD(void *args, unsigned int x0, unsigned int y0, unsigned int x1, unsigned int y1, unsigned int workerIndex)
+{
+	const a3_FractalLadderDesc *desc = (const a3_FractalLadderDesc *)args;
+	const a3_DoubleDouble centerX = a3mpFixedGetDD(&desc->view.centerX);
+	const a3_DoubleDouble centerY = a3mpFixedGetDD(&desc->view.centerY);
+	const double dx = desc->view.width / (double)desc->width;
+	const double dy = desc->view.height / (double)desc->height;
+	a3_DoubleDouble cx, cy, zx, zy, x2, y2, xy;
+	double mag;
+	float smooth;
+	unsigned int x, y, iter, index;
+
+	for (y = y0; y < y1; ++y)
+	{
+		cy = a3ddAdd(centerY, a3ddSet(((double)y + 0.5) * dy - 0.5 * desc->view.height, 0.0));
+		for (x = x0, index = y * desc->width + x0; x < x1; ++x, ++index)
+		{
+			cx = a3ddAdd(centerX, a3ddSet(((double)x + 0.5) * dx - 0.5 * desc->view.width, 0.0));
+			zx = cx;
+			zy = cy;
+			mag = 0.0;
+			for (iter = 0; iter < desc->iterations; ++iter)
+			{
+				// z' = (3x^2 - y^2, 6xy) + c
+				x2 = a3ddSqr(zx);
+				y2 = a3ddSqr(zy);
+				xy = a3ddMul(zx, zy);
+				zx = a3ddAdd(a3ddSub(a3ddMulD(x2, 3.0), y2), cx);
+				zy = a3ddAdd(a3ddMulD(xy, 6.0), cy);
+				mag = zx.hi * zx.hi + zy.hi * zy.hi;
+				if (mag > a3fractal_bailout)
+					break;
+			}
+
+			smooth = iter < desc->iterations
+				? (float)((double)iter - 1.0 - log2(log2(mag)))
+				: a3fractal_interior;
+			if (desc->smooth_out_opt)
+				desc->smooth_out_opt[index] = smooth;
+			if (desc->iter_out_opt)
+				desc->iter_out_opt[index] = iter;
+			if (desc->rgba_out_opt)
+				a3fractalShade(smooth, desc->rgba_out_opt + index * 4);
+		}
+	}
+}
+
+
+//-----------------------------------------------------------------------------
+// ladder
+
+double a3fractalLadderSpacing(const a3_FractalDeepView *view, unsigned int width, unsigned int height)
+{
+	double spacing, scale;
+	if (view && width && height)
+	{
+		spacing = a3minimum(view->width / (double)width, view->height / (double)height);
+		scale = a3maximum(fabs(a3mpFixedGetDouble(&view->centerX)), fabs(a3mpFixedGetDouble(&view->centerY)));
+		scale = a3maximum(scale, a3fractal_ladderScaleMin);
+		return (spacing / scale);
+	}
+	return -1.0;
+}
+
+a3_FractalTier a3fractalLadderSelectTier(double spacing, unsigned int iterations)
+{
+	const double growth = a3fractal_ladderMargin * (double)a3maximum(iterations, 1);
+	if (spacing >= a3fractal_ladderEpsilonSingle * growth)
+		return a3fractal_tierSingle;
+	if (spacing >= a3fractal_ladderEpsilonDouble * growth)
+		return a3fractal_tierDouble;
+	if (spacing >= a3fractal_ladderSpacingDD && spacing >= a3fractal_ladderEpsilonDD * growth)
+		return a3fractal_tierDD;
+	return a3fractal_tierPerturb;
+}
+
+const char *a3fractalGetTierName(a3_FractalTier tier)
+{
+	static const char *names[a3fractal_tierCount] = {
+		"float SIMD", "double SIMD", "double-double", "perturbation",
+	};
+	if (tier >= a3fractal_tierSingle && tier < a3fractal_tierCount)
+		return names[tier];
+	return "auto";
+}
+
+int a3fractalLadderRender(a3_FractalLadder *ladder, const a3_FractalLadderDesc *desc, a3_ThreadPool *pool_opt)
+{
+	a3_FractalEscapeDesc escape[1];
+	a3_FractalPerturbDesc perturb[1];
+	a3_FractalTier tier;
+	double spacing;
+	int result;
+
+	if (ladder && desc && desc->width && desc->height)
+	{
+		spacing = a3fractalLadderSpacing(&desc->view, desc->width, desc->height);
+		tier = desc->tier;
+		if (tier <= a3fractal_tierAuto || tier >= a3fractal_tierCount)
+			tier = a3fractalLadderSelectTier(spacing, desc->iterations);
+
+		switch (tier)
+		{
+		case a3fractal_tierSingle:
+		case a3fractal_tierDouble:
+			escape->view.centerX = a3mpFixedGetDouble(&desc->view.centerX);
+			escape->view.centerY = a3mpFixedGetDouble(&desc->view.centerY);
+			escape->view.width = desc->view.width;
+			escape->view.height = desc->view.height;
+			escape->width = desc->width;
+			escape->height = desc->height;
+			escape->iterations = desc->iterations;
+			escape->isa = desc->isa;
+			escape->precision = (tier == a3fractal_tierSingle ? a3fractal_precisionSingle : a3fractal_precisionDouble);
+			escape->offsetX = escape->offsetY = 0;
+			escape->smooth_out_opt = desc->smooth_out_opt;
+			escape->iter_out_opt = desc->iter_out_opt;
+			escape->rgba_out_opt = desc->rgba_out_opt;
+			result = a3fractalEscapeRenderTiled(escape, pool_opt, 0);
+			break;
+		case a3fractal_tierDD:
+			result = a3threadPoolParallelFor2D(pool_opt, 0, a3fractalLadderTaskDD, (void *)desc, desc->width, desc->height, 32, 32);
+			if (result >= 0)
+				result = (int)(desc->width * desc->height);
+			break;
+		default:
+			perturb->view = desc->view;
+			perturb->width = desc->width;
+			perturb->height = desc->height;
+			perturb->iterations = desc->iterations;
+			perturb->iterationsMax = desc->iterationsMax;
+			perturb->referenceMax = 0;
+			perturb->glitchTolerance = 0.0;
+			perturb->accel = desc->accel;
+			perturb->blaEpsilon = 0.0;
+			perturb->smooth_out_opt = desc->smooth_out_opt;
+			perturb->iter_out_opt = desc->iter_out_opt;
+			perturb->rgba_out_opt = desc->rgba_out_opt;
+			result = a3fractalPerturbRender(perturb, ladder->reference, pool_opt, &ladder->perturb);
+			break;
+		}
+
+		if (result > 0)
+		{
+			ladder->tier = tier;
+			ladder->spacing = spacing;
+			++ladder->frames[tier];
+		}
+		return result;
+	}
+	return -1;
+}
+
+int a3fractalLadderRelease(a3_FractalLadder *ladder)
+{
+	unsigned int i;
+	if (ladder)
+	{
+		a3fractalReferenceRelease(ladder->reference);
+		ladder->tier = a3fractal_tierSingle;
+		ladder->spacing = 0.0;
+		for (i = 0; i < a3fractal_tierCount; ++i)
+			ladder->frames[i] = 0;
+		return 1;
+	}
+	return -1;
+}
+
+
+//-----------------------------------------------------------------------------
@@ -0,0 +1,171 @@
+/*
+	animal3D SDK: Minimal 3D Animation Framework
+	Fractals Midterm: CPU fractal engines
+
+	a3_DemoFractalLadder.h
+	Automatic precision ladder for the Mandelbrot shader.
+
+	Each frame is rendered with the cheapest arithmetic that still resolves
+	its pixels: single-precision SIMD while zoomed out, double-precision
+	SIMD past that, then double-double per pixel, then perturbation against
+	an extended-precision reference. The tier is chosen from the pixel
+	spacing relative to the magnitude of the view center, since that is
+	what the coordinates must resolve, and from the iteration cap, since
+	rounding accumulates along the orbit; every frame records its tier.
+
+	Every tier is held to the same error budget by the same test: a tier
+	is used while its epsilon times the iteration cap times
+	'a3fractal_ladderMargin' is at most the relative pixel spacing, which
+	keeps it within 0.1% of double-double's iteration counts. Pixels whose
+	count changes when c moves by 1/1024 of a pixel are not counted
+	against the budget; they lie on chaotic orbits no tier below
+	double-double resolves at any spacing, and they are up to a fifth of a
+	deep, high-cap frame.
+*/
+
+#ifndef __ANIMAL3D_DEMOFRACTALLADDER_H
+#define __ANIMAL3D_DEMOFRACTALLADDER_H
+
+
+#include "a3_DemoFractalPerturb.h"
+
+
+//-----------------------------------------------------------------------------
+
+#ifdef __cplusplus
+extern "C"
+{
+#else	// !__cplusplus
+	typedef struct a3_FractalLadder				a3_FractalLadder;
+	typedef struct a3_FractalLadderDesc			a3_FractalLadderDesc;
+	typedef enum a3_FractalTier					a3_FractalTier;
+#endif	// __cplusplus
+
+
+//-----------------------------------------------------------------------------
+
+	// precision of the tiers below perturbation: float, double and
+	//	double-double epsilon (2^-23, 2^-52, 2^-104)
+#define a3fractal_ladderEpsilonSingle	1.1920928955078125e-7
+#define a3fractal_ladderEpsilonDouble	2.2204460492503131e-16
+#define a3fractal_ladderEpsilonDD		4.9303806576313238e-32
+
+	// a tier is only used while the relative pixel spacing is at least
+	//	its epsilon times the iteration cap times this margin, 5 bits;
+	//	measured over caps 32 to 2000 and widths 3 to 3e-13, float and
+	//	double then differ from double-double on at most 0.04% of the
+	//	pixels the budget counts; two bits lower float is over budget
+#define a3fractal_ladderMargin			32.0
+
+	// smallest relative pixel spacing double-double is used for, whatever
+	//	the cap; this is a cost limit, not an accuracy one: it hands over
+	//	to perturbation early (2^-64) since
+	//	perturbation is far cheaper per pixel and only loses to it on
+	//	short, setup-bound frames
+#define a3fractal_ladderSpacingDD		5.4210108624275222e-20
+
+	// smallest magnitude spacing is measured against; orbits of points
+	//	near the origin still visit points of about this size
+#define a3fractal_ladderScaleMin		0.25
+
+
+	// rendering tiers, cheapest first
+	enum a3_FractalTier
+	{
+		a3fractal_tierAuto = -1,		// pick per frame from pixel spacing
+		a3fractal_tierSingle,			// single-precision SIMD
+		a3fractal_tierDouble,			// double-precision SIMD
+		a3fractal_tierDD,				// double-double per pixel
+		a3fractal_tierPerturb,			// perturbation
+		a3fractal_tierCount
+	};
+
+
+	// ladder render description
+	//	member view: extended-precision window into the complex plane
+	//	members width, height: image dimensions in pixels
+	//	member iterations: iteration cap, same meaning as 'uIter'
+	//	member iterationsMax: largest cap a perturbation reference is sized
+	//		for; 0 sizes it to 'iterations'
+	//	member isa: instruction set for the SIMD tiers; auto picks at runtime
+	//	member tier: tier to force; auto picks per frame
+	//	member accel: acceleration flags for the perturbation tier
+	//	members smooth_out_opt, iter_out_opt, rgba_out_opt: optional
+	//		outputs, same layout and meaning as the escape-time engine
+	struct a3_FractalLadderDesc
+	{
+		a3_FractalDeepView view;
+		unsigned int width, height;
+		unsigned int iterations, iterationsMax;
+		a3_FractalISA isa;
+		a3_FractalTier tier;
+		unsigned int accel;
+		float *smooth_out_opt;
+		unsigned int *iter_out_opt;
+		unsigned char *rgba_out_opt;
+	};
+
+
+	// ladder state kept between frames, zero-initialize before first use
+	//	member reference: perturbation reference, reused while the view
+	//		center holds still
+	//	member tier: tier of the last frame
+	//	member spacing: relative pixel spacing of the last frame
+	//	member frames: number of frames rendered with each tier
+	//	member perturb: counters of the last perturbation frame
+	struct a3_FractalLadder
+	{
+		a3_FractalReference reference[1];
+		a3_FractalTier tier;
+		double spacing;
+		unsigned int frames[a3fractal_tierCount];
+		a3_FractalPerturbStats perturb;
+	};
+
+
+//-----------------------------------------------------------------------------
+
+	// Get the pixel spacing of a view relative to its center.
+	//	param view: non-null pointer to view
+	//	params width, height: image dimensions
+	//	return: relative spacing if success
+	//	return: -1 if invalid params
+	double a3fractalLadderSpacing(const a3_FractalDeepView *view, unsigned int width, unsigned int height);
+
+	// Get the cheapest tier that resolves a relative pixel spacing over
+	//	orbits of a given length.
+	//	param spacing: relative pixel spacing
+	//	param iterations: iteration cap
+	//	return: tier (never auto)
+	a3_FractalTier a3fractalLadderSelectTier(double spacing, unsigned int iterations);
+
+	// Get a readable name of a tier.
+	//	param tier: tier
+	//	return: name cstring
+	const char *a3fractalGetTierName(a3_FractalTier tier);
+
+	// Render an image with the tier the view calls for.
+	//	param ladder: non-null pointer to ladder state
+	//	param desc: non-null pointer to render description
+	//	param pool_opt: optional pool; renders on this thread if null
+	//	return: number of pixels rendered if success
+	//	return: 0 if fail (out of memory)
+	//	return: -1 if invalid params
+	int a3fractalLadderRender(a3_FractalLadder *ladder, const a3_FractalLadderDesc *desc, a3_ThreadPool *pool_opt);
+
+	// Release ladder state.
+	//	param ladder: non-null pointer to ladder state
+	//	return: 1 if success
+	//	return: -1 if invalid params
+	int a3fractalLadderRelease(a3_FractalLadder *ladder);
+
+
+//-----------------------------------------------------------------------------
+
+
+#ifdef __cplusplus
+}
+#endif	// __cplusplus
+
+
+#endif	// !__ANIMAL3D_DEMOFRACTALLADDER_H
@@ -0,0 +1,2086 @@
+/*
+	animal3D SDK: Minimal 3D Animation Framework
+	Fractals Midterm: CPU fractal engines
+
+	a3_DemoFractalMenger.c
+	CPU Menger sponge raymarcher implementation.
+
+	The per-ray loop, as in the shader:
+		d = 0.02, f = 1
+		for (steps = 0; steps < 256; ++steps)
+			if (|d| < 0.001 || f > 50) stop
+			f += d, p = eye + dir f, d = distance(p)
+		shaded if f < 100
+	Rays that give up past 50 units or at the step cap are still shaded if
+	they are nearer than 100; that is the shader's rule and the source of
+	its fogged horizon, so it is kept.
+
+	A packet steps while any of its rays is still moving; rays that have
+	stopped keep their distance, and since their point does not move,
+	re-evaluating it changes nothing. 'mod' is x - 2 floor(x / 2) as GLSL
+	defines it and no kernel uses fused multiply-add, so every instruction
+	set marches every ray to the same point.
+*/
+
+#include "a3_DemoFractalMenger.h"
+#include "_utilities/a3_DemoSIMD.h"
+#include "_utilities/a3_DemoDual.h"
+
+#include "animal3D/a3/a3macros.h"
+
+#include <math.h>
+#include <stdlib.h>
+
+
+//-----------------------------------------------------------------------------
+
+#ifdef _MSC_VER
+#define a3menger_inline	static __forceinline
+#else	// !_MSC_VER
+#define a3menger_inline	static inline __attribute__((always_inline))
+#endif	// _MSC_VER
+
+// rays handed to a kernel at once: one block of the image, in packets
+#define a3menger_span		(a3fractal_mengerConeBlock * a3fractal_mengerConeBlock)
+
+// tile edge for pooled renders
+#define a3menger_tile		32
+
+// exact traversal stack: up to 10 cells at the top level, 7 below, 3
+//	arms each
+#define a3menger_found		32
+#define a3menger_stack		(a3menger_found + 24 * a3fractal_mengerDepthMax)
+
+// a level's detail relative to the one above
+#define a3menger_third		(1.0f / 3.0f)
+
+// default cache sample spacing
+#define a3menger_spacing	(1.0f / 32.0f)
+
+// the shader's initial distance and the cross arm length it calls 'inf'
+#define a3menger_first		0.02f
+#define a3menger_arm		100.0f
+
+
+// rays for a kernel, one packet after another, lane-major within packets
+typedef struct a3_MengerSpan
+{
+	float dirX[a3menger_span], dirY[a3menger_span], dirZ[a3menger_span];
+	float start[a3menger_span];
+	float dist[a3menger_span];
+	float normalX[a3menger_span], normalY[a3menger_span], normalZ[a3menger_span];
+	unsigned int steps[a3menger_span];
+	unsigned int skipped[a3menger_span];
+	unsigned char id[a3menger_span];
+} a3_MengerSpan;
+
+// kernel: march 'count' rays from a shared eye, each from its start
+//	distance, with steps scaled by 'omega' until the first overshoot
+//	writes the distance each ray stopped at, the surface id there, the
+//	steps it took and, for rays closer than the far distance, the normal,
+//	from the dual gradient if 'gradient' is set; levels fade out below
+//	'pixel', the size of a pixel one unit away, if it is not zero, and
+//	'depth' is read only by kernels not specialized to one; with a cache
+//	and no falloff, packets step by cached bounds where they can and
+//	'skipped' counts the steps that did not evaluate the scene
+typedef void(*a3_FractalMengerSpanFunc)(const float *eye, a3_MengerSpan *span, const unsigned int count, const float omega, const int gradient, const float pixel, const unsigned int depth, a3_FractalBrickCache *cache_opt, a3_FractalBrickStats *stats);
+
+
+// ray setup; the shader's 'u' and 'v', and 'vcv' offset by the scaled eye
+typedef struct a3_MengerCamera
+{
+	float center[3], u[3], v[3];
+	float aspect, width, height;
+	float offsetX, offsetY;
+	float pixel;
+} a3_MengerCamera;
+
+// one frame; counters are per thread, merged after the frame
+typedef struct a3_MengerPass
+{
+	const a3_FractalMengerDesc *desc;
+	a3_FractalMengerStats *counters;
+} a3_MengerPass;
+
+
+// per variant: half size of 'objBox', scale of the first fold, and the
+//	size of what the first level carves, the gap between two beams or the
+//	side of the middle hole; each level below carves a third of that
+static const float a3mengerBoxSize[a3fractal_mengerVariantCount] = { 4.0f, 3.0f };
+static const float a3mengerFirstScale[a3fractal_mengerVariantCount] = { 1.0f, 1.0f / 3.0f };
+static const float a3mengerDetail[a3fractal_mengerVariantCount] = { 0.5f, 2.0f };
+
+// largest rate at which each sponge's distance changes: the shader's
+//	overestimates by up to 4/3, see 'a3fractal_mengerRelaxation'
+static const float a3mengerLipschitz[a3fractal_mengerVariantCount] = { 4.0f / 3.0f, 1.0f };
+
+// packet shape per instruction set, lanes across by lanes up
+static const unsigned int a3mengerPacketW[a3fractal_isaCount] = { 1, 2, 4, 4 };
+static const unsigned int a3mengerPacketH[a3fractal_isaCount] = { 1, 2, 2, 4 };
+
+
+//-----------------------------------------------------------------------------
+// scene
+
+a3menger_inline float a3mengerBox_scalar(const float x, const float y, const float z, const float bx, const float by, const float bz)
+{
+	// 'objBoxS': inside, the largest axis distance; outside, the length
+	const float dx = fabsf(x) - bx, dy = fabsf(y) - by, dz = fabsf(z) - bz;
+	const float ex = a3maximum(dx, 0.0f), ey = a3maximum(dy, 0.0f), ez = a3maximum(dz, 0.0f);
+	const float mc = a3maximum(a3maximum(dx, dy), dz);
+	const float len = sqrtf(ex * ex + ey * ey + ez * ez);
+	return a3minimum(mc, len);
+}
+
+a3menger_inline float a3mengerCross_scalar(const float x, const float y, const float z)
+{
+	const float da = a3mengerBox_scalar(x, y, z, a3menger_arm, 2.0f, 2.0f);
+	const float db = a3mengerBox_scalar(y, z, x, 2.0f, a3menger_arm, 2.0f);
+	const float dc = a3mengerBox_scalar(z, x, y, 2.0f, 2.0f, a3menger_arm);
+	return a3minimum(da, a3minimum(db, dc));
+}
+
+// continuous detail: share of a level's carving kept at a ratio of its
+//	detail to the pixel size, all of it from 3 pixels across, none at 1
+a3menger_inline float a3mengerFade_scalar(const float ratio)
+{
+	return a3minimum(a3maximum((ratio - 1.0f) * 0.5f, 0.0f), 1.0f);
+}
+
+// distance to one level's solid in a cell, scaled to the cell
+a3menger_inline float a3mengerCut_scalar(const float ax, const float ay, const float az, const int variant)
+{
+	float rx, ry, rz;
+	if (variant == a3fractal_mengerVariantClassic)
+	{
+		// the cross through the middle thirds, cells centered at |a| = 1
+		rx = fabsf(1.0f - 3.0f * fabsf(ax));
+		ry = fabsf(1.0f - 3.0f * fabsf(ay));
+		rz = fabsf(1.0f - 3.0f * fabsf(az));
+		return a3minimum(a3maximum(rx, ry), a3minimum(a3maximum(ry, rz), a3maximum(rz, rx))) - 1.0f;
+	}
+	return a3mengerCross_scalar(1.0f - 4.0f * fabsf(ax), 1.0f - 4.0f * fabsf(ay), 1.0f - 4.0f * fabsf(az));
+}
+
+a3menger_inline float a3mengerSponge_scalar(const float x, const float y, const float z, const unsigned int depth, const int variant, const int falloff, float ratio)
+{
+	const float b = a3mengerBoxSize[variant];
+	float d = a3mengerBox_scalar(x, y, z, b, b, b), s = a3mengerFirstScale[variant], ax, ay, az, c;
+	unsigned int m;
+	for (m = 0; m < depth; ++m)
+	{
+		if (falloff && ratio <= 1.0f)
+			break;
+
+		// fold into the cell, cut the scaled level out of it
+		ax = x * s;
+		ay = y * s;
+		az = z * s;
+		ax = ax - 2.0f * floorf(ax * 0.5f) - 1.0f;
+		ay = ay - 2.0f * floorf(ay * 0.5f) - 1.0f;
+		az = az - 2.0f * floorf(az * 0.5f) - 1.0f;
+		s *= 3.0f;
+		c = a3mengerCut_scalar(ax, ay, az, variant) / s;
+		if (falloff)
+		{
+			d = d + a3mengerFade_scalar(ratio) * (a3maximum(d, c) - d);
+			ratio = ratio * a3menger_third;
+		}
+		else
+			d = a3maximum(d, c);
+	}
+	return d;
+}
+
+a3menger_inline float a3mengerScene_scalar(const float x, const float y, const float z, unsigned int *id_out_opt, const unsigned int depth, const int variant, const int falloff, const float ratio)
+{
+	const float floorDist = y + 10.0f, sponge = a3mengerSponge_scalar(x, y, z, depth, variant, falloff, ratio);
+	if (id_out_opt)
+		*id_out_opt = floorDist < sponge ? a3fractal_mengerFloor : a3fractal_mengerSponge;
+	return a3minimum(floorDist, sponge);
+}
+
+float a3fractalMengerDistance(float x, float y, float z, unsigned int *id_out_opt)
+{
+	return a3mengerScene_scalar(x, y, z, id_out_opt, a3fractal_mengerLevels, a3fractal_mengerVariantShader, 0, 0.0f);
+}
+
+// the same scene on duals: distance and gradient in one pass
+
+a3menger_inline a3_FractalDual a3mengerBoxDual_scalar(const a3_FractalDual x, const a3_FractalDual y, const a3_FractalDual z, const float bx, const float by, const float bz)
+{
+	const a3_FractalDual dx = a3fractalDualAddC(a3fractalDualAbs(x), -bx);
+	const a3_FractalDual dy = a3fractalDualAddC(a3fractalDualAbs(y), -by);
+	const a3_FractalDual dz = a3fractalDualAddC(a3fractalDualAbs(z), -bz);
+	const a3_FractalDual ex = a3fractalDualMaxC(dx, 0.0f), ey = a3fractalDualMaxC(dy, 0.0f), ez = a3fractalDualMaxC(dz, 0.0f);
+	const a3_FractalDual mc = a3fractalDualMax(a3fractalDualMax(dx, dy), dz);
+	const a3_FractalDual len = a3fractalDualSqrt(a3fractalDualAdd(a3fractalDualAdd(a3fractalDualMul(ex, ex), a3fractalDualMul(ey, ey)), a3fractalDualMul(ez, ez)));
+	return a3fractalDualMin(mc, len);
+}
+
+a3menger_inline a3_FractalDual a3mengerCutDual_scalar(const a3_FractalDual ax, const a3_FractalDual ay, const a3_FractalDual az, const int variant)
+{
+	a3_FractalDual rx, ry, rz;
+	if (variant == a3fractal_mengerVariantClassic)
+	{
+		rx = a3fractalDualAbs(a3fractalDualCSub(1.0f, a3fractalDualMulC(a3fractalDualAbs(ax), 3.0f)));
+		ry = a3fractalDualAbs(a3fractalDualCSub(1.0f, a3fractalDualMulC(a3fractalDualAbs(ay), 3.0f)));
+		rz = a3fractalDualAbs(a3fractalDualCSub(1.0f, a3fractalDualMulC(a3fractalDualAbs(az), 3.0f)));
+		return a3fractalDualAddC(a3fractalDualMin(a3fractalDualMax(rx, ry), a3fractalDualMin(a3fractalDualMax(ry, rz), a3fractalDualMax(rz, rx))), -1.0f);
+	}
+	rx = a3fractalDualCSub(1.0f, a3fractalDualMulC(a3fractalDualAbs(ax), 4.0f));
+	ry = a3fractalDualCSub(1.0f, a3fractalDualMulC(a3fractalDualAbs(ay), 4.0f));
+	rz = a3fractalDualCSub(1.0f, a3fractalDualMulC(a3fractalDualAbs(az), 4.0f));
+	return a3fractalDualMin(a3mengerBoxDual_scalar(rx, ry, rz, a3menger_arm, 2.0f, 2.0f),
+		a3fractalDualMin(a3mengerBoxDual_scalar(ry, rz, rx, 2.0f, a3menger_arm, 2.0f), a3mengerBoxDual_scalar(rz, rx, ry, 2.0f, 2.0f, a3menger_arm)));
+}
+
+a3menger_inline a3_FractalDual a3mengerDistanceDual_scalar(const float x, const float y, const float z, unsigned int *id_out, const unsigned int depth, const int variant, const int falloff, float ratio)
+{
+	const float b = a3mengerBoxSize[variant];
+	const a3_FractalDual px = a3fractalDualVar(x, 0), py = a3fractalDualVar(y, 1), pz = a3fractalDualVar(z, 2);
+	a3_FractalDual d = a3mengerBoxDual_scalar(px, py, pz, b, b, b), rx, ry, rz, c, floorDist;
+	float s = a3mengerFirstScale[variant];
+	unsigned int m;
+	for (m = 0; m < depth; ++m)
+	{
+		if (falloff && ratio <= 1.0f)
+			break;
+		rx = a3fractalDualAddC(a3fractalDualMod(a3fractalDualMulC(px, s), 2.0f, 0.5f), -1.0f);
+		ry = a3fractalDualAddC(a3fractalDualMod(a3fractalDualMulC(py, s), 2.0f, 0.5f), -1.0f);
+		rz = a3fractalDualAddC(a3fractalDualMod(a3fractalDualMulC(pz, s), 2.0f, 0.5f), -1.0f);
+		s *= 3.0f;
+		c = a3fractalDualDivC(a3mengerCutDual_scalar(rx, ry, rz, variant), s);
+		if (falloff)
+		{
+			d = a3fractalDualAdd(d, a3fractalDualMulC(a3fractalDualSub(a3fractalDualMax(d, c), d), a3mengerFade_scalar(ratio)));
+			ratio = ratio * a3menger_third;
+		}
+		else
+			d = a3fractalDualMax(d, c);
+	}
+	floorDist = a3fractalDualAddC(py, 10.0f);
+	*id_out = floorDist.v < d.v ? a3fractal_mengerFloor : a3fractal_mengerSponge;
+	return a3fractalDualMin(floorDist, d);
+}
+
+float a3fractalMengerGradient(float x, float y, float z, float *gradient_out, unsigned int *id_out_opt)
+{
+	unsigned int id;
+	const a3_FractalDual d = a3mengerDistanceDual_scalar(x, y, z, &id, a3fractal_mengerLevels, a3fractal_mengerVariantShader, 0, 0.0f);
+	if (gradient_out)
+	{
+		gradient_out[0] = d.dx;
+		gradient_out[1] = d.dy;
+		gradient_out[2] = d.dz;
+	}
+	if (id_out_opt)
+		*id_out_opt = id;
+	return d.v;
+}
+
+
+//-----------------------------------------------------------------------------
+// kernels
+
+// cached march: one lookup per packet, at the middle of its moving rays;
+//	a ray's bound is the middle's less the most the sponge can change
+//	between the two points, so neighboring rays share the lookup;
+//	returns the bound at the middle, written to 'center_out'; outside the
+//	cache, 'objBox' alone bounds the sponge
+a3menger_inline float a3mengerCacheBound(a3_FractalBrickCache *cache, a3_FractalBrickStats *stats, const float *px, const float *py, const float *pz, const unsigned int lanes, const unsigned int moving, const int variant, float *center_out)
+{
+	const float b = a3mengerBoxSize[variant];
+	float cx = 0.0f, cy = 0.0f, cz = 0.0f, n = 0.0f, bound;
+	unsigned int j;
+	for (j = 0; j < lanes; ++j)
+		if (moving & (1u << j))
+		{
+			cx += px[j];
+			cy += py[j];
+			cz += pz[j];
+			n += 1.0f;
+		}
+	cx /= n;
+	cy /= n;
+	cz /= n;
+	if (a3fractalBrickCacheSample(cache, cx, cy, cz, &bound, stats) <= 0)
+		bound = a3mengerBox_scalar(cx, cy, cz, b, b, b);
+	center_out[0] = cx;
+	center_out[1] = cy;
+	center_out[2] = cz;
+	return bound;
+}
+
+// normal of one ray that stopped at distance 'd' from the scene
+a3menger_inline void a3fractalMengerNormal_scalar(const float *eye, a3_MengerSpan *span, const unsigned int i, const float d, const int gradient, const unsigned int depth, const int variant, const int falloff, const float ratio)
+{
+	a3_FractalDual g;
+	const float e = a3fractal_mengerNormal;
+	const float px = eye[0] + span->dirX[i] * span->dist[i];
+	const float py = eye[1] + span->dirY[i] * span->dist[i];
+	const float pz = eye[2] + span->dirZ[i] * span->dist[i];
+	float nx, ny, nz, len;
+	unsigned int id;
+	if (gradient)
+	{
+		g = a3mengerDistanceDual_scalar(px, py, pz, &id, depth, variant, falloff, ratio);
+		nx = g.dx;
+		ny = g.dy;
+		nz = g.dz;
+	}
+	else
+	{
+		// backward differences, as the shader
+		nx = d - a3mengerScene_scalar(px - e, py, pz, 0, depth, variant, falloff, ratio);
+		ny = d - a3mengerScene_scalar(px, py - e, pz, 0, depth, variant, falloff, ratio);
+		nz = d - a3mengerScene_scalar(px, py, pz - e, 0, depth, variant, falloff, ratio);
+	}
+	len = sqrtf(nx * nx + ny * ny + nz * nz);
+	if (len > 0.0f)
+	{
+		nx = nx / len;
+		ny = ny / len;
+		nz = nz / len;
+	}
+	span->normalX[i] = nx;
+	span->normalY[i] = ny;
+	span->normalZ[i] = nz;
+}
+
+// scalar fallback
+a3menger_inline void a3fractalMengerSpanT_scalar(const float *eye, a3_MengerSpan *span, const unsigned int count, const float omega, const int gradient, const float pixel, const unsigned int depth, const int variant, a3_FractalBrickCache *cache, a3_FractalBrickStats *stats)
+{
+	const float detail = a3mengerDetail[variant];
+	const float margin = cache ? a3fractalBrickCacheGetMargin(cache) : 0.0f;
+	const int falloff = pixel > 0.0f;
+	float d, f, w, dPrev, fPrev, px, py, pz, floorDist, bound, center[3], ratio = 0.0f;
+	unsigned int i, steps, skipped, id, idPrev;
+	int bounded, boundedPrev;
+	for (i = 0; i < count; ++i)
+	{
+		d = a3menger_first;
+		f = span->start[i];
+		w = omega;
+		id = a3fractal_mengerFloor;
+		skipped = 0;
+		bounded = 0;
+		for (steps = 0; steps < a3fractal_mengerSteps; ++steps)
+		{
+			if (fabsf(d) < a3fractal_mengerEpsilon || f > a3fractal_mengerFar * 0.5f)
+				break;
+			fPrev = f;
+			dPrev = d;
+			idPrev = id;
+			boundedPrev = bounded;
+			f += w * d;
+			px = eye[0] + span->dirX[i] * f;
+			py = eye[1] + span->dirY[i] * f;
+			pz = eye[2] + span->dirZ[i] * f;
+			if (falloff)
+				ratio = detail / (f * pixel);
+
+			// a bound is never within epsilon, so rays only stop on
+			//	evaluated distances or on the floor, which is always exact
+			bound = cache ? a3mengerCacheBound(cache, stats, &px, &py, &pz, 1, 1, variant, center) : 0.0f;
+			if (bound > margin)
+			{
+				floorDist = py + 10.0f;
+				bounded = floorDist >= bound;
+				id = bounded ? a3fractal_mengerSponge : a3fractal_mengerFloor;
+				d = a3minimum(floorDist, bound);
+				++skipped;
+			}
+			else
+			{
+				d = a3mengerScene_scalar(px, py, pz, &id, depth, variant, falloff, ratio);
+				bounded = 0;
+			}
+
+			// the spheres around the last two points do not overlap, so the
+			//	gap between them was never checked: back up, stop relaxing
+			if (w > 1.0f && fabsf(d) + fabsf(dPrev) < f - fPrev)
+			{
+				f = fPrev;
+				d = dPrev;
+				id = idPrev;
+				bounded = boundedPrev;
+				w = 1.0f;
+			}
+		}
+		if (falloff)
+			ratio = detail / (f * pixel);
+
+		// rays that ran out on a bound are shaded from the distance itself
+		if (bounded && f < a3fractal_mengerFar)
+		{
+			d = a3mengerScene_scalar(eye[0] + span->dirX[i] * f, eye[1] + span->dirY[i] * f, eye[2] + span->dirZ[i] * f, &id, depth, variant, falloff, ratio);
+			--skipped;
+		}
+		span->dist[i] = f;
+		span->steps[i] = steps;
+		span->skipped[i] = skipped;
+		span->id[i] = (unsigned char)id;
+		if (f < a3fractal_mengerFar)
+			a3fractalMengerNormal_scalar(eye, span, i, d, gradient, depth, variant, falloff, ratio);
+	}
+}
+
+
+#if A3_FRACTAL_X86
+
+// SSE2: 2x2 rays per instruction
+
+A3_FRACTAL_TARGET("sse2")
+a3menger_inline __m128 a3mengerBox_sse2(const __m128 x, const __m128 y, const __m128 z, const float bx, const float by, const float bz)
+{
+	const __m128 sign = _mm_set1_ps(-0.0f), zero = _mm_setzero_ps();
+	const __m128 dx = _mm_sub_ps(_mm_andnot_ps(sign, x), _mm_set1_ps(bx));
+	const __m128 dy = _mm_sub_ps(_mm_andnot_ps(sign, y), _mm_set1_ps(by));
+	const __m128 dz = _mm_sub_ps(_mm_andnot_ps(sign, z), _mm_set1_ps(bz));
+	const __m128 ex = _mm_max_ps(dx, zero), ey = _mm_max_ps(dy, zero), ez = _mm_max_ps(dz, zero);
+	const __m128 mc = _mm_max_ps(_mm_max_ps(dx, dy), dz);
+	const __m128 len = _mm_sqrt_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(ex, ex), _mm_mul_ps(ey, ey)), _mm_mul_ps(ez, ez)));
+	return _mm_min_ps(mc, len);
+}
+
+A3_FRACTAL_TARGET("sse2")
+a3menger_inline __m128 a3mengerFold_sse2(const __m128 v)
+{
+	// v - 2 floor(v / 2) - 1; SSE2 has no floor, so truncate and correct
+	//	the negatives, exact while |v| < 2^31
+	const __m128 one = _mm_set1_ps(1.0f), h = _mm_mul_ps(v, _mm_set1_ps(0.5f));
+	__m128 t = _mm_cvtepi32_ps(_mm_cvttps_epi32(h));
+	t = _mm_sub_ps(t, _mm_and_ps(_mm_cmpgt_ps(t, h), one));
+	return _mm_sub_ps(_mm_sub_ps(v, _mm_mul_ps(_mm_set1_ps(2.0f), t)), one);
+}
+
+A3_FRACTAL_TARGET("sse2")
+a3menger_inline __m128 a3mengerFade_sse2(const __m128 ratio)
+{
+	const __m128 one = _mm_set1_ps(1.0f);
+	return _mm_min_ps(_mm_max_ps(_mm_mul_ps(_mm_sub_ps(ratio, one), _mm_set1_ps(0.5f)), _mm_setzero_ps()), one);
+}
+
+A3_FRACTAL_TARGET("sse2")
+a3menger_inline __m128 a3mengerCut_sse2(const __m128 ax, const __m128 ay, const __m128 az, const int variant)
+{
+	const __m128 sign = _mm_set1_ps(-0.0f), one = _mm_set1_ps(1.0f), four = _mm_set1_ps(4.0f);
+	__m128 rx, ry, rz;
+	if (variant == a3fractal_mengerVariantClassic)
+	{
+		const __m128 three = _mm_set1_ps(3.0f);
+		rx = _mm_andnot_ps(sign, _mm_sub_ps(one, _mm_mul_ps(three, _mm_andnot_ps(sign, ax))));
+		ry = _mm_andnot_ps(sign, _mm_sub_ps(one, _mm_mul_ps(three, _mm_andnot_ps(sign, ay))));
+		rz = _mm_andnot_ps(sign, _mm_sub_ps(one, _mm_mul_ps(three, _mm_andnot_ps(sign, az))));
+		return _mm_sub_ps(_mm_min_ps(_mm_max_ps(rx, ry), _mm_min_ps(_mm_max_ps(ry, rz), _mm_max_ps(rz, rx))), one);
+	}
+	rx = _mm_sub_ps(one, _mm_mul_ps(four, _mm_andnot_ps(sign, ax)));
+	ry = _mm_sub_ps(one, _mm_mul_ps(four, _mm_andnot_ps(sign, ay)));
+	rz = _mm_sub_ps(one, _mm_mul_ps(four, _mm_andnot_ps(sign, az)));
+	return _mm_min_ps(a3mengerBox_sse2(rx, ry, rz, a3menger_arm, 2.0f, 2.0f),
+		_mm_min_ps(a3mengerBox_sse2(ry, rz, rx, 2.0f, a3menger_arm, 2.0f), a3mengerBox_sse2(rz, rx, ry, 2.0f, 2.0f, a3menger_arm)));
+}
+
+A3_FRACTAL_TARGET("sse2")
+a3menger_inline __m128 a3mengerDistance_sse2(const __m128 x, const __m128 y, const __m128 z, __m128 *sponge_out, const unsigned int depth, const int variant, const int falloff, __m128 ratio)
+{
+	const __m128 one = _mm_set1_ps(1.0f);
+	const float b = a3mengerBoxSize[variant];
+	__m128 d = a3mengerBox_sse2(x, y, z, b, b, b), s = _mm_set1_ps(a3mengerFirstScale[variant]), c, floorDist;
+	unsigned int m;
+	for (m = 0; m < depth; ++m)
+	{
+		if (falloff && _mm_movemask_ps(_mm_cmpgt_ps(ratio, one)) == 0)
+			break;
+		c = a3mengerCut_sse2(a3mengerFold_sse2(_mm_mul_ps(x, s)), a3mengerFold_sse2(_mm_mul_ps(y, s)), a3mengerFold_sse2(_mm_mul_ps(z, s)), variant);
+		s = _mm_mul_ps(s, _mm_set1_ps(3.0f));
+		c = _mm_div_ps(c, s);
+		if (falloff)
+		{
+			d = _mm_add_ps(d, _mm_mul_ps(a3mengerFade_sse2(ratio), _mm_sub_ps(_mm_max_ps(d, c), d)));
+			ratio = _mm_mul_ps(ratio, _mm_set1_ps(a3menger_third));
+		}
+		else
+			d = _mm_max_ps(d, c);
+	}
+	floorDist = _mm_add_ps(y, _mm_set1_ps(10.0f));
+	if (sponge_out)
+		*sponge_out = _mm_cmpnlt_ps(floorDist, d);
+	return _mm_min_ps(floorDist, d);
+}
+
+A3_FRACTAL_TARGET("sse2")
+a3menger_inline a3_FractalDual4 a3mengerBoxDual_sse2(const a3_FractalDual4 x, const a3_FractalDual4 y, const a3_FractalDual4 z, const float bx, const float by, const float bz)
+{
+	const __m128 zero = _mm_setzero_ps();
+	const a3_FractalDual4 dx = a3fractalDualAddC_sse2(a3fractalDualAbs_sse2(x), _mm_set1_ps(-bx));
+	const a3_FractalDual4 dy = a3fractalDualAddC_sse2(a3fractalDualAbs_sse2(y), _mm_set1_ps(-by));
+	const a3_FractalDual4 dz = a3fractalDualAddC_sse2(a3fractalDualAbs_sse2(z), _mm_set1_ps(-bz));
+	const a3_FractalDual4 ex = a3fractalDualMaxC_sse2(dx, zero), ey = a3fractalDualMaxC_sse2(dy, zero), ez = a3fractalDualMaxC_sse2(dz, zero);
+	const a3_FractalDual4 mc = a3fractalDualMax_sse2(a3fractalDualMax_sse2(dx, dy), dz);
+	const a3_FractalDual4 len = a3fractalDualSqrt_sse2(a3fractalDualAdd_sse2(a3fractalDualAdd_sse2(a3fractalDualMul_sse2(ex, ex), a3fractalDualMul_sse2(ey, ey)), a3fractalDualMul_sse2(ez, ez)));
+	return a3fractalDualMin_sse2(mc, len);
+}
+
+A3_FRACTAL_TARGET("sse2")
+a3menger_inline a3_FractalDual4 a3mengerCutDual_sse2(const a3_FractalDual4 ax, const a3_FractalDual4 ay, const a3_FractalDual4 az, const int variant)
+{
+	const __m128 one = _mm_set1_ps(1.0f), four = _mm_set1_ps(4.0f);
+	a3_FractalDual4 rx, ry, rz;
+	if (variant == a3fractal_mengerVariantClassic)
+	{
+		const __m128 three = _mm_set1_ps(3.0f);
+		rx = a3fractalDualAbs_sse2(a3fractalDualCSub_sse2(one, a3fractalDualMulC_sse2(a3fractalDualAbs_sse2(ax), three)));
+		ry = a3fractalDualAbs_sse2(a3fractalDualCSub_sse2(one, a3fractalDualMulC_sse2(a3fractalDualAbs_sse2(ay), three)));
+		rz = a3fractalDualAbs_sse2(a3fractalDualCSub_sse2(one, a3fractalDualMulC_sse2(a3fractalDualAbs_sse2(az), three)));
+		return a3fractalDualAddC_sse2(a3fractalDualMin_sse2(a3fractalDualMax_sse2(rx, ry), a3fractalDualMin_sse2(a3fractalDualMax_sse2(ry, rz), a3fractalDualMax_sse2(rz, rx))), _mm_set1_ps(-1.0f));
+	}
+	rx = a3fractalDualCSub_sse2(one, a3fractalDualMulC_sse2(a3fractalDualAbs_sse2(ax), four));
+	ry = a3fractalDualCSub_sse2(one, a3fractalDualMulC_sse2(a3fractalDualAbs_sse2(ay), four));
+	rz = a3fractalDualCSub_sse2(one, a3fractalDualMulC_sse2(a3fractalDualAbs_sse2(az), four));
+	return a3fractalDualMin_sse2(a3mengerBoxDual_sse2(rx, ry, rz, a3menger_arm, 2.0f, 2.0f),
+		a3fractalDualMin_sse2(a3mengerBoxDual_sse2(ry, rz, rx, 2.0f, a3menger_arm, 2.0f), a3mengerBoxDual_sse2(rz, rx, ry, 2.0f, 2.0f, a3menger_arm)));
+}
+
+A3_FRACTAL_TARGET("sse2")
+a3menger_inline a3_FractalDual4 a3mengerDistanceDual_sse2(const __m128 x, const __m128 y, const __m128 z, const unsigned int depth, const int variant, const int falloff, __m128 ratio)
+{
+	const __m128 one = _mm_set1_ps(1.0f), minusOne = _mm_set1_ps(-1.0f);
+	const float b = a3mengerBoxSize[variant];
+	const a3_FractalDual4 px = a3fractalDualVar_sse2(x, 0), py = a3fractalDualVar_sse2(y, 1), pz = a3fractalDualVar_sse2(z, 2);
+	a3_FractalDual4 d = a3mengerBoxDual_sse2(px, py, pz, b, b, b), rx, ry, rz, c;
+	__m128 s = _mm_set1_ps(a3mengerFirstScale[variant]);
+	unsigned int m;
+	for (m = 0; m < depth; ++m)
+	{
+		if (falloff && _mm_movemask_ps(_mm_cmpgt_ps(ratio, one)) == 0)
+			break;
+		rx = a3fractalDualAddC_sse2(a3fractalDualMod_sse2(a3fractalDualMulC_sse2(px, s), 2.0f, 0.5f), minusOne);
+		ry = a3fractalDualAddC_sse2(a3fractalDualMod_sse2(a3fractalDualMulC_sse2(py, s), 2.0f, 0.5f), minusOne);
+		rz = a3fractalDualAddC_sse2(a3fractalDualMod_sse2(a3fractalDualMulC_sse2(pz, s), 2.0f, 0.5f), minusOne);
+		s = _mm_mul_ps(s, _mm_set1_ps(3.0f));
+		c = a3fractalDualDivC_sse2(a3mengerCutDual_sse2(rx, ry, rz, variant), s);
+		if (falloff)
+		{
+			d = a3fractalDualAdd_sse2(d, a3fractalDualMulC_sse2(a3fractalDualSub_sse2(a3fractalDualMax_sse2(d, c), d), a3mengerFade_sse2(ratio)));
+			ratio = _mm_mul_ps(ratio, _mm_set1_ps(a3menger_third));
+		}
+		else
+			d = a3fractalDualMax_sse2(d, c);
+	}
+	return a3fractalDualMin_sse2(a3fractalDualAddC_sse2(py, _mm_set1_ps(10.0f)), d);
+}
+
+A3_FRACTAL_TARGET("sse2")
+a3menger_inline void a3fractalMengerSpanT_sse2(const float *eye, a3_MengerSpan *span, const unsigned int count, const float omega, const int gradient, const float pixel, const unsigned int depth, const int variant, a3_FractalBrickCache *cache, a3_FractalBrickStats *stats)
+{
+	const __m128 detail = _mm_set1_ps(a3mengerDetail[variant]), pix = _mm_set1_ps(pixel);
+	const int falloff = pixel > 0.0f;
+	__m128 ratio = _mm_setzero_ps();
+	a3_FractalDual4 g;
+	const __m128 sign = _mm_set1_ps(-0.0f), one = _mm_set1_ps(1.0f), e = _mm_set1_ps(a3fractal_mengerNormal);
+	const __m128 eps = _mm_set1_ps(a3fractal_mengerEpsilon), halfFar = _mm_set1_ps(a3fractal_mengerFar * 0.5f);
+	const __m128 ex = _mm_set1_ps(eye[0]), ey = _mm_set1_ps(eye[1]), ez = _mm_set1_ps(eye[2]);
+	const __m128 margin = _mm_set1_ps(cache ? a3fractalBrickCacheGetMargin(cache) : 0.0f), lipschitz = _mm_set1_ps(a3mengerLipschitz[variant]);
+	__m128 dx, dy, dz, d, f, w, dn, dPrev, fPrev, px, py, pz, nx, ny, nz, len, sponge, spongeNew, spongePrev, moving, fail;
+	__m128 ox, oy, oz, floorDist, fresh, bounded, boundedPrev, fix, bound = _mm_setzero_ps();
+	__m128i steps, skipped;
+	float lane[3][4], center[3], c;
+	unsigned int i, j, k, idBits;
+
+	for (i = 0; i < count; i += 4)
+	{
+		dx = _mm_loadu_ps(span->dirX + i);
+		dy = _mm_loadu_ps(span->dirY + i);
+		dz = _mm_loadu_ps(span->dirZ + i);
+		d = _mm_set1_ps(a3menger_first);
+		f = _mm_loadu_ps(span->start + i);
+		w = _mm_set1_ps(omega);
+		sponge = _mm_setzero_ps();
+		bounded = _mm_setzero_ps();
+		steps = _mm_setzero_si128();
+		skipped = _mm_setzero_si128();
+		for (k = 0; k < a3fractal_mengerSteps; ++k)
+		{
+			// 'not less' and 'not greater' keep NaN rays moving, as the
+			//	scalar test does
+			moving = _mm_and_ps(_mm_cmpnlt_ps(_mm_andnot_ps(sign, d), eps), _mm_cmpngt_ps(f, halfFar));
+			if (_mm_movemask_ps(moving) == 0)
+				break;
+			fPrev = f;
+			dPrev = d;
+			spongePrev = sponge;
+			boundedPrev = bounded;
+			f = _mm_add_ps(f, _mm_and_ps(moving, _mm_mul_ps(w, d)));
+			px = _mm_add_ps(ex, _mm_mul_ps(dx, f));
+			py = _mm_add_ps(ey, _mm_mul_ps(dy, f));
+			pz = _mm_add_ps(ez, _mm_mul_ps(dz, f));
+			if (falloff)
+				ratio = _mm_div_ps(detail, _mm_mul_ps(f, pix));
+
+			// the packet skips the scene only if every moving ray's bound
+			//	is worth stepping by
+			fresh = moving;
+			if (cache)
+			{
+				_mm_storeu_ps(lane[0], px);
+				_mm_storeu_ps(lane[1], py);
+				_mm_storeu_ps(lane[2], pz);
+				c = a3mengerCacheBound(cache, stats, lane[0], lane[1], lane[2], 4, (unsigned int)_mm_movemask_ps(moving), variant, center);
+				ox = _mm_sub_ps(px, _mm_set1_ps(center[0]));
+				oy = _mm_sub_ps(py, _mm_set1_ps(center[1]));
+				oz = _mm_sub_ps(pz, _mm_set1_ps(center[2]));
+				bound = _mm_sub_ps(_mm_set1_ps(c), _mm_mul_ps(lipschitz, _mm_sqrt_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(ox, ox), _mm_mul_ps(oy, oy)), _mm_mul_ps(oz, oz)))));
+				fresh = _mm_andnot_ps(_mm_cmpgt_ps(bound, margin), moving);
+			}
+			if (_mm_movemask_ps(fresh))
+			{
+				dn = a3mengerDistance_sse2(px, py, pz, &spongeNew, depth, variant, falloff, ratio);
+				bounded = _mm_andnot_ps(moving, bounded);
+			}
+			else
+			{
+				// a bound is never within epsilon, so rays only stop on
+				//	evaluated distances or on the floor, which is always exact
+				floorDist = _mm_add_ps(py, _mm_set1_ps(10.0f));
+				dn = _mm_min_ps(floorDist, bound);
+				spongeNew = _mm_cmpnlt_ps(floorDist, bound);
+				bounded = _mm_or_ps(_mm_and_ps(moving, spongeNew), _mm_andnot_ps(moving, bounded));
+				skipped = _mm_sub_epi32(skipped, _mm_castps_si128(moving));
+			}
+			d = _mm_or_ps(_mm_and_ps(moving, dn), _mm_andnot_ps(moving, d));
+			sponge = _mm_or_ps(_mm_and_ps(moving, spongeNew), _mm_andnot_ps(moving, sponge));
+			steps = _mm_sub_epi32(steps, _mm_castps_si128(moving));
+
+			// overshoot: back up, stop relaxing
+			fail = _mm_and_ps(_mm_and_ps(moving, _mm_cmpgt_ps(w, one)),
+				_mm_cmplt_ps(_mm_add_ps(_mm_andnot_ps(sign, d), _mm_andnot_ps(sign, dPrev)), _mm_sub_ps(f, fPrev)));
+			if (_mm_movemask_ps(fail))
+			{
+				f = _mm_or_ps(_mm_and_ps(fail, fPrev), _mm_andnot_ps(fail, f));
+				d = _mm_or_ps(_mm_and_ps(fail, dPrev), _mm_andnot_ps(fail, d));
+				sponge = _mm_or_ps(_mm_and_ps(fail, spongePrev), _mm_andnot_ps(fail, sponge));
+				bounded = _mm_or_ps(_mm_and_ps(fail, boundedPrev), _mm_andnot_ps(fail, bounded));
+				w = _mm_or_ps(_mm_and_ps(fail, one), _mm_andnot_ps(fail, w));
+			}
+		}
+		px = _mm_add_ps(ex, _mm_mul_ps(dx, f));
+		py = _mm_add_ps(ey, _mm_mul_ps(dy, f));
+		pz = _mm_add_ps(ez, _mm_mul_ps(dz, f));
+		if (falloff)
+			ratio = _mm_div_ps(detail, _mm_mul_ps(f, pix));
+
+		// rays that ran out on a bound are shaded from the distance itself
+		fix = _mm_and_ps(bounded, _mm_cmplt_ps(f, _mm_set1_ps(a3fractal_mengerFar)));
+		if (_mm_movemask_ps(fix))
+		{
+			dn = a3mengerDistance_sse2(px, py, pz, &spongeNew, depth, variant, falloff, ratio);
+			d = _mm_or_ps(_mm_and_ps(fix, dn), _mm_andnot_ps(fix, d));
+			sponge = _mm_or_ps(_mm_and_ps(fix, spongeNew), _mm_andnot_ps(fix, sponge));
+			skipped = _mm_add_epi32(skipped, _mm_castps_si128(fix));
+		}
+		_mm_storeu_ps(span->dist + i, f);
+		_mm_storeu_si128((__m128i *)(span->steps + i), steps);
+		_mm_storeu_si128((__m128i *)(span->skipped + i), skipped);
+		idBits = (unsigned int)_mm_movemask_ps(sponge);
+		for (j = 0; j < 4; ++j)
+			span->id[i + j] = (unsigned char)((idBits >> j) & 1);
+
+		if (_mm_movemask_ps(_mm_cmplt_ps(f, _mm_set1_ps(a3fractal_mengerFar))))
+		{
+			if (gradient)
+			{
+				g = a3mengerDistanceDual_sse2(px, py, pz, depth, variant, falloff, ratio);
+				nx = g.dx;
+				ny = g.dy;
+				nz = g.dz;
+			}
+			else
+			{
+				nx = _mm_sub_ps(d, a3mengerDistance_sse2(_mm_sub_ps(px, e), py, pz, 0, depth, variant, falloff, ratio));
+				ny = _mm_sub_ps(d, a3mengerDistance_sse2(px, _mm_sub_ps(py, e), pz, 0, depth, variant, falloff, ratio));
+				nz = _mm_sub_ps(d, a3mengerDistance_sse2(px, py, _mm_sub_ps(pz, e), 0, depth, variant, falloff, ratio));
+			}
+			len = _mm_sqrt_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(nx, nx), _mm_mul_ps(ny, ny)), _mm_mul_ps(nz, nz)));
+			len = _mm_or_ps(_mm_and_ps(_mm_cmpgt_ps(len, _mm_setzero_ps()), len), _mm_andnot_ps(_mm_cmpgt_ps(len, _mm_setzero_ps()), _mm_set1_ps(1.0f)));
+			_mm_storeu_ps(span->normalX + i, _mm_div_ps(nx, len));
+			_mm_storeu_ps(span->normalY + i, _mm_div_ps(ny, len));
+			_mm_storeu_ps(span->normalZ + i, _mm_div_ps(nz, len));
+		}
+	}
+}
+
+
+// AVX2: 4x2 rays per instruction
+
+A3_FRACTAL_TARGET("avx2")
+a3menger_inline __m256 a3mengerBox_avx2(const __m256 x, const __m256 y, const __m256 z, const float bx, const float by, const float bz)
+{
+	const __m256 sign = _mm256_set1_ps(-0.0f), zero = _mm256_setzero_ps();
+	const __m256 dx = _mm256_sub_ps(_mm256_andnot_ps(sign, x), _mm256_set1_ps(bx));
+	const __m256 dy = _mm256_sub_ps(_mm256_andnot_ps(sign, y), _mm256_set1_ps(by));
+	const __m256 dz = _mm256_sub_ps(_mm256_andnot_ps(sign, z), _mm256_set1_ps(bz));
+	const __m256 ex = _mm256_max_ps(dx, zero), ey = _mm256_max_ps(dy, zero), ez = _mm256_max_ps(dz, zero);
+	const __m256 mc = _mm256_max_ps(_mm256_max_ps(dx, dy), dz);
+	const __m256 len = _mm256_sqrt_ps(_mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(ex, ex), _mm256_mul_ps(ey, ey)), _mm256_mul_ps(ez, ez)));
+	return _mm256_min_ps(mc, len);
+}
+
+A3_FRACTAL_TARGET("avx2")
+a3menger_inline __m256 a3mengerFold_avx2(const __m256 v)
+{
+	const __m256 one = _mm256_set1_ps(1.0f);
+	const __m256 t = _mm256_floor_ps(_mm256_mul_ps(v, _mm256_set1_ps(0.5f)));
+	return _mm256_sub_ps(_mm256_sub_ps(v, _mm256_mul_ps(_mm256_set1_ps(2.0f), t)), one);
+}
+
+A3_FRACTAL_TARGET("avx2")
+a3menger_inline __m256 a3mengerFade_avx2(const __m256 ratio)
+{
+	const __m256 one = _mm256_set1_ps(1.0f);
+	return _mm256_min_ps(_mm256_max_ps(_mm256_mul_ps(_mm256_sub_ps(ratio, one), _mm256_set1_ps(0.5f)), _mm256_setzero_ps()), one);
+}
+
+A3_FRACTAL_TARGET("avx2")
+a3menger_inline __m256 a3mengerCut_avx2(const __m256 ax, const __m256 ay, const __m256 az, const int variant)
+{
+	const __m256 sign = _mm256_set1_ps(-0.0f), one = _mm256_set1_ps(1.0f), four = _mm256_set1_ps(4.0f);
+	__m256 rx, ry, rz;
+	if (variant == a3fractal_mengerVariantClassic)
+	{
+		const __m256 three = _mm256_set1_ps(3.0f);
+		rx = _mm256_andnot_ps(sign, _mm256_sub_ps(one, _mm256_mul_ps(three, _mm256_andnot_ps(sign, ax))));
+		ry = _mm256_andnot_ps(sign, _mm256_sub_ps(one, _mm256_mul_ps(three, _mm256_andnot_ps(sign, ay))));
+		rz = _mm256_andnot_ps(sign, _mm256_sub_ps(one, _mm256_mul_ps(three, _mm256_andnot_ps(sign, az))));
+		return _mm256_sub_ps(_mm256_min_ps(_mm256_max_ps(rx, ry), _mm256_min_ps(_mm256_max_ps(ry, rz), _mm256_max_ps(rz, rx))), one);
+	}
+	rx = _mm256_sub_ps(one, _mm256_mul_ps(four, _mm256_andnot_ps(sign, ax)));
+	ry = _mm256_sub_ps(one, _mm256_mul_ps(four, _mm256_andnot_ps(sign, ay)));
+	rz = _mm256_sub_ps(one, _mm256_mul_ps(four, _mm256_andnot_ps(sign, az)));
+	return _mm256_min_ps(a3mengerBox_avx2(rx, ry, rz, a3menger_arm, 2.0f, 2.0f),
+		_mm256_min_ps(a3mengerBox_avx2(ry, rz, rx, 2.0f, a3menger_arm, 2.0f), a3mengerBox_avx2(rz, rx, ry, 2.0f, 2.0f, a3menger_arm)));
+}
+
+A3_FRACTAL_TARGET("avx2")
+a3menger_inline __m256 a3mengerDistance_avx2(const __m256 x, const __m256 y, const __m256 z, __m256 *sponge_out, const unsigned int depth, const int variant, const int falloff, __m256 ratio)
+{
+	const __m256 one = _mm256_set1_ps(1.0f);
+	const float b = a3mengerBoxSize[variant];
+	__m256 d = a3mengerBox_avx2(x, y, z, b, b, b), s = _mm256_set1_ps(a3mengerFirstScale[variant]), c, floorDist;
+	unsigned int m;
+	for (m = 0; m < depth; ++m)
+	{
+		if (falloff && _mm256_movemask_ps(_mm256_cmp_ps(ratio, one, _CMP_GT_OQ)) == 0)
+			break;
+		c = a3mengerCut_avx2(a3mengerFold_avx2(_mm256_mul_ps(x, s)), a3mengerFold_avx2(_mm256_mul_ps(y, s)), a3mengerFold_avx2(_mm256_mul_ps(z, s)), variant);
+		s = _mm256_mul_ps(s, _mm256_set1_ps(3.0f));
+		c = _mm256_div_ps(c, s);
+		if (falloff)
+		{
+			d = _mm256_add_ps(d, _mm256_mul_ps(a3mengerFade_avx2(ratio), _mm256_sub_ps(_mm256_max_ps(d, c), d)));
+			ratio = _mm256_mul_ps(ratio, _mm256_set1_ps(a3menger_third));
+		}
+		else
+			d = _mm256_max_ps(d, c);
+	}
+	floorDist = _mm256_add_ps(y, _mm256_set1_ps(10.0f));
+	if (sponge_out)
+		*sponge_out = _mm256_cmp_ps(floorDist, d, _CMP_NLT_UQ);
+	return _mm256_min_ps(floorDist, d);
+}
+
+A3_FRACTAL_TARGET("avx2")
+a3menger_inline a3_FractalDual8 a3mengerBoxDual_avx2(const a3_FractalDual8 x, const a3_FractalDual8 y, const a3_FractalDual8 z, const float bx, const float by, const float bz)
+{
+	const __m256 zero = _mm256_setzero_ps();
+	const a3_FractalDual8 dx = a3fractalDualAddC_avx2(a3fractalDualAbs_avx2(x), _mm256_set1_ps(-bx));
+	const a3_FractalDual8 dy = a3fractalDualAddC_avx2(a3fractalDualAbs_avx2(y), _mm256_set1_ps(-by));
+	const a3_FractalDual8 dz = a3fractalDualAddC_avx2(a3fractalDualAbs_avx2(z), _mm256_set1_ps(-bz));
+	const a3_FractalDual8 ex = a3fractalDualMaxC_avx2(dx, zero), ey = a3fractalDualMaxC_avx2(dy, zero), ez = a3fractalDualMaxC_avx2(dz, zero);
+	const a3_FractalDual8 mc = a3fractalDualMax_avx2(a3fractalDualMax_avx2(dx, dy), dz);
+	const a3_FractalDual8 len = a3fractalDualSqrt_avx2(a3fractalDualAdd_avx2(a3fractalDualAdd_avx2(a3fractalDualMul_avx2(ex, ex), a3fractalDualMul_avx2(ey, ey)), a3fractalDualMul_avx2(ez, ez)));
+	return a3fractalDualMin_avx2(mc, len);
+}
+
+A3_FRACTAL_TARGET("avx2")
+a3menger_inline a3_FractalDual8 a3mengerCutDual_avx2(const a3_FractalDual8 ax, const a3_FractalDual8 ay, const a3_FractalDual8 az, const int variant)
+{
+	const __m256 one = _mm256_set1_ps(1.0f), four = _mm256_set1_ps(4.0f);
+	a3_FractalDual8 rx, ry, rz;
+	if (variant == a3fractal_mengerVariantClassic)
+	{
+		const __m256 three = _mm256_set1_ps(3.0f);
+		rx = a3fractalDualAbs_avx2(a3fractalDualCSub_avx2(one, a3fractalDualMulC_avx2(a3fractalDualAbs_avx2(ax), three)));
+		ry = a3fractalDualAbs_avx2(a3fractalDualCSub_avx2(one, a3fractalDualMulC_avx2(a3fractalDualAbs_avx2(ay), three)));
+		rz = a3fractalDualAbs_avx2(a3fractalDualCSub_avx2(one, a3fractalDualMulC_avx2(a3fractalDualAbs_avx2(az), three)));
+		return a3fractalDualAddC_avx2(a3fractalDualMin_avx2(a3fractalDualMax_avx2(rx, ry), a3fractalDualMin_avx2(a3fractalDualMax_avx2(ry, rz), a3fractalDualMax_avx2(rz, rx))), _mm256_set1_ps(-1.0f));
+	}
+	rx = a3fractalDualCSub_avx2(one, a3fractalDualMulC_avx2(a3fractalDualAbs_avx2(ax), four));
+	ry = a3fractalDualCSub_avx2(one, a3fractalDualMulC_avx2(a3fractalDualAbs_avx2(ay), four));
+	rz = a3fractalDualCSub_avx2(one, a3fractalDualMulC_avx2(a3fractalDualAbs_avx2(az), four));
+	return a3fractalDualMin_avx2(a3mengerBoxDual_avx2(rx, ry, rz, a3menger_arm, 2.0f, 2.0f),
+		a3fractalDualMin_avx2(a3mengerBoxDual_avx2(ry, rz, rx, 2.0f, a3menger_arm, 2.0f), a3mengerBoxDual_avx2(rz, rx, ry, 2.0f, 2.0f, a3menger_arm)));
+}
+
+A3_FRACTAL_TARGET("avx2")
+a3menger_inline a3_FractalDual8 a3mengerDistanceDual_avx2(const __m256 x, const __m256 y, const __m256 z, const unsigned int depth, const int variant, const int falloff, __m256 ratio)
+{
+	const __m256 one = _mm256_set1_ps(1.0f), minusOne = _mm256_set1_ps(-1.0f);
+	const float b = a3mengerBoxSize[variant];
+	const a3_FractalDual8 px = a3fractalDualVar_avx2(x, 0), py = a3fractalDualVar_avx2(y, 1), pz = a3fractalDualVar_avx2(z, 2);
+	a3_FractalDual8 d = a3mengerBoxDual_avx2(px, py, pz, b, b, b), rx, ry, rz, c;
+	__m256 s = _mm256_set1_ps(a3mengerFirstScale[variant]);
+	unsigned int m;
+	for (m = 0; m < depth; ++m)
+	{
+		if (falloff && _mm256_movemask_ps(_mm256_cmp_ps(ratio, one, _CMP_GT_OQ)) == 0)
+			break;
+		rx = a3fractalDualAddC_avx2(a3fractalDualMod_avx2(a3fractalDualMulC_avx2(px, s), 2.0f, 0.5f), minusOne);
+		ry = a3fractalDualAddC_avx2(a3fractalDualMod_avx2(a3fractalDualMulC_avx2(py, s), 2.0f, 0.5f), minusOne);
+		rz = a3fractalDualAddC_avx2(a3fractalDualMod_avx2(a3fractalDualMulC_avx2(pz, s), 2.0f, 0.5f), minusOne);
+		s = _mm256_mul_ps(s, _mm256_set1_ps(3.0f));
+		c = a3fractalDualDivC_avx2(a3mengerCutDual_avx2(rx, ry, rz, variant), s);
+		if (falloff)
+		{
+			d = a3fractalDualAdd_avx2(d, a3fractalDualMulC_avx2(a3fractalDualSub_avx2(a3fractalDualMax_avx2(d, c), d), a3mengerFade_avx2(ratio)));
+			ratio = _mm256_mul_ps(ratio, _mm256_set1_ps(a3menger_third));
+		}
+		else
+			d = a3fractalDualMax_avx2(d, c);
+	}
+	return a3fractalDualMin_avx2(a3fractalDualAddC_avx2(py, _mm256_set1_ps(10.0f)), d);
+}
+
+A3_FRACTAL_TARGET("avx2")
+a3menger_inline void a3fractalMengerSpanT_avx2(const float *eye, a3_MengerSpan *span, const unsigned int count, const float omega, const int gradient, const float pixel, const unsigned int depth, const int variant, a3_FractalBrickCache *cache, a3_FractalBrickStats *stats)
+{
+	const __m256 detail = _mm256_set1_ps(a3mengerDetail[variant]), pix = _mm256_set1_ps(pixel);
+	const int falloff = pixel > 0.0f;
+	__m256 ratio = _mm256_setzero_ps();
+	a3_FractalDual8 g;
+	const __m256 sign = _mm256_set1_ps(-0.0f), one = _mm256_set1_ps(1.0f), e = _mm256_set1_ps(a3fractal_mengerNormal);
+	const __m256 eps = _mm256_set1_ps(a3fractal_mengerEpsilon), halfFar = _mm256_set1_ps(a3fractal_mengerFar * 0.5f);
+	const __m256 ex = _mm256_set1_ps(eye[0]), ey = _mm256_set1_ps(eye[1]), ez = _mm256_set1_ps(eye[2]);
+	const __m256 margin = _mm256_set1_ps(cache ? a3fractalBrickCacheGetMargin(cache) : 0.0f), lipschitz = _mm256_set1_ps(a3mengerLipschitz[variant]);
+	__m256 dx, dy, dz, d, f, w, dn, dPrev, fPrev, px, py, pz, nx, ny, nz, len, sponge, spongeNew, spongePrev, moving, fail;
+	__m256 ox, oy, oz, floorDist, fresh, bounded, boundedPrev, fix, bound = _mm256_setzero_ps();
+	__m256i steps, skipped;
+	float lane[3][8], center[3], c;
+	unsigned int i, j, k, idBits;
+
+	for (i = 0; i < count; i += 8)
+	{
+		dx = _mm256_loadu_ps(span->dirX + i);
+		dy = _mm256_loadu_ps(span->dirY + i);
+		dz = _mm256_loadu_ps(span->dirZ + i);
+		d = _mm256_set1_ps(a3menger_first);
+		f = _mm256_loadu_ps(span->start + i);
+		w = _mm256_set1_ps(omega);
+		sponge = _mm256_setzero_ps();
+		bounded = _mm256_setzero_ps();
+		steps = _mm256_setzero_si256();
+		skipped = _mm256_setzero_si256();
+		for (k = 0; k < a3fractal_mengerSteps; ++k)
+		{
+			moving = _mm256_and_ps(_mm256_cmp_ps(_mm256_andnot_ps(sign, d), eps, _CMP_NLT_UQ), _mm256_cmp_ps(f, halfFar, _CMP_NGT_UQ));
+			if (_mm256_movemask_ps(moving) == 0)
+				break;
+			fPrev = f;
+			dPrev = d;
+			spongePrev = sponge;
+			boundedPrev = bounded;
+			f = _mm256_add_ps(f, _mm256_and_ps(moving, _mm256_mul_ps(w, d)));
+			px = _mm256_add_ps(ex, _mm256_mul_ps(dx, f));
+			py = _mm256_add_ps(ey, _mm256_mul_ps(dy, f));
+			pz = _mm256_add_ps(ez, _mm256_mul_ps(dz, f));
+			if (falloff)
+				ratio = _mm256_div_ps(detail, _mm256_mul_ps(f, pix));
+
+			fresh = moving;
+			if (cache)
+			{
+				_mm256_storeu_ps(lane[0], px);
+				_mm256_storeu_ps(lane[1], py);
+				_mm256_storeu_ps(lane[2], pz);
+				c = a3mengerCacheBound(cache, stats, lane[0], lane[1], lane[2], 8, (unsigned int)_mm256_movemask_ps(moving), variant, center);
+				ox = _mm256_sub_ps(px, _mm256_set1_ps(center[0]));
+				oy = _mm256_sub_ps(py, _mm256_set1_ps(center[1]));
+				oz = _mm256_sub_ps(pz, _mm256_set1_ps(center[2]));
+				bound = _mm256_sub_ps(_mm256_set1_ps(c), _mm256_mul_ps(lipschitz, _mm256_sqrt_ps(_mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(ox, ox), _mm256_mul_ps(oy, oy)), _mm256_mul_ps(oz, oz)))));
+				fresh = _mm256_andnot_ps(_mm256_cmp_ps(bound, margin, _CMP_GT_OQ), moving);
+			}
+			if (_mm256_movemask_ps(fresh))
+			{
+				dn = a3mengerDistance_avx2(px, py, pz, &spongeNew, depth, variant, falloff, ratio);
+				bounded = _mm256_andnot_ps(moving, bounded);
+			}
+			else
+			{
+				floorDist = _mm256_add_ps(py, _mm256_set1_ps(10.0f));
+				dn = _mm256_min_ps(floorDist, bound);
+				spongeNew = _mm256_cmp_ps(floorDist, bound, _CMP_NLT_UQ);
+				bounded = _mm256_blendv_ps(bounded, spongeNew, moving);
+				skipped = _mm256_sub_epi32(skipped, _mm256_castps_si256(moving));
+			}
+			d = _mm256_blendv_ps(d, dn, moving);
+			sponge = _mm256_blendv_ps(sponge, spongeNew, moving);
+			steps = _mm256_sub_epi32(steps, _mm256_castps_si256(moving));
+
+			fail = _mm256_and_ps(_mm256_and_ps(moving, _mm256_cmp_ps(w, one, _CMP_GT_OQ)),
+				_mm256_cmp_ps(_mm256_add_ps(_mm256_andnot_ps(sign, d), _mm256_andnot_ps(sign, dPrev)), _mm256_sub_ps(f, fPrev), _CMP_LT_OQ));
+			if (_mm256_movemask_ps(fail))
+			{
+				f = _mm256_blendv_ps(f, fPrev, fail);
+				d = _mm256_blendv_ps(d, dPrev, fail);
+				sponge = _mm256_blendv_ps(sponge, spongePrev, fail);
+				bounded = _mm256_blendv_ps(bounded, boundedPrev, fail);
+				w = _mm256_blendv_ps(w, one, fail);
+			}
+		}
+		px = _mm256_add_ps(ex, _mm256_mul_ps(dx, f));
+		py = _mm256_add_ps(ey, _mm256_mul_ps(dy, f));
+		pz = _mm256_add_ps(ez, _mm256_mul_ps(dz, f));
+		if (falloff)
+			ratio = _mm256_div_ps(detail, _mm256_mul_ps(f, pix));
+		fix = _mm256_and_ps(bounded, _mm256_cmp_ps(f, _mm256_set1_ps(a3fractal_mengerFar), _CMP_LT_OQ));
+		if (_mm256_movemask_ps(fix))
+		{
+			dn = a3mengerDistance_avx2(px, py, pz, &spongeNew, depth, variant, falloff, ratio);
+			d = _mm256_blendv_ps(d, dn, fix);
+			sponge = _mm256_blendv_ps(sponge, spongeNew, fix);
+			skipped = _mm256_add_epi32(skipped, _mm256_castps_si256(fix));
+		}
+		_mm256_storeu_ps(span->dist + i, f);
+		_mm256_storeu_si256((__m256i *)(span->steps + i), steps);
+		_mm256_storeu_si256((__m256i *)(span->skipped + i), skipped);
+		idBits = (unsigned int)_mm256_movemask_ps(sponge);
+		for (j = 0; j < 8; ++j)
+			span->id[i + j] = (unsigned char)((idBits >> j) & 1);
+
+		if (_mm256_movemask_ps(_mm256_cmp_ps(f, _mm256_set1_ps(a3fractal_mengerFar), _CMP_LT_OQ)))
+		{
+			if (gradient)
+			{
+				g = a3mengerDistanceDual_avx2(px, py, pz, depth, variant, falloff, ratio);
+				nx = g.dx;
+				ny = g.dy;
+				nz = g.dz;
+			}
+			else
+			{
+				nx = _mm256_sub_ps(d, a3mengerDistance_avx2(_mm256_sub_ps(px, e), py, pz, 0, depth, variant, falloff, ratio));
+				ny = _mm256_sub_ps(d, a3mengerDistance_avx2(px, _mm256_sub_ps(py, e), pz, 0, depth, variant, falloff, ratio));
+				nz = _mm256_sub_ps(d, a3mengerDistance_avx2(px, py, _mm256_sub_ps(pz, e), 0, depth, variant, falloff, ratio));
+			}
+			len = _mm256_sqrt_ps(_mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(nx, nx), _mm256_mul_ps(ny, ny)), _mm256_mul_ps(nz, nz)));
+			len = _mm256_blendv_ps(_mm256_set1_ps(1.0f), len, _mm256_cmp_ps(len, _mm256_setzero_ps(), _CMP_GT_OQ));
+			_mm256_storeu_ps(span->normalX + i, _mm256_div_ps(nx, len));
+			_mm256_storeu_ps(span->normalY + i, _mm256_div_ps(ny, len));
+			_mm256_storeu_ps(span->normalZ + i, _mm256_div_ps(nz, len));
+		}
+	}
+}
+
+
+#if A3_FRACTAL_AVX512
+
+// AVX-512: 4x4 rays per instruction
+
+A3_FRACTAL_TARGET("avx512f")
+a3menger_inline __m512 a3mengerBox_avx512(const __m512 x, const __m512 y, const __m512 z, const float bx, const float by, const float bz)
+{
+	const __m512 zero = _mm512_setzero_ps();
+	const __m512 dx = _mm512_sub_ps(_mm512_abs_ps(x), _mm512_set1_ps(bx));
+	const __m512 dy = _mm512_sub_ps(_mm512_abs_ps(y), _mm512_set1_ps(by));
+	const __m512 dz = _mm512_sub_ps(_mm512_abs_ps(z), _mm512_set1_ps(bz));
+	const __m512 ex = _mm512_max_ps(dx, zero), ey = _mm512_max_ps(dy, zero), ez = _mm512_max_ps(dz, zero);
+	const __m512 mc = _mm512_max_ps(_mm512_max_ps(dx, dy), dz);
+	const __m512 len = _mm512_sqrt_ps(_mm512_add_ps(_mm512_add_ps(_mm512_mul_ps(ex, ex), _mm512_mul_ps(ey, ey)), _mm512_mul_ps(ez, ez)));
+	return _mm512_min_ps(mc, len);
+}
+
+A3_FRACTAL_TARGET("avx512f")
+a3menger_inline __m512 a3mengerFold_avx512(const __m512 v)
+{
+	const __m512 one = _mm512_set1_ps(1.0f);
+	const __m512 t = _mm512_roundscale_ps(_mm512_mul_ps(v, _mm512_set1_ps(0.5f)), _MM_FROUND_TO_NEG_INF | _MM_FROUND_NO_EXC);
+	return _mm512_sub_ps(_mm512_sub_ps(v, _mm512_mul_ps(_mm512_set1_ps(2.0f), t)), one);
+}
+
+A3_FRACTAL_TARGET("avx512f")
+a3menger_inline __m512 a3mengerFade_avx512(const __m512 ratio)
+{
+	const __m512 one = _mm512_set1_ps(1.0f);
+	return _mm512_min_ps(_mm512_max_ps(_mm512_mul_ps(_mm512_sub_ps(ratio, one), _mm512_set1_ps(0.5f)), _mm512_setzero_ps()), one);
+}
+
+A3_FRACTAL_TARGET("avx512f")
+a3menger_inline __m512 a3mengerCut_avx512(const __m512 ax, const __m512 ay, const __m512 az, const int variant)
+{
+	const __m512 one = _mm512_set1_ps(1.0f), four = _mm512_set1_ps(4.0f);
+	__m512 rx, ry, rz;
+	if (variant == a3fractal_mengerVariantClassic)
+	{
+		const __m512 three = _mm512_set1_ps(3.0f);
+		rx = _mm512_abs_ps(_mm512_sub_ps(one, _mm512_mul_ps(three, _mm512_abs_ps(ax))));
+		ry = _mm512_abs_ps(_mm512_sub_ps(one, _mm512_mul_ps(three, _mm512_abs_ps(ay))));
+		rz = _mm512_abs_ps(_mm512_sub_ps(one, _mm512_mul_ps(three, _mm512_abs_ps(az))));
+		return _mm512_sub_ps(_mm512_min_ps(_mm512_max_ps(rx, ry), _mm512_min_ps(_mm512_max_ps(ry, rz), _mm512_max_ps(rz, rx))), one);
+	}
+	rx = _mm512_sub_ps(one, _mm512_mul_ps(four, _mm512_abs_ps(ax)));
+	ry = _mm512_sub_ps(one, _mm512_mul_ps(four, _mm512_abs_ps(ay)));
+	rz = _mm512_sub_ps(one, _mm512_mul_ps(four, _mm512_abs_ps(az)));
+	return _mm512_min_ps(a3mengerBox_avx512(rx, ry, rz, a3menger_arm, 2.0f, 2.0f),
+		_mm512_min_ps(a3mengerBox_avx512(ry, rz, rx, 2.0f, a3menger_arm, 2.0f), a3mengerBox_avx512(rz, rx, ry, 2.0f, 2.0f, a3menger_arm)));
+}
+
+A3_FRACTAL_TARGET("avx512f")
+a3menger_inline __m512 a3mengerDistance_avx512(const __m512 x, const __m512 y, const __m512 z, __mmask16 *sponge_out, const unsigned int depth, const int variant, const int falloff, __m512 ratio)
+{
+	const __m512 one = _mm512_set1_ps(1.0f);
+	const float b = a3mengerBoxSize[variant];
+	__m512 d = a3mengerBox_avx512(x, y, z, b, b, b), s = _mm512_set1_ps(a3mengerFirstScale[variant]), c, floorDist;
+	unsigned int m;
+	for (m = 0; m < depth; ++m)
+	{
+		if (falloff && _mm512_cmp_ps_mask(ratio, one, _CMP_GT_OQ) == 0)
+			break;
+		c = a3mengerCut_avx512(a3mengerFold_avx512(_mm512_mul_ps(x, s)), a3mengerFold_avx512(_mm512_mul_ps(y, s)), a3mengerFold_avx512(_mm512_mul_ps(z, s)), variant);
+		s = _mm512_mul_ps(s, _mm512_set1_ps(3.0f));
+		c = _mm512_div_ps(c, s);
+		if (falloff)
+		{
+			d = _mm512_add_ps(d, _mm512_mul_ps(a3mengerFade_avx512(ratio), _mm512_sub_ps(_mm512_max_ps(d, c), d)));
+			ratio = _mm512_mul_ps(ratio, _mm512_set1_ps(a3menger_third));
+		}
+		else
+			d = _mm512_max_ps(d, c);
+	}
+	floorDist = _mm512_add_ps(y, _mm512_set1_ps(10.0f));
+	if (sponge_out)
+		*sponge_out = _mm512_cmp_ps_mask(floorDist, d, _CMP_NLT_UQ);
+	return _mm512_min_ps(floorDist, d);
+}
+
+A3_FRACTAL_TARGET("avx512f")
+a3menger_inline a3_FractalDual16 a3mengerBoxDual_avx512(const a3_FractalDual16 x, const a3_FractalDual16 y, const a3_FractalDual16 z, const float bx, const float by, const float bz)
+{
+	const __m512 zero = _mm512_setzero_ps();
+	const a3_FractalDual16 dx = a3fractalDualAddC_avx512(a3fractalDualAbs_avx512(x), _mm512_set1_ps(-bx));
+	const a3_FractalDual16 dy = a3fractalDualAddC_avx512(a3fractalDualAbs_avx512(y), _mm512_set1_ps(-by));
+	const a3_FractalDual16 dz = a3fractalDualAddC_avx512(a3fractalDualAbs_avx512(z), _mm512_set1_ps(-bz));
+	const a3_FractalDual16 ex = a3fractalDualMaxC_avx512(dx, zero), ey = a3fractalDualMaxC_avx512(dy, zero), ez = a3fractalDualMaxC_avx512(dz, zero);
+	const a3_FractalDual16 mc = a3fractalDualMax_avx512(a3fractalDualMax_avx512(dx, dy), dz);
+	const a3_FractalDual16 len = a3fractalDualSqrt_avx512(a3fractalDualAdd_avx512(a3fractalDualAdd_avx512(a3fractalDualMul_avx512(ex, ex), a3fractalDualMul_avx512(ey, ey)), a3fractalDualMul_avx512(ez, ez)));
+	return a3fractalDualMin_avx512(mc, len);
+}
+
+A3_FRACTAL_TARGET("avx512f")
+a3menger_inline a3_FractalDual16 a3mengerCutDual_avx512(const a3_FractalDual16 ax, const a3_FractalDual16 ay, const a3_FractalDual16 az, const int variant)
+{
+	const __m512 one = _mm512_set1_ps(1.0f), four = _mm512_set1_ps(4.0f);
+	a3_FractalDual16 rx, ry, rz;
+	if (variant == a3fractal_mengerVariantClassic)
+	{
+		const __m512 three = _mm512_set1_ps(3.0f);
+		rx = a3fractalDualAbs_avx512(a3fractalDualCSub_avx512(one, a3fractalDualMulC_avx512(a3fractalDualAbs_avx512(ax), three)));
+		ry = a3fractalDualAbs_avx512(a3fractalDualCSub_avx512(one, a3fractalDualMulC_avx512(a3fractalDualAbs_avx512(ay), three)));
+		rz = a3fractalDualAbs_avx512(a3fractalDualCSub_avx512(one, a3fractalDualMulC_avx512(a3fractalDualAbs_avx512(az), three)));
+		return a3fractalDualAddC_avx512(a3fractalDualMin_avx512(a3fractalDualMax_avx512(rx, ry), a3fractalDualMin_avx512(a3fractalDualMax_avx512(ry, rz), a3fractalDualMax_avx512(rz, rx))), _mm512_set1_ps(-1.0f));
+	}
+	rx = a3fractalDualCSub_avx512(one, a3fractalDualMulC_avx512(a3fractalDualAbs_avx512(ax), four));
+	ry = a3fractalDualCSub_avx512(one, a3fractalDualMulC_avx512(a3fractalDualAbs_avx512(ay), four));
+	rz = a3fractalDualCSub_avx512(one, a3fractalDualMulC_avx512(a3fractalDualAbs_avx512(az), four));
+	return a3fractalDualMin_avx512(a3mengerBoxDual_avx512(rx, ry, rz, a3menger_arm, 2.0f, 2.0f),
+		a3fractalDualMin_avx512(a3mengerBoxDual_avx512(ry, rz, rx, 2.0f, a3menger_arm, 2.0f), a3mengerBoxDual_avx512(rz, rx, ry, 2.0f, 2.0f, a3menger_arm)));
+}
+
+A3_FRACTAL_TARGET("avx512f")
+a3menger_inline a3_FractalDual16 a3mengerDistanceDual_avx512(const __m512 x, const __m512 y, const __m512 z, const unsigned int depth, const int variant, const int falloff, __m512 ratio)
+{
+	const __m512 one = _mm512_set1_ps(1.0f), minusOne = _mm512_set1_ps(-1.0f);
+	const float b = a3mengerBoxSize[variant];
+	const a3_FractalDual16 px = a3fractalDualVar_avx512(x, 0), py = a3fractalDualVar_avx512(y, 1), pz = a3fractalDualVar_avx512(z, 2);
+	a3_FractalDual16 d = a3mengerBoxDual_avx512(px, py, pz, b, b, b), rx, ry, rz, c;
+	__m512 s = _mm512_set1_ps(a3mengerFirstScale[variant]);
+	unsigned int m;
+	for (m = 0; m < depth; ++m)
+	{
+		if (falloff && _mm512_cmp_ps_mask(ratio, one, _CMP_GT_OQ) == 0)
+			break;
+		rx = a3fractalDualAddC_avx512(a3fractalDualMod_avx512(a3fractalDualMulC_avx512(px, s), 2.0f, 0.5f), minusOne);
+		ry = a3fractalDualAddC_avx512(a3fractalDualMod_avx512(a3fractalDualMulC_avx512(py, s), 2.0f, 0.5f), minusOne);
+		rz = a3fractalDualAddC_avx512(a3fractalDualMod_avx512(a3fractalDualMulC_avx512(pz, s), 2.0f, 0.5f), minusOne);
+		s = _mm512_mul_ps(s, _mm512_set1_ps(3.0f));
+		c = a3fractalDualDivC_avx512(a3mengerCutDual_avx512(rx, ry, rz, variant), s);
+		if (falloff)
+		{
+			d = a3fractalDualAdd_avx512(d, a3fractalDualMulC_avx512(a3fractalDualSub_avx512(a3fractalDualMax_avx512(d, c), d), a3mengerFade_avx512(ratio)));
+			ratio = _mm512_mul_ps(ratio, _mm512_set1_ps(a3menger_third));
+		}
+		else
+			d = a3fractalDualMax_avx512(d, c);
+	}
+	return a3fractalDualMin_avx512(a3fractalDualAddC_avx512(py, _mm512_set1_ps(10.0f)), d);
+}
+
+A3_FRACTAL_TARGET("avx512f")
+a3menger_inline void a3fractalMengerSpanT_avx512(const float *eye, a3_MengerSpan *span, const unsigned int count, const float omega, const int gradient, const float pixel, const unsigned int depth, const int variant, a3_FractalBrickCache *cache, a3_FractalBrickStats *stats)
+{
+	const __m512 detail = _mm512_set1_ps(a3mengerDetail[variant]), pix = _mm512_set1_ps(pixel);
+	const int falloff = pixel > 0.0f;
+	__m512 ratio = _mm512_setzero_ps();
+	a3_FractalDual16 g;
+	const __m512 one = _mm512_set1_ps(1.0f), e = _mm512_set1_ps(a3fractal_mengerNormal);
+	const __m512 eps = _mm512_set1_ps(a3fractal_mengerEpsilon), halfFar = _mm512_set1_ps(a3fractal_mengerFar * 0.5f);
+	const __m512 ex = _mm512_set1_ps(eye[0]), ey = _mm512_set1_ps(eye[1]), ez = _mm512_set1_ps(eye[2]);
+	const __m512 margin = _mm512_set1_ps(cache ? a3fractalBrickCacheGetMargin(cache) : 0.0f), lipschitz = _mm512_set1_ps(a3mengerLipschitz[variant]);
+	__m512 dx, dy, dz, d, f, w, dn, dPrev, fPrev, px, py, pz, nx, ny, nz, len;
+	__m512 ox, oy, oz, floorDist, bound = _mm512_setzero_ps();
+	__m512i steps, skipped;
+	__mmask16 sponge, spongeNew, spongePrev, moving, fail, fresh, bounded, boundedPrev, fix;
+	float lane[3][16], center[3], c;
+	unsigned int i, j, k;
+
+	for (i = 0; i < count; i += 16)
+	{
+		dx = _mm512_loadu_ps(span->dirX + i);
+		dy = _mm512_loadu_ps(span->dirY + i);
+		dz = _mm512_loadu_ps(span->dirZ + i);
+		d = _mm512_set1_ps(a3menger_first);
+		f = _mm512_loadu_ps(span->start + i);
+		w = _mm512_set1_ps(omega);
+		sponge = 0;
+		bounded = 0;
+		steps = _mm512_setzero_si512();
+		skipped = _mm512_setzero_si512();
+		for (k = 0; k < a3fractal_mengerSteps; ++k)
+		{
+			moving = _mm512_cmp_ps_mask(_mm512_abs_ps(d), eps, _CMP_NLT_UQ) & _mm512_cmp_ps_mask(f, halfFar, _CMP_NGT_UQ);
+			if (moving == 0)
+				break;
+			fPrev = f;
+			dPrev = d;
+			spongePrev = sponge;
+			boundedPrev = bounded;
+			f = _mm512_mask_add_ps(f, moving, f, _mm512_mul_ps(w, d));
+			px = _mm512_add_ps(ex, _mm512_mul_ps(dx, f));
+			py = _mm512_add_ps(ey, _mm512_mul_ps(dy, f));
+			pz = _mm512_add_ps(ez, _mm512_mul_ps(dz, f));
+			if (falloff)
+				ratio = _mm512_div_ps(detail, _mm512_mul_ps(f, pix));
+
+			fresh = moving;
+			if (cache)
+			{
+				_mm512_storeu_ps(lane[0], px);
+				_mm512_storeu_ps(lane[1], py);
+				_mm512_storeu_ps(lane[2], pz);
+				c = a3mengerCacheBound(cache, stats, lane[0], lane[1], lane[2], 16, moving, variant, center);
+				ox = _mm512_sub_ps(px, _mm512_set1_ps(center[0]));
+				oy = _mm512_sub_ps(py, _mm512_set1_ps(center[1]));
+				oz = _mm512_sub_ps(pz, _mm512_set1_ps(center[2]));
+				bound = _mm512_sub_ps(_mm512_set1_ps(c), _mm512_mul_ps(lipschitz, _mm512_sqrt_ps(_mm512_add_ps(_mm512_add_ps(_mm512_mul_ps(ox, ox), _mm512_mul_ps(oy, oy)), _mm512_mul_ps(oz, oz)))));
+				fresh = (__mmask16)(moving & ~_mm512_cmp_ps_mask(bound, margin, _CMP_GT_OQ));
+			}
+			if (fresh)
+			{
+				dn = a3mengerDistance_avx512(px, py, pz, &spongeNew, depth, variant, falloff, ratio);
+				bounded = (__mmask16)(bounded & ~moving);
+			}
+			else
+			{
+				floorDist = _mm512_add_ps(py, _mm512_set1_ps(10.0f));
+				dn = _mm512_min_ps(floorDist, bound);
+				spongeNew = _mm512_cmp_ps_mask(floorDist, bound, _CMP_NLT_UQ);
+				bounded = (__mmask16)((bounded & ~moving) | (spongeNew & moving));
+				skipped = _mm512_mask_add_epi32(skipped, moving, skipped, _mm512_set1_epi32(1));
+			}
+			d = _mm512_mask_mov_ps(d, moving, dn);
+			sponge = (__mmask16)((sponge & ~moving) | (spongeNew & moving));
+			steps = _mm512_mask_add_epi32(steps, moving, steps, _mm512_set1_epi32(1));
+
+			fail = _mm512_mask_cmp_ps_mask((__mmask16)(moving & _mm512_cmp_ps_mask(w, one, _CMP_GT_OQ)),
+				_mm512_add_ps(_mm512_abs_ps(d), _mm512_abs_ps(dPrev)), _mm512_sub_ps(f, fPrev), _CMP_LT_OQ);
+			if (fail)
+			{
+				f = _mm512_mask_mov_ps(f, fail, fPrev);
+				d = _mm512_mask_mov_ps(d, fail, dPrev);
+				sponge = (__mmask16)((sponge & ~fail) | (spongePrev & fail));
+				bounded = (__mmask16)((bounded & ~fail) | (boundedPrev & fail));
+				w = _mm512_mask_mov_ps(w, fail, one);
+			}
+		}
+		px = _mm512_add_ps(ex, _mm512_mul_ps(dx, f));
+		py = _mm512_add_ps(ey, _mm512_mul_ps(dy, f));
+		pz = _mm512_add_ps(ez, _mm512_mul_ps(dz, f));
+		if (falloff)
+			ratio = _mm512_div_ps(detail, _mm512_mul_ps(f, pix));
+		fix = (__mmask16)(bounded & _mm512_cmp_ps_mask(f, _mm512_set1_ps(a3fractal_mengerFar), _CMP_LT_OQ));
+		if (fix)
+		{
+			dn = a3mengerDistance_avx512(px, py, pz, &spongeNew, depth, variant, falloff, ratio);
+			d = _mm512_mask_mov_ps(d, fix, dn);
+			sponge = (__mmask16)((sponge & ~fix) | (spongeNew & fix));
+			skipped = _mm512_mask_sub_epi32(skipped, fix, skipped, _mm512_set1_epi32(1));
+		}
+		_mm512_storeu_ps(span->dist + i, f);
+		_mm512_storeu_si512(span->steps + i, steps);
+		_mm512_storeu_si512(span->skipped + i, skipped);
+		for (j = 0; j < 16; ++j)
+			span->id[i + j] = (unsigned char)((sponge >> j) & 1);
+
+		if (_mm512_cmp_ps_mask(f, _mm512_set1_ps(a3fractal_mengerFar), _CMP_LT_OQ))
+		{
+			if (gradient)
+			{
+				g = a3mengerDistanceDual_avx512(px, py, pz, depth, variant, falloff, ratio);
+				nx = g.dx;
+				ny = g.dy;
+				nz = g.dz;
+			}
+			else
+			{
+				nx = _mm512_sub_ps(d, a3mengerDistance_avx512(_mm512_sub_ps(px, e), py, pz, 0, depth, variant, falloff, ratio));
+				ny = _mm512_sub_ps(d, a3mengerDistance_avx512(px, _mm512_sub_ps(py, e), pz, 0, depth, variant, falloff, ratio));
+				nz = _mm512_sub_ps(d, a3mengerDistance_avx512(px, py, _mm512_sub_ps(pz, e), 0, depth, variant, falloff, ratio));
+			}
+			len = _mm512_sqrt_ps(_mm512_add_ps(_mm512_add_ps(_mm512_mul_ps(nx, nx), _mm512_mul_ps(ny, ny)), _mm512_mul_ps(nz, nz)));
+			len = _mm512_mask_mov_ps(_mm512_set1_ps(1.0f), _mm512_cmp_ps_mask(len, _mm512_setzero_ps(), _CMP_GT_OQ), len);
+			_mm512_storeu_ps(span->normalX + i, _mm512_div_ps(nx, len));
+			_mm512_storeu_ps(span->normalY + i, _mm512_div_ps(ny, len));
+			_mm512_storeu_ps(span->normalZ + i, _mm512_div_ps(nz, len));
+		}
+	}
+}
+
+#endif	// A3_FRACTAL_AVX512
+
+#endif	// A3_FRACTAL_X86
+
+
+// kernels per instruction set, variant and depth: each one the template
+//	with both fixed, so the level loop unrolls and the variant's branches
+//	fold away; depth 0 takes the depth as a parameter, for deeper sponges
+#define A3_MENGER_KERNEL(target, isa, variant, depth, levels)	\
+target	\
+static void a3fractalMengerSpan_##isa##_##variant##depth(const float *eye, a3_MengerSpan *span, const unsigned int count, const float omega, const int gradient, const float pixel, const unsigned int depthAny, a3_FractalBrickCache *cache_opt, a3_FractalBrickStats *stats)	\
+{	\
+	(void)depthAny;	\
+	a3fractalMengerSpanT_##isa(eye, span, count, omega, gradient, pixel, levels, a3fractal_mengerVariant##variant, cache_opt, stats);	\
+}
+#define A3_MENGER_KERNELS(target, isa)	\
+A3_MENGER_KERNEL(target, isa, Shader, 0, depthAny)	\
+A3_MENGER_KERNEL(target, isa, Shader, 1, 1)	\
+A3_MENGER_KERNEL(target, isa, Shader, 2, 2)	\
+A3_MENGER_KERNEL(target, isa, Shader, 3, 3)	\
+A3_MENGER_KERNEL(target, isa, Shader, 4, 4)	\
+A3_MENGER_KERNEL(target, isa, Classic, 0, depthAny)	\
+A3_MENGER_KERNEL(target, isa, Classic, 1, 1)	\
+A3_MENGER_KERNEL(target, isa, Classic, 2, 2)	\
+A3_MENGER_KERNEL(target, isa, Classic, 3, 3)	\
+A3_MENGER_KERNEL(target, isa, Classic, 4, 4)
+#define A3_MENGER_KERNEL_ROW(isa)	\
+	{	\
+		{ a3fractalMengerSpan_##isa##_Shader0, a3fractalMengerSpan_##isa##_Shader1, a3fractalMengerSpan_##isa##_Shader2, a3fractalMengerSpan_##isa##_Shader3, a3fractalMengerSpan_##isa##_Shader4 },	\
+		{ a3fractalMengerSpan_##isa##_Classic0, a3fractalMengerSpan_##isa##_Classic1, a3fractalMengerSpan_##isa##_Classic2, a3fractalMengerSpan_##isa##_Classic3, a3fractalMengerSpan_##isa##_Classic4 },	\
+	}
+
+#define a3menger_untargeted
+A3_MENGER_KERNELS(a3menger_untargeted, scalar)
+#if A3_FRACTAL_X86
+A3_MENGER_KERNELS(A3_FRACTAL_TARGET("sse2"), sse2)
+A3_MENGER_KERNELS(A3_FRACTAL_TARGET("avx2"), avx2)
+#if A3_FRACTAL_AVX512
+A3_MENGER_KERNELS(A3_FRACTAL_TARGET("avx512f"), avx512)
+#endif	// A3_FRACTAL_AVX512
+#endif	// A3_FRACTAL_X86
+
+// kernel table, indexed by instruction set, variant and depth up to
+//	'a3fractal_mengerUnrolled', or 0 for any other depth
+static const a3_FractalMengerSpanFunc a3fractalMengerSpanFuncs[a3fractal_isaCount][a3fractal_mengerVariantCount][a3fractal_mengerUnrolled + 1] = {
+	A3_MENGER_KERNEL_ROW(scalar),
+#if A3_FRACTAL_X86
+	A3_MENGER_KERNEL_ROW(sse2),
+	A3_MENGER_KERNEL_ROW(avx2),
+#if A3_FRACTAL_AVX512
+	A3_MENGER_KERNEL_ROW(avx512),
+#else	// !A3_FRACTAL_AVX512
+	A3_MENGER_KERNEL_ROW(avx2),
+#endif	// A3_FRACTAL_AVX512
+#else	// !A3_FRACTAL_X86
+	A3_MENGER_KERNEL_ROW(scalar),
+	A3_MENGER_KERNEL_ROW(scalar),
+	A3_MENGER_KERNEL_ROW(scalar),
+#endif	// A3_FRACTAL_X86
+};
+
+#undef a3menger_untargeted
+#undef A3_MENGER_KERNEL_ROW
+#undef A3_MENGER_KERNELS
+#undef A3_MENGER_KERNEL
+
+
+//-----------------------------------------------------------------------------
+// distance cache
+
+// sponge a cache holds, pointed to by its field's user pointer
+typedef struct a3_MengerField
+{
+	unsigned int depth;
+	a3_FractalMengerVariant variant;
+} a3_MengerField;
+
+#define A3_MENGER_FIELDS(variant)	\
+	{	\
+		{ 0, variant }, { 1, variant }, { 2, variant }, { 3, variant }, { 4, variant }, { 5, variant }, { 6, variant },	\
+		{ 7, variant }, { 8, variant }, { 9, variant }, { 10, variant }, { 11, variant }, { 12, variant },	\
+	}
+static const a3_MengerField a3mengerFields[a3fractal_mengerVariantCount][a3fractal_mengerDepthMax + 1] = {
+	A3_MENGER_FIELDS(a3fractal_mengerVariantShader),
+	A3_MENGER_FIELDS(a3fractal_mengerVariantClassic),
+};
+#undef A3_MENGER_FIELDS
+
+static float a3fractalMengerSpongeField(void *user, float x, float y, float z)
+{
+	const a3_MengerField *field = (const a3_MengerField *)user;
+	return a3mengerSponge_scalar(x, y, z, field->depth, field->variant, 0, 0.0f);
+}
+
+int a3fractalMengerCacheCreate(a3_FractalBrickCache **cache_out, unsigned int depth, a3_FractalMengerVariant variant, float spacing, unsigned long long budget)
+{
+	a3_FractalBrickDesc desc[1] = { 0 };
+	if (cache_out && (unsigned int)variant < a3fractal_mengerVariantCount && spacing >= 0.0f)
+	{
+		// one sample of padding around 'objBox'
+		depth = depth ? a3minimum(depth, a3fractal_mengerDepthMax) : a3fractal_mengerLevels;
+		desc->field = a3fractalMengerSpongeField;
+		desc->user = (void *)(a3mengerFields[variant] + depth);
+		desc->spacing = spacing > 0.0f ? spacing : a3menger_spacing;
+		desc->boundsMin[0] = desc->boundsMin[1] = desc->boundsMin[2] = -a3mengerBoxSize[variant] - desc->spacing;
+		desc->boundsMax[0] = desc->boundsMax[1] = desc->boundsMax[2] = a3mengerBoxSize[variant] + desc->spacing;
+		desc->lipschitz = a3mengerLipschitz[variant];
+		desc->budget = budget;
+		return a3fractalBrickCacheCreate(cache_out, desc);
+	}
+	return -1;
+}
+
+//-----------------------------------------------------------------------------
+// compiled scene
+
+int a3fractalMengerSceneBuild(a3_FractalSDFScene *scene, unsigned int depth, a3_FractalMengerVariant variant)
+{
+	float b, s;
+	int plane, sponge, cut, level;
+	unsigned int m;
+	if (scene && depth <= a3fractal_mengerDepthMax && (unsigned int)variant < a3fractal_mengerVariantCount)
+	{
+		if (!depth)
+			depth = a3fractal_mengerLevels;
+		b = a3mengerBoxSize[variant];
+		plane = a3fractalSDFPlane(scene, 0.0f, 1.0f, 0.0f, -10.0f, a3fractal_mengerFloor);
+		sponge = a3fractalSDFBox(scene, b, b, b, a3fractal_mengerSponge);
+
+		// one cell's solid, shared by every level, in thirds of a cell as
+		//	the level above divides it: for the shader, the cross at
+		//	1 - 4|a| in its own units, as the shader leaves it; for the
+		//	classic sponge, the three bars at |1 - 3|a||
+		if (variant == a3fractal_mengerVariantClassic)
+		{
+			cut = a3fractalSDFUnion(scene,
+				a3fractalSDFBox(scene, a3menger_arm, 1.0f, 1.0f, a3fractal_mengerSponge),
+				a3fractalSDFUnion(scene,
+					a3fractalSDFBox(scene, 1.0f, a3menger_arm, 1.0f, a3fractal_mengerSponge),
+					a3fractalSDFBox(scene, 1.0f, 1.0f, a3menger_arm, a3fractal_mengerSponge)));
+			cut = a3fractalSDFMirror(scene, a3fractalSDFScale(scene, a3fractalSDFWarp(scene, a3fractalSDFMirror(scene, cut), -1.0f, 1.0f, 1.0f, 1.0f), a3menger_third));
+		}
+		else
+		{
+			cut = a3fractalSDFUnion(scene,
+				a3fractalSDFBox(scene, a3menger_arm, 2.0f, 2.0f, a3fractal_mengerSponge),
+				a3fractalSDFUnion(scene,
+					a3fractalSDFBox(scene, 2.0f, a3menger_arm, 2.0f, a3fractal_mengerSponge),
+					a3fractalSDFBox(scene, 2.0f, 2.0f, a3menger_arm, a3fractal_mengerSponge)));
+			cut = a3fractalSDFMirror(scene, a3fractalSDFScale(scene, a3fractalSDFWarp(scene, cut, -4.0f * a3menger_third, 1.0f, 1.0f, 1.0f), a3menger_third));
+		}
+
+		// each level folds space into cells 2 units across at its scale
+		for (m = 0, s = a3mengerFirstScale[variant]; m < depth; ++m, s *= 3.0f)
+		{
+			level = a3fractalSDFScale(scene, a3fractalSDFRepeat(scene, cut, 2.0f), 1.0f / s);
+			sponge = a3fractalSDFIntersect(scene, sponge, level);
+		}
+		return a3fractalSDFUnion(scene, plane, sponge);
+	}
+	return -1;
+}
+
+// march 'count' rays through a compiled scene together: each step
+//	gathers the points of the rays still moving and evaluates them in one
+//	batch, as do the normals after; returns scene evaluations made
+static unsigned long long a3fractalMengerSpanProgram(const float *eye, a3_MengerSpan *span, const unsigned int count, const float omega, const a3_FractalSDFProgram *program, const a3_FractalISA isa, a3_FractalSDFStats *stats)
+{
+	float x[a3menger_span * 3], y[a3menger_span * 3], z[a3menger_span * 3], batch[a3menger_span * 3];
+	float d[a3menger_span], f[a3menger_span], w[a3menger_span];
+	float dPrev[a3menger_span], fPrev[a3menger_span];
+	unsigned int id[a3menger_span], idPrev[a3menger_span], batchId[a3menger_span];
+	unsigned int active[a3menger_span];
+	const float e = a3fractal_mengerNormal;
+	float nx, ny, nz, len;
+	unsigned long long evaluations = 0;
+	unsigned int i, j, n, live;
+
+	for (i = 0; i < count; ++i)
+	{
+		d[i] = a3menger_first;
+		f[i] = span->start[i];
+		w[i] = omega;
+		id[i] = a3fractal_mengerFloor;
+		span->steps[i] = 0;
+		active[i] = i;
+	}
+	for (n = count; n; n = live)
+	{
+		// drop the rays that stopped, step the rest
+		for (j = live = 0; j < n; ++j)
+		{
+			i = active[j];
+			if (fabsf(d[i]) < a3fractal_mengerEpsilon || f[i] > a3fractal_mengerFar * 0.5f || span->steps[i] >= a3fractal_mengerSteps)
+				continue;
+			fPrev[i] = f[i];
+			dPrev[i] = d[i];
+			idPrev[i] = id[i];
+			f[i] += w[i] * d[i];
+			x[live] = eye[0] + span->dirX[i] * f[i];
+			y[live] = eye[1] + span->dirY[i] * f[i];
+			z[live] = eye[2] + span->dirZ[i] * f[i];
+			active[live++] = i;
+		}
+		a3fractalSDFEvaluate(program, x, y, z, live, batch, batchId, isa, stats);
+		evaluations += live;
+		for (j = 0; j < live; ++j)
+		{
+			i = active[j];
+			d[i] = batch[j];
+			id[i] = batchId[j];
+			++span->steps[i];
+			if (w[i] > 1.0f && fabsf(d[i]) + fabsf(dPrev[i]) < f[i] - fPrev[i])
+			{
+				f[i] = fPrev[i];
+				d[i] = dPrev[i];
+				id[i] = idPrev[i];
+				w[i] = 1.0f;
+			}
+		}
+	}
+
+	// backward differences for every ray that will be shaded
+	for (i = n = 0; i < count; ++i)
+	{
+		span->dist[i] = f[i];
+		span->id[i] = (unsigned char)a3minimum(id[i], 255u);
+		if (f[i] < a3fractal_mengerFar)
+		{
+			x[n * 3] = eye[0] + span->dirX[i] * f[i];
+			y[n * 3] = eye[1] + span->dirY[i] * f[i];
+			z[n * 3] = eye[2] + span->dirZ[i] * f[i];
+			x[n * 3 + 1] = x[n * 3 + 2] = x[n * 3];
+			y[n * 3 + 1] = y[n * 3 + 2] = y[n * 3];
+			z[n * 3 + 1] = z[n * 3 + 2] = z[n * 3];
+			x[n * 3] -= e;
+			y[n * 3 + 1] -= e;
+			z[n * 3 + 2] -= e;
+			active[n++] = i;
+		}
+	}
+	a3fractalSDFEvaluate(program, x, y, z, n * 3, batch, 0, isa, stats);
+	evaluations += n * 3;
+	for (j = 0; j < n; ++j)
+	{
+		i = active[j];
+		nx = d[i] - batch[j * 3];
+		ny = d[i] - batch[j * 3 + 1];
+		nz = d[i] - batch[j * 3 + 2];
+		len = sqrtf(nx * nx + ny * ny + nz * nz);
+		if (len > 0.0f)
+		{
+			nx = nx / len;
+			ny = ny / len;
+			nz = nz / len;
+		}
+		span->normalX[i] = nx;
+		span->normalY[i] = ny;
+		span->normalZ[i] = nz;
+	}
+	return evaluations;
+}
+
+
+//-----------------------------------------------------------------------------
+// exact traversal
+
+// a stretch of ray inside the solid carved down to 'level', entered
+//	through a face on 'axis', or 3 if it begins where the ray does
+typedef struct a3_MengerInterval
+{
+	double t0, t1;
+	unsigned int level, axis;
+} a3_MengerInterval;
+
+// clip a stretch of ray to a box, keeping the axis of the face it enters
+static int a3fractalMengerClip(const double *o, const double *d, const double *bmin, const double *bmax, a3_MengerInterval *run)
+{
+	double ta, tb, tt;
+	unsigned int k;
+	for (k = 0; k < 3; ++k)
+	{
+		if (d[k] == 0.0)
+		{
+			if (o[k] < bmin[k] || o[k] > bmax[k])
+				return 0;
+			continue;
+		}
+		ta = (bmin[k] - o[k]) / d[k];
+		tb = (bmax[k] - o[k]) / d[k];
+		if (ta > tb)
+		{
+			tt = ta;
+			ta = tb;
+			tb = tt;
+		}
+		if (ta > run->t0)
+		{
+			run->t0 = ta;
+			run->axis = k;
+		}
+		if (tb < run->t1)
+			run->t1 = tb;
+	}
+	return (run->t0 < run->t1);
+}
+
+float a3fractalMengerTrace(const float *origin, const float *dir, float tMin, float tMax, unsigned int depth, a3_FractalMengerVariant variant, float pixel, float *normal_out_opt, unsigned int *id_out_opt, unsigned int *cells_out_opt)
+{
+	a3_MengerInterval stack[a3menger_stack], found[a3menger_found], cur, run;
+	double o[3], d[3], bmin[3], bmax[3], h, t, tc, tExit, te, hit = tMax, b, shift;
+	int idx[3];
+	unsigned int top = 0, count, i, k, axis, exitAxis, middle, hitAxis = 3, cells = 0, id = a3fractal_mengerSponge;
+
+	if ((unsigned int)variant >= a3fractal_mengerVariantCount)
+		variant = a3fractal_mengerVariantShader;
+	depth = depth ? a3minimum(depth, a3fractal_mengerDepthMax) : a3fractal_mengerLevels;
+
+	// the classic sponge's cells are aligned to its corner, the shader's
+	//	to the origin
+	b = (double)a3mengerBoxSize[variant];
+	shift = variant == a3fractal_mengerVariantClassic ? b : 0.0;
+	for (k = 0; k < 3; ++k)
+	{
+		o[k] = (double)origin[k] + shift;
+		d[k] = (double)dir[k];
+	}
+
+	// the floor plane first; the sponge only matters in front of it
+	if (d[1] < 0.0)
+	{
+		t = (shift - 10.0 - o[1]) / d[1];
+		if (t >= tMin && t < hit)
+		{
+			hit = t;
+			hitAxis = 1;
+			id = a3fractal_mengerFloor;
+		}
+	}
+
+	// 'objBox'
+	run.t0 = tMin;
+	run.t1 = hit;
+	run.level = 0;
+	run.axis = 3;
+	bmin[0] = bmin[1] = bmin[2] = shift - b;
+	bmax[0] = bmax[1] = bmax[2] = shift + b;
+	if (a3fractalMengerClip(o, d, bmin, bmax, &run))
+		stack[top++] = run;
+
+	// depth first, nearest first: the first stretch that survives every
+	//	level is the nearest hit, as every stretch still on the stack
+	//	starts no earlier and anything a sibling shares with it has been
+	//	searched already
+	while (top)
+	{
+		// level 'l' carves cells of edge 2 / 3^l; with falloff, a level
+		//	that carves less than a pixel is not descended into
+		cur = stack[--top];
+		h = 2.0 / pow(3.0, (double)cur.level);
+		if (cur.level == depth || (pixel > 0.0f && (double)a3mengerDetail[variant] * h * 0.5 < (double)pixel * cur.t0))
+		{
+			hit = cur.t0;
+			hitAxis = cur.axis;
+			id = a3fractal_mengerSponge;
+			break;
+		}
+
+		// the shader's sponge folds space into the cells; within a cell,
+		//	'objCross' keeps the three arms where at least two coordinates
+		//	lie in the middle three quarters of the cell; the classic one
+		//	keeps the cells that are not in the middle third of their
+		//	parent along two axes or more
+		count = 0;
+		axis = cur.axis;
+		for (t = cur.t0; t < cur.t1 && count + 3 <= a3menger_found; t = tExit)
+		{
+			++cells;
+			tc = t + h * 1.0e-6;
+			tExit = cur.t1;
+			exitAxis = 3;
+			for (k = 0; k < 3; ++k)
+				idx[k] = (int)floor((o[k] + d[k] * tc) / h);
+			for (k = 0; k < 3; ++k)
+				if (d[k] != 0.0)
+				{
+					te = ((double)(idx[k] + (d[k] > 0.0 ? 1 : 0)) * h - o[k]) / d[k];
+					if (te < tExit)
+					{
+						tExit = te;
+						exitAxis = k;
+					}
+				}
+			if (tExit <= t)
+				tExit = tc;
+
+			if (variant == a3fractal_mengerVariantClassic)
+			{
+				// the whole cell, entered where the last one was left
+				for (k = 0, middle = 0; k < 3; ++k)
+					middle += (((idx[k] % 3) + 3) % 3 == 1);
+				if (middle <= 1)
+				{
+					run.t0 = t;
+					run.t1 = tExit;
+					run.level = cur.level + 1;
+					run.axis = axis;
+					found[count++] = run;
+				}
+				axis = exitAxis;
+				continue;
+			}
+
+			for (i = 0; i < 3; ++i)
+			{
+				for (k = 0; k < 3; ++k)
+				{
+					bmin[k] = (double)idx[k] * h + h * 0.125;
+					bmax[k] = (double)idx[k] * h + h * 0.875;
+				}
+				bmin[i] = (double)idx[i] * h;
+				bmax[i] = bmin[i] + h;
+				run.t0 = t;
+				run.t1 = tExit;
+				run.level = cur.level + 1;
+				run.axis = axis;
+				if (a3fractalMengerClip(o, d, bmin, bmax, &run))
+				{
+					// keep the arms of a cell in order of entry
+					for (k = count++; k > 0 && found[k - 1].t0 > run.t0; --k)
+						found[k] = found[k - 1];
+					found[k] = run;
+				}
+			}
+
+			// stretches that begin on a cell wall are inside on both sides,
+			//	so they only ever continue the previous cell's
+			axis = 3;
+		}
+
+		// nearest on top
+		for (i = count; i > 0 && top < a3menger_stack; --i)
+			stack[top++] = found[i - 1];
+	}
+
+	if (normal_out_opt)
+	{
+		for (k = 0; k < 3; ++k)
+			normal_out_opt[k] = hitAxis == k ? (d[k] > 0.0 ? -1.0f : 1.0f) : 0.0f;
+		if (hitAxis == 3)
+			for (k = 0; k < 3; ++k)
+				normal_out_opt[k] = -dir[k];
+	}
+	if (id_out_opt)
+		*id_out_opt = id;
+	if (cells_out_opt)
+		*cells_out_opt = cells;
+	return (float)hit;
+}
+
+// trace 'count' rays exactly
+static void a3fractalMengerSpanExact(const float *eye, a3_MengerSpan *span, const unsigned int count, const unsigned int depth, const a3_FractalMengerVariant variant, const float pixel)
+{
+	float dir[3], normal[3];
+	unsigned int i, id;
+	for (i = 0; i < count; ++i)
+	{
+		dir[0] = span->dirX[i];
+		dir[1] = span->dirY[i];
+		dir[2] = span->dirZ[i];
+		span->dist[i] = a3fractalMengerTrace(eye, dir, span->start[i], a3fractal_mengerFar, depth, variant, pixel, normal, &id, span->steps + i);
+		span->id[i] = (unsigned char)id;
+		span->normalX[i] = normal[0];
+		span->normalY[i] = normal[1];
+		span->normalZ[i] = normal[2];
+	}
+}
+
+
+//-----------------------------------------------------------------------------
+// shading
+
+// 'floorColor' and 'primitiveColor'
+static void a3fractalMengerSurfaceColor(const unsigned int id, const float x, const float z, float *rgb_out)
+{
+	static const float checker[4][3] = {
+		{ 0.3f, 0.2f, 0.0f }, { 1.0f, 1.0f, 1.0f }, { 1.0f, 1.0f, 1.0f }, { 0.4f, 0.1f, 0.2f },
+	};
+	const float *c;
+	float u, v;
+	if (id == a3fractal_mengerFloor)
+	{
+		u = x * 0.2f;
+		v = z * 0.2f;
+		c = checker[(u - floorf(u) > 0.2f ? 2 : 0) + (v - floorf(v) > 0.2f ? 1 : 0)];
+		rgb_out[0] = c[0];
+		rgb_out[1] = c[1];
+		rgb_out[2] = c[2];
+	}
+	else
+	{
+		rgb_out[0] = 0.6f;
+		rgb_out[1] = 0.6f;
+		rgb_out[2] = 0.8f;
+	}
+}
+
+// color of one marched ray
+static void a3fractalMengerShade(const float *eye, const a3_MengerSpan *span, const unsigned int n, unsigned char *rgba_out)
+{
+	float p[3], rgb[3], b, spec, fog, c;
+	unsigned int k;
+	if (span->dist[n] < a3fractal_mengerFar)
+	{
+		// diffuse toward the eye, which is along -dir, plus a tight
+		//	highlight, fading with distance
+		p[0] = eye[0] + span->dirX[n] * span->dist[n];
+		p[1] = eye[1] + span->dirY[n] * span->dist[n];
+		p[2] = eye[2] + span->dirZ[n] * span->dist[n];
+		a3fractalMengerSurfaceColor(span->id[n], p[0], p[2], rgb);
+		b = -(span->normalX[n] * span->dirX[n] + span->normalY[n] * span->dirY[n] + span->normalZ[n] * span->dirZ[n]);
+		spec = b > 0.0f ? powf(b, 60.0f) : 0.0f;
+		fog = 1.0f - span->dist[n] * 0.01f;
+		for (k = 0; k < 3; ++k)
+		{
+			c = (b * rgb[k] + spec) * fog;
+			rgba_out[k] = (unsigned char)(a3clamp(0.0f, 1.0f, c) * 255.0f + 0.5f);
+		}
+	}
+	else
+	{
+		// gone too far
+		rgba_out[0] = 0;
+		rgba_out[1] = 255;
+		rgba_out[2] = 255;
+	}
+	rgba_out[3] = 255;
+}
+
+
+//-----------------------------------------------------------------------------
+// camera
+
+static int a3fractalMengerCameraInit(a3_MengerCamera *camera, const a3_FractalMengerDesc *desc)
+{
+	// look from 'prp' at the origin, +Y up, screen one unit out
+	float vpn[3], len;
+	unsigned int i;
+	len = sqrtf(desc->eye[0] * desc->eye[0] + desc->eye[1] * desc->eye[1] + desc->eye[2] * desc->eye[2]);
+	if (len <= 0.0f)
+		return -1;
+	vpn[0] = -desc->eye[0] / len;
+	vpn[1] = -desc->eye[1] / len;
+	vpn[2] = -desc->eye[2] / len;
+	camera->u[0] = vpn[2];
+	camera->u[1] = 0.0f;
+	camera->u[2] = -vpn[0];
+	len = sqrtf(camera->u[0] * camera->u[0] + camera->u[2] * camera->u[2]);
+	if (len > 0.0f)
+	{
+		camera->u[0] /= len;
+		camera->u[2] /= len;
+	}
+	else
+		camera->u[0] = 1.0f;
+	camera->v[0] = vpn[1] * camera->u[2] - vpn[2] * camera->u[1];
+	camera->v[1] = vpn[2] * camera->u[0] - vpn[0] * camera->u[2];
+	camera->v[2] = vpn[0] * camera->u[1] - vpn[1] * camera->u[0];
+
+	// screen center 'vcv', already offset by the scaled eye the direction
+	//	is taken from
+	for (i = 0; i < 3; ++i)
+		camera->center[i] = desc->eye[i] + vpn[i] - desc->eye[i] * (float)desc->iter;
+	// the screen spans the frame; this image is the part at the offset
+	camera->width = (float)(desc->frameWidth ? desc->frameWidth : desc->width);
+	camera->height = (float)(desc->frameHeight ? desc->frameHeight : desc->height);
+	camera->aspect = desc->aspect > 0.0f ? desc->aspect : camera->width / camera->height;
+	camera->offsetX = (float)desc->offsetX;
+	camera->offsetY = (float)desc->offsetY;
+
+	// a pixel's angle, near enough, for falloff
+	len = sqrtf(camera->center[0] * camera->center[0] + camera->center[1] * camera->center[1] + camera->center[2] * camera->center[2]);
+	camera->pixel = len > 0.0f ? 2.0f / (camera->height * len) : 0.0f;
+	return 1;
+}
+
+// unit direction through a point on the image, in pixels
+static void a3fractalMengerCameraRay(const a3_MengerCamera *camera, const float x, const float y, float *dir_out)
+{
+	const float sx = -1.0f + 2.0f * ((x + camera->offsetX) / camera->width), sy = -1.0f + 2.0f * ((y + camera->offsetY) / camera->height);
+	float len;
+	unsigned int k;
+	for (k = 0; k < 3; ++k)
+		dir_out[k] = camera->center[k] + sx * camera->u[k] * camera->aspect + sy * camera->v[k];
+	len = sqrtf(dir_out[0] * dir_out[0] + dir_out[1] * dir_out[1] + dir_out[2] * dir_out[2]);
+	dir_out[0] /= len;
+	dir_out[1] /= len;
+	dir_out[2] /= len;
+}
+
+// cone prepass: distance along every ray through a rectangle of the image
+//	up to which the scene is empty
+static float a3fractalMengerConeStart(const a3_MengerCamera *camera, const float *eye, const float x0, const float y0, const float x1, const float y1, const unsigned int depth, const int variant, const float pixel, const a3_FractalSDFProgram *program_opt, unsigned long long *evaluations)
+{
+	// a cone around the ray through the center holds the rays through the
+	//	corners, so every ray through the rectangle; a sphere of radius d
+	//	around the axis point at t holds the cone's points up to axial
+	//	t + (d - t k) / (1 + k), k being the tangent of the half angle
+	float axis[3], corner[3], cosA = 1.0f, c, k, t, d, step, ratio = 0.0f;
+	unsigned int i;
+	a3fractalMengerCameraRay(camera, 0.5f * (x0 + x1), 0.5f * (y0 + y1), axis);
+	for (i = 0; i < 4; ++i)
+	{
+		a3fractalMengerCameraRay(camera, (i & 1) ? x1 : x0, (i & 2) ? y1 : y0, corner);
+		c = axis[0] * corner[0] + axis[1] * corner[1] + axis[2] * corner[2];
+		cosA = a3minimum(cosA, c);
+	}
+	if (cosA <= 0.0f)
+		return a3fractal_mengerStart;
+	k = sqrtf(1.0f - cosA * cosA) / cosA;
+
+	// a ray's axial distance is never more than its own, so the rays are
+	//	clear from their start to wherever the cone is clear
+	t = a3fractal_mengerStart * cosA;
+	for (i = 0; i < a3fractal_mengerSteps && t <= a3fractal_mengerFar * 0.5f; ++i)
+	{
+		corner[0] = eye[0] + axis[0] * t;
+		corner[1] = eye[1] + axis[1] * t;
+		corner[2] = eye[2] + axis[2] * t;
+		if (program_opt)
+			a3fractalSDFEvaluate(program_opt, corner, corner + 1, corner + 2, 1, &d, 0, a3fractal_isaScalar, 0);
+		else
+		{
+			if (pixel > 0.0f)
+				ratio = a3mengerDetail[variant] / (t * pixel);
+			d = a3mengerScene_scalar(corner[0], corner[1], corner[2], 0, depth, variant, pixel > 0.0f, ratio);
+		}
+		++*evaluations;
+		step = (d - t * k) / (1.0f + k);
+		if (step < a3fractal_mengerEpsilon)
+			break;
+		t += step;
+	}
+
+	// rays take the shader's seed step first, landing on 't', and at least
+	//	one real step before giving up past half the far distance
+	t = a3minimum(t, a3fractal_mengerFar * 0.5f);
+	return a3maximum(a3fractal_mengerStart, t - a3menger_first);
+}
+
+
+//-----------------------------------------------------------------------------
+// render
+
+unsigned int a3fractalMengerDepthForIter(int iter)
+{
+	return iter > 0 ? a3minimum((unsigned int)iter, a3fractal_mengerDepthMax) : a3fractal_mengerLevels;
+}
+
+int a3fractalMengerRenderRect(const a3_FractalMengerDesc *desc, unsigned int x0, unsigned int y0, unsigned int x1, unsigned int y1, a3_FractalMengerStats *stats_out_opt)
+{
+	a3_MengerSpan span[1];
+	a3_MengerCamera camera[1];
+	a3_FractalMengerStats stats = { 0 };
+	float dir[3], start, omega, pixel;
+	unsigned long long marched = 0, skipped = 0;
+	unsigned int bx, by, bx1, by1, px, py, j, n, col, row, packW, packH, index, depth;
+	int gradient;
+	a3_FractalISA isa, best;
+	a3_FractalMengerVariant variant;
+	a3_FractalMengerSpanFunc march;
+	a3_FractalBrickCache *cache;
+
+	if (desc && desc->width && desc->height)
+	{
+		x1 = a3minimum(x1, desc->width);
+		y1 = a3minimum(y1, desc->height);
+		if (x0 >= x1 || y0 >= y1)
+			return 0;
+		if (a3fractalMengerCameraInit(camera, desc) < 0)
+			return -1;
+
+		best = a3fractalDetectISA();
+		isa = desc->isa;
+		if (isa == a3fractal_isaAuto || isa > best)
+			isa = best;
+		depth = desc->depth ? a3minimum(desc->depth, a3fractal_mengerDepthMax) : a3fractal_mengerLevels;
+		variant = (unsigned int)desc->variant < a3fractal_mengerVariantCount ? desc->variant : a3fractal_mengerVariantShader;
+		pixel = desc->falloff && !desc->program_opt ? camera->pixel : 0.0f;
+		gradient = desc->normal == a3fractal_mengerNormalGradient && !desc->program_opt;
+		march = a3fractalMengerSpanFuncs[isa][variant][depth <= a3fractal_mengerUnrolled ? depth : 0];
+		cache = desc->march != a3fractal_mengerMarchExact && !desc->program_opt ? desc->cache_opt : 0;
+		packW = a3mengerPacketW[isa];
+		packH = a3mengerPacketH[isa];
+		omega = 1.0f;
+		if (desc->march != a3fractal_mengerMarchShader)
+			omega = desc->relaxation > 0.0f ? desc->relaxation : a3fractal_mengerRelaxation;
+
+		// blocks aligned to the image, one span each
+		for (by = y0; by < y1; by = by1)
+		{
+			by1 = a3minimum((by / a3fractal_mengerConeBlock + 1) * a3fractal_mengerConeBlock, y1);
+			for (bx = x0; bx < x1; bx = bx1)
+			{
+				bx1 = a3minimum((bx / a3fractal_mengerConeBlock + 1) * a3fractal_mengerConeBlock, x1);
+				start = a3fractal_mengerStart;
+				if (desc->march == a3fractal_mengerMarchCone)
+					start = a3fractalMengerConeStart(camera, desc->eye, (float)bx, (float)by, (float)bx1, (float)by1, depth, variant, pixel, desc->program_opt, &stats.prepass);
+
+				// fill span packet by packet, clamping lanes past the edge
+				for (py = by, n = 0; py < by1; py += packH)
+					for (px = bx; px < bx1; px += packW)
+						for (j = 0; j < packW * packH; ++j, ++n)
+						{
+							col = a3minimum(px + j % packW, bx1 - 1);
+							row = a3minimum(py + j / packW, by1 - 1);
+							a3fractalMengerCameraRay(camera, (float)col + 0.5f, (float)row + 0.5f, dir);
+							span->dirX[n] = dir[0];
+							span->dirY[n] = dir[1];
+							span->dirZ[n] = dir[2];
+							span->start[n] = start;
+						}
+				if (desc->march == a3fractal_mengerMarchExact)
+					a3fractalMengerSpanExact(desc->eye, span, n, depth, variant, pixel);
+				else if (desc->program_opt)
+					marched += a3fractalMengerSpanProgram(desc->eye, span, n, omega, desc->program_opt, isa, &stats.program);
+				else
+					march(desc->eye, span, n, omega, gradient, cache ? 0.0f : pixel, depth, cache, &stats.cache);
+
+				// outputs
+				for (py = by, n = 0; py < by1; py += packH)
+					for (px = bx; px < bx1; px += packW)
+						for (j = 0; j < packW * packH; ++j, ++n)
+						{
+							col = px + j % packW;
+							row = py + j / packW;
+							if (col >= bx1 || row >= by1)
+								continue;
+							index = row * desc->width + col;
+							stats.steps += span->steps[n];
+							if (cache)
+								skipped += span->skipped[n];
+							if (span->dist[n] < a3fractal_mengerFar)
+								++stats.hits;
+							if (desc->steps_out_opt)
+								desc->steps_out_opt[index] = span->steps[n];
+							if (desc->depth_out_opt)
+								desc->depth_out_opt[index] = span->dist[n];
+							if (desc->rgba_out_opt)
+								a3fractalMengerShade(desc->eye, span, n, desc->rgba_out_opt + index * 4);
+						}
+			}
+		}
+		if (desc->march != a3fractal_mengerMarchExact)
+			stats.evaluations = desc->program_opt ? marched + stats.prepass
+				: stats.steps - skipped + stats.prepass
+				+ (gradient ? 1 : 3) * (unsigned long long)stats.hits;
+
+		if (stats_out_opt)
+		{
+			stats_out_opt->hits += stats.hits;
+			stats_out_opt->steps += stats.steps;
+			stats_out_opt->prepass += stats.prepass;
+			stats_out_opt->evaluations += stats.evaluations;
+			stats_out_opt->cache.lookups += stats.cache.lookups;
+			stats_out_opt->cache.hits += stats.cache.hits;
+			stats_out_opt->cache.baked += stats.cache.baked;
+			stats_out_opt->cache.evicted += stats.cache.evicted;
+			stats_out_opt->cache.failed += stats.cache.failed;
+			stats_out_opt->program.groups += stats.program.groups;
+			stats_out_opt->program.instructions += stats.program.instructions;
+			stats_out_opt->program.pruned += stats.program.pruned;
+		}
+		return (int)((x1 - x0) * (y1 - y0));
+	}
+	return -1;
+}
+
+static void a3fractalMengerTask(void *args, unsigned int x0, unsigned int y0, unsigned int x1, unsigned int y1, unsigned int workerIndex)
+{
+	const a3_MengerPass *pass = (const a3_MengerPass *)args;
+	a3fractalMengerRenderRect(pass->desc, x0, y0, x1, y1, pass->counters + workerIndex);
+}
+
+int a3fractalMengerRender(const a3_FractalMengerDesc *desc, a3_ThreadPool *pool_opt, a3_FractalMengerStats *stats_out_opt)
+{
+	a3_FractalMengerStats stats = { 0 };
+	a3_MengerPass pass[1];
+	unsigned int workers, i;
+
+	if (desc && desc->width && desc->height)
+	{
+		workers = a3threadPoolGetWorkerCount(pool_opt) + 1;
+		pass->counters = (a3_FractalMengerStats *)calloc(workers, sizeof(a3_FractalMengerStats));
+		if (!pass->counters)
+			return 0;
+		pass->desc = desc;
+		if (a3threadPoolParallelFor2D(pool_opt, 0, a3fractalMengerTask, pass, desc->width, desc->height, a3menger_tile, a3menger_tile) < 0)
+		{
+			free(pass->counters);
+			return 0;
+		}
+
+		for (i = 0; i < workers; ++i)
+		{
+			stats.hits += pass->counters[i].hits;
+			stats.steps += pass->counters[i].steps;
+			stats.prepass += pass->counters[i].prepass;
+			stats.evaluations += pass->counters[i].evaluations;
+			stats.cache.lookups += pass->counters[i].cache.lookups;
+			stats.cache.hits += pass->counters[i].cache.hits;
+			stats.cache.baked += pass->counters[i].cache.baked;
+			stats.cache.evicted += pass->counters[i].cache.evicted;
+			stats.cache.failed += pass->counters[i].cache.failed;
+			stats.program.groups += pass->counters[i].program.groups;
+			stats.program.instructions += pass->counters[i].program.instructions;
+			stats.program.pruned += pass->counters[i].program.pruned;
+		}
+		if (stats_out_opt)
+			*stats_out_opt = stats;
+
+		free(pass->counters);
+		return (int)(desc->width * desc->height);
+	}
+	return -1;
+}
+
+
+//-----------------------------------------------------------------------------
@@ -0,0 +1,337 @@
+/*
+	animal3D SDK: Minimal 3D Animation Framework
+	Fractals Midterm: CPU fractal engines
+
+	a3_DemoFractalMenger.h
+	CPU raymarcher for the Menger sponge shader.
+
+	Renders the scene of "drawMenger_fs4x.glsl" without a GPU: the same
+	checkered floor and 3-level sponge, the same camera construction from
+	the view vector and 'uIter', the same march (start at 1, at most 256
+	steps, stop within 0.001 of a surface or past 50 units) and the same
+	finite-difference shading. Rays are marched in packets of 2x2, 4x2 or
+	4x4 neighboring pixels using SSE2, AVX2 or AVX-512, selected at
+	runtime, with a scalar fallback; a packet keeps stepping until all of
+	its rays have stopped, and since neighboring rays fold through the
+	same cells they take nearly the same number of steps.
+
+	Besides the shader's march there are two cheaper ones. Relaxed sphere
+	tracing scales each step past the safe distance and, when the spheres
+	around consecutive points stop overlapping, backs up to the last safe
+	point and continues unrelaxed. Cone marching adds a prepass that
+	traces one cone per 8x8 block, wide enough to hold all of the block's
+	rays, and starts the block's rays where the cone first nears a
+	surface; rays toward the open floor skip most of their early steps.
+
+	The shader's normal takes three more distance evaluations per pixel.
+	The gradient normal instead evaluates the scene once on dual numbers,
+	which carry derivatives through every operation, and gets the exact
+	gradient of the distance at the hit point along with its value.
+
+	The exact mode does not march at all. The shader's sponge is the box
+	[-4, 4]^3 with, at each level, every cell reduced to the three arms
+	of a cross through its middle three quarters; the cells are 2 units
+	at the top and a third of that at each level below. A ray is clipped
+	to the box, walked cell by cell, clipped to each cell's arms, and the
+	stretches that remain are walked one level down, nearest first, on a
+	short explicit stack; the first stretch to survive every level is the
+	hit, with the face it entered through as the normal. There is no step
+	cap and no epsilon, so edges stay sharp at any depth, and rays the
+	shader gives up on past 50 units find the floor or the sky. The
+	classic sponge is traversed the same way, keeping the 20 of each
+	cell's 27 subcells that are not in a middle third along two axes.
+
+	The shader hard-codes three levels. Here the depth is chosen per
+	render, up to 12, along with a variant: the shader's lattice of beams,
+	or the classic sponge, a cube with the cross through its middle thirds
+	taken out at every level. Kernels are instantiated for each variant
+	at depths 1 to 4 so the level loop unrolls completely; deeper sponges
+	take a generic kernel. With detail falloff on, each level fades out
+	as its features shrink from 3 pixels across to 1 at the distance they
+	are evaluated at, and the levels below are skipped; far pixels stop
+	paying for detail they cannot show, without popping as they move.
+
+	The sponge never moves, so its distance can also be baked into a
+	sparse brick cache shared by every frame. A cached march looks up one
+	bound per packet and step, at the middle of the packet's moving rays,
+	and takes each ray's bound as that one less the most the sponge can
+	change between the two points; when every moving ray's bound is
+	larger than the cache's margin the packet steps by them without
+	evaluating the sponge. The floor is always evaluated, being a single
+	add. Bounds step shorter than distances, so rays the march gives up
+	on may stop at other points than without the cache.
+
+	The scene can also be given as a compiled distance field program, see
+	"a3_DemoFractalSDF.h"; the shader's scene, at any depth and either
+	variant, is built by 'a3fractalMengerSceneBuild'. A program march
+	steps all of a block's rays together, gathering the points of the
+	rays still moving and evaluating them in one batch, so new scenes
+	march on SIMD lanes without a kernel of their own.
+
+	Two things in the shader are not reproduced: its aspect ratio is the
+	texcoord quotient u/v, which changes across the screen, where here it
+	is constant; and its final color is multiplied by 'uMVP', which has no
+	meaning without a draw call.
+*/
+
+#ifndef __ANIMAL3D_DEMOFRACTALMENGER_H
+#define __ANIMAL3D_DEMOFRACTALMENGER_H
+
+
+#include "a3_DemoFractalEscape.h"
+#include "a3_DemoFractalBricks.h"
+#include "a3_DemoFractalSDF.h"
+
+
+//-----------------------------------------------------------------------------
+
+#ifdef __cplusplus
+extern "C"
+{
+#else	// !__cplusplus
+	typedef struct a3_FractalMengerDesc			a3_FractalMengerDesc;
+	typedef struct a3_FractalMengerStats		a3_FractalMengerStats;
+	typedef enum a3_FractalMengerMarch			a3_FractalMengerMarch;
+	typedef enum a3_FractalMengerNormal			a3_FractalMengerNormal;
+	typedef enum a3_FractalMengerVariant		a3_FractalMengerVariant;
+#endif	// __cplusplus
+
+
+//-----------------------------------------------------------------------------
+
+	// march constants matching the shader
+	//	steps: step cap
+	//	start: distance along the ray marching starts from
+	//	epsilon: distance to a surface at which a ray stops
+	//	far: distance at which a ray is no longer shaded; rays also stop
+	//		stepping past half of it
+	//	normal: finite-difference offset for the surface normal
+#define a3fractal_mengerSteps			256
+#define a3fractal_mengerStart			1.0f
+#define a3fractal_mengerEpsilon			0.001f
+#define a3fractal_mengerFar				100.0f
+#define a3fractal_mengerNormal			0.02f
+
+	// default step scale for relaxed marches; kept low because the
+	//	sponge's distance already overestimates by up to 4/3 in the carved
+	//	cells, so plain steps are partly relaxed
+#define a3fractal_mengerRelaxation		1.2f
+
+	// edge in pixels of the blocks the cone prepass traces
+#define a3fractal_mengerConeBlock		8
+
+	// sponge levels 'objMenger' carves
+#define a3fractal_mengerLevels			3
+
+	// deepest sponge with kernels of its own
+#define a3fractal_mengerUnrolled		4
+
+	// deepest sponge accepted
+#define a3fractal_mengerDepthMax		12
+
+	// scene nodes 'a3fractalMengerSceneBuild' adds at most
+#define a3fractal_mengerSceneNodes		64
+
+	// surface ids, as in the shader's second distance component
+#define a3fractal_mengerFloor			0
+#define a3fractal_mengerSponge			1
+
+
+	// how rays step toward the surface
+	enum a3_FractalMengerMarch
+	{
+		a3fractal_mengerMarchShader,	// whole steps from the shader's start
+		a3fractal_mengerMarchRelaxed,	// relaxed steps, whole after an overshoot
+		a3fractal_mengerMarchCone,		// relaxed, from a per-block cone prepass
+		a3fractal_mengerMarchExact,		// exact traversal of the sponge's cells
+	};
+
+
+	// how the surface normal is found
+	enum a3_FractalMengerNormal
+	{
+		a3fractal_mengerNormalDifference,	// the shader's backward differences
+		a3fractal_mengerNormalGradient,		// distance gradient from one dual evaluation
+	};
+
+
+	// which sponge is carved
+	enum a3_FractalMengerVariant
+	{
+		a3fractal_mengerVariantShader,		// the shader's: beams through cells 2 units across
+		a3fractal_mengerVariantClassic,		// Menger's: one cube 6 units across, middle thirds out
+
+		a3fractal_mengerVariantCount
+	};
+
+
+	// Menger render description
+	//	member eye: the shader's 'prp', the point rays leave from; the
+	//		camera looks from it toward the origin with +Y up
+	//	member iter: the shader's 'uIter'; ray directions are taken from
+	//		the eye scaled by this to the screen point, so 1 is an ordinary
+	//		pinhole camera and the demo's default 0 aims from the origin
+	//	member aspect: horizontal screen scale; 0 uses width / height
+	//	members width, height: image dimensions in pixels
+	//	members offsetX, offsetY: pixel offset of this image within a larger
+	//		frame; pixel (x, y) is traced as frame pixel (x + offsetX,
+	//		y + offsetY); usually 0
+	//	members frameWidth, frameHeight: dimensions of that frame, which set
+	//		the aspect and the screen a pixel covers; 0 uses width and height
+	//	member isa: instruction set to use; auto picks at runtime
+	//	member march: how rays step; the shader's march is the default
+	//	member relaxation: step scale for relaxed marches; 0 uses default
+	//	member normal: how normals are found; differences are the default
+	//	member depth: sponge levels, up to 'a3fractal_mengerDepthMax'; 0
+	//		uses the shader's; see 'a3fractalMengerDepthForIter'
+	//	member variant: sponge to carve; the shader's is the default
+	//	member falloff: nonzero fades out levels smaller than a pixel
+	//	member cache_opt: optional sponge distance cache for marches,
+	//		see 'a3fractalMengerCacheCreate'; it must have been created for
+	//		the same depth and variant; not used by exact traversal, and
+	//		cached marches have no falloff
+	//	member program_opt: optional compiled scene to march instead of
+	//		the sponge; depth, variant, cache and falloff do not apply,
+	//		exact traversal still traces the sponge, and normals are
+	//		always differences; surface ids other than the floor's are
+	//		shaded as the sponge
+	//	member steps_out_opt: optional march steps taken per pixel, or
+	//		cells visited by exact traversal
+	//	member depth_out_opt: optional march distance per pixel; rays the
+	//		shader would not shade store at least 'a3fractal_mengerFar'
+	//	member rgba_out_opt: optional 8-bit RGBA color per pixel
+	// all buffers are row-major, row 0 at the bottom (texcoord v = 0)
+	struct a3_FractalMengerDesc
+	{
+		float eye[3];
+		int iter;
+		float aspect;
+		unsigned int width, height;
+		int offsetX, offsetY;
+		unsigned int frameWidth, frameHeight;
+		a3_FractalISA isa;
+		a3_FractalMengerMarch march;
+		float relaxation;
+		a3_FractalMengerNormal normal;
+		unsigned int depth;
+		a3_FractalMengerVariant variant;
+		int falloff;
+		a3_FractalBrickCache *cache_opt;
+		const a3_FractalSDFProgram *program_opt;
+		unsigned int *steps_out_opt;
+		float *depth_out_opt;
+		unsigned char *rgba_out_opt;
+	};
+
+
+	// per-frame counters
+	//	member hits: rays the shader would shade
+	//	member steps: march steps taken by all rays, or cells visited
+	//	member prepass: cone prepass steps
+	//	member evaluations: scene distance evaluations: steps, prepass and
+	//		normals; a dual evaluation counts as one, exact traversal
+	//		takes none, and steps served by a cache do not count
+	//	member cache: lookups in the distance cache, if one was given
+	//	member program: program counters, if one was given
+	struct a3_FractalMengerStats
+	{
+		unsigned int hits;
+		unsigned long long steps;
+		unsigned long long prepass;
+		unsigned long long evaluations;
+		a3_FractalBrickStats cache;
+		a3_FractalSDFStats program;
+	};
+
+
+//-----------------------------------------------------------------------------
+
+	// Evaluate the scene distance at a point, as the shader's 'distToObj'.
+	//	params x, y, z: point
+	//	param id_out_opt: optional pointer to closest surface id
+	//	return: distance to the closest surface
+	float a3fractalMengerDistance(float x, float y, float z, unsigned int *id_out_opt);
+
+	// Evaluate the scene distance and its gradient at a point.
+	//	params x, y, z: point
+	//	param gradient_out: non-null pointer to 3 floats
+	//	param id_out_opt: optional pointer to closest surface id
+	//	return: distance to the closest surface, the same value as
+	//		'a3fractalMengerDistance'
+	float a3fractalMengerGradient(float x, float y, float z, float *gradient_out, unsigned int *id_out_opt);
+
+	// Get the sponge depth for the demo's iteration value: 0, the demo's
+	//	default, keeps the shader's levels; others are clamped to the range
+	//	of depths accepted.
+	//	param iter: the demo's 'fract_iter', sent to shaders as 'uIter'
+	//	return: sponge levels
+	unsigned int a3fractalMengerDepthForIter(int iter);
+
+	// Trace a ray exactly against the floor and the sponge.
+	//	param origin: non-null pointer to 3 floats, ray origin
+	//	param dir: non-null pointer to 3 floats, ray direction (any length;
+	//		distances are in multiples of it)
+	//	params tMin, tMax: stretch of ray to search
+	//	param depth: sponge levels, up to 'a3fractal_mengerDepthMax'; 0
+	//		uses the shader's
+	//	param variant: sponge to carve
+	//	param pixel: size of a pixel one unit along the ray, below which
+	//		levels are not descended into; 0 descends to 'depth'
+	//	param normal_out_opt: optional pointer to 3 floats, unit normal of
+	//		the face hit
+	//	param id_out_opt: optional pointer to surface id hit
+	//	param cells_out_opt: optional pointer to number of cells visited
+	//	return: distance to the first hit, or 'tMax' if none
+	float a3fractalMengerTrace(const float *origin, const float *dir, float tMin, float tMax, unsigned int depth, a3_FractalMengerVariant variant, float pixel, float *normal_out_opt, unsigned int *id_out_opt, unsigned int *cells_out_opt);
+
+	// Create an empty cache of the sponge's distance for marches.
+	//	param cache_out: non-null pointer to cache pointer; must be null
+	//	param depth: sponge levels, as the render description's
+	//	param variant: sponge to carve
+	//	param spacing: distance between cached samples; 0 uses 1/32
+	//	param budget: bytes of sampled bricks to keep at most
+	//	return: number of bricks the budget holds if success
+	//	return: 0 if fail (already created or out of memory)
+	//	return: -1 if invalid params
+	int a3fractalMengerCacheCreate(a3_FractalBrickCache **cache_out, unsigned int depth, a3_FractalMengerVariant variant, float spacing, unsigned long long budget);
+
+	// Build the floor and the sponge as a distance field scene; the
+	//	distances match 'a3fractalMengerDistance' to rounding at the
+	//	shader's depth and variant.
+	//	param scene: non-null pointer to scene with room for at least
+	//		'a3fractal_mengerSceneNodes' more nodes
+	//	param depth: sponge levels, up to 'a3fractal_mengerDepthMax'; 0
+	//		uses the shader's
+	//	param variant: sponge to carve
+	//	return: root node if success
+	//	return: -1 if invalid params or scene full
+	int a3fractalMengerSceneBuild(a3_FractalSDFScene *scene, unsigned int depth, a3_FractalMengerVariant variant);
+
+	// Render a rectangle of the image.
+	//	param desc: non-null pointer to render description
+	//	params x0, y0: first pixel in rectangle
+	//	params x1, y1: one past last pixel in rectangle (clamped to image)
+	//	param stats_out_opt: optional pointer to counters, added to
+	//	return: number of pixels rendered if success
+	//	return: -1 if invalid params
+	int a3fractalMengerRenderRect(const a3_FractalMengerDesc *desc, unsigned int x0, unsigned int y0, unsigned int x1, unsigned int y1, a3_FractalMengerStats *stats_out_opt);
+
+	// Render the whole image as tiles spread over a thread pool.
+	//	param desc: non-null pointer to render description
+	//	param pool_opt: optional pool; renders on this thread if null
+	//	param stats_out_opt: optional pointer to frame counters
+	//	return: number of pixels rendered if success
+	//	return: 0 if fail (out of memory)
+	//	return: -1 if invalid params
+	int a3fractalMengerRender(const a3_FractalMengerDesc *desc, a3_ThreadPool *pool_opt, a3_FractalMengerStats *stats_out_opt);
+
+
+//-----------------------------------------------------------------------------
+
+
+#ifdef __cplusplus
+}
+#endif	// __cplusplus
+
+
+#endif	// !__ANIMAL3D_DEMOFRACTALMENGER_H
@@ -0,0 +1,386 @@
+/*
+	animal3D SDK: Minimal 3D Animation Framework
+	Fractals Midterm: CPU fractal engines
+
+	a3_DemoFractalMengerMesh.c
+	Menger sponge mesh implementation.
+*/
+
+#include "a3_DemoFractalMengerMesh.h"
+#include "_utilities/a3_DemoAtomic.h"
+
+#include "animal3D/a3graphics/a3geometry/a3_ProceduralGeometry.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+
+//-----------------------------------------------------------------------------
+// internal structures
+
+// cubes per task
+#define a3mengerMesh_chunk		4096
+
+// hash slots: empty, and the flag set on a face two cubes put in
+#define a3mengerMesh_empty		-1L
+#define a3mengerMesh_shared		0x40000000L
+
+// one sponge
+typedef struct a3_MengerMeshPass
+{
+	unsigned int depth, cubes;
+	float size, edge;
+
+	// face table, its size less one, and a mask of visible faces per cube
+	volatile long *table;
+	unsigned int mask;
+	unsigned char *visible;
+
+	// visible faces per chunk, then the first face each chunk writes
+	unsigned int *chunkFaces;
+
+	// outputs
+	float *instances, *positions, *normals;
+	void *indices;
+	unsigned int indexSize;
+} a3_MengerMeshPass;
+
+
+// the 20 subcubes each level keeps, as offsets in thirds of the cube
+static const unsigned char a3mengerMeshKeep[20][3] = {
+	{ 0, 0, 0 }, { 1, 0, 0 }, { 2, 0, 0 }, { 0, 1, 0 }, { 2, 1, 0 }, { 0, 2, 0 }, { 1, 2, 0 }, { 2, 2, 0 },
+	{ 0, 0, 1 }, { 2, 0, 1 }, { 0, 2, 1 }, { 2, 2, 1 },
+	{ 0, 0, 2 }, { 1, 0, 2 }, { 2, 0, 2 }, { 0, 1, 2 }, { 2, 1, 2 }, { 0, 2, 2 }, { 1, 2, 2 }, { 2, 2, 2 },
+};
+
+
+//-----------------------------------------------------------------------------
+// cubes and faces
+
+// lattice cell of a cube: its index in base 20, one digit per level,
+//	the last level's first
+static void a3fractalMengerMeshCube(unsigned int index, const unsigned int depth, unsigned int *cell_out)
+{
+	unsigned int level, digit, scale = 1;
+	cell_out[0] = cell_out[1] = cell_out[2] = 0;
+	for (level = 0; level < depth; ++level, scale *= 3)
+	{
+		digit = index % 20;
+		index /= 20;
+		cell_out[0] += a3mengerMeshKeep[digit][0] * scale;
+		cell_out[1] += a3mengerMeshKeep[digit][1] * scale;
+		cell_out[2] += a3mengerMeshKeep[digit][2] * scale;
+	}
+}
+
+// face 'f' of a cell, 2 per axis, negative side first; a face is keyed
+//	by its axis and the cell on its negative side, offset by one so the
+//	cell outside the sponge's low faces fits in a byte
+static long a3fractalMengerMeshFaceKey(const unsigned int *cell, const unsigned int f)
+{
+	const unsigned int axis = f >> 1;
+	unsigned int key[3];
+	key[0] = cell[0] + 1;
+	key[1] = cell[1] + 1;
+	key[2] = cell[2] + 1;
+	if (!(f & 1))
+		--key[axis];
+	return (long)((axis << 24) | (key[0] << 16) | (key[1] << 8) | key[2]);
+}
+
+static unsigned int a3fractalMengerMeshHash(unsigned int key)
+{
+	key ^= key >> 16;
+	key *= 0x85ebca6bu;
+	key ^= key >> 13;
+	key *= 0xc2b2ae35u;
+	key ^= key >> 16;
+	return key;
+}
+
+// put a face in the table, flagging it if it is already there
+static void a3fractalMengerMeshInsert(const a3_MengerMeshPass *pass, const long key)
+{
+	unsigned int slot = a3fractalMengerMeshHash((unsigned int)key) & pass->mask;
+	long found;
+	for (;;)
+	{
+		found = a3atomicLoad(pass->table + slot);
+		if (found == a3mengerMesh_empty)
+		{
+			found = a3atomicCompareSwap(pass->table + slot, a3mengerMesh_empty, key);
+			if (found == a3mengerMesh_empty)
+				return;
+		}
+		if ((found & ~a3mengerMesh_shared) == key)
+		{
+			a3atomicOr(pass->table + slot, a3mengerMesh_shared);
+			return;
+		}
+		slot = (slot + 1) & pass->mask;
+	}
+}
+
+// whether a face was put in twice; every face has been put in once
+static int a3fractalMengerMeshShared(const a3_MengerMeshPass *pass, const long key)
+{
+	unsigned int slot = a3fractalMengerMeshHash((unsigned int)key) & pass->mask;
+	while ((pass->table[slot] & ~a3mengerMesh_shared) != key)
+		slot = (slot + 1) & pass->mask;
+	return (pass->table[slot] & a3mengerMesh_shared) != 0;
+}
+
+
+//-----------------------------------------------------------------------------
+// tasks; cubes run along x
+
+static void a3fractalMengerMeshInstanceTask(void *args, unsigned int x0, unsigned int y0, unsigned int x1, unsigned int y1, unsigned int workerIndex)
+{
+	const a3_MengerMeshPass *pass = (const a3_MengerMeshPass *)args;
+	const float half = pass->size * 0.5f;
+	float *instance = pass->instances + x0 * a3fractal_mengerMeshInstance;
+	unsigned int cell[3], i;
+	for (i = x0; i < x1; ++i, instance += a3fractal_mengerMeshInstance)
+	{
+		a3fractalMengerMeshCube(i, pass->depth, cell);
+		instance[0] = ((float)cell[0] + 0.5f) * pass->edge - half;
+		instance[1] = ((float)cell[1] + 0.5f) * pass->edge - half;
+		instance[2] = ((float)cell[2] + 0.5f) * pass->edge - half;
+		instance[3] = pass->edge;
+	}
+}
+
+static void a3fractalMengerMeshInsertTask(void *args, unsigned int x0, unsigned int y0, unsigned int x1, unsigned int y1, unsigned int workerIndex)
+{
+	const a3_MengerMeshPass *pass = (const a3_MengerMeshPass *)args;
+	unsigned int cell[3], i, f;
+	for (i = x0; i < x1; ++i)
+	{
+		a3fractalMengerMeshCube(i, pass->depth, cell);
+		for (f = 0; f < 6; ++f)
+			a3fractalMengerMeshInsert(pass, a3fractalMengerMeshFaceKey(cell, f));
+	}
+}
+
+static void a3fractalMengerMeshVisibleTask(void *args, unsigned int x0, unsigned int y0, unsigned int x1, unsigned int y1, unsigned int workerIndex)
+{
+	const a3_MengerMeshPass *pass = (const a3_MengerMeshPass *)args;
+	unsigned int cell[3], i, f, faces = 0;
+	unsigned char visible;
+	for (i = x0; i < x1; ++i)
+	{
+		a3fractalMengerMeshCube(i, pass->depth, cell);
+		for (f = 0, visible = 0; f < 6; ++f)
+			if (!a3fractalMengerMeshShared(pass, a3fractalMengerMeshFaceKey(cell, f)))
+			{
+				visible |= (unsigned char)(1 << f);
+				++faces;
+			}
+		pass->visible[i] = visible;
+	}
+	pass->chunkFaces[x0 / a3mengerMesh_chunk] = faces;
+}
+
+static void a3fractalMengerMeshEmitTask(void *args, unsigned int x0, unsigned int y0, unsigned int x1, unsigned int y1, unsigned int workerIndex)
+{
+	// corners of a face in the two axes after its own, counterclockwise
+	//	seen from the positive side
+	static const unsigned int corner[4][2] = { { 0, 0 }, { 1, 0 }, { 1, 1 }, { 0, 1 } };
+	static const unsigned int order[2][6] = { { 0, 2, 1, 0, 3, 2 }, { 0, 1, 2, 0, 2, 3 } };
+	const a3_MengerMeshPass *pass = (const a3_MengerMeshPass *)args;
+	const float half = pass->size * 0.5f;
+	unsigned int face = pass->chunkFaces[x0 / a3mengerMesh_chunk], cell[3], p[3], i, f, k, axis, u, v, side, vertex, index;
+	for (i = x0; i < x1; ++i)
+	{
+		if (!pass->visible[i])
+			continue;
+		a3fractalMengerMeshCube(i, pass->depth, cell);
+		for (f = 0; f < 6; ++f)
+			if (pass->visible[i] & (1 << f))
+			{
+				axis = f >> 1;
+				side = f & 1;
+				u = (axis + 1) % 3;
+				v = (axis + 2) % 3;
+				vertex = face * 4;
+				index = face * 6;
+				for (k = 0; k < 4; ++k, ++vertex)
+				{
+					p[axis] = cell[axis] + side;
+					p[u] = cell[u] + corner[k][0];
+					p[v] = cell[v] + corner[k][1];
+					pass->positions[vertex * 3 + 0] = (float)p[0] * pass->edge - half;
+					pass->positions[vertex * 3 + 1] = (float)p[1] * pass->edge - half;
+					pass->positions[vertex * 3 + 2] = (float)p[2] * pass->edge - half;
+					pass->normals[vertex * 3 + 0] = pass->normals[vertex * 3 + 1] = pass->normals[vertex * 3 + 2] = 0.0f;
+					pass->normals[vertex * 3 + axis] = side ? 1.0f : -1.0f;
+				}
+				vertex = face * 4;
+				for (k = 0; k < 6; ++k, ++index)
+					switch (pass->indexSize)
+					{
+					case 1:
+						((unsigned char *)pass->indices)[index] = (unsigned char)(vertex + order[side][k]);
+						break;
+					case 2:
+						((unsigned short *)pass->indices)[index] = (unsigned short)(vertex + order[side][k]);
+						break;
+					default:
+						((unsigned int *)pass->indices)[index] = vertex + order[side][k];
+						break;
+					}
+				++face;
+			}
+	}
+}
+
+
+//-----------------------------------------------------------------------------
+
+// cubes in a sponge and the cells along its edge
+static void a3fractalMengerMeshCount(const unsigned int depth, unsigned int *cubes_out, unsigned int *cells_out)
+{
+	unsigned int level;
+	*cubes_out = *cells_out = 1;
+	for (level = 0; level < depth; ++level)
+	{
+		*cubes_out *= 20;
+		*cells_out *= 3;
+	}
+}
+
+int a3fractalMengerMeshCreateInstances(a3_GeometryData *cube_out_opt, float **instances_out, unsigned int depth, float size, a3_ThreadPool *pool_opt)
+{
+	a3_ProceduralGeometryDescriptor cube[1] = { a3geomShape_none };
+	a3_MengerMeshPass pass[1] = { 0 };
+	unsigned int cells;
+
+	if (instances_out && depth <= a3fractal_mengerMeshDepthMax && size > 0.0f)
+	{
+		if (*instances_out || (cube_out_opt && cube_out_opt->data))
+			return 0;
+		a3fractalMengerMeshCount(depth, &pass->cubes, &cells);
+		pass->depth = depth;
+		pass->size = size;
+		pass->edge = size / (float)cells;
+		pass->instances = (float *)malloc(pass->cubes * a3fractal_mengerMeshInstance * sizeof(float));
+		if (!pass->instances)
+			return 0;
+		if (a3threadPoolParallelFor2D(pool_opt, 0, a3fractalMengerMeshInstanceTask, pass, pass->cubes, 1, a3mengerMesh_chunk, 1) < 0)
+		{
+			free(pass->instances);
+			return 0;
+		}
+
+		if (cube_out_opt && (a3proceduralCreateDescriptorBox(cube, a3geomFlag_normals, 1.0f, 1.0f, 1.0f, 1, 1, 1) <= 0 ||
+			a3proceduralGenerateGeometryData(cube_out_opt, cube) <= 0))
+		{
+			free(pass->instances);
+			return 0;
+		}
+		*instances_out = pass->instances;
+		return (int)pass->cubes;
+	}
+	return -1;
+}
+
+int a3fractalMengerMeshReleaseInstances(float **instances)
+{
+	if (instances)
+	{
+		free(*instances);
+		*instances = 0;
+		return 1;
+	}
+	return -1;
+}
+
+int a3fractalMengerMeshCreate(a3_GeometryData *mesh_out, unsigned int depth, float size, a3_ThreadPool *pool_opt, a3_FractalMengerMeshStats *stats_out_opt)
+{
+	const a3_GeometryVertexAttributeName attribs[2] = { a3attrib_geomPosition, a3attrib_geomNormal };
+	a3_MengerMeshPass pass[1] = { 0 };
+	a3_FractalMengerMeshStats stats = { 0 };
+	unsigned int cells, chunks, faces, slots, i, t;
+	size_t vertexBytes;
+
+	if (mesh_out && depth <= a3fractal_mengerMeshDepthMax && size > 0.0f)
+	{
+		if (mesh_out->data)
+			return 0;
+		a3fractalMengerMeshCount(depth, &pass->cubes, &cells);
+		pass->depth = depth;
+		pass->size = size;
+		pass->edge = size / (float)cells;
+		chunks = (pass->cubes + a3mengerMesh_chunk - 1) / a3mengerMesh_chunk;
+
+		// at most 6 faces per cube, at most three quarters full
+		for (slots = 1; slots < pass->cubes * 8; slots <<= 1);
+		pass->mask = slots - 1;
+		pass->table = (volatile long *)malloc(slots * sizeof(long));
+		pass->visible = (unsigned char *)malloc(pass->cubes);
+		pass->chunkFaces = (unsigned int *)calloc(chunks, sizeof(unsigned int));
+		if (pass->table)
+			memset((void *)pass->table, 0xff, slots * sizeof(long));
+
+		// the visible pass looks up every face, so it only runs once every
+		//	face is in
+		if (pass->table && pass->visible && pass->chunkFaces &&
+			a3threadPoolParallelFor2D(pool_opt, 0, a3fractalMengerMeshInsertTask, pass, pass->cubes, 1, a3mengerMesh_chunk, 1) >= 0 &&
+			a3threadPoolParallelFor2D(pool_opt, 0, a3fractalMengerMeshVisibleTask, pass, pass->cubes, 1, a3mengerMesh_chunk, 1) >= 0)
+		{
+			// each chunk writes after the faces of the chunks before it
+			for (i = 0, faces = 0; i < chunks; ++i)
+			{
+				t = pass->chunkFaces[i];
+				pass->chunkFaces[i] = faces;
+				faces += t;
+			}
+
+			stats.cubes = pass->cubes;
+			stats.faces = pass->cubes * 6;
+			stats.hidden = stats.faces - faces;
+			stats.vertices = faces * 4;
+			stats.triangles = faces * 2;
+
+			// positions, then normals, then indices in one block
+			a3geometryCreateVertexFormat(mesh_out->vertexFormat, attribs, 2);
+			a3geometryCreateIndexFormat(mesh_out->indexFormat, stats.vertices);
+			pass->indexSize = mesh_out->indexFormat->indexSize;
+			vertexBytes = (size_t)stats.vertices * 6 * sizeof(float);
+			mesh_out->data = malloc(vertexBytes + (size_t)faces * 6 * pass->indexSize);
+			if (mesh_out->data)
+			{
+				pass->positions = (float *)mesh_out->data;
+				pass->normals = pass->positions + stats.vertices * 3;
+				pass->indices = (unsigned char *)mesh_out->data + vertexBytes;
+				if (a3threadPoolParallelFor2D(pool_opt, 0, a3fractalMengerMeshEmitTask, pass, pass->cubes, 1, a3mengerMesh_chunk, 1) >= 0)
+				{
+					mesh_out->primType = a3prim_triangles;
+					mesh_out->numVertices = stats.vertices;
+					mesh_out->numIndices = faces * 6;
+					mesh_out->attribData[a3attrib_geomPosition] = pass->positions;
+					mesh_out->attribData[a3attrib_geomNormal] = pass->normals;
+					mesh_out->indexData = pass->indices;
+				}
+				else
+				{
+					free(mesh_out->data);
+					mesh_out->data = 0;
+				}
+			}
+		}
+		free((void *)pass->table);
+		free(pass->visible);
+		free(pass->chunkFaces);
+
+		if (!mesh_out->data)
+			return 0;
+		if (stats_out_opt)
+			*stats_out_opt = stats;
+		return (int)stats.triangles;
+	}
+	return -1;
+}
+
+
+//-----------------------------------------------------------------------------
@@ -0,0 +1,115 @@
+/*
+	animal3D SDK: Minimal 3D Animation Framework
+	Fractals Midterm: CPU fractal engines
+
+	a3_DemoFractalMengerMesh.h
+	Triangle meshes of the classic Menger sponge.
+
+	A level-N classic sponge is 20^N equal cubes: each level keeps the 20
+	of a cube's 27 subcubes that are not in a middle third along two axes
+	or more. It can be rasterized instead of raymarched in two forms.
+
+	The instanced form is one unit cube, made by the procedural box, and
+	one transform per sponge cube, its center and edge; a vertex shader
+	reads them by instance id and the sponge draws in one instanced call.
+	It costs 12 triangles a cube, most of them between two cubes.
+
+	The merged form is one mesh of only the faces that can be seen. Every
+	cube's 6 faces go into a hash table keyed by the face's position on
+	the sponge's lattice; a face that two cubes put in is between them and
+	is dropped. Cubes are enumerated straight from their index, and the
+	hash, the visibility test and the vertex output all run in parallel;
+	the output is the same for any number of threads.
+
+	With the same size, both match the raymarcher's classic variant at the
+	same depth, so either can be timed against it level by level.
+*/
+
+#ifndef __ANIMAL3D_DEMOFRACTALMENGERMESH_H
+#define __ANIMAL3D_DEMOFRACTALMENGERMESH_H
+
+
+#include "animal3D/a3graphics/a3geometry/a3_GeometryData.h"
+#include "_utilities/a3_DemoThreadPool.h"
+
+
+//-----------------------------------------------------------------------------
+
+#ifdef __cplusplus
+extern "C"
+{
+#else	// !__cplusplus
+	typedef struct a3_FractalMengerMeshStats	a3_FractalMengerMeshStats;
+#endif	// __cplusplus
+
+
+//-----------------------------------------------------------------------------
+
+	// deepest sponge meshed; level 5 is 3.2 million cubes
+#define a3fractal_mengerMeshDepthMax	5
+
+	// floats per instance: center x, y, z and edge
+#define a3fractal_mengerMeshInstance	4
+
+
+	// mesh counters
+	//	member cubes: cubes in the sponge
+	//	member faces: cube faces before removal
+	//	member hidden: faces removed for being between two cubes
+	//	member vertices, triangles: size of the merged mesh
+	struct a3_FractalMengerMeshStats
+	{
+		unsigned int cubes;
+		unsigned int faces;
+		unsigned int hidden;
+		unsigned int vertices;
+		unsigned int triangles;
+	};
+
+
+//-----------------------------------------------------------------------------
+
+	// Create the instanced form of a sponge centered at the origin.
+	//	param cube_out_opt: optional pointer to unused geometry data; gets
+	//		the unit cube with normals, release with 'a3geometryReleaseData'
+	//	param instances_out: non-null pointer to instance array pointer;
+	//		must be null; gets 'a3fractal_mengerMeshInstance' floats per cube
+	//	param depth: sponge levels, up to 'a3fractal_mengerMeshDepthMax'
+	//	param size: edge of the whole sponge; the raymarcher's is 6
+	//	param pool_opt: optional pool; generates on this thread if null
+	//	return: number of instances if success
+	//	return: 0 if fail (already created or out of memory)
+	//	return: -1 if invalid params
+	int a3fractalMengerMeshCreateInstances(a3_GeometryData *cube_out_opt, float **instances_out, unsigned int depth, float size, a3_ThreadPool *pool_opt);
+
+	// Release an instance array.
+	//	param instances: non-null pointer to instance array pointer; reset
+	//		to null
+	//	return: 1 if success
+	//	return: -1 if invalid params
+	int a3fractalMengerMeshReleaseInstances(float **instances);
+
+	// Create the merged form of a sponge centered at the origin: indexed
+	//	triangles with positions and flat normals, wound counterclockwise
+	//	seen from outside.
+	//	param mesh_out: non-null pointer to unused geometry data; release
+	//		with 'a3geometryReleaseData'
+	//	param depth: sponge levels, up to 'a3fractal_mengerMeshDepthMax'
+	//	param size: edge of the whole sponge; the raymarcher's is 6
+	//	param pool_opt: optional pool; generates on this thread if null
+	//	param stats_out_opt: optional pointer to counters
+	//	return: number of triangles if success
+	//	return: 0 if fail (already created or out of memory)
+	//	return: -1 if invalid params
+	int a3fractalMengerMeshCreate(a3_GeometryData *mesh_out, unsigned int depth, float size, a3_ThreadPool *pool_opt, a3_FractalMengerMeshStats *stats_out_opt);
+
+
+//-----------------------------------------------------------------------------
+
+
+#ifdef __cplusplus
+}
+#endif	// __cplusplus
+
+
+#endif	// !__ANIMAL3D_DEMOFRACTALMENGERMESH_H
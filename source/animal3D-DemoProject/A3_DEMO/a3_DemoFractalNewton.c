@@ -0,0 +1,483 @@
+/*
+	animal3D SDK: Minimal 3D Animation Framework
+	Fractals Midterm: CPU fractal engines
+
+	a3_DemoFractalNewton.c
+	CPU Newton-fractal engine implementation.
+
+	The per-pixel loop, in single precision like the shader:
+		z = c
+		for (steps = 0; steps < cap; ++steps)
+			if (|z - root k|^2 < tol^2 for some k) -> root = k, stop
+			z -= a (z^3 - 1) / (3 z^2)
+	A start on a root takes 0 steps. The fractional time compares the
+	final distance with the tolerance on a log scale: under quadratic
+	convergence the log distance doubles per step, so the fraction walks
+	smoothly from one step band to the next. SIMD kernels latch root,
+	steps and distance per lane and use no fused multiply-add, so every
+	instruction set produces the same basins and step counts.
+*/
+
+#include "a3_DemoFractalNewton.h"
+#include "_utilities/a3_DemoSIMD.h"
+
+#include "animal3D/a3/a3macros.h"
+
+#include <math.h>
+#include <stdlib.h>
+
+
+//-----------------------------------------------------------------------------
+
+// pixels handed to a kernel at once; multiple of the widest packet
+#define a3newton_span		64
+
+// tile edge for pooled renders
+#define a3newton_tile		32
+
+// cube roots of unity
+#define a3newton_root1x		(-0.5f)
+#define a3newton_root1y		0.8660254f
+
+
+// kernel: step 'count' pixels on one row
+//	writes the root reached, the steps taken and the squared distance to
+//	the root at the stop
+typedef void(*a3_FractalNewtonSpanFunc)(const float *cx, const float cy, const unsigned int count, const unsigned int cap, const float a, const float tol2, unsigned char *root_out, unsigned int *steps_out, float *dist_out);
+
+
+// one frame; counters are per thread, merged after the frame
+typedef struct a3_NewtonPass
+{
+	const a3_FractalNewtonDesc *desc;
+	a3_FractalNewtonStats *counters;
+} a3_NewtonPass;
+
+
+//-----------------------------------------------------------------------------
+// kernels
+
+// scalar fallback
+static void a3fractalNewtonSpan_scalar(const float *cx, const float cy, const unsigned int count, const unsigned int cap, const float a, const float tol2, unsigned char *root_out, unsigned int *steps_out, float *dist_out)
+{
+	unsigned int i, steps;
+	float zx, zy, x2, y2, fx, fy, gx, gy, den, d0, d1, d2;
+	for (i = 0; i < count; ++i)
+	{
+		zx = cx[i];
+		zy = cy;
+		root_out[i] = a3fractal_newtonNoRoot;
+		dist_out[i] = 0.0f;
+		for (steps = 0; ; ++steps)
+		{
+			d0 = (zx - 1.0f) * (zx - 1.0f) + zy * zy;
+			d1 = (zx - a3newton_root1x) * (zx - a3newton_root1x) + (zy - a3newton_root1y) * (zy - a3newton_root1y);
+			d2 = (zx - a3newton_root1x) * (zx - a3newton_root1x) + (zy + a3newton_root1y) * (zy + a3newton_root1y);
+			if (d0 < tol2)
+			{
+				root_out[i] = 0;
+				dist_out[i] = d0;
+				break;
+			}
+			if (d1 < tol2)
+			{
+				root_out[i] = 1;
+				dist_out[i] = d1;
+				break;
+			}
+			if (d2 < tol2)
+			{
+				root_out[i] = 2;
+				dist_out[i] = d2;
+				break;
+			}
+			if (steps == cap)
+				break;
+
+			// f = z^3 - 1, f' = 3 z^2, z -= a f / f'
+			x2 = zx * zx;
+			y2 = zy * zy;
+			fx = zx * (x2 - 3.0f * y2) - 1.0f;
+			fy = zy * (3.0f * x2 - y2);
+			gx = 3.0f * (x2 - y2);
+			gy = 6.0f * zx * zy;
+			den = gx * gx + gy * gy;
+			zx = zx - a * ((fx * gx + fy * gy) / den);
+			zy = zy - a * ((fy * gx - fx * gy) / den);
+		}
+		steps_out[i] = steps;
+	}
+}
+
+
+#if A3_FRACTAL_X86
+
+// SSE2: 4 pixels per instruction
+A3_FRACTAL_TARGET("sse2")
+static void a3fractalNewtonSpan_sse2(const float *cx, const float cy, const unsigned int count, const unsigned int cap, const float a, const float tol2, unsigned char *root_out, unsigned int *steps_out, float *dist_out)
+{
+	const __m128 one = _mm_set1_ps(1.0f), three = _mm_set1_ps(3.0f), six = _mm_set1_ps(6.0f);
+	const __m128 rx = _mm_set1_ps(a3newton_root1x), ry = _mm_set1_ps(a3newton_root1y);
+	const __m128 va = _mm_set1_ps(a), vtol = _mm_set1_ps(tol2);
+	__m128 zx, zy, x2, y2, fx, fy, gx, gy, den, d0, d1, d2, hit, done;
+	__m128 rootLatch, stepLatch, distLatch;
+	float rootStore[4], stepStore[4], distStore[4];
+	unsigned int i, j, steps;
+
+	for (i = 0; i < count; i += 4)
+	{
+		zx = _mm_loadu_ps(cx + i);
+		zy = _mm_set1_ps(cy);
+		done = _mm_setzero_ps();
+		rootLatch = _mm_set1_ps((float)a3fractal_newtonNoRoot);
+		stepLatch = _mm_set1_ps((float)cap);
+		distLatch = _mm_setzero_ps();
+		for (steps = 0; ; ++steps)
+		{
+			d0 = _mm_add_ps(_mm_mul_ps(_mm_sub_ps(zx, one), _mm_sub_ps(zx, one)), _mm_mul_ps(zy, zy));
+			d1 = _mm_add_ps(_mm_mul_ps(_mm_sub_ps(zx, rx), _mm_sub_ps(zx, rx)), _mm_mul_ps(_mm_sub_ps(zy, ry), _mm_sub_ps(zy, ry)));
+			d2 = _mm_add_ps(_mm_mul_ps(_mm_sub_ps(zx, rx), _mm_sub_ps(zx, rx)), _mm_mul_ps(_mm_add_ps(zy, ry), _mm_add_ps(zy, ry)));
+
+			// latch in reverse priority so the first root tested wins
+			hit = _mm_andnot_ps(done, _mm_cmplt_ps(d2, vtol));
+			rootLatch = _mm_or_ps(_mm_and_ps(hit, _mm_set1_ps(2.0f)), _mm_andnot_ps(hit, rootLatch));
+			distLatch = _mm_or_ps(_mm_and_ps(hit, d2), _mm_andnot_ps(hit, distLatch));
+			hit = _mm_andnot_ps(done, _mm_cmplt_ps(d1, vtol));
+			rootLatch = _mm_or_ps(_mm_and_ps(hit, one), _mm_andnot_ps(hit, rootLatch));
+			distLatch = _mm_or_ps(_mm_and_ps(hit, d1), _mm_andnot_ps(hit, distLatch));
+			hit = _mm_andnot_ps(done, _mm_cmplt_ps(d0, vtol));
+			rootLatch = _mm_andnot_ps(hit, rootLatch);
+			distLatch = _mm_or_ps(_mm_and_ps(hit, d0), _mm_andnot_ps(hit, distLatch));
+			hit = _mm_andnot_ps(done, _mm_cmplt_ps(_mm_min_ps(_mm_min_ps(d0, d1), d2), vtol));
+			stepLatch = _mm_or_ps(_mm_and_ps(hit, _mm_set1_ps((float)steps)), _mm_andnot_ps(hit, stepLatch));
+			done = _mm_or_ps(done, hit);
+			if (_mm_movemask_ps(done) == 0xf || steps == cap)
+				break;
+
+			x2 = _mm_mul_ps(zx, zx);
+			y2 = _mm_mul_ps(zy, zy);
+			fx = _mm_sub_ps(_mm_mul_ps(zx, _mm_sub_ps(x2, _mm_mul_ps(three, y2))), one);
+			fy = _mm_mul_ps(zy, _mm_sub_ps(_mm_mul_ps(three, x2), y2));
+			gx = _mm_mul_ps(three, _mm_sub_ps(x2, y2));
+			gy = _mm_mul_ps(_mm_mul_ps(six, zx), zy);
+			den = _mm_add_ps(_mm_mul_ps(gx, gx), _mm_mul_ps(gy, gy));
+			zx = _mm_sub_ps(zx, _mm_mul_ps(va, _mm_div_ps(_mm_add_ps(_mm_mul_ps(fx, gx), _mm_mul_ps(fy, gy)), den)));
+			zy = _mm_sub_ps(zy, _mm_mul_ps(va, _mm_div_ps(_mm_sub_ps(_mm_mul_ps(fy, gx), _mm_mul_ps(fx, gy)), den)));
+		}
+		_mm_storeu_ps(rootStore, rootLatch);
+		_mm_storeu_ps(stepStore, stepLatch);
+		_mm_storeu_ps(distStore, distLatch);
+		for (j = 0; j < 4; ++j)
+		{
+			root_out[i + j] = (unsigned char)rootStore[j];
+			steps_out[i + j] = (unsigned int)stepStore[j];
+			dist_out[i + j] = distStore[j];
+		}
+	}
+}
+
+
+// AVX2: 8 pixels per instruction
+A3_FRACTAL_TARGET("avx2")
+static void a3fractalNewtonSpan_avx2(const float *cx, const float cy, const unsigned int count, const unsigned int cap, const float a, const float tol2, unsigned char *root_out, unsigned int *steps_out, float *dist_out)
+{
+	const __m256 one = _mm256_set1_ps(1.0f), three = _mm256_set1_ps(3.0f), six = _mm256_set1_ps(6.0f);
+	const __m256 rx = _mm256_set1_ps(a3newton_root1x), ry = _mm256_set1_ps(a3newton_root1y);
+	const __m256 va = _mm256_set1_ps(a), vtol = _mm256_set1_ps(tol2);
+	__m256 zx, zy, x2, y2, fx, fy, gx, gy, den, d0, d1, d2, hit, done;
+	__m256 rootLatch, stepLatch, distLatch;
+	float rootStore[8], stepStore[8], distStore[8];
+	unsigned int i, j, steps;
+
+	for (i = 0; i < count; i += 8)
+	{
+		zx = _mm256_loadu_ps(cx + i);
+		zy = _mm256_set1_ps(cy);
+		done = _mm256_setzero_ps();
+		rootLatch = _mm256_set1_ps((float)a3fractal_newtonNoRoot);
+		stepLatch = _mm256_set1_ps((float)cap);
+		distLatch = _mm256_setzero_ps();
+		for (steps = 0; ; ++steps)
+		{
+			d0 = _mm256_add_ps(_mm256_mul_ps(_mm256_sub_ps(zx, one), _mm256_sub_ps(zx, one)), _mm256_mul_ps(zy, zy));
+			d1 = _mm256_add_ps(_mm256_mul_ps(_mm256_sub_ps(zx, rx), _mm256_sub_ps(zx, rx)), _mm256_mul_ps(_mm256_sub_ps(zy, ry), _mm256_sub_ps(zy, ry)));
+			d2 = _mm256_add_ps(_mm256_mul_ps(_mm256_sub_ps(zx, rx), _mm256_sub_ps(zx, rx)), _mm256_mul_ps(_mm256_add_ps(zy, ry), _mm256_add_ps(zy, ry)));
+
+			hit = _mm256_andnot_ps(done, _mm256_cmp_ps(d2, vtol, _CMP_LT_OQ));
+			rootLatch = _mm256_blendv_ps(rootLatch, _mm256_set1_ps(2.0f), hit);
+			distLatch = _mm256_blendv_ps(distLatch, d2, hit);
+			hit = _mm256_andnot_ps(done, _mm256_cmp_ps(d1, vtol, _CMP_LT_OQ));
+			rootLatch = _mm256_blendv_ps(rootLatch, one, hit);
+			distLatch = _mm256_blendv_ps(distLatch, d1, hit);
+			hit = _mm256_andnot_ps(done, _mm256_cmp_ps(d0, vtol, _CMP_LT_OQ));
+			rootLatch = _mm256_blendv_ps(rootLatch, _mm256_setzero_ps(), hit);
+			distLatch = _mm256_blendv_ps(distLatch, d0, hit);
+			hit = _mm256_andnot_ps(done, _mm256_cmp_ps(_mm256_min_ps(_mm256_min_ps(d0, d1), d2), vtol, _CMP_LT_OQ));
+			stepLatch = _mm256_blendv_ps(stepLatch, _mm256_set1_ps((float)steps), hit);
+			done = _mm256_or_ps(done, hit);
+			if (_mm256_movemask_ps(done) == 0xff || steps == cap)
+				break;
+
+			x2 = _mm256_mul_ps(zx, zx);
+			y2 = _mm256_mul_ps(zy, zy);
+			fx = _mm256_sub_ps(_mm256_mul_ps(zx, _mm256_sub_ps(x2, _mm256_mul_ps(three, y2))), one);
+			fy = _mm256_mul_ps(zy, _mm256_sub_ps(_mm256_mul_ps(three, x2), y2));
+			gx = _mm256_mul_ps(three, _mm256_sub_ps(x2, y2));
+			gy = _mm256_mul_ps(_mm256_mul_ps(six, zx), zy);
+			den = _mm256_add_ps(_mm256_mul_ps(gx, gx), _mm256_mul_ps(gy, gy));
+			zx = _mm256_sub_ps(zx, _mm256_mul_ps(va, _mm256_div_ps(_mm256_add_ps(_mm256_mul_ps(fx, gx), _mm256_mul_ps(fy, gy)), den)));
+			zy = _mm256_sub_ps(zy, _mm256_mul_ps(va, _mm256_div_ps(_mm256_sub_ps(_mm256_mul_ps(fy, gx), _mm256_mul_ps(fx, gy)), den)));
+		}
+		_mm256_storeu_ps(rootStore, rootLatch);
+		_mm256_storeu_ps(stepStore, stepLatch);
+		_mm256_storeu_ps(distStore, distLatch);
+		for (j = 0; j < 8; ++j)
+		{
+			root_out[i + j] = (unsigned char)rootStore[j];
+			steps_out[i + j] = (unsigned int)stepStore[j];
+			dist_out[i + j] = distStore[j];
+		}
+	}
+}
+
+
+#if A3_FRACTAL_AVX512
+
+// AVX-512: 16 pixels per instruction
+A3_FRACTAL_TARGET("avx512f")
+static void a3fractalNewtonSpan_avx512(const float *cx, const float cy, const unsigned int count, const unsigned int cap, const float a, const float tol2, unsigned char *root_out, unsigned int *steps_out, float *dist_out)
+{
+	const __m512 one = _mm512_set1_ps(1.0f), three = _mm512_set1_ps(3.0f), six = _mm512_set1_ps(6.0f);
+	const __m512 rx = _mm512_set1_ps(a3newton_root1x), ry = _mm512_set1_ps(a3newton_root1y);
+	const __m512 va = _mm512_set1_ps(a), vtol = _mm512_set1_ps(tol2);
+	__m512 zx, zy, x2, y2, fx, fy, gx, gy, den, d0, d1, d2;
+	__m512 rootLatch, stepLatch, distLatch;
+	__mmask16 hit0, hit1, hit2, done;
+	float rootStore[16], stepStore[16], distStore[16];
+	unsigned int i, j, steps;
+
+	for (i = 0; i < count; i += 16)
+	{
+		zx = _mm512_loadu_ps(cx + i);
+		zy = _mm512_set1_ps(cy);
+		done = 0;
+		rootLatch = _mm512_set1_ps((float)a3fractal_newtonNoRoot);
+		stepLatch = _mm512_set1_ps((float)cap);
+		distLatch = _mm512_setzero_ps();
+		for (steps = 0; ; ++steps)
+		{
+			d0 = _mm512_add_ps(_mm512_mul_ps(_mm512_sub_ps(zx, one), _mm512_sub_ps(zx, one)), _mm512_mul_ps(zy, zy));
+			d1 = _mm512_add_ps(_mm512_mul_ps(_mm512_sub_ps(zx, rx), _mm512_sub_ps(zx, rx)), _mm512_mul_ps(_mm512_sub_ps(zy, ry), _mm512_sub_ps(zy, ry)));
+			d2 = _mm512_add_ps(_mm512_mul_ps(_mm512_sub_ps(zx, rx), _mm512_sub_ps(zx, rx)), _mm512_mul_ps(_mm512_add_ps(zy, ry), _mm512_add_ps(zy, ry)));
+
+			hit0 = _mm512_mask_cmp_ps_mask((__mmask16)~done, d0, vtol, _CMP_LT_OQ);
+			hit1 = (__mmask16)(_mm512_mask_cmp_ps_mask((__mmask16)~done, d1, vtol, _CMP_LT_OQ) & ~hit0);
+			hit2 = (__mmask16)(_mm512_mask_cmp_ps_mask((__mmask16)~done, d2, vtol, _CMP_LT_OQ) & ~hit0 & ~hit1);
+			rootLatch = _mm512_mask_mov_ps(rootLatch, hit0, _mm512_setzero_ps());
+			rootLatch = _mm512_mask_mov_ps(rootLatch, hit1, one);
+			rootLatch = _mm512_mask_mov_ps(rootLatch, hit2, _mm512_set1_ps(2.0f));
+			distLatch = _mm512_mask_mov_ps(distLatch, hit0, d0);
+			distLatch = _mm512_mask_mov_ps(distLatch, hit1, d1);
+			distLatch = _mm512_mask_mov_ps(distLatch, hit2, d2);
+			stepLatch = _mm512_mask_mov_ps(stepLatch, (__mmask16)(hit0 | hit1 | hit2), _mm512_set1_ps((float)steps));
+			done = (__mmask16)(done | hit0 | hit1 | hit2);
+			if (done == 0xffff || steps == cap)
+				break;
+
+			x2 = _mm512_mul_ps(zx, zx);
+			y2 = _mm512_mul_ps(zy, zy);
+			fx = _mm512_sub_ps(_mm512_mul_ps(zx, _mm512_sub_ps(x2, _mm512_mul_ps(three, y2))), one);
+			fy = _mm512_mul_ps(zy, _mm512_sub_ps(_mm512_mul_ps(three, x2), y2));
+			gx = _mm512_mul_ps(three, _mm512_sub_ps(x2, y2));
+			gy = _mm512_mul_ps(_mm512_mul_ps(six, zx), zy);
+			den = _mm512_add_ps(_mm512_mul_ps(gx, gx), _mm512_mul_ps(gy, gy));
+			zx = _mm512_sub_ps(zx, _mm512_mul_ps(va, _mm512_div_ps(_mm512_add_ps(_mm512_mul_ps(fx, gx), _mm512_mul_ps(fy, gy)), den)));
+			zy = _mm512_sub_ps(zy, _mm512_mul_ps(va, _mm512_div_ps(_mm512_sub_ps(_mm512_mul_ps(fy, gx), _mm512_mul_ps(fx, gy)), den)));
+		}
+		_mm512_storeu_ps(rootStore, rootLatch);
+		_mm512_storeu_ps(stepStore, stepLatch);
+		_mm512_storeu_ps(distStore, distLatch);
+		for (j = 0; j < 16; ++j)
+		{
+			root_out[i + j] = (unsigned char)rootStore[j];
+			steps_out[i + j] = (unsigned int)stepStore[j];
+			dist_out[i + j] = distStore[j];
+		}
+	}
+}
+
+#endif	// A3_FRACTAL_AVX512
+
+#endif	// A3_FRACTAL_X86
+
+
+// kernel table, indexed by instruction set
+static const a3_FractalNewtonSpanFunc a3fractalNewtonSpanFuncs[a3fractal_isaCount] = {
+	a3fractalNewtonSpan_scalar,
+#if A3_FRACTAL_X86
+	a3fractalNewtonSpan_sse2,
+	a3fractalNewtonSpan_avx2,
+#if A3_FRACTAL_AVX512
+	a3fractalNewtonSpan_avx512,
+#else	// !A3_FRACTAL_AVX512
+	a3fractalNewtonSpan_avx2,
+#endif	// A3_FRACTAL_AVX512
+#else	// !A3_FRACTAL_X86
+	a3fractalNewtonSpan_scalar,
+	a3fractalNewtonSpan_scalar,
+	a3fractalNewtonSpan_scalar,
+#endif	// A3_FRACTAL_X86
+};
+
+
+//-----------------------------------------------------------------------------
+// shading
+
+void a3fractalShadeRoot(unsigned int root, unsigned int roots, float smooth, unsigned char *rgba_out)
+{
+	// hue by basin, value falling off with convergence time
+	const float k[3] = { 1.0f, 2.0f / 3.0f, 1.0f / 3.0f }, s = 0.75f;
+	float h, v = 0.0f, m, c;
+	unsigned int i;
+
+	h = roots ? (float)root / (float)roots : 0.0f;
+	if (root < roots)
+		v = a3clamp(0.1f, 1.0f, 1.0f / (1.0f + 0.06f * a3maximum(smooth, 0.0f)));
+
+	for (i = 0; i < 3; ++i)
+	{
+		m = h + k[i];
+		m = fabsf((m - floorf(m)) * 6.0f - 3.0f);
+		m = a3clamp(0.0f, 1.0f, m - 1.0f);
+		c = v * (1.0f + (m - 1.0f) * s);
+		rgba_out[i] = (unsigned char)(c * 255.0f + 0.5f);
+	}
+	rgba_out[3] = 255;
+}
+
+
+//-----------------------------------------------------------------------------
+// render
+
+int a3fractalNewtonRenderRect(const a3_FractalNewtonDesc *desc, unsigned int x0, unsigned int y0, unsigned int x1, unsigned int y1, a3_FractalNewtonStats *stats_out_opt)
+{
+	float cx[a3newton_span], dist[a3newton_span];
+	unsigned int steps[a3newton_span];
+	unsigned char root[a3newton_span];
+	a3_FractalNewtonStats stats = { 0 };
+	float tol, a, logTol2, smooth;
+	double left, bottom, dx, dy, cy;
+	unsigned int x, y, i, n, padded, lanes, index;
+	a3_FractalISA isa, best;
+	a3_FractalNewtonSpanFunc span;
+
+	if (desc && desc->width && desc->height)
+	{
+		x1 = a3minimum(x1, desc->width);
+		y1 = a3minimum(y1, desc->height);
+		if (x0 >= x1 || y0 >= y1)
+			return 0;
+
+		best = a3fractalDetectISA();
+		isa = desc->isa;
+		if (isa == a3fractal_isaAuto || isa > best)
+			isa = best;
+		span = a3fractalNewtonSpanFuncs[isa];
+		lanes = a3fractalGetISALanes(isa);
+
+		tol = desc->tolerance > 0.0f ? desc->tolerance : a3fractal_newtonTolerance;
+		a = desc->relaxation > 0.0f ? desc->relaxation : 1.0f;
+		logTol2 = logf(tol * tol);
+		dx = desc->view.width / (double)desc->width;
+		dy = desc->view.height / (double)desc->height;
+		left = desc->view.centerX - 0.5 * desc->view.width;
+		bottom = desc->view.centerY - 0.5 * desc->view.height;
+
+		for (y = y0; y < y1; ++y)
+		{
+			cy = bottom + ((double)((int)y + desc->offsetY) + 0.5) * dy;
+			for (x = x0; x < x1; x += n)
+			{
+				// fill span, padding to a whole packet with the last pixel
+				n = a3minimum(a3newton_span, x1 - x);
+				padded = (n + lanes - 1) / lanes * lanes;
+				for (i = 0; i < n; ++i)
+					cx[i] = (float)(left + ((double)((int)(x + i) + desc->offsetX) + 0.5) * dx);
+				for (; i < padded; ++i)
+					cx[i] = cx[n - 1];
+				span(cx, (float)cy, padded, desc->iterations, a, tol * tol, root, steps, dist);
+
+				// outputs
+				index = y * desc->width + x;
+				for (i = 0; i < n; ++i, ++index)
+				{
+					stats.steps += steps[i];
+					smooth = (float)steps[i];
+					if (root[i] != a3fractal_newtonNoRoot)
+					{
+						++stats.converged;
+						smooth -= log2f(logf(a3maximum(dist[i], 1.0e-30f)) / logTol2);
+					}
+					if (desc->root_out_opt)
+						desc->root_out_opt[index] = root[i];
+					if (desc->steps_out_opt)
+						desc->steps_out_opt[index] = steps[i];
+					if (desc->smooth_out_opt)
+						desc->smooth_out_opt[index] = smooth;
+					if (desc->rgba_out_opt)
+						a3fractalShadeRoot(root[i], 3, smooth, desc->rgba_out_opt + index * 4);
+				}
+			}
+		}
+
+		if (stats_out_opt)
+		{
+			stats_out_opt->converged += stats.converged;
+			stats_out_opt->steps += stats.steps;
+		}
+		return (int)((x1 - x0) * (y1 - y0));
+	}
+	return -1;
+}
+
+static void a3fractalNewtonTask(void *args, unsigned int x0, unsigned int y0, unsigned int x1, unsigned int y1, unsigned int workerIndex)
+{
+	const a3_NewtonPass *pass = (const a3_NewtonPass *)args;
+	a3fractalNewtonRenderRect(pass->desc, x0, y0, x1, y1, pass->counters + workerIndex);
+}
+
+int a3fractalNewtonRender(const a3_FractalNewtonDesc *desc, a3_ThreadPool *pool_opt, a3_FractalNewtonStats *stats_out_opt)
+{
+	a3_FractalNewtonStats stats = { 0 };
+	a3_NewtonPass pass[1];
+	unsigned int workers, i;
+
+	if (desc && desc->width && desc->height)
+	{
+		workers = a3threadPoolGetWorkerCount(pool_opt) + 1;
+		pass->counters = (a3_FractalNewtonStats *)calloc(workers, sizeof(a3_FractalNewtonStats));
+		if (!pass->counters)
+			return 0;
+		pass->desc = desc;
+		if (a3threadPoolParallelFor2D(pool_opt, 0, a3fractalNewtonTask, pass, desc->width, desc->height, a3newton_tile, a3newton_tile) < 0)
+		{
+			free(pass->counters);
+			return 0;
+		}
+
+		for (i = 0; i < workers; ++i)
+		{
+			stats.converged += pass->counters[i].converged;
+			stats.steps += pass->counters[i].steps;
+		}
+		if (stats_out_opt)
+			*stats_out_opt = stats;
+
+		free(pass->counters);
+		return (int)(desc->width * desc->height);
+	}
+	return -1;
+}
+
+
+//-----------------------------------------------------------------------------
@@ -0,0 +1,135 @@
+/*
+	animal3D SDK: Minimal 3D Animation Framework
+	Fractals Midterm: CPU fractal engines
+
+	a3_DemoFractalNewton.h
+	CPU Newton-fractal engine for the Julia shader.
+
+	"drawJulia_fs4x.glsl" runs Newton's method on z^3 - 1 for a fixed 512
+	steps with no exit test, then colors by distance to the roots. Here
+	each pixel stops as soon as it is within a tolerance of a root, which
+	for most of the image is under 20 steps; the root it reached and the
+	steps it took are recorded and the color is its basin's hue, darkened
+	with the convergence time. Pixels are evaluated 4, 8 or 16 at a time
+	using SSE2, AVX2 or AVX-512, selected at runtime, with a scalar
+	fallback; a packet stops when all of its lanes have converged.
+
+	The shader's derivative is 2z^2 instead of 3z^2, which is the true
+	Newton step scaled by 1.5; a relaxation of 1.5 reproduces its basins.
+*/
+
+#ifndef __ANIMAL3D_DEMOFRACTALNEWTON_H
+#define __ANIMAL3D_DEMOFRACTALNEWTON_H
+
+
+#include "a3_DemoFractalEscape.h"
+
+
+//-----------------------------------------------------------------------------
+
+#ifdef __cplusplus
+extern "C"
+{
+#else	// !__cplusplus
+	typedef struct a3_FractalNewtonDesc			a3_FractalNewtonDesc;
+	typedef struct a3_FractalNewtonStats		a3_FractalNewtonStats;
+#endif	// __cplusplus
+
+
+//-----------------------------------------------------------------------------
+
+	// default convergence tolerance: distance to a root, in plane units,
+	//	at which a pixel stops
+#define a3fractal_newtonTolerance		1.0e-3f
+
+	// the shader's step count
+#define a3fractal_newtonIterations		512
+
+	// relaxation matching the shader's derivative
+#define a3fractal_newtonShaderRelaxation	1.5f
+
+	// root value stored for pixels that never converge
+#define a3fractal_newtonNoRoot			0xff
+
+
+	// Newton render description
+	//	member view: window into the complex plane
+	//	members width, height: image dimensions in pixels
+	//	member iterations: step cap; the shader runs 512
+	//	member tolerance: convergence distance; 0 uses default
+	//	member relaxation: step scale, z -= a f / f'; 0 means 1
+	//	member isa: instruction set to use; auto picks at runtime
+	//	members offsetX, offsetY: pixel offset of this image within a larger
+	//		pixel lattice over the same view; pixel (x, y) is evaluated at
+	//		lattice pixel (x + offsetX, y + offsetY); usually 0
+	//	member root_out_opt: optional root index per pixel (0 is 1, then
+	//		counterclockwise), or 'a3fractal_newtonNoRoot'
+	//	member steps_out_opt: optional steps taken per pixel; pixels that
+	//		never converge store 'iterations'
+	//	member smooth_out_opt: optional fractional convergence time per
+	//		pixel, continuous across the step bands
+	//	member rgba_out_opt: optional 8-bit RGBA color per pixel
+	// all buffers are row-major, row 0 at the bottom (texcoord v = 0)
+	struct a3_FractalNewtonDesc
+	{
+		a3_FractalView view;
+		unsigned int width, height;
+		unsigned int iterations;
+		float tolerance;
+		float relaxation;
+		a3_FractalISA isa;
+		int offsetX, offsetY;
+		unsigned char *root_out_opt;
+		unsigned int *steps_out_opt;
+		float *smooth_out_opt;
+		unsigned char *rgba_out_opt;
+	};
+
+
+	// per-frame counters
+	//	member converged: pixels that reached a root
+	//	member steps: pixel steps performed
+	struct a3_FractalNewtonStats
+	{
+		unsigned int converged;
+		unsigned long long steps;
+	};
+
+
+//-----------------------------------------------------------------------------
+
+	// Convert a basin and convergence time to color.
+	//	param root: root index or 'a3fractal_newtonNoRoot' (black)
+	//	param roots: number of roots the hues are spread over
+	//	param smooth: fractional convergence time
+	//	param rgba_out: non-null pointer to 4 bytes
+	void a3fractalShadeRoot(unsigned int root, unsigned int roots, float smooth, unsigned char *rgba_out);
+
+	// Render a rectangle of the image.
+	//	param desc: non-null pointer to render description
+	//	params x0, y0: first pixel in rectangle
+	//	params x1, y1: one past last pixel in rectangle (clamped to image)
+	//	param stats_out_opt: optional pointer to counters, added to
+	//	return: number of pixels rendered if success
+	//	return: -1 if invalid params
+	int a3fractalNewtonRenderRect(const a3_FractalNewtonDesc *desc, unsigned int x0, unsigned int y0, unsigned int x1, unsigned int y1, a3_FractalNewtonStats *stats_out_opt);
+
+	// Render the whole image as tiles spread over a thread pool.
+	//	param desc: non-null pointer to render description
+	//	param pool_opt: optional pool; renders on this thread if null
+	//	param stats_out_opt: optional pointer to frame counters
+	//	return: number of pixels rendered if success
+	//	return: 0 if fail (out of memory)
+	//	return: -1 if invalid params
+	int a3fractalNewtonRender(const a3_FractalNewtonDesc *desc, a3_ThreadPool *pool_opt, a3_FractalNewtonStats *stats_out_opt);
+
+
+//-----------------------------------------------------------------------------
+
+
+#ifdef __cplusplus
+}
+#endif	// __cplusplus
+
+
+#endif	// !__ANIMAL3D_DEMOFRACTALNEWTON_H
@@ -0,0 +1,741 @@
+/*
+	animal3D SDK: Minimal 3D Animation Framework
+	Fractals Midterm: CPU fractal engines
+
+	a3_DemoFractalPerturb.c
+	Perturbation deep-zoom renderer implementation.
+
+	With reference orbit W and pixel orbit W + d (conjugated coordinates):
+		d' = (2 W + d) d + dc
+	which only involves small numbers, so doubles suffice at any depth the
+	reference can be computed at. The reference uses double-double down to
+	a pixel spacing around 1e-28, quad-double down to 1e-60 and fixed-point
+	below that, with limbs to spare over the spacing.
+
+	Glitch handling: a pixel whose |W + d| drops below tolerance * |W| has
+	lost its low bits to cancellation; it is flagged with that ratio, and
+	after each pass the flagged pixel with the smallest ratio (the one
+	closest to whatever feature the reference failed to follow) becomes the
+	next reference. Only flagged pixels are rendered again. A pixel that
+	outlives the reference orbit is flagged the same way.
+*/
+
+#include "a3_DemoFractalPerturb.h"
+
+#include "animal3D/a3/a3macros.h"
+
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+
+//-----------------------------------------------------------------------------
+// constants
+
+// conjugation scale of the imaginary axis
+#define a3perturb_sqrt3		1.7320508075688772
+
+// pixel states during a render
+enum a3_PerturbPixelState
+{
+	a3perturb_done,
+	a3perturb_pending,
+	a3perturb_glitched,
+};
+
+
+//-----------------------------------------------------------------------------
+// view
+
+int a3fractalDeepViewSetDefault(a3_FractalDeepView *view_out)
+{
+	if (view_out)
+	{
+		view_out->width = view_out->height = 1.0;
+		a3mpFixedSetDouble(&view_out->centerX, a3mpFixedLimbsForSpacing(view_out->width), 0.0);
+		a3mpFixedSetDouble(&view_out->centerY, a3mpFixedLimbsForSpacing(view_out->width), 0.0);
+		return 1;
+	}
+	return -1;
+}
+
+int a3fractalDeepViewZoom(a3_FractalDeepView *view, unsigned int width, unsigned int height, double x, double y, double scale)
+{
+	unsigned int limbs;
+	if (view && width && height && scale > 0.0)
+	{
+		// grow the center first so the new pixel spacing is representable
+		limbs = a3mpFixedLimbsForSpacing(view->width * scale / (double)width);
+		limbs = a3maximum(limbs, view->centerX.limbs);
+		a3mpFixedResize(&view->centerX, &view->centerX, limbs);
+		a3mpFixedResize(&view->centerY, &view->centerY, limbs);
+
+		// offset from current center, small enough for a double
+		a3mpFixedAddDouble(&view->centerX, &view->centerX, (x / (double)width - 0.5) * view->width);
+		a3mpFixedAddDouble(&view->centerY, &view->centerY, (y / (double)height - 0.5) * view->height);
+
+		view->width *= scale;
+		view->height *= scale;
+		return 1;
+	}
+	return -1;
+}
+
+
+//-----------------------------------------------------------------------------
+// reference orbit
+
+// extend the orbit in double-double
+static void a3fractalReferenceExtendDD(a3_FractalReference *ref, const unsigned int iterations)
+{
+	const a3_DoubleDouble cx = a3mpFixedGetDD(&ref->centerX), cy = a3mpFixedGetDD(&ref->centerY);
+	a3_DoubleDouble x = a3qdGetDD(ref->state[0]), y = a3qdGetDD(ref->state[1]), x2, y2, xy;
+	double *orbit = ref->orbit + ref->length * 2;
+	unsigned int n;
+
+	for (n = ref->length; n < iterations; ++n)
+	{
+		// z' = (3x^2 - y^2, 6xy) + c
+		x2 = a3ddSqr(x);
+		y2 = a3ddSqr(y);
+		xy = a3ddMul(x, y);
+		x = a3ddAdd(a3ddSub(a3ddMulD(x2, 3.0), y2), cx);
+		y = a3ddAdd(a3ddMulD(xy, 6.0), cy);
+
+		orbit += 2;
+		orbit[0] = 3.0 * x.hi + 3.0 * x.lo;
+		orbit[1] = a3perturb_sqrt3 * (y.hi + y.lo);
+		if (x.hi * x.hi + y.hi * y.hi > a3fractal_bailout)
+		{
+			ref->escaped = 1;
+			++n;
+			break;
+		}
+	}
+	ref->length = n;
+	ref->state[0] = a3qdSetDD(x);
+	ref->state[1] = a3qdSetDD(y);
+}
+
+// extend the orbit in quad-double
+static void a3fractalReferenceExtendQD(a3_FractalReference *ref, const unsigned int iterations)
+{
+	const a3_QuadDouble cx = a3mpFixedGetQD(&ref->centerX), cy = a3mpFixedGetQD(&ref->centerY);
+	a3_QuadDouble x = ref->state[0], y = ref->state[1], x2, y2, xy;
+	double *orbit = ref->orbit + ref->length * 2;
+	unsigned int n;
+
+	for (n = ref->length; n < iterations; ++n)
+	{
+		x2 = a3qdSqr(x);
+		y2 = a3qdSqr(y);
+		xy = a3qdMul(x, y);
+		x = a3qdAdd(a3qdSub(a3qdMulD(x2, 3.0), y2), cx);
+		y = a3qdAdd(a3qdMulD(xy, 6.0), cy);
+
+		orbit += 2;
+		orbit[0] = 3.0 * a3qdGetDouble(x);
+		orbit[1] = a3perturb_sqrt3 * a3qdGetDouble(y);
+		if (x.x[0] * x.x[0] + y.x[0] * y.x[0] > a3fractal_bailout)
+		{
+			ref->escaped = 1;
+			++n;
+			break;
+		}
+	}
+	ref->length = n;
+	ref->state[0] = x;
+	ref->state[1] = y;
+}
+
+// extend the orbit in fixed-point at the reference's limb count
+static void a3fractalReferenceExtendFixed(a3_FractalReference *ref, const unsigned int iterations)
+{
+	a3_MPFixed cx[1], cy[1], x2[1], y2[1], xy[1];
+	a3_MPFixed *x = ref->stateFixed, *y = ref->stateFixed + 1;
+	double *orbit = ref->orbit + ref->length * 2, fx, fy;
+	unsigned int n;
+
+	a3mpFixedResize(cx, &ref->centerX, ref->limbs);
+	a3mpFixedResize(cy, &ref->centerY, ref->limbs);
+	for (n = ref->length; n < iterations; ++n)
+	{
+		a3mpFixedSqr(x2, x);
+		a3mpFixedSqr(y2, y);
+		a3mpFixedMul(xy, x, y);
+		a3mpFixedMulInt(x2, x2, 3);
+		a3mpFixedSub(x, x2, y2);
+		a3mpFixedAdd(x, x, cx);
+		a3mpFixedMulInt(xy, xy, 6);
+		a3mpFixedAdd(y, xy, cy);
+
+		fx = a3mpFixedGetDouble(x);
+		fy = a3mpFixedGetDouble(y);
+		orbit += 2;
+		orbit[0] = 3.0 * fx;
+		orbit[1] = a3perturb_sqrt3 * fy;
+		if (fx * fx + fy * fy > a3fractal_bailout)
+		{
+			ref->escaped = 1;
+			++n;
+			break;
+		}
+	}
+	ref->length = n;
+}
+
+a3_FractalPrecision a3fractalReferencePrecision(double spacing)
+{
+	if (spacing >= a3fractal_precisionSpacingDD)
+		return a3fractal_precisionDD;
+	if (spacing >= a3fractal_precisionSpacingQD)
+		return a3fractal_precisionQD;
+	return a3fractal_precisionFixed;
+}
+
+int a3fractalReferenceCompute(a3_FractalReference *ref, const a3_MPFixed *centerX, const a3_MPFixed *centerY, double spacing, unsigned int iterations)
+{
+	a3_FractalPrecision precision;
+	double *orbit;
+	unsigned int limbs;
+
+	if (ref && centerX && centerY && centerX->limbs == centerY->limbs)
+	{
+		precision = a3fractalReferencePrecision(spacing);
+		limbs = 0;
+		if (precision == a3fractal_precisionFixed)
+		{
+			limbs = a3mpFixedLimbsForSpacing(spacing);
+			limbs = a3maximum(limbs, centerX->limbs);
+		}
+
+		// new center or arithmetic: restart at z = c
+		if (!ref->orbit || ref->precision != precision || ref->limbs != limbs ||
+			a3mpFixedEqual(&ref->centerX, centerX) != 1 || a3mpFixedEqual(&ref->centerY, centerY) != 1)
+		{
+			ref->centerX = *centerX;
+			ref->centerY = *centerY;
+			ref->precision = precision;
+			ref->limbs = limbs;
+			ref->length = 0;
+			ref->escaped = 0;
+			if (precision == a3fractal_precisionFixed)
+			{
+				a3mpFixedResize(ref->stateFixed, centerX, limbs);
+				a3mpFixedResize(ref->stateFixed + 1, centerY, limbs);
+			}
+			else
+			{
+				ref->state[0] = a3mpFixedGetQD(centerX);
+				ref->state[1] = a3mpFixedGetQD(centerY);
+			}
+		}
+
+		// grow buffer, keeping what is already computed
+		if (ref->capacity < iterations || !ref->orbit)
+		{
+			orbit = (double *)realloc(ref->orbit, (iterations + 1) * 2 * sizeof(double));
+			if (!orbit)
+				return 0;
+			ref->orbit = orbit;
+			ref->capacity = iterations;
+		}
+		if (ref->length == 0)
+		{
+			ref->orbit[0] = 3.0 * a3mpFixedGetDouble(centerX);
+			ref->orbit[1] = a3perturb_sqrt3 * a3mpFixedGetDouble(centerY);
+		}
+
+		// extend from last point
+		if (!ref->escaped && ref->length < iterations)
+		{
+			switch (precision)
+			{
+			case a3fractal_precisionDD:
+				a3fractalReferenceExtendDD(ref, iterations);
+				break;
+			case a3fractal_precisionQD:
+				a3fractalReferenceExtendQD(ref, iterations);
+				break;
+			default:
+				a3fractalReferenceExtendFixed(ref, iterations);
+				break;
+			}
+		}
+		return 1;
+	}
+	return -1;
+}
+
+int a3fractalReferenceRelease(a3_FractalReference *ref)
+{
+	if (ref)
+	{
+		free(ref->orbit);
+		free(ref->bla->node);
+		memset(ref, 0, sizeof(a3_FractalReference));
+		return 1;
+	}
+	return -1;
+}
+
+
+//-----------------------------------------------------------------------------
+// nucleus
+
+int a3fractalFindNucleus(a3_MPFixed *centerX, a3_MPFixed *centerY, unsigned int period, unsigned int steps)
+{
+	a3_MPFixed x[1], y[1], x2[1], y2[1], xy[1];
+	double zx, zy, jxx, jxy, jyx, jyy, txx, txy, det, stepX, stepY, resolution;
+	unsigned int s, n;
+
+	if (centerX && centerY && centerX->limbs == centerY->limbs && period)
+	{
+		// stop once a step is within a few units of the last limb
+		resolution = ldexp(1.0, 8 - 32 * (int)(centerX->limbs - 1));
+		for (s = 0; s < steps; ++s)
+		{
+			// z_1 = c and dz_1/dc = I
+			*x = *centerX;
+			*y = *centerY;
+			jxx = jyy = 1.0;
+			jxy = jyx = 0.0;
+			for (n = 1; n < period; ++n)
+			{
+				zx = a3mpFixedGetDouble(x);
+				zy = a3mpFixedGetDouble(y);
+				if (zx * zx + zy * zy > a3fractal_bailout)
+					return 0;
+
+				// J' = [6x -2y; 6y 6x] J + I
+				txx = 6.0 * zx * jxx - 2.0 * zy * jyx + 1.0;
+				txy = 6.0 * zx * jxy - 2.0 * zy * jyy;
+				jyx = 6.0 * zy * jxx + 6.0 * zx * jyx;
+				jyy = 6.0 * zy * jxy + 6.0 * zx * jyy + 1.0;
+				jxx = txx;
+				jxy = txy;
+
+				// z' = (3x^2 - y^2, 6xy) + c
+				a3mpFixedSqr(x2, x);
+				a3mpFixedSqr(y2, y);
+				a3mpFixedMul(xy, x, y);
+				a3mpFixedMulInt(x2, x2, 3);
+				a3mpFixedSub(x, x2, y2);
+				a3mpFixedAdd(x, x, centerX);
+				a3mpFixedMulInt(xy, xy, 6);
+				a3mpFixedAdd(y, xy, centerY);
+			}
+
+			// solve J step = -z
+			zx = a3mpFixedGetDouble(x);
+			zy = a3mpFixedGetDouble(y);
+			det = jxx * jyy - jxy * jyx;
+			stepX = (jxy * zy - jyy * zx) / det;
+			stepY = (jyx * zx - jxx * zy) / det;
+			if (!(fabs(stepX) + fabs(stepY) < 1.0))
+				return 0;
+			a3mpFixedAddDouble(centerX, centerX, stepX);
+			a3mpFixedAddDouble(centerY, centerY, stepY);
+			if (fabs(stepX) + fabs(stepY) <= resolution)
+				return 1;
+		}
+		return 0;
+	}
+	return -1;
+}
+
+
+//-----------------------------------------------------------------------------
+// bilinear approximation
+
+// node layout in the table: A (complex), B (complex), validity radius
+#define a3perturb_blaStride		5
+
+// references shorter than this are not approximated: the few steps a
+//	short table could skip do not repay searching it at every step
+#define a3perturb_blaLengthMin	1024
+
+// validity radius of one perturbation step d' = A d + B dc, A = 2 W
+static double a3fractalBLAStepRadius(const double au, const double av, const double epsilon, const double radius)
+{
+	const double a = sqrt(au * au + av * av);
+	return a3maximum(0.0, (epsilon * a - radius) / (a + 1.0));
+}
+
+// merge x followed by y into one node covering both
+static void a3fractalBLAMerge(double *node_out, const double *x, const double *y, const double radius)
+{
+	const double ax = sqrt(x[0] * x[0] + x[1] * x[1]);
+	const double bx = sqrt(x[2] * x[2] + x[3] * x[3]);
+	double r;
+
+	// A = Ay Ax, B = Ay Bx + By
+	node_out[0] = y[0] * x[0] - y[1] * x[1];
+	node_out[1] = y[0] * x[1] + y[1] * x[0];
+	node_out[2] = y[0] * x[2] - y[1] * x[3] + y[2];
+	node_out[3] = y[0] * x[3] + y[1] * x[2] + y[3];
+
+	// d stays valid for y while |Ax d + Bx dc| < Ry
+	r = y[4] - bx * radius;
+	if (ax > 0.0)
+		r /= ax;
+	else
+		r = (r >= 0.0 ? x[4] : 0.0);
+	node_out[4] = a3maximum(0.0, a3minimum(x[4], r));
+}
+
+int a3fractalReferenceBuildBLA(a3_FractalReference *ref, double epsilon, double radius)
+{
+	a3_FractalBLATable *bla;
+	const double *orbit;
+	double *node, *level, step0[a3perturb_blaStride], step1[a3perturb_blaStride];
+	unsigned int count, total, levels, j;
+
+	if (ref && ref->orbit && epsilon > 0.0 && radius >= 0.0)
+	{
+		bla = ref->bla;
+		if (bla->node && bla->length == ref->length && bla->epsilon == epsilon && bla->radius == radius)
+			return 1;
+
+		// level k (from 1) has one node per whole run of 2^k steps
+		for (levels = 0, total = 0, count = ref->length >> 1; count && levels < a3fractal_blaLevelMax; count >>= 1, ++levels)
+			total += count;
+		free(bla->node);
+		bla->node = 0;
+		bla->levels = bla->valid = 0;
+		if (total)
+		{
+			bla->node = (double *)malloc(total * a3perturb_blaStride * sizeof(double));
+			if (!bla->node)
+				return 0;
+		}
+
+		// level 1 from pairs of single steps: A = 2 W, B = 1
+		orbit = ref->orbit;
+		node = bla->node;
+		count = ref->length >> 1;
+		step0[2] = step1[2] = 1.0;
+		step0[3] = step1[3] = 0.0;
+		for (j = 0; j < count; ++j, orbit += 4, node += a3perturb_blaStride)
+		{
+			step0[0] = 2.0 * orbit[0];
+			step0[1] = 2.0 * orbit[1];
+			step0[4] = a3fractalBLAStepRadius(step0[0], step0[1], epsilon, radius);
+			step1[0] = 2.0 * orbit[2];
+			step1[1] = 2.0 * orbit[3];
+			step1[4] = a3fractalBLAStepRadius(step1[0], step1[1], epsilon, radius);
+			a3fractalBLAMerge(node, step0, step1, radius);
+			bla->valid += (node[4] > 0.0);
+		}
+
+		// higher levels from pairs of the level below
+		bla->levelOffset[0] = 0;
+		bla->levelCount[0] = count;
+		for (bla->levels = 1; bla->levels < levels; ++bla->levels)
+		{
+			level = bla->node + bla->levelOffset[bla->levels - 1] * a3perturb_blaStride;
+			bla->levelOffset[bla->levels] = bla->levelOffset[bla->levels - 1] + count;
+			count >>= 1;
+			bla->levelCount[bla->levels] = count;
+			for (j = 0; j < count; ++j, level += a3perturb_blaStride * 2, node += a3perturb_blaStride)
+				a3fractalBLAMerge(node, level, level + a3perturb_blaStride, radius);
+		}
+
+		bla->length = ref->length;
+		bla->epsilon = epsilon;
+		bla->radius = radius;
+		return 1;
+	}
+	return -1;
+}
+
+
+//-----------------------------------------------------------------------------
+// render
+
+// per-thread counters, merged after each pass
+typedef struct a3_PerturbCounters
+{
+	unsigned long long iterations, skipped, blaSteps;
+	unsigned int glitched;
+} a3_PerturbCounters;
+
+// one pass over all pending pixels against one reference
+typedef struct a3_PerturbPass
+{
+	const a3_FractalPerturbDesc *desc;
+	const a3_FractalReference *ref;
+	const a3_FractalBLATable *bla;
+	double refOffsetX, refOffsetY;
+	double tolerance2;
+	unsigned char *state;
+	float *ratio;
+	a3_PerturbCounters *counters;
+} a3_PerturbPass;
+
+
+// write outputs for a finished pixel
+static void a3fractalPerturbWrite(const a3_FractalPerturbDesc *desc, const unsigned int index, const unsigned int iter, const double mag)
+{
+	const float smooth = iter < desc->iterations
+		? (float)((double)iter - 1.0 - log2(log2(mag)))
+		: a3fractal_interior;
+	if (desc->smooth_out_opt)
+		desc->smooth_out_opt[index] = smooth;
+	if (desc->iter_out_opt)
+		desc->iter_out_opt[index] = iter;
+	if (desc->rgba_out_opt)
+		a3fractalShade(smooth, desc->rgba_out_opt + index * 4);
+}
+
+static void a3fractalPerturbTask(void *args, unsigned int x0, unsigned int y0, unsigned int x1, unsigned int y1, unsigned int workerIndex)
+{
+	const a3_PerturbPass *pass = (const a3_PerturbPass *)args;
+	const a3_FractalPerturbDesc *desc = pass->desc;
+	const a3_FractalBLATable *bla = pass->bla;
+	const double *orbit = pass->ref->orbit, *node, *skip = 0;
+	const unsigned int length = pass->ref->length, cap = desc->iterations;
+	const double dx = desc->view.width / (double)desc->width;
+	const double dy = desc->view.height / (double)desc->height;
+	const double tolerance2 = pass->tolerance2;
+	double dcu, dcv, du, dv, tu, tv, fu, fv, wu, wv, mag, full2, ref2;
+	a3_PerturbCounters counters = { 0 };
+	unsigned int x, y, m, k, j, index;
+	int escaped, glitch;
+
+	for (y = y0; y < y1; ++y)
+	{
+		dcv = a3perturb_sqrt3 * (((double)y + 0.5) * dy - 0.5 * desc->view.height - pass->refOffsetY);
+		for (x = x0, index = y * desc->width + x0; x < x1; ++x, ++index)
+		{
+			if (pass->state[index] != a3perturb_pending)
+				continue;
+
+			// difference from reference, z starts at c so d starts at dc
+			//	'm' counts steps taken; escaping after step m is loop index m - 1
+			dcu = 3.0 * (((double)x + 0.5) * dx - 0.5 * desc->view.width - pass->refOffsetX);
+			du = dcu;
+			dv = dcv;
+			mag = 0.0;
+			escaped = glitch = 0;
+			for (m = 0; m < cap; )
+			{
+				if (m >= length)
+				{
+					// reference escaped before this pixel did
+					pass->ratio[index] = 0.0f;
+					glitch = 1;
+					break;
+				}
+
+				// take the longest approximation starting here that is valid
+				//	for this difference and does not pass the cap; a run's
+				//	radius is at most its first half's, so levels are tried
+				//	upward and the first that fails ends the search
+				k = 0;
+				if (bla && !(m & 1))
+				{
+					full2 = du * du + dv * dv;
+					for (j = 1; j <= bla->levels && !(m & ((1u << j) - 1)) && (m >> j) < bla->levelCount[j - 1] && cap - m >= (1u << j); ++j)
+					{
+						node = bla->node + (bla->levelOffset[j - 1] + (m >> j)) * a3perturb_blaStride;
+						if (full2 >= node[4] * node[4])
+							break;
+						skip = node;
+						k = j;
+					}
+					if (k)
+					{
+						// d = A d + B dc
+						node = skip;
+						fu = node[0] * du - node[1] * dv + node[2] * dcu - node[3] * dcv;
+						dv = node[0] * dv + node[1] * du + node[2] * dcv + node[3] * dcu;
+						du = fu;
+						m += 1u << k;
+						counters.skipped += 1u << k;
+						++counters.blaSteps;
+					}
+				}
+				if (!k)
+				{
+					// d' = (2 W + d) d + dc
+					tu = 2.0 * orbit[m * 2] + du;
+					tv = 2.0 * orbit[m * 2 + 1] + dv;
+					fu = tu * du - tv * dv + dcu;
+					dv = tu * dv + tv * du + dcv;
+					du = fu;
+					++m;
+					++counters.iterations;
+				}
+
+				wu = orbit[m * 2];
+				wv = orbit[m * 2 + 1];
+				fu = wu + du;
+				fv = wv + dv;
+
+				// bailout measured in the shader's coordinates
+				mag = fu * fu * (1.0 / 9.0) + fv * fv * (1.0 / 3.0);
+				if (mag > a3fractal_bailout)
+				{
+					escaped = 1;
+					break;
+				}
+
+				// Pauldelbrot: full value tiny compared to reference
+				full2 = fu * fu + fv * fv;
+				ref2 = wu * wu + wv * wv;
+				if (full2 < tolerance2 * ref2)
+				{
+					pass->ratio[index] = (float)(full2 / ref2);
+					glitch = 1;
+					break;
+				}
+			}
+
+			if (glitch)
+			{
+				pass->state[index] = a3perturb_glitched;
+				++counters.glitched;
+			}
+			else
+			{
+				pass->state[index] = a3perturb_done;
+				a3fractalPerturbWrite(desc, index, escaped ? m - 1 : cap, mag);
+			}
+		}
+	}
+
+	pass->counters[workerIndex].iterations += counters.iterations;
+	pass->counters[workerIndex].skipped += counters.skipped;
+	pass->counters[workerIndex].blaSteps += counters.blaSteps;
+	pass->counters[workerIndex].glitched += counters.glitched;
+}
+
+// prepare acceleration for the pass's reference
+static int a3fractalPerturbPrepare(a3_PerturbPass *pass, a3_FractalReference *ref, const double epsilon, const double radius)
+{
+	pass->ref = ref;
+	pass->bla = 0;
+	if ((pass->desc->accel & a3fractal_accelBLA) && ref->length >= a3perturb_blaLengthMin)
+	{
+		if (a3fractalReferenceBuildBLA(ref, epsilon, radius) <= 0)
+			return 0;
+		if (ref->bla->valid)
+			pass->bla = ref->bla;
+	}
+	return 1;
+}
+
+int a3fractalPerturbRender(const a3_FractalPerturbDesc *desc, a3_FractalReference *ref, a3_ThreadPool *pool_opt, a3_FractalPerturbStats *stats_out_opt)
+{
+	a3_FractalPerturbStats stats = { 0 };
+	a3_FractalReference rebase[1] = { 0 };
+	a3_PerturbPass pass[1];
+	a3_MPFixed centerX[1], centerY[1];
+	double spacing, epsilon, radius;
+	unsigned int pixels, glitched, referenceMax, workers, index, best, i;
+	float bestRatio;
+	int result;
+
+	if (desc && ref && desc->width && desc->height)
+	{
+		pixels = desc->width * desc->height;
+		workers = a3threadPoolGetWorkerCount(pool_opt) + 1;
+		referenceMax = desc->referenceMax ? desc->referenceMax : a3fractal_referenceMax;
+
+		// largest |dc| for any reference inside the view, conjugated
+		spacing = a3minimum(desc->view.width / (double)desc->width, desc->view.height / (double)desc->height);
+		epsilon = desc->blaEpsilon > 0.0 ? desc->blaEpsilon : a3fractal_blaEpsilon;
+		radius = sqrt(9.0 * desc->view.width * desc->view.width + 3.0 * desc->view.height * desc->view.height);
+
+		pass->desc = desc;
+		pass->tolerance2 = desc->glitchTolerance > 0.0 ? desc->glitchTolerance : a3fractal_glitchTolerance;
+		pass->tolerance2 *= pass->tolerance2;
+		pass->state = (unsigned char *)malloc(pixels);
+		pass->ratio = (float *)malloc(pixels * sizeof(float));
+		pass->counters = (a3_PerturbCounters *)calloc(workers, sizeof(a3_PerturbCounters));
+		if (!pass->state || !pass->ratio || !pass->counters ||
+			a3fractalReferenceCompute(ref, &desc->view.centerX, &desc->view.centerY, spacing, a3maximum(desc->iterations, desc->iterationsMax)) <= 0 ||
+			!a3fractalPerturbPrepare(pass, ref, epsilon, radius))
+		{
+			free(pass->state);
+			free(pass->ratio);
+			free(pass->counters);
+			return 0;
+		}
+		memset(pass->state, a3perturb_pending, pixels);
+
+		// first reference at the view center
+		result = (int)pixels;
+		pass->refOffsetX = pass->refOffsetY = 0.0;
+		stats.referenceLength = ref->length;
+		stats.precision = ref->precision;
+		for (stats.references = 1; ; ++stats.references)
+		{
+			for (i = 0; i < workers; ++i)
+				pass->counters[i].glitched = 0;
+			if (a3threadPoolParallelFor2D(pool_opt, 0, a3fractalPerturbTask, pass, desc->width, desc->height, 32, 32) < 0)
+			{
+				result = 0;
+				break;
+			}
+			for (i = 0, glitched = 0; i < workers; ++i)
+				glitched += pass->counters[i].glitched;
+			if (stats.references == 1)
+				stats.glitched = glitched;
+			if (!glitched || stats.references >= referenceMax)
+				break;
+
+			// rebase: new reference at the deepest glitched pixel
+			best = pixels;
+			bestRatio = 2.0f;
+			for (index = 0; index < pixels; ++index)
+				if (pass->state[index] == a3perturb_glitched)
+				{
+					pass->state[index] = a3perturb_pending;
+					if (pass->ratio[index] < bestRatio)
+					{
+						bestRatio = pass->ratio[index];
+						best = index;
+					}
+				}
+			pass->refOffsetX = ((double)(best % desc->width) + 0.5) * desc->view.width / (double)desc->width - 0.5 * desc->view.width;
+			pass->refOffsetY = ((double)(best / desc->width) + 0.5) * desc->view.height / (double)desc->height - 0.5 * desc->view.height;
+			a3mpFixedAddDouble(centerX, &desc->view.centerX, pass->refOffsetX);
+			a3mpFixedAddDouble(centerY, &desc->view.centerY, pass->refOffsetY);
+			if (a3fractalReferenceCompute(rebase, centerX, centerY, spacing, desc->iterations) <= 0 ||
+				!a3fractalPerturbPrepare(pass, rebase, epsilon, radius))
+				break;
+		}
+
+		// a pass whose tiles could not be queued left pixels unrendered
+		if (result)
+		{
+			// whatever is still glitched is shown as interior
+			for (index = 0; index < pixels; ++index)
+				if (pass->state[index] != a3perturb_done)
+				{
+					a3fractalPerturbWrite(desc, index, desc->iterations, 0.0);
+					++stats.unresolved;
+				}
+			for (i = 0; i < workers; ++i)
+			{
+				stats.iterations += pass->counters[i].iterations;
+				stats.skipped += pass->counters[i].skipped;
+				stats.blaSteps += pass->counters[i].blaSteps;
+			}
+			if (stats_out_opt)
+				*stats_out_opt = stats;
+		}
+
+		a3fractalReferenceRelease(rebase);
+		free(pass->state);
+		free(pass->ratio);
+		free(pass->counters);
+		return result;
+	}
+	return -1;
+}
+
+
+//-----------------------------------------------------------------------------
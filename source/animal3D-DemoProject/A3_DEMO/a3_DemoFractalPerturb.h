@@ -0,0 +1,289 @@
+/*
+	animal3D SDK: Minimal 3D Animation Framework
+	Fractals Midterm: CPU fractal engines
+
+	a3_DemoFractalPerturb.h
+	Perturbation deep-zoom renderer for the Mandelbrot shader.
+
+	One reference orbit is computed in extended precision at a point in the
+	view; every pixel then iterates only its small difference from that
+	orbit in double precision, so the per-pixel cost does not depend on
+	depth. Pixels whose difference stops being small relative to the orbit
+	are flagged using Pauldelbrot's criterion and rendered again against a
+	new reference placed inside the glitched region.
+
+	The shader's map z' = (3x^2 - y^2, 6xy) + c is conjugate to z^2 + c
+	under u = 3x, v = sqrt(3)y; orbits and differences are stored in those
+	coordinates so the per-pixel step is the standard complex square.
+
+	Optionally, a table of bilinear approximations (BLA) over the reference
+	lets a pixel replace a run of 2^k steps with d = A d + B dc while its
+	difference is below the run's validity radius; runs are merged pairwise
+	into a binary tree so the longest valid run is found in a few tests.
+	This is what makes caps in the millions practical.
+
+	The view center is a fixed-point number whose limbs grow as the view
+	zooms in. The reference is computed in double-double, quad-double or
+	fixed-point depending on the pixel spacing, so only frames that need
+	the slow arithmetic pay for it.
+
+	Iteration semantics are those of 'uIter': the demo's 'fract_iter' is
+	the iteration cap and 'fract_iterMax' sizes the reference orbit, so
+	stepping 'fract_iter' up and down reuses the same reference.
+*/
+
+#ifndef __ANIMAL3D_DEMOFRACTALPERTURB_H
+#define __ANIMAL3D_DEMOFRACTALPERTURB_H
+
+
+#include "a3_DemoFractalEscape.h"
+#include "_utilities/a3_DemoMultiprecision.h"
+
+
+//-----------------------------------------------------------------------------
+
+#ifdef __cplusplus
+extern "C"
+{
+#else	// !__cplusplus
+	typedef struct a3_FractalDeepView			a3_FractalDeepView;
+	typedef struct a3_FractalBLATable			a3_FractalBLATable;
+	typedef struct a3_FractalReference			a3_FractalReference;
+	typedef struct a3_FractalPerturbDesc		a3_FractalPerturbDesc;
+	typedef struct a3_FractalPerturbStats		a3_FractalPerturbStats;
+	typedef enum a3_FractalAccelFlag			a3_FractalAccelFlag;
+	typedef enum a3_FractalPrecision			a3_FractalPrecision;
+#endif	// __cplusplus
+
+
+//-----------------------------------------------------------------------------
+
+	// default Pauldelbrot tolerance: a pixel is glitched when its value
+	//	falls below this fraction of the reference value
+#define a3fractal_glitchTolerance		1.0e-3
+
+	// default number of references per frame, including the first
+#define a3fractal_referenceMax			32
+
+	// default BLA tolerance (2^-46): relative size of the neglected d^2
+	//	term; looser tolerances let the error outgrow double rounding, and
+	//	pixels that linger near the set amplify it into different escape
+	//	iterations
+#define a3fractal_blaEpsilon			(1.0 / 70368744177664.0)
+
+	// most levels in a BLA table; level k skips 2^k steps
+#define a3fractal_blaLevelMax			31
+
+	// smallest pixel spacings the double-based reference arithmetic is
+	//	used for; below them the next type up is used
+#define a3fractal_precisionSpacingDD	1.0e-28
+#define a3fractal_precisionSpacingQD	1.0e-60
+
+
+	// acceleration stages for perturbation, combined as flags
+	enum a3_FractalAccelFlag
+	{
+		a3fractal_accelNone = 0x0,
+		a3fractal_accelBLA = 0x1,		// bilinear approximation skipping
+	};
+
+
+	// reference orbit arithmetic
+	enum a3_FractalPrecision
+	{
+		a3fractal_precisionDD,			// double-double, about 106 bits
+		a3fractal_precisionQD,			// quad-double, about 212 bits
+		a3fractal_precisionFixed,		// fixed-point, limbs set by spacing
+	};
+
+
+	// window into the complex plane with an extended-precision center
+	//	members centerX, centerY: center, both with the same limb count
+	//	members width, height: plane extent covered by the whole image
+	struct a3_FractalDeepView
+	{
+		a3_MPFixed centerX, centerY;
+		double width, height;
+	};
+
+
+	// bilinear approximation table over a reference orbit
+	//	member node: nodes of every level, 5 values each: A (complex),
+	//		B (complex) and validity radius
+	//	members levelOffset, levelCount: first node and number of nodes in
+	//		each level; entry k - 1 is level k, whose node j covers steps
+	//		[j 2^k, (j + 1) 2^k)
+	//	member levels: number of levels
+	//	member valid: number of level 1 nodes with a nonzero radius; a
+	//		run's radius is at most its first half's, so if this is zero
+	//		no node at any level is ever valid
+	//	members length, epsilon, radius: parameters it was built for
+	struct a3_FractalBLATable
+	{
+		double *node;
+		unsigned int levelOffset[a3fractal_blaLevelMax], levelCount[a3fractal_blaLevelMax];
+		unsigned int levels;
+		unsigned int valid;
+		unsigned int length;
+		double epsilon, radius;
+	};
+
+
+	// reference orbit, zero-initialize before first use
+	//	members centerX, centerY: point the orbit was computed for
+	//	member orbit: conjugated orbit points (u, v), 'length' + 1 of them
+	//	member capacity: number of steps the orbit buffer can hold
+	//	member length: number of steps computed
+	//	member escaped: orbit escaped at step 'length'
+	//	member precision: arithmetic the orbit is computed with
+	//	member limbs: fixed-point limb count, used with fixed-point only
+	//	member state: last point (x, y) for double-based arithmetic
+	//	member stateFixed: last point (x, y) for fixed-point
+	//	member bla: approximation table, built on demand
+	struct a3_FractalReference
+	{
+		a3_MPFixed centerX, centerY;
+		double *orbit;
+		unsigned int capacity, length;
+		int escaped;
+		a3_FractalPrecision precision;
+		unsigned int limbs;
+		a3_QuadDouble state[2];
+		a3_MPFixed stateFixed[2];
+		a3_FractalBLATable bla[1];
+	};
+
+
+	// perturbation render description
+	//	member view: extended-precision window into the complex plane
+	//	members width, height: image dimensions in pixels
+	//	member iterations: iteration cap, same meaning as 'uIter'
+	//	member iterationsMax: largest cap the reference is sized for; 0
+	//		sizes it to 'iterations'
+	//	member referenceMax: references allowed per frame; 0 uses default
+	//	member glitchTolerance: Pauldelbrot tolerance; 0 uses default
+	//	member accel: acceleration flags
+	//	member blaEpsilon: BLA tolerance; 0 uses default
+	//	members smooth_out_opt, iter_out_opt, rgba_out_opt: optional
+	//		outputs, same layout and meaning as the escape-time engine
+	struct a3_FractalPerturbDesc
+	{
+		a3_FractalDeepView view;
+		unsigned int width, height;
+		unsigned int iterations, iterationsMax;
+		unsigned int referenceMax;
+		double glitchTolerance;
+		unsigned int accel;
+		double blaEpsilon;
+		float *smooth_out_opt;
+		unsigned int *iter_out_opt;
+		unsigned char *rgba_out_opt;
+	};
+
+
+	// per-frame counters
+	//	member references: references used, including the first
+	//	member referenceLength: steps in the first reference
+	//	member precision: arithmetic of the first reference
+	//	member glitched: pixels flagged against the first reference
+	//	member unresolved: pixels still glitched when references ran out;
+	//		these are output as interior
+	//	member iterations: pixel iterations performed over all passes
+	//	member skipped: pixel iterations replaced by approximations
+	//	member blaSteps: approximations applied
+	struct a3_FractalPerturbStats
+	{
+		unsigned int references;
+		unsigned int referenceLength;
+		a3_FractalPrecision precision;
+		unsigned int glitched;
+		unsigned int unresolved;
+		unsigned long long iterations;
+		unsigned long long skipped;
+		unsigned long long blaSteps;
+	};
+
+
+//-----------------------------------------------------------------------------
+
+	// Set deep view to the one used by the shader.
+	//	param view_out: non-null pointer to view
+	//	return: 1 if success
+	//	return: -1 if invalid param
+	int a3fractalDeepViewSetDefault(a3_FractalDeepView *view_out);
+
+	// Move the view center to a pixel and scale the extent.
+	//	param view: non-null pointer to view
+	//	params width, height: image dimensions
+	//	params x, y: pixel coordinates of new center
+	//	param scale: extent multiplier; less than 1 zooms in
+	//	return: 1 if success
+	//	return: -1 if invalid params
+	int a3fractalDeepViewZoom(a3_FractalDeepView *view, unsigned int width, unsigned int height, double x, double y, double scale);
+
+	// Get the arithmetic a reference needs to resolve a pixel spacing.
+	//	param spacing: plane distance between neighbouring pixels
+	//	return: reference arithmetic
+	a3_FractalPrecision a3fractalReferencePrecision(double spacing);
+
+	// Compute or extend a reference orbit; an orbit already computed for
+	//	the same center and arithmetic is reused and extended if too short.
+	//	param ref: non-null pointer to reference
+	//	params centerX, centerY: non-null point with matching limb counts
+	//	param spacing: pixel spacing the orbit must resolve
+	//	param iterations: number of steps required; fewer are computed if
+	//		the orbit escapes first
+	//	return: 1 if success
+	//	return: 0 if fail (out of memory)
+	//	return: -1 if invalid params
+	int a3fractalReferenceCompute(a3_FractalReference *ref, const a3_MPFixed *centerX, const a3_MPFixed *centerY, double spacing, unsigned int iterations);
+
+	// Refine a point to the nucleus of a nearby hyperbolic component using
+	//	Newton's method on z_period(c) = 0, z_0 = 0; the orbit is iterated
+	//	in fixed-point and the derivative in doubles.
+	//	params centerX, centerY: non-null starting point with matching limb
+	//		counts, replaced by the nucleus; the limb count sets the accuracy
+	//	param period: period of the component
+	//	param steps: most Newton steps to take
+	//	return: 1 if converged
+	//	return: 0 if not converged (the point is left where it stopped)
+	//	return: -1 if invalid params
+	int a3fractalFindNucleus(a3_MPFixed *centerX, a3_MPFixed *centerY, unsigned int period, unsigned int steps);
+
+	// Build or reuse the approximation table for a reference orbit.
+	//	param ref: non-null pointer to computed reference
+	//	param epsilon: positive tolerance
+	//	param radius: largest |dc| the table must hold for, in conjugated
+	//		coordinates
+	//	return: 1 if success
+	//	return: 0 if fail (out of memory)
+	//	return: -1 if invalid params
+	int a3fractalReferenceBuildBLA(a3_FractalReference *ref, double epsilon, double radius);
+
+	// Release a reference orbit and its table.
+	//	param ref: non-null pointer to reference
+	//	return: 1 if success
+	//	return: -1 if invalid params
+	int a3fractalReferenceRelease(a3_FractalReference *ref);
+
+	// Render an image using perturbation.
+	//	param desc: non-null pointer to render description
+	//	param ref: non-null pointer to reference kept between frames; it is
+	//		placed at the view center
+	//	param pool_opt: optional pool; renders on this thread if null
+	//	param stats_out_opt: optional pointer to frame counters
+	//	return: number of pixels rendered if success
+	//	return: 0 if fail (out of memory)
+	//	return: -1 if invalid params
+	int a3fractalPerturbRender(const a3_FractalPerturbDesc *desc, a3_FractalReference *ref, a3_ThreadPool *pool_opt, a3_FractalPerturbStats *stats_out_opt);
+
+
+//-----------------------------------------------------------------------------
+
+
+#ifdef __cplusplus
+}
+#endif	// __cplusplus
+
+
+#endif	// !__ANIMAL3D_DEMOFRACTALPERTURB_H
@@ -0,0 +1,553 @@
+/*
+	animal3D SDK: Minimal 3D Animation Framework
+	Fractals Midterm: CPU fractal engines
+
+	a3_DemoFractalPolynomial.c
+	Polynomial Newton-fractal implementation.
+
+	C has no templates, so the degree is specialized the C way: one
+	force-inlined kernel body takes the degree as a parameter, and a small
+	wrapper per degree 2 to 8 calls it with a literal; the optimizer then
+	sees a constant trip count and unrolls the Horner loop. The generic
+	wrapper passes the polynomial's own degree.
+
+	A pixel has converged when its Newton step is shorter than the
+	tolerance; it is then classified against the nearest precomputed
+	root, so no root is tested while iterating. The exception is a
+	polynomial with a repeated root: until a pixel comes within capture
+	range of one, each step checks whether it has, and from then on the
+	step is scaled by that root's multiplicity. Pixels iterate in double
+	precision, which high-degree polynomials need near their roots.
+*/
+
+#include "a3_DemoFractalPolynomial.h"
+
+#include "animal3D/a3/a3macros.h"
+
+#include <math.h>
+#include <stdlib.h>
+
+
+//-----------------------------------------------------------------------------
+
+#ifdef _MSC_VER
+#define a3poly_inline	static __forceinline
+#else	// !_MSC_VER
+#define a3poly_inline	static inline __attribute__((always_inline))
+#endif	// _MSC_VER
+
+// pixels handed to a kernel at once
+#define a3poly_span		64
+
+// tile edge for pooled renders
+#define a3poly_tile		32
+
+// a converged pixel belongs to the nearest root if it is within this
+//	many tolerances of it; multiple roots converge slowly and stop short
+#define a3poly_classify	8.0
+
+// Aberth-Ehrlich also stops moving a root whose step is this small,
+//	relative to the root
+#define a3poly_aberthEpsilon	1.0e-15
+
+// a repeated root captures pixels within this fraction of the distance to
+//	the nearest other root
+#define a3poly_capture	0.25
+
+
+// one frame; counters are per thread, merged after the frame
+typedef struct a3_PolyPass
+{
+	const a3_FractalPolyNewtonDesc *desc;
+	double tol2, a, logTol2;
+	a3_FractalNewtonStats *counters;
+
+	// squared capture radius per root, 0 for simple roots; 'repeated'
+	//	is set if any root is captured at all
+	double capture2[a3fractal_polyDegreeMax];
+	int repeated;
+} a3_PolyPass;
+
+// kernel: step 'count' pixels on one row
+typedef void(*a3_FractalPolySpanFunc)(const a3_PolyPass *pass, const double *cx, const double cy, const unsigned int count, unsigned char *root_out, unsigned int *steps_out, float *smooth_out, a3_FractalNewtonStats *stats);
+
+
+//-----------------------------------------------------------------------------
+// polynomial
+
+// f and f' at z in one Horner pass; also returns the rounding error
+//	bound of f, sum |c_k| |z|^k, scaled to its last bit
+static double a3fractalPolynomialHorner(const a3_FractalPolynomial *poly, const double x, const double y, double *f, double *df)
+{
+	const double r = sqrt(x * x + y * y);
+	double fx = poly->coeffRe[poly->degree], fy = poly->coeffIm[poly->degree], dx = 0.0, dy = 0.0, t;
+	double bound = sqrt(fx * fx + fy * fy);
+	unsigned int k;
+	for (k = poly->degree; k-- > 0;)
+	{
+		bound = bound * r + sqrt(poly->coeffRe[k] * poly->coeffRe[k] + poly->coeffIm[k] * poly->coeffIm[k]);
+		t = dx * x - dy * y + fx;
+		dy = dx * y + dy * x + fy;
+		dx = t;
+		t = fx * x - fy * y + poly->coeffRe[k];
+		fy = fx * y + fy * x + poly->coeffIm[k];
+		fx = t;
+	}
+	f[0] = fx;
+	f[1] = fy;
+	df[0] = dx;
+	df[1] = dy;
+	return (bound * 4.0 * (double)poly->degree * 2.2204460492503131e-16);
+}
+
+// find all roots at once by Aberth-Ehrlich
+static int a3fractalPolynomialAberth(a3_FractalPolynomial *poly)
+{
+	const unsigned int n = poly->degree;
+	const double lead = poly->coeffRe[n] * poly->coeffRe[n] + poly->coeffIm[n] * poly->coeffIm[n];
+	double f[2], df[2], wx, wy, sx, sy, ex, ey, den, ox, oy, radius = 0.0, angle, bound;
+	unsigned char done[a3fractal_polyDegreeMax] = { 0 };
+	unsigned int i, j, iter, left;
+
+	// start on a circle inside the Cauchy bound, off the real axis so
+	//	conjugate pairs are not started symmetric
+	for (i = 0; i < n; ++i)
+		radius = a3maximum(radius, sqrt((poly->coeffRe[i] * poly->coeffRe[i] + poly->coeffIm[i] * poly->coeffIm[i]) / lead));
+	radius = 1.0 + radius;
+	for (i = 0; i < n; ++i)
+	{
+		angle = 6.283185307179586 * (double)i / (double)n + 0.4;
+		poly->rootRe[i] = radius * cos(angle);
+		poly->rootIm[i] = radius * sin(angle);
+	}
+
+	for (iter = 0; iter < a3fractal_polyAberthMax; ++iter)
+	{
+		left = 0;
+		for (i = 0; i < n; ++i)
+		{
+			// a root is done once f is down to its own rounding error;
+			//	done roots still repel the others
+			if (done[i])
+				continue;
+			bound = a3fractalPolynomialHorner(poly, poly->rootRe[i], poly->rootIm[i], f, df);
+			if (f[0] * f[0] + f[1] * f[1] <= bound * bound)
+			{
+				done[i] = 1;
+				continue;
+			}
+			++left;
+			den = df[0] * df[0] + df[1] * df[1];
+			if (den == 0.0)
+			{
+				// stationary point: nudge off it
+				poly->rootRe[i] += 1.0e-8 * radius;
+				continue;
+			}
+
+			// w = f / f', s = sum of 1 / (z_i - z_j)
+			wx = (f[0] * df[0] + f[1] * df[1]) / den;
+			wy = (f[1] * df[0] - f[0] * df[1]) / den;
+			sx = sy = 0.0;
+			for (j = 0; j < n; ++j)
+				if (j != i)
+				{
+					ex = poly->rootRe[i] - poly->rootRe[j];
+					ey = poly->rootIm[i] - poly->rootIm[j];
+					den = ex * ex + ey * ey;
+					if (den > 0.0)
+					{
+						sx += ex / den;
+						sy -= ey / den;
+					}
+				}
+
+			// offset = w / (1 - w s); plain Newton if that is singular
+			ex = 1.0 - (wx * sx - wy * sy);
+			ey = -(wx * sy + wy * sx);
+			den = ex * ex + ey * ey;
+			if (den > 0.0)
+			{
+				ox = (wx * ex + wy * ey) / den;
+				oy = (wy * ex - wx * ey) / den;
+			}
+			else
+			{
+				ox = wx;
+				oy = wy;
+			}
+			poly->rootRe[i] -= ox;
+			poly->rootIm[i] -= oy;
+			if (ox * ox + oy * oy <= a3poly_aberthEpsilon * a3poly_aberthEpsilon * (poly->rootRe[i] * poly->rootRe[i] + poly->rootIm[i] * poly->rootIm[i]))
+				done[i] = 1;
+		}
+		if (!left)
+			return 1;
+	}
+	return 0;
+}
+
+// merge estimates of the same root: single-link clusters of roots within
+//	'a3fractal_polyRootMerge' of each other become their mean, with the
+//	cluster size as its multiplicity; input is 'degree' roots, output
+//	'rootCount'
+static void a3fractalPolynomialMerge(a3_FractalPolynomial *poly)
+{
+	const unsigned int n = poly->degree;
+	double rootRe[a3fractal_polyDegreeMax], rootIm[a3fractal_polyDegreeMax], ex, ey, r;
+	unsigned char cluster[a3fractal_polyDegreeMax], member[a3fractal_polyDegreeMax];
+	unsigned int i, j, k, count, members;
+
+	for (i = 0; i < n; ++i)
+	{
+		rootRe[i] = poly->rootRe[i];
+		rootIm[i] = poly->rootIm[i];
+		cluster[i] = 0xff;
+	}
+	for (i = 0, count = 0; i < n; ++i)
+		if (cluster[i] == 0xff)
+		{
+			// grow the cluster until no other root is near any member
+			cluster[i] = (unsigned char)count;
+			member[0] = (unsigned char)i;
+			for (k = 0, members = 1; k < members; ++k)
+				for (j = i + 1; j < n; ++j)
+					if (cluster[j] == 0xff)
+					{
+						ex = rootRe[j] - rootRe[member[k]];
+						ey = rootIm[j] - rootIm[member[k]];
+						r = 1.0 + sqrt(rootRe[j] * rootRe[j] + rootIm[j] * rootIm[j]);
+						if (ex * ex + ey * ey <= a3fractal_polyRootMerge * a3fractal_polyRootMerge * r * r)
+						{
+							cluster[j] = (unsigned char)count;
+							member[members++] = (unsigned char)j;
+						}
+					}
+
+			ex = ey = 0.0;
+			for (k = 0; k < members; ++k)
+			{
+				ex += rootRe[member[k]];
+				ey += rootIm[member[k]];
+			}
+			poly->rootRe[count] = ex / (double)members;
+			poly->rootIm[count] = ey / (double)members;
+			poly->rootMultiplicity[count] = (unsigned char)members;
+			++count;
+		}
+	poly->rootCount = count;
+}
+
+
+int a3fractalPolynomialSetCoefficients(a3_FractalPolynomial *poly, const double *coeffRe, const double *coeffIm_opt, unsigned int degree)
+{
+	unsigned int k;
+	int result;
+	if (poly && coeffRe && degree >= 1 && degree <= a3fractal_polyDegreeMax &&
+		(coeffRe[degree] != 0.0 || (coeffIm_opt && coeffIm_opt[degree] != 0.0)))
+	{
+		poly->degree = degree;
+		for (k = 0; k <= degree; ++k)
+		{
+			poly->coeffRe[k] = coeffRe[k];
+			poly->coeffIm[k] = coeffIm_opt ? coeffIm_opt[k] : 0.0;
+		}
+		result = a3fractalPolynomialAberth(poly);
+		a3fractalPolynomialMerge(poly);
+		return result;
+	}
+	return -1;
+}
+
+int a3fractalPolynomialSetRoots(a3_FractalPolynomial *poly, const double *rootRe, const double *rootIm_opt, unsigned int count)
+{
+	double rx, ry, t;
+	unsigned int i, k;
+	if (poly && rootRe && count >= 1 && count <= a3fractal_polyDegreeMax)
+	{
+		// multiply out (z - r_0)(z - r_1)...
+		poly->degree = count;
+		poly->coeffRe[0] = 1.0;
+		poly->coeffIm[0] = 0.0;
+		for (i = 0; i < count; ++i)
+		{
+			rx = rootRe[i];
+			ry = rootIm_opt ? rootIm_opt[i] : 0.0;
+			poly->rootRe[i] = rx;
+			poly->rootIm[i] = ry;
+			poly->coeffRe[i + 1] = poly->coeffRe[i];
+			poly->coeffIm[i + 1] = poly->coeffIm[i];
+			for (k = i; k > 0; --k)
+			{
+				t = poly->coeffRe[k - 1] - (rx * poly->coeffRe[k] - ry * poly->coeffIm[k]);
+				poly->coeffIm[k] = poly->coeffIm[k - 1] - (rx * poly->coeffIm[k] + ry * poly->coeffRe[k]);
+				poly->coeffRe[k] = t;
+			}
+			t = -(rx * poly->coeffRe[0] - ry * poly->coeffIm[0]);
+			poly->coeffIm[0] = -(rx * poly->coeffIm[0] + ry * poly->coeffRe[0]);
+			poly->coeffRe[0] = t;
+		}
+		a3fractalPolynomialMerge(poly);
+		return 1;
+	}
+	return -1;
+}
+
+int a3fractalPolynomialEvaluate(const a3_FractalPolynomial *poly, double x, double y, double *f_out, double *df_out_opt)
+{
+	double df[2];
+	if (poly && poly->degree >= 1 && poly->degree <= a3fractal_polyDegreeMax && f_out)
+	{
+		a3fractalPolynomialHorner(poly, x, y, f_out, df_out_opt ? df_out_opt : df);
+		return 1;
+	}
+	return -1;
+}
+
+
+//-----------------------------------------------------------------------------
+// kernels
+
+a3poly_inline void a3fractalPolySpan(const a3_PolyPass *pass, const unsigned int degree, const double *cx, const double cy, const unsigned int count, unsigned char *root_out, unsigned int *steps_out, float *smooth_out, a3_FractalNewtonStats *stats)
+{
+	const a3_FractalPolynomial *poly = pass->desc->poly;
+	const double *cr = poly->coeffRe, *ci = poly->coeffIm;
+	const unsigned int cap = pass->desc->iterations;
+	const double a = pass->a, tol2 = pass->tol2;
+	double zx, zy, fx, fy, dx, dy, t, den, qx, qy, step2, best, dist, m;
+	unsigned int i, k, steps, root;
+
+	for (i = 0; i < count; ++i)
+	{
+		zx = cx[i];
+		zy = cy;
+		step2 = 0.0;
+		m = a;
+		root = a3fractal_newtonNoRoot;
+		for (steps = 0; steps < cap; )
+		{
+			// once near a repeated root, step by its multiplicity
+			if (pass->repeated && m == a)
+				for (k = 0; k < poly->rootCount; ++k)
+				{
+					dist = (zx - poly->rootRe[k]) * (zx - poly->rootRe[k]) + (zy - poly->rootIm[k]) * (zy - poly->rootIm[k]);
+					if (dist < pass->capture2[k])
+					{
+						m = a * (double)poly->rootMultiplicity[k];
+						break;
+					}
+				}
+
+			// Horner for f and f' together
+			fx = cr[degree];
+			fy = ci[degree];
+			dx = dy = 0.0;
+			for (k = degree; k-- > 0;)
+			{
+				t = dx * zx - dy * zy + fx;
+				dy = dx * zy + dy * zx + fy;
+				dx = t;
+				t = fx * zx - fy * zy + cr[k];
+				fy = fx * zy + fy * zx + ci[k];
+				fx = t;
+			}
+			den = dx * dx + dy * dy;
+			if (den == 0.0)
+			{
+				// landed exactly on a repeated root, or stuck on a zero of
+				//	f' that is not a root: counts as never converging
+				if (fx == 0.0 && fy == 0.0)
+				{
+					step2 = 0.0;
+					root = 0;
+				}
+				else
+					steps = cap;
+				break;
+			}
+
+			// z -= a m f / f'
+			qx = m * (fx * dx + fy * dy) / den;
+			qy = m * (fy * dx - fx * dy) / den;
+			zx -= qx;
+			zy -= qy;
+			++steps;
+			step2 = qx * qx + qy * qy;
+			if (step2 < tol2)
+			{
+				root = 0;
+				break;
+			}
+		}
+
+		// nearest root, if close enough
+		if (root == 0)
+		{
+			best = tol2 * a3poly_classify * a3poly_classify;
+			root = a3fractal_newtonNoRoot;
+			for (k = 0; k < poly->rootCount; ++k)
+			{
+				dist = (zx - poly->rootRe[k]) * (zx - poly->rootRe[k]) + (zy - poly->rootIm[k]) * (zy - poly->rootIm[k]);
+				if (dist < best)
+				{
+					best = dist;
+					root = k;
+				}
+			}
+		}
+
+		stats->steps += steps;
+		root_out[i] = (unsigned char)root;
+		steps_out[i] = steps;
+		smooth_out[i] = (float)steps;
+		if (root != a3fractal_newtonNoRoot)
+		{
+			++stats->converged;
+			smooth_out[i] -= (float)(log2(log(a3maximum(step2, 1.0e-300)) / pass->logTol2));
+		}
+	}
+}
+
+#define A3_POLY_KERNEL(n)	\
+static void a3fractalPolySpan_##n(const a3_PolyPass *pass, const double *cx, const double cy, const unsigned int count, unsigned char *root_out, unsigned int *steps_out, float *smooth_out, a3_FractalNewtonStats *stats)	\
+{	\
+	a3fractalPolySpan(pass, n, cx, cy, count, root_out, steps_out, smooth_out, stats);	\
+}
+A3_POLY_KERNEL(2)
+A3_POLY_KERNEL(3)
+A3_POLY_KERNEL(4)
+A3_POLY_KERNEL(5)
+A3_POLY_KERNEL(6)
+A3_POLY_KERNEL(7)
+A3_POLY_KERNEL(8)
+#undef A3_POLY_KERNEL
+
+static void a3fractalPolySpan_generic(const a3_PolyPass *pass, const double *cx, const double cy, const unsigned int count, unsigned char *root_out, unsigned int *steps_out, float *smooth_out, a3_FractalNewtonStats *stats)
+{
+	a3fractalPolySpan(pass, pass->desc->poly->degree, cx, cy, count, root_out, steps_out, smooth_out, stats);
+}
+
+// kernel table, indexed by degree
+static const a3_FractalPolySpanFunc a3fractalPolySpanFuncs[9] = {
+	a3fractalPolySpan_generic,
+	a3fractalPolySpan_generic,
+	a3fractalPolySpan_2,
+	a3fractalPolySpan_3,
+	a3fractalPolySpan_4,
+	a3fractalPolySpan_5,
+	a3fractalPolySpan_6,
+	a3fractalPolySpan_7,
+	a3fractalPolySpan_8,
+};
+
+
+//-----------------------------------------------------------------------------
+// render
+
+static void a3fractalPolyNewtonTask(void *args, unsigned int x0, unsigned int y0, unsigned int x1, unsigned int y1, unsigned int workerIndex)
+{
+	const a3_PolyPass *pass = (const a3_PolyPass *)args;
+	const a3_FractalPolyNewtonDesc *desc = pass->desc;
+	const unsigned int degree = desc->poly->degree;
+	const a3_FractalPolySpanFunc span = a3fractalPolySpanFuncs[degree <= 8 ? degree : 0];
+	const double dx = desc->view.width / (double)desc->width;
+	const double dy = desc->view.height / (double)desc->height;
+	const double left = desc->view.centerX - 0.5 * desc->view.width;
+	const double bottom = desc->view.centerY - 0.5 * desc->view.height;
+	double cx[a3poly_span], cy;
+	float smooth[a3poly_span];
+	unsigned int steps[a3poly_span];
+	unsigned char root[a3poly_span];
+	a3_FractalNewtonStats stats = { 0 };
+	unsigned int x, y, i, n, index;
+
+	for (y = y0; y < y1; ++y)
+	{
+		cy = bottom + ((double)y + 0.5) * dy;
+		for (x = x0; x < x1; x += n)
+		{
+			n = a3minimum(a3poly_span, x1 - x);
+			for (i = 0; i < n; ++i)
+				cx[i] = left + ((double)(x + i) + 0.5) * dx;
+			span(pass, cx, cy, n, root, steps, smooth, &stats);
+
+			index = y * desc->width + x;
+			for (i = 0; i < n; ++i, ++index)
+			{
+				if (desc->root_out_opt)
+					desc->root_out_opt[index] = root[i];
+				if (desc->steps_out_opt)
+					desc->steps_out_opt[index] = steps[i];
+				if (desc->smooth_out_opt)
+					desc->smooth_out_opt[index] = smooth[i];
+				if (desc->rgba_out_opt)
+					a3fractalShadeRoot(root[i], desc->poly->rootCount, smooth[i], desc->rgba_out_opt + index * 4);
+			}
+		}
+	}
+
+	pass->counters[workerIndex].converged += stats.converged;
+	pass->counters[workerIndex].steps += stats.steps;
+}
+
+int a3fractalPolyNewtonRender(const a3_FractalPolyNewtonDesc *desc, a3_ThreadPool *pool_opt, a3_FractalNewtonStats *stats_out_opt)
+{
+	a3_FractalNewtonStats stats = { 0 };
+	a3_PolyPass pass[1];
+	unsigned int workers, i, k;
+	double tol, dx, dy;
+
+	if (desc && desc->width && desc->height && desc->poly && desc->poly->degree >= 1 && desc->poly->degree <= a3fractal_polyDegreeMax &&
+		desc->poly->rootCount >= 1 && desc->poly->rootCount <= desc->poly->degree)
+	{
+		workers = a3threadPoolGetWorkerCount(pool_opt) + 1;
+		pass->counters = (a3_FractalNewtonStats *)calloc(workers, sizeof(a3_FractalNewtonStats));
+		if (!pass->counters)
+			return 0;
+		tol = desc->tolerance > 0.0f ? (double)desc->tolerance : (double)a3fractal_newtonTolerance;
+		pass->desc = desc;
+		pass->tol2 = tol * tol;
+		pass->logTol2 = log(pass->tol2);
+		pass->a = desc->relaxation > 0.0f ? (double)desc->relaxation : 1.0;
+
+		// a repeated root captures within a fraction of the way to its
+		//	nearest neighbour; a lone root captures everything
+		pass->repeated = 0;
+		for (i = 0; i < desc->poly->rootCount; ++i)
+		{
+			pass->capture2[i] = 0.0;
+			if (desc->poly->rootMultiplicity[i] > 1)
+			{
+				pass->capture2[i] = 1.0e300;
+				for (k = 0; k < desc->poly->rootCount; ++k)
+					if (k != i)
+					{
+						dx = desc->poly->rootRe[k] - desc->poly->rootRe[i];
+						dy = desc->poly->rootIm[k] - desc->poly->rootIm[i];
+						pass->capture2[i] = a3minimum(pass->capture2[i], (dx * dx + dy * dy) * a3poly_capture * a3poly_capture);
+					}
+				pass->repeated = 1;
+			}
+		}
+		if (a3threadPoolParallelFor2D(pool_opt, 0, a3fractalPolyNewtonTask, pass, desc->width, desc->height, a3poly_tile, a3poly_tile) < 0)
+		{
+			free(pass->counters);
+			return 0;
+		}
+
+		for (i = 0; i < workers; ++i)
+		{
+			stats.converged += pass->counters[i].converged;
+			stats.steps += pass->counters[i].steps;
+		}
+		if (stats_out_opt)
+			*stats_out_opt = stats;
+
+		free(pass->counters);
+		return (int)(desc->width * desc->height);
+	}
+	return -1;
+}
+
+
+//-----------------------------------------------------------------------------
@@ -0,0 +1,144 @@
+/*
+	animal3D SDK: Minimal 3D Animation Framework
+	Fractals Midterm: CPU fractal engines
+
+	a3_DemoFractalPolynomial.h
+	Newton fractals for arbitrary complex polynomials.
+
+	The Julia shader hard-codes z^3 - 1 in 'fractal' and 'fractal_deriv'
+	(with 2z^2 for the derivative) and classifies against hand-written root
+	constants. Here a polynomial is given by its coefficients or its
+	roots; f and f' are evaluated together in one Horner pass, and the
+	roots used to classify basins are found once, up front, with the
+	Aberth-Ehrlich method. Estimates of a repeated root are merged into one
+	root with a multiplicity m, and pixels near it take the step m f / f',
+	which keeps convergence quadratic and the basin one color. Kernels are instantiated for degrees 2 to 8 so
+	the Horner loop unrolls completely; other degrees take a generic path.
+*/
+
+#ifndef __ANIMAL3D_DEMOFRACTALPOLYNOMIAL_H
+#define __ANIMAL3D_DEMOFRACTALPOLYNOMIAL_H
+
+
+#include "a3_DemoFractalNewton.h"
+
+
+//-----------------------------------------------------------------------------
+
+#ifdef __cplusplus
+extern "C"
+{
+#else	// !__cplusplus
+	typedef struct a3_FractalPolynomial			a3_FractalPolynomial;
+	typedef struct a3_FractalPolyNewtonDesc		a3_FractalPolyNewtonDesc;
+#endif	// __cplusplus
+
+
+//-----------------------------------------------------------------------------
+
+	// highest supported degree
+#define a3fractal_polyDegreeMax			64
+
+	// largest Aberth-Ehrlich iteration count before giving up
+#define a3fractal_polyAberthMax			500
+
+	// roots closer than this, relative to 1 + |root|, are one repeated
+	//	root; Aberth-Ehrlich only resolves a root of multiplicity m to
+	//	about the m-th root of machine epsilon
+#define a3fractal_polyRootMerge			1.0e-3
+
+
+	// complex polynomial and its roots
+	//	member degree: degree, at least 1
+	//	members coeffRe, coeffIm: coefficient of z^k at index k
+	//	member rootCount: number of distinct roots
+	//	members rootRe, rootIm: distinct roots, 'rootCount' of them
+	//	member rootMultiplicity: times each root repeats; sums to 'degree'
+	struct a3_FractalPolynomial
+	{
+		unsigned int degree, rootCount;
+		double coeffRe[a3fractal_polyDegreeMax + 1], coeffIm[a3fractal_polyDegreeMax + 1];
+		double rootRe[a3fractal_polyDegreeMax], rootIm[a3fractal_polyDegreeMax];
+		unsigned char rootMultiplicity[a3fractal_polyDegreeMax];
+	};
+
+
+	// polynomial Newton render description
+	//	member view: window into the complex plane
+	//	members width, height: image dimensions in pixels
+	//	member iterations: step cap
+	//	member tolerance: convergence step length; 0 uses default
+	//	member relaxation: step scale, z -= a f / f'; 0 means 1
+	//	member poly: non-null pointer to polynomial
+	//	member root_out_opt: optional distinct root index per pixel, or
+	//		'a3fractal_newtonNoRoot'
+	//	member steps_out_opt: optional steps taken per pixel; pixels that
+	//		never converge, or land on a zero of f', store 'iterations'
+	//	member smooth_out_opt: optional fractional convergence time
+	//	member rgba_out_opt: optional 8-bit RGBA color per pixel
+	// all buffers are row-major, row 0 at the bottom (texcoord v = 0)
+	struct a3_FractalPolyNewtonDesc
+	{
+		a3_FractalView view;
+		unsigned int width, height;
+		unsigned int iterations;
+		float tolerance;
+		float relaxation;
+		const a3_FractalPolynomial *poly;
+		unsigned char *root_out_opt;
+		unsigned int *steps_out_opt;
+		float *smooth_out_opt;
+		unsigned char *rgba_out_opt;
+	};
+
+
+//-----------------------------------------------------------------------------
+
+	// Set a polynomial from its coefficients and find its roots.
+	//	param poly: non-null pointer to polynomial
+	//	params coeffRe, coeffIm: coefficient of z^k at index k; imaginary
+	//		parts are optional (null means all real)
+	//	param degree: degree, 1 to 'a3fractal_polyDegreeMax'; the leading
+	//		coefficient must not be zero
+	//	return: 1 if success
+	//	return: 0 if the roots did not all converge (best estimates kept)
+	//	return: -1 if invalid params
+	int a3fractalPolynomialSetCoefficients(a3_FractalPolynomial *poly, const double *coeffRe, const double *coeffIm_opt, unsigned int degree);
+
+	// Set a monic polynomial from its roots.
+	//	param poly: non-null pointer to polynomial
+	//	params rootRe, rootIm: roots, repeated ones listed again;
+	//		imaginary parts are optional
+	//	param count: number of roots, 1 to 'a3fractal_polyDegreeMax'
+	//	return: 1 if success
+	//	return: -1 if invalid params
+	int a3fractalPolynomialSetRoots(a3_FractalPolynomial *poly, const double *rootRe, const double *rootIm_opt, unsigned int count);
+
+	// Evaluate a polynomial and its derivative at a point.
+	//	param poly: non-null pointer to polynomial
+	//	params x, y: point
+	//	param f_out: non-null pointer to 2 doubles, f(z)
+	//	param df_out_opt: optional pointer to 2 doubles, f'(z)
+	//	return: 1 if success
+	//	return: -1 if invalid params
+	int a3fractalPolynomialEvaluate(const a3_FractalPolynomial *poly, double x, double y, double *f_out, double *df_out_opt);
+
+	// Render the Newton fractal of a polynomial as tiles over a pool.
+	//	param desc: non-null pointer to render description
+	//	param pool_opt: optional pool; renders on this thread if null
+	//	param stats_out_opt: optional pointer to frame counters
+	//	return: number of pixels rendered if success
+	//	return: 0 if fail (out of memory)
+	//	return: -1 if invalid params
+	int a3fractalPolyNewtonRender(const a3_FractalPolyNewtonDesc *desc, a3_ThreadPool *pool_opt, a3_FractalNewtonStats *stats_out_opt);
+
+
+//-----------------------------------------------------------------------------
+
+
+#ifdef __cplusplus
+}
+#endif	// __cplusplus
+
+
+#endif	// !__ANIMAL3D_DEMOFRACTALPOLYNOMIAL_H
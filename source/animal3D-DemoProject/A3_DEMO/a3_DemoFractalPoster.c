@@ -0,0 +1,611 @@
+/*
+	animal3D SDK: Minimal 3D Animation Framework
+	Fractals Midterm: CPU fractal engines
+
+	a3_DemoFractalPoster.c
+	Out-of-core poster implementation.
+
+	A band is rendered bottom row first, as every engine's buffers are,
+	and written top row first, as files are; band 0 is the top of the
+	poster. Each band reuses the engines' own descriptions, cut down to
+	its rows: the escape-time and Newton descriptions keep the whole
+	poster's view and size and are offset to the band's first row, and
+	the Menger camera is told the band is part of a larger frame. Only the
+	band's rows are rendered, so every pixel center is the one a single
+	render of the whole poster would use.
+
+	The PNG encoder is written for bands, not for ratio. Each row takes
+	whichever of the five PNG filters leaves the smallest sum of bytes,
+	except a band's first, which has no row above it in the band and
+	takes none or Sub. The filtered rows are compressed by LZ77 over a
+	hash of the last position of each three bytes, one probe per byte,
+	coded with deflate's fixed Huffman codes; smooth fractal regions
+	filter to runs of small values, which is most of what is won. The
+	band then ends with an empty stored block, which byte-aligns it
+	without ending the stream, and goes out as its own IDAT chunk with
+	its CRC already taken. The writer only combines the bands' Adler-32
+	checksums, which needs their lengths and not their bytes.
+*/
+
+#include "a3_DemoFractalPoster.h"
+#include "a3_DemoFractalNewton.h"
+#include "a3_DemoFractalMenger.h"
+
+#include "animal3D/a3/a3macros.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+
+//-----------------------------------------------------------------------------
+
+// the Julia shader's step scale, see 'a3_DemoFractalNewton.h'
+#define a3poster_newtonRelaxation	1.5f
+
+// deflate limits: window, match lengths, hash size
+#define a3poster_window			32768
+#define a3poster_matchMin		3
+#define a3poster_matchMax		258
+#define a3poster_hashBits		15
+
+// Adler-32 modulus and bytes summed before reducing
+#define a3poster_adlerBase		65521u
+#define a3poster_adlerRun		5552u
+
+
+// one poster
+typedef struct a3_PosterPass
+{
+	const a3_FractalPosterDesc *desc;
+	unsigned int bandRows, bandCount;
+	size_t rowBytes;
+} a3_PosterPass;
+
+// one band slot: the band in it, its buffers and its output
+//	member group: counts the band's task while it runs
+//	member index, rows: band and its height
+//	member rgba: rendered band, bottom row first
+//	member raw: file rows, top row first; PNG rows start with a filter
+//	member out: bytes to write; for PNG a whole IDAT chunk
+//	member head: last position of each hash, for LZ77
+//	members size, rawSize: bytes in 'out' and 'raw'
+//	member adler: checksum of 'raw'
+typedef struct a3_PosterBand
+{
+	a3_ThreadPoolGroup group;
+	const a3_PosterPass *pass;
+	unsigned int index, rows;
+	unsigned char *rgba, *raw, *out;
+	int *head;
+	size_t size, rawSize;
+	unsigned int adler;
+} a3_PosterBand;
+
+
+// bit stream, least significant bit first
+typedef struct a3_PosterBits
+{
+	unsigned char *out;
+	size_t size;
+	unsigned long long bits;
+	unsigned int count;
+} a3_PosterBits;
+
+
+//-----------------------------------------------------------------------------
+// checksums
+
+// CRC-32 of each byte value, polynomial 0xedb88320 (PNG, zlib)
+static const unsigned int a3posterCRCTable[256] = {
+	0x00000000u, 0x77073096u, 0xee0e612cu, 0x990951bau, 0x076dc419u, 0x706af48fu, 0xe963a535u, 0x9e6495a3u,
+	0x0edb8832u, 0x79dcb8a4u, 0xe0d5e91eu, 0x97d2d988u, 0x09b64c2bu, 0x7eb17cbdu, 0xe7b82d07u, 0x90bf1d91u,
+	0x1db71064u, 0x6ab020f2u, 0xf3b97148u, 0x84be41deu, 0x1adad47du, 0x6ddde4ebu, 0xf4d4b551u, 0x83d385c7u,
+	0x136c9856u, 0x646ba8c0u, 0xfd62f97au, 0x8a65c9ecu, 0x14015c4fu, 0x63066cd9u, 0xfa0f3d63u, 0x8d080df5u,
+	0x3b6e20c8u, 0x4c69105eu, 0xd56041e4u, 0xa2677172u, 0x3c03e4d1u, 0x4b04d447u, 0xd20d85fdu, 0xa50ab56bu,
+	0x35b5a8fau, 0x42b2986cu, 0xdbbbc9d6u, 0xacbcf940u, 0x32d86ce3u, 0x45df5c75u, 0xdcd60dcfu, 0xabd13d59u,
+	0x26d930acu, 0x51de003au, 0xc8d75180u, 0xbfd06116u, 0x21b4f4b5u, 0x56b3c423u, 0xcfba9599u, 0xb8bda50fu,
+	0x2802b89eu, 0x5f058808u, 0xc60cd9b2u, 0xb10be924u, 0x2f6f7c87u, 0x58684c11u, 0xc1611dabu, 0xb6662d3du,
+	0x76dc4190u, 0x01db7106u, 0x98d220bcu, 0xefd5102au, 0x71b18589u, 0x06b6b51fu, 0x9fbfe4a5u, 0xe8b8d433u,
+	0x7807c9a2u, 0x0f00f934u, 0x9609a88eu, 0xe10e9818u, 0x7f6a0dbbu, 0x086d3d2du, 0x91646c97u, 0xe6635c01u,
+	0x6b6b51f4u, 0x1c6c6162u, 0x856530d8u, 0xf262004eu, 0x6c0695edu, 0x1b01a57bu, 0x8208f4c1u, 0xf50fc457u,
+	0x65b0d9c6u, 0x12b7e950u, 0x8bbeb8eau, 0xfcb9887cu, 0x62dd1ddfu, 0x15da2d49u, 0x8cd37cf3u, 0xfbd44c65u,
+	0x4db26158u, 0x3ab551ceu, 0xa3bc0074u, 0xd4bb30e2u, 0x4adfa541u, 0x3dd895d7u, 0xa4d1c46du, 0xd3d6f4fbu,
+	0x4369e96au, 0x346ed9fcu, 0xad678846u, 0xda60b8d0u, 0x44042d73u, 0x33031de5u, 0xaa0a4c5fu, 0xdd0d7cc9u,
+	0x5005713cu, 0x270241aau, 0xbe0b1010u, 0xc90c2086u, 0x5768b525u, 0x206f85b3u, 0xb966d409u, 0xce61e49fu,
+	0x5edef90eu, 0x29d9c998u, 0xb0d09822u, 0xc7d7a8b4u, 0x59b33d17u, 0x2eb40d81u, 0xb7bd5c3bu, 0xc0ba6cadu,
+	0xedb88320u, 0x9abfb3b6u, 0x03b6e20cu, 0x74b1d29au, 0xead54739u, 0x9dd277afu, 0x04db2615u, 0x73dc1683u,
+	0xe3630b12u, 0x94643b84u, 0x0d6d6a3eu, 0x7a6a5aa8u, 0xe40ecf0bu, 0x9309ff9du, 0x0a00ae27u, 0x7d079eb1u,
+	0xf00f9344u, 0x8708a3d2u, 0x1e01f268u, 0x6906c2feu, 0xf762575du, 0x806567cbu, 0x196c3671u, 0x6e6b06e7u,
+	0xfed41b76u, 0x89d32be0u, 0x10da7a5au, 0x67dd4accu, 0xf9b9df6fu, 0x8ebeeff9u, 0x17b7be43u, 0x60b08ed5u,
+	0xd6d6a3e8u, 0xa1d1937eu, 0x38d8c2c4u, 0x4fdff252u, 0xd1bb67f1u, 0xa6bc5767u, 0x3fb506ddu, 0x48b2364bu,
+	0xd80d2bdau, 0xaf0a1b4cu, 0x36034af6u, 0x41047a60u, 0xdf60efc3u, 0xa867df55u, 0x316e8eefu, 0x4669be79u,
+	0xcb61b38cu, 0xbc66831au, 0x256fd2a0u, 0x5268e236u, 0xcc0c7795u, 0xbb0b4703u, 0x220216b9u, 0x5505262fu,
+	0xc5ba3bbeu, 0xb2bd0b28u, 0x2bb45a92u, 0x5cb36a04u, 0xc2d7ffa7u, 0xb5d0cf31u, 0x2cd99e8bu, 0x5bdeae1du,
+	0x9b64c2b0u, 0xec63f226u, 0x756aa39cu, 0x026d930au, 0x9c0906a9u, 0xeb0e363fu, 0x72076785u, 0x05005713u,
+	0x95bf4a82u, 0xe2b87a14u, 0x7bb12baeu, 0x0cb61b38u, 0x92d28e9bu, 0xe5d5be0du, 0x7cdcefb7u, 0x0bdbdf21u,
+	0x86d3d2d4u, 0xf1d4e242u, 0x68ddb3f8u, 0x1fda836eu, 0x81be16cdu, 0xf6b9265bu, 0x6fb077e1u, 0x18b74777u,
+	0x88085ae6u, 0xff0f6a70u, 0x66063bcau, 0x11010b5cu, 0x8f659effu, 0xf862ae69u, 0x616bffd3u, 0x166ccf45u,
+	0xa00ae278u, 0xd70dd2eeu, 0x4e048354u, 0x3903b3c2u, 0xa7672661u, 0xd06016f7u, 0x4969474du, 0x3e6e77dbu,
+	0xaed16a4au, 0xd9d65adcu, 0x40df0b66u, 0x37d83bf0u, 0xa9bcae53u, 0xdebb9ec5u, 0x47b2cf7fu, 0x30b5ffe9u,
+	0xbdbdf21cu, 0xcabac28au, 0x53b39330u, 0x24b4a3a6u, 0xbad03605u, 0xcdd70693u, 0x54de5729u, 0x23d967bfu,
+	0xb3667a2eu, 0xc4614ab8u, 0x5d681b02u, 0x2a6f2b94u, 0xb40bbe37u, 0xc30c8ea1u, 0x5a05df1bu, 0x2d02ef8du,
+};
+
+static unsigned int a3posterCRC(unsigned int crc, const unsigned char *data, size_t size)
+{
+	crc = ~crc;
+	while (size--)
+		crc = a3posterCRCTable[(crc ^ *data++) & 0xff] ^ (crc >> 8);
+	return ~crc;
+}
+
+static unsigned int a3posterAdler(const unsigned char *data, size_t size)
+{
+	unsigned int a = 1, b = 0, run;
+	while (size)
+	{
+		run = (unsigned int)a3minimum(size, a3poster_adlerRun);
+		size -= run;
+		while (run--)
+		{
+			a += *data++;
+			b += a;
+		}
+		a %= a3poster_adlerBase;
+		b %= a3poster_adlerBase;
+	}
+	return (b << 16 | a);
+}
+
+// checksum of two runs from theirs and the second's length
+static unsigned int a3posterAdlerCombine(const unsigned int adler0, const unsigned int adler1, const unsigned long long size1)
+{
+	const unsigned int n = (unsigned int)(size1 % a3poster_adlerBase);
+	const unsigned int a0 = adler0 & 0xffff, b0 = adler0 >> 16;
+	const unsigned int a1 = adler1 & 0xffff, b1 = adler1 >> 16;
+	unsigned int a, b;
+	a = (a0 + a1 + a3poster_adlerBase - 1) % a3poster_adlerBase;
+	b = (unsigned int)((b0 + b1 + (unsigned long long)n * (a0 + a3poster_adlerBase - 1)) % a3poster_adlerBase);
+	return (b << 16 | a);
+}
+
+static void a3posterPut32(unsigned char *out, const unsigned int value)
+{
+	out[0] = (unsigned char)(value >> 24);
+	out[1] = (unsigned char)(value >> 16);
+	out[2] = (unsigned char)(value >> 8);
+	out[3] = (unsigned char)(value);
+}
+
+
+//-----------------------------------------------------------------------------
+// deflate
+
+// deflate's length and distance bases and extra bits
+static const unsigned short a3posterLengthBase[29] = {
+	3, 4, 5, 6, 7, 8, 9, 10, 11, 13, 15, 17, 19, 23, 27, 31,
+	35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 258,
+};
+static const unsigned char a3posterLengthExtra[29] = {
+	0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2,
+	3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0,
+};
+static const unsigned short a3posterDistBase[30] = {
+	1, 2, 3, 4, 5, 7, 9, 13, 17, 25, 33, 49, 65, 97, 129, 193,
+	257, 385, 513, 769, 1025, 1537, 2049, 3073, 4097, 6145, 8193, 12289, 16385, 24577,
+};
+static const unsigned char a3posterDistExtra[30] = {
+	0, 0, 0, 0, 1, 1, 2, 2, 3, 3, 4, 4, 5, 5, 6, 6,
+	7, 7, 8, 8, 9, 9, 10, 10, 11, 11, 12, 12, 13, 13,
+};
+
+static void a3posterBitsPut(a3_PosterBits *bits, const unsigned int value, const unsigned int count)
+{
+	bits->bits |= (unsigned long long)value << bits->count;
+	bits->count += count;
+	while (bits->count >= 8)
+	{
+		bits->out[bits->size++] = (unsigned char)bits->bits;
+		bits->bits >>= 8;
+		bits->count -= 8;
+	}
+}
+
+// Huffman codes go most significant bit first
+static void a3posterBitsCode(a3_PosterBits *bits, unsigned int code, const unsigned int length)
+{
+	unsigned int reversed = 0, i;
+	for (i = 0; i < length; ++i, code >>= 1)
+		reversed = (reversed << 1) | (code & 1);
+	a3posterBitsPut(bits, reversed, length);
+}
+
+// fixed literal/length code
+static void a3posterBitsSymbol(a3_PosterBits *bits, const unsigned int symbol)
+{
+	if (symbol < 144)
+		a3posterBitsCode(bits, 0x30 + symbol, 8);
+	else if (symbol < 256)
+		a3posterBitsCode(bits, 0x190 + symbol - 144, 9);
+	else if (symbol < 280)
+		a3posterBitsCode(bits, symbol - 256, 7);
+	else
+		a3posterBitsCode(bits, 0xc0 + symbol - 280, 8);
+}
+
+static void a3posterBitsMatch(a3_PosterBits *bits, const unsigned int length, const unsigned int dist)
+{
+	unsigned int code = 28;
+	while (a3posterLengthBase[code] > length)
+		--code;
+	a3posterBitsSymbol(bits, 257 + code);
+	a3posterBitsPut(bits, length - a3posterLengthBase[code], a3posterLengthExtra[code]);
+	code = 29;
+	while (a3posterDistBase[code] > dist)
+		--code;
+	a3posterBitsCode(bits, code, 5);
+	a3posterBitsPut(bits, dist - a3posterDistBase[code], a3posterDistExtra[code]);
+}
+
+// compress a band to one fixed Huffman block and an empty stored block
+static size_t a3posterDeflate(const unsigned char *data, const size_t size, unsigned char *out, int *head)
+{
+	a3_PosterBits bits[1] = { 0 };
+	unsigned int hash, length, best, dist, max;
+	size_t i;
+	int candidate;
+
+	bits->out = out;
+	memset(head, 0xff, sizeof(int) << a3poster_hashBits);
+	a3posterBitsPut(bits, 2, 3);
+	for (i = 0; i < size; )
+	{
+		best = 0;
+		dist = 0;
+		if (i + a3poster_matchMin <= size)
+		{
+			// one probe: the last time these three bytes were seen
+			hash = ((unsigned int)data[i] << 16 | (unsigned int)data[i + 1] << 8 | data[i + 2]) * 2654435761u >> (32 - a3poster_hashBits);
+			candidate = head[hash];
+			head[hash] = (int)i;
+			if (candidate >= 0 && i - (size_t)candidate <= a3poster_window)
+			{
+				max = (unsigned int)a3minimum(size - i, a3poster_matchMax);
+				for (length = 0; length < max && data[candidate + length] == data[i + length]; ++length);
+				if (length >= a3poster_matchMin)
+				{
+					best = length;
+					dist = (unsigned int)(i - (size_t)candidate);
+				}
+			}
+		}
+		if (best)
+		{
+			a3posterBitsMatch(bits, best, dist);
+			i += best;
+		}
+		else
+			a3posterBitsSymbol(bits, data[i++]);
+	}
+	a3posterBitsSymbol(bits, 256);
+
+	// empty stored block: align, then a zero length
+	a3posterBitsPut(bits, 0, 3);
+	if (bits->count)
+		a3posterBitsPut(bits, 0, 8 - bits->count);
+	a3posterBitsPut(bits, 0x0000, 16);
+	a3posterBitsPut(bits, 0xffff, 16);
+	return bits->size;
+}
+
+
+//-----------------------------------------------------------------------------
+// bands
+
+// PNG filter predictors
+static unsigned char a3posterPaeth(const int a, const int b, const int c)
+{
+	const int p = a + b - c;
+	const int pa = p > a ? p - a : a - p, pb = p > b ? p - b : b - p, pc = p > c ? p - c : c - p;
+	return (unsigned char)(pa <= pb && pa <= pc ? a : pb <= pc ? b : c);
+}
+
+// filter a row into 'out', picking the filter with the least sum
+static void a3posterFilterRow(const unsigned char *row, const unsigned char *above_opt, const size_t size, unsigned char *out, unsigned char *scratch)
+{
+	unsigned long long sum, best = ~0ull;
+	unsigned int filter, filters = above_opt ? 5 : 2;
+	unsigned char left, up, corner, value;
+	size_t i;
+
+	for (filter = 0; filter < filters; ++filter)
+	{
+		for (i = 0, sum = 0; i < size; ++i)
+		{
+			left = i >= 3 ? row[i - 3] : 0;
+			up = above_opt ? above_opt[i] : 0;
+			corner = above_opt && i >= 3 ? above_opt[i - 3] : 0;
+			switch (filter)
+			{
+			case 0: value = row[i]; break;
+			case 1: value = (unsigned char)(row[i] - left); break;
+			case 2: value = (unsigned char)(row[i] - up); break;
+			case 3: value = (unsigned char)(row[i] - ((left + up) >> 1)); break;
+			default: value = (unsigned char)(row[i] - a3posterPaeth(left, up, corner)); break;
+			}
+			scratch[i] = value;
+			sum += value < 128 ? value : 256 - value;
+		}
+		if (sum < best)
+		{
+			best = sum;
+			out[0] = (unsigned char)filter;
+			memcpy(out + 1, scratch, size);
+		}
+	}
+}
+
+// render a band into its slot's color buffer
+static void a3posterRenderBand(const a3_PosterPass *pass, const a3_PosterBand *band)
+{
+	const a3_FractalPosterDesc *desc = pass->desc;
+	const unsigned int y0 = desc->height - a3minimum((band->index + 1) * pass->bandRows, desc->height);
+	a3_FractalEscapeDesc escape[1] = { 0 };
+	a3_FractalNewtonDesc newton[1] = { 0 };
+	a3_FractalMengerDesc menger[1] = { 0 };
+
+	switch (desc->kind)
+	{
+	case a3fractal_posterEscape:
+		escape->view = desc->view;
+		escape->width = desc->width;
+		escape->height = desc->height;
+		escape->offsetY = (int)y0;
+		escape->iterations = (unsigned int)desc->iter;
+		escape->isa = desc->isa;
+		escape->precision = desc->precision;
+		escape->rgba_out_opt = band->rgba;
+		a3fractalEscapeRenderRect(escape, 0, 0, desc->width, band->rows);
+		break;
+	case a3fractal_posterNewton:
+		newton->view = desc->view;
+		newton->width = desc->width;
+		newton->height = desc->height;
+		newton->offsetY = (int)y0;
+		newton->iterations = a3fractal_posterNewtonSteps;
+		newton->relaxation = a3poster_newtonRelaxation;
+		newton->isa = desc->isa;
+		newton->rgba_out_opt = band->rgba;
+		a3fractalNewtonRenderRect(newton, 0, 0, desc->width, band->rows, 0);
+		break;
+	default:
+		memcpy(menger->eye, desc->eye, sizeof(menger->eye));
+		menger->iter = desc->iter;
+		menger->width = desc->width;
+		menger->height = band->rows;
+		menger->offsetY = (int)y0;
+		menger->frameWidth = desc->width;
+		menger->frameHeight = desc->height;
+		menger->isa = desc->isa;
+		menger->depth = a3fractalMengerDepthForIter(desc->iter);
+		menger->rgba_out_opt = band->rgba;
+		a3fractalMengerRenderRect(menger, 0, 0, desc->width, band->rows, 0);
+		break;
+	}
+}
+
+// band task: render, convert to file rows, and for PNG filter, compress
+//	and wrap in a chunk
+static void a3posterBandTask(void *args, unsigned int x0, unsigned int y0, unsigned int x1, unsigned int y1, unsigned int workerIndex)
+{
+	a3_PosterBand *band = (a3_PosterBand *)args;
+	const a3_PosterPass *pass = band->pass;
+	const unsigned int w = pass->desc->width;
+	const size_t rowBytes = pass->rowBytes;
+	unsigned char *rgb, *above = 0, *raw, *chunk;
+	const unsigned char *src;
+	unsigned int row, x;
+
+	a3posterRenderBand(pass, band);
+
+	// top row first, alpha dropped; PNG rows go to the tail of 'out' to
+	//	be filtered into 'raw'
+	rgb = pass->desc->format == a3fractal_posterPNG ? band->out + band->rows * rowBytes : band->raw;
+	for (row = 0; row < band->rows; ++row)
+	{
+		src = band->rgba + (size_t)(band->rows - 1 - row) * w * 4;
+		for (x = 0; x < w; ++x, src += 4)
+		{
+			rgb[(size_t)row * rowBytes + x * 3 + 0] = src[0];
+			rgb[(size_t)row * rowBytes + x * 3 + 1] = src[1];
+			rgb[(size_t)row * rowBytes + x * 3 + 2] = src[2];
+		}
+	}
+	if (pass->desc->format == a3fractal_posterPPM)
+	{
+		band->rawSize = band->size = band->rows * rowBytes;
+		return;
+	}
+
+	// filter rows into 'raw', then compress into 'out' after the chunk's
+	//	length and type
+	raw = band->raw;
+	for (row = 0; row < band->rows; ++row, raw += rowBytes + 1)
+	{
+		a3posterFilterRow(rgb + (size_t)row * rowBytes, above, rowBytes, raw, band->rgba);
+		above = rgb + (size_t)row * rowBytes;
+	}
+	band->rawSize = band->rows * (rowBytes + 1);
+	band->adler = a3posterAdler(band->raw, band->rawSize);
+	chunk = band->out;
+	memcpy(chunk + 4, "IDAT", 4);
+	band->size = a3posterDeflate(band->raw, band->rawSize, chunk + 8, band->head);
+	a3posterPut32(chunk, (unsigned int)band->size);
+	a3posterPut32(chunk + 8 + band->size, a3posterCRC(0, chunk + 4, band->size + 4));
+	band->size += 12;
+}
+
+
+//-----------------------------------------------------------------------------
+// render
+
+// write a PNG chunk from its type and data
+static int a3posterWriteChunk(FILE *fp, const char *type, const unsigned char *data, const unsigned int size, unsigned long long *bytes)
+{
+	unsigned char word[4];
+	unsigned int crc = a3posterCRC(0, (const unsigned char *)type, 4);
+	*bytes += 12 + size;
+	if (size)
+		crc = a3posterCRC(crc, data, size);
+	a3posterPut32(word, size);
+	if (fwrite(word, 1, 4, fp) != 4 || fwrite(type, 1, 4, fp) != 4 || (size && fwrite(data, 1, size, fp) != size))
+		return 0;
+	a3posterPut32(word, crc);
+	return (fwrite(word, 1, 4, fp) == 4);
+}
+
+static void a3posterBandRelease(a3_PosterBand *band)
+{
+	free(band->rgba);
+	free(band->raw);
+	free(band->out);
+	free(band->head);
+}
+
+int a3fractalPosterRender(const a3_FractalPosterDesc *desc, const char *filePath, a3_ThreadPool *pool_opt, a3_FractalPosterStats *stats_out_opt)
+{
+	static const unsigned char signature[8] = { 0x89, 'P', 'N', 'G', '\r', '\n', 0x1a, '\n' };
+	static const unsigned char zlibHeader[2] = { 0x78, 0x01 };
+	a3_FractalPosterStats stats = { 0 };
+	a3_PosterPass pass[1];
+	a3_PosterBand *bands, *band;
+	unsigned char header[13], trailer[9];
+	unsigned int slots, next, i, adler = 1;
+	size_t rgbaBytes, rawBytes, outBytes;
+	char text[64];
+	FILE *fp;
+	int ok;
+
+	if (desc && filePath && *filePath && desc->width && desc->height && (desc->kind != a3fractal_posterEscape || desc->iter > 0) &&
+		(desc->kind != a3fractal_posterMenger || desc->eye[0] != 0.0f || desc->eye[1] != 0.0f || desc->eye[2] != 0.0f))
+	{
+		pass->desc = desc;
+		pass->bandRows = desc->bandRows ? desc->bandRows : a3maximum(a3fractal_posterBandPixels / desc->width, 1);
+		pass->bandRows = a3minimum(pass->bandRows, desc->height);
+		pass->bandCount = (desc->height + pass->bandRows - 1) / pass->bandRows;
+		pass->rowBytes = (size_t)desc->width * 3;
+		slots = desc->bandsInFlight ? desc->bandsInFlight : (a3threadPoolGetWorkerCount(pool_opt) + 1) * a3fractal_posterBandsPerThread;
+		slots = a3minimum(slots, pass->bandCount);
+
+		// band buffers: the color doubles as filter scratch, and PNG's
+		//	'out' holds the unfiltered rows until they are filtered, then
+		//	the chunk, which fixed codes keep under 9 bits per byte
+		rgbaBytes = (size_t)desc->width * pass->bandRows * 4;
+		rawBytes = (pass->rowBytes + 1) * pass->bandRows;
+		outBytes = desc->format == a3fractal_posterPNG ? a3maximum(rawBytes + rawBytes / 8 + 64, pass->rowBytes * pass->bandRows * 2) : 0;
+		bands = (a3_PosterBand *)calloc(slots, sizeof(a3_PosterBand));
+		ok = bands != 0;
+		for (i = 0; ok && i < slots; ++i)
+		{
+			band = bands + i;
+			a3threadPoolGroupInit(&band->group);
+			band->pass = pass;
+			band->rgba = (unsigned char *)malloc(rgbaBytes);
+			band->raw = (unsigned char *)malloc(rawBytes);
+			if (desc->format == a3fractal_posterPNG)
+			{
+				band->out = (unsigned char *)malloc(outBytes);
+				band->head = (int *)malloc(sizeof(int) << a3poster_hashBits);
+				ok = band->out && band->head;
+			}
+			ok = ok && band->rgba && band->raw;
+		}
+		fp = ok ? fopen(filePath, "wb") : 0;
+		if (!fp)
+		{
+			for (i = 0; bands && i < slots; ++i)
+				a3posterBandRelease(bands + i);
+			free(bands);
+			return 0;
+		}
+		stats.bandBytes = (unsigned long long)slots * (rgbaBytes + rawBytes + outBytes + (desc->format == a3fractal_posterPNG ? sizeof(int) << a3poster_hashBits : 0));
+
+		// file header
+		if (desc->format == a3fractal_posterPNG)
+		{
+			a3posterPut32(header, desc->width);
+			a3posterPut32(header + 4, desc->height);
+			header[8] = 8;
+			header[9] = 2;
+			header[10] = header[11] = header[12] = 0;
+			ok = fwrite(signature, 1, 8, fp) == 8 && a3posterWriteChunk(fp, "IHDR", header, 13, &stats.fileBytes) && a3posterWriteChunk(fp, "IDAT", zlibHeader, 2, &stats.fileBytes);
+			stats.fileBytes += 8;
+		}
+		else
+		{
+			sprintf(text, "P6\n%u %u\n255\n", desc->width, desc->height);
+			ok = fputs(text, fp) >= 0;
+			stats.fileBytes = strlen(text);
+		}
+
+		// fill every slot, then write bands in order, refilling each slot
+		//	as soon as its band is out; a band that cannot be queued ends
+		//	the render at that band
+		for (next = 0; next < slots; ++next)
+		{
+			bands[next].index = next;
+			bands[next].rows = a3minimum(pass->bandRows, desc->height - next * pass->bandRows);
+			if (a3threadPoolSubmit(pool_opt, &bands[next].group, a3posterBandTask, bands + next, next, 0, next + 1, 1) <= 0)
+			{
+				ok = 0;
+				break;
+			}
+		}
+		for (i = 0; i < next; ++i)
+		{
+			band = bands + i % slots;
+			if (band->group.pending)
+				++stats.waits;
+			a3threadPoolWait(pool_opt, &band->group);
+			if (ok)
+			{
+				ok = fwrite(desc->format == a3fractal_posterPNG ? band->out : band->raw, 1, band->size, fp) == band->size;
+				stats.fileBytes += band->size;
+				adler = a3posterAdlerCombine(adler, band->adler, band->rawSize);
+				++stats.bands;
+			}
+			if (ok && next < pass->bandCount)
+			{
+				band->index = next;
+				band->rows = a3minimum(pass->bandRows, desc->height - next * pass->bandRows);
+				if (a3threadPoolSubmit(pool_opt, &band->group, a3posterBandTask, band, next, 0, next + 1, 1) > 0)
+					++next;
+				else
+					ok = 0;
+			}
+		}
+
+		// end the stream with a final empty stored block and the checksum
+		if (ok && desc->format == a3fractal_posterPNG)
+		{
+			trailer[0] = 0x01;
+			trailer[1] = trailer[2] = 0x00;
+			trailer[3] = trailer[4] = 0xff;
+			a3posterPut32(trailer + 5, adler);
+			ok = a3posterWriteChunk(fp, "IDAT", trailer, 9, &stats.fileBytes) && a3posterWriteChunk(fp, "IEND", 0, 0, &stats.fileBytes);
+		}
+		ok = (fclose(fp) == 0) && ok;
+
+		for (i = 0; i < slots; ++i)
+			a3posterBandRelease(bands + i);
+		free(bands);
+		if (stats_out_opt)
+			*stats_out_opt = stats;
+		return ok ? (int)stats.bands : 0;
+	}
+	return -1;
+}
+
+
+//-----------------------------------------------------------------------------
@@ -0,0 +1,145 @@
+/*
+	animal3D SDK: Minimal 3D Animation Framework
+	Fractals Midterm: CPU fractal engines
+
+	a3_DemoFractalPoster.h
+	Out-of-core poster renders streamed to PNG or PPM.
+
+	A poster a hundred thousand pixels on a side is 30 GB of color, more
+	than the machine holds, but an image file is written top to bottom,
+	so no more of it needs to exist at once than the rows being written.
+	Here the image is cut into horizontal bands of a few rows each. Each
+	band is a task: a worker renders it with the demo's escape-time,
+	Newton or Menger engine, turns it into the file's rows and, for PNG,
+	filters and compresses them, all without the other bands. The thread
+	that started the render writes finished bands to the file in order
+	and hands their memory to the next band to be rendered.
+
+	A fixed number of bands is in flight, twice the threads by default:
+	enough that the workers always have a band to render while the writer
+	waits for the oldest one, and few enough that memory is that many
+	bands, not the image. PNG bands are compressed as independent deflate
+	blocks ending on a byte boundary, so the file is one zlib stream and
+	its checksum is combined from the bands' own.
+
+	Render parameters are the demo's: the escape-time cap is 'uIter', the
+	Newton fractal runs the shader's fixed step count, and the Menger
+	camera and sponge depth follow 'uIter' the way the shader does.
+*/
+
+#ifndef __ANIMAL3D_DEMOFRACTALPOSTER_H
+#define __ANIMAL3D_DEMOFRACTALPOSTER_H
+
+
+#include "a3_DemoFractalEscape.h"
+
+
+//-----------------------------------------------------------------------------
+
+#ifdef __cplusplus
+extern "C"
+{
+#else	// !__cplusplus
+	typedef struct a3_FractalPosterDesc			a3_FractalPosterDesc;
+	typedef struct a3_FractalPosterStats		a3_FractalPosterStats;
+	typedef enum a3_FractalPosterKind			a3_FractalPosterKind;
+	typedef enum a3_FractalPosterFormat			a3_FractalPosterFormat;
+#endif	// __cplusplus
+
+
+//-----------------------------------------------------------------------------
+
+	// default pixels per band and bands in flight per thread
+#define a3fractal_posterBandPixels		(1 << 20)
+#define a3fractal_posterBandsPerThread	2
+
+	// steps the Julia shader runs for the Newton fractal
+#define a3fractal_posterNewtonSteps		512
+
+
+	// which demo fractal a poster shows
+	enum a3_FractalPosterKind
+	{
+		a3fractal_posterEscape,		// the Mandelbrot shader's escape time
+		a3fractal_posterNewton,		// the Julia shader's Newton fractal
+		a3fractal_posterMenger,		// the Menger shader's sponge
+	};
+
+
+	// file written
+	enum a3_FractalPosterFormat
+	{
+		a3fractal_posterPPM,		// binary PPM, uncompressed
+		a3fractal_posterPNG,		// 8-bit RGB PNG, compressed
+	};
+
+
+	// poster description
+	//	member kind: fractal to render
+	//	member format: file to write
+	//	members width, height: poster dimensions in pixels
+	//	member iter: the demo's 'fract_iter', sent to shaders as 'uIter':
+	//		the escape-time cap, which must be positive, or the Menger
+	//		camera and depth; the Newton fractal does not use it
+	//	member view: window into the complex plane, for escape-time and
+	//		Newton posters
+	//	member precision: escape-time arithmetic
+	//	member eye: the Menger shader's 'prp'
+	//	member isa: instruction set to use; auto picks at runtime
+	//	member bandRows: rows per band; 0 fits about
+	//		'a3fractal_posterBandPixels' pixels in one
+	//	member bandsInFlight: bands rendered or waiting to be written at
+	//		once, which bounds memory; 0 uses
+	//		'a3fractal_posterBandsPerThread' per thread
+	struct a3_FractalPosterDesc
+	{
+		a3_FractalPosterKind kind;
+		a3_FractalPosterFormat format;
+		unsigned int width, height;
+		int iter;
+		a3_FractalView view;
+		a3_FractalEscapePrecision precision;
+		float eye[3];
+		a3_FractalISA isa;
+		unsigned int bandRows;
+		unsigned int bandsInFlight;
+	};
+
+
+	// render counters
+	//	member bands: bands written
+	//	member fileBytes: size of the file
+	//	member bandBytes: memory held by bands in flight, the render's peak
+	//	member waits: times the writer found the next band unfinished and
+	//		rendered queued bands until it was
+	struct a3_FractalPosterStats
+	{
+		unsigned int bands;
+		unsigned long long fileBytes;
+		unsigned long long bandBytes;
+		unsigned int waits;
+	};
+
+
+//-----------------------------------------------------------------------------
+
+	// Render a poster band by band straight into a file.
+	//	param desc: non-null pointer to poster description
+	//	param filePath: non-null, non-empty path; overwritten
+	//	param pool_opt: optional pool; renders on this thread if null
+	//	param stats_out_opt: optional pointer to render counters
+	//	return: number of bands written if success
+	//	return: 0 if fail (out of memory, or the file could not be written)
+	//	return: -1 if invalid params
+	int a3fractalPosterRender(const a3_FractalPosterDesc *desc, const char *filePath, a3_ThreadPool *pool_opt, a3_FractalPosterStats *stats_out_opt);
+
+
+//-----------------------------------------------------------------------------
+
+
+#ifdef __cplusplus
+}
+#endif	// __cplusplus
+
+
+#endif	// !__ANIMAL3D_DEMOFRACTALPOSTER_H
@@ -0,0 +1,829 @@
+/*
+	animal3D SDK: Minimal 3D Animation Framework
+	Fractals Midterm: CPU fractal engines
+
+	a3_DemoFractalPyramid.c
+	Memory-mapped tile pyramid implementation.
+
+	The file is a header, an open-addressed index of tile entries, and
+	tile data, each tile on its own pages. Data is only ever appended;
+	when the index fills, a table twice its size is appended after the
+	data and the old one is left unused. The whole file is mapped, and
+	grown and mapped again when it runs out of room. The table from
+	content hash to data is kept in memory only and rebuilt from the
+	index's hashes when a file is opened.
+*/
+
+// POSIX file calls are hidden by a strict C standard unless asked for,
+//	before any system header
+#ifndef _WIN32
+#define _XOPEN_SOURCE 700
+#endif	// !_WIN32
+
+#include "a3_DemoFractalPyramid.h"
+#include "a3_DemoFractalInterior.h"
+
+#include "animal3D/a3/a3macros.h"
+
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+
+//-----------------------------------------------------------------------------
+// platform primitives: mapped file
+
+#ifdef _WIN32
+#include <Windows.h>
+
+typedef struct a3_PyramidFile
+{
+	HANDLE file, mapping;
+} a3_PyramidFile;
+
+static int a3pyramidFileOpen(a3_PyramidFile *f, const char *path, const int create, const int readOnly)
+{
+	f->mapping = 0;
+	f->file = CreateFileA(path, readOnly ? GENERIC_READ : (GENERIC_READ | GENERIC_WRITE), FILE_SHARE_READ, 0,
+		create ? CREATE_ALWAYS : OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, 0);
+	return (f->file != INVALID_HANDLE_VALUE);
+}
+
+static void a3pyramidFileClose(a3_PyramidFile *f)
+{
+	CloseHandle(f->file);
+}
+
+static unsigned long long a3pyramidFileSize(a3_PyramidFile *f)
+{
+	LARGE_INTEGER size;
+	return GetFileSizeEx(f->file, &size) ? (unsigned long long)size.QuadPart : 0;
+}
+
+static int a3pyramidFileResize(a3_PyramidFile *f, const unsigned long long size)
+{
+	LARGE_INTEGER end;
+	end.QuadPart = (LONGLONG)size;
+	return (SetFilePointerEx(f->file, end, 0, FILE_BEGIN) && SetEndOfFile(f->file));
+}
+
+static unsigned char *a3pyramidFileMap(a3_PyramidFile *f, const unsigned long long size, const int readOnly)
+{
+	void *map = 0;
+	if (size != (SIZE_T)size)
+		return 0;
+	f->mapping = CreateFileMappingA(f->file, 0, readOnly ? PAGE_READONLY : PAGE_READWRITE, (DWORD)(size >> 32), (DWORD)size, 0);
+	if (f->mapping)
+	{
+		map = MapViewOfFile(f->mapping, readOnly ? FILE_MAP_READ : FILE_MAP_WRITE, 0, 0, (SIZE_T)size);
+		if (!map)
+		{
+			CloseHandle(f->mapping);
+			f->mapping = 0;
+		}
+	}
+	return (unsigned char *)map;
+}
+
+static void a3pyramidFileUnmap(a3_PyramidFile *f, unsigned char *map, const unsigned long long size)
+{
+	(void)size;
+	UnmapViewOfFile(map);
+	CloseHandle(f->mapping);
+	f->mapping = 0;
+}
+
+static int a3pyramidFileFlush(a3_PyramidFile *f, unsigned char *map, const unsigned long long size)
+{
+	(void)f;
+	return (FlushViewOfFile(map, (SIZE_T)size) != 0);
+}
+
+#else	// !_WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+typedef struct a3_PyramidFile
+{
+	int file;
+} a3_PyramidFile;
+
+static int a3pyramidFileOpen(a3_PyramidFile *f, const char *path, const int create, const int readOnly)
+{
+	f->file = open(path, readOnly ? O_RDONLY : (O_RDWR | (create ? (O_CREAT | O_TRUNC) : 0)), 0644);
+	return (f->file >= 0);
+}
+
+static void a3pyramidFileClose(a3_PyramidFile *f)
+{
+	close(f->file);
+}
+
+static unsigned long long a3pyramidFileSize(a3_PyramidFile *f)
+{
+	struct stat st;
+	return fstat(f->file, &st) == 0 ? (unsigned long long)st.st_size : 0;
+}
+
+static int a3pyramidFileResize(a3_PyramidFile *f, const unsigned long long size)
+{
+	return (ftruncate(f->file, (off_t)size) == 0);
+}
+
+static unsigned char *a3pyramidFileMap(a3_PyramidFile *f, const unsigned long long size, const int readOnly)
+{
+	void *map;
+	if (size != (size_t)size)
+		return 0;
+	map = mmap(0, (size_t)size, PROT_READ | (readOnly ? 0 : PROT_WRITE), MAP_SHARED, f->file, 0);
+	return map != MAP_FAILED ? (unsigned char *)map : 0;
+}
+
+static void a3pyramidFileUnmap(a3_PyramidFile *f, unsigned char *map, const unsigned long long size)
+{
+	(void)f;
+	munmap(map, (size_t)size);
+}
+
+static int a3pyramidFileFlush(a3_PyramidFile *f, unsigned char *map, const unsigned long long size)
+{
+	(void)f;
+	return (msync(map, (size_t)size, MS_SYNC) == 0);
+}
+
+#endif	// _WIN32
+
+
+//-----------------------------------------------------------------------------
+// internal structures
+
+#define a3pyramid_magic			0x50543341u	// "A3TP"
+#define a3pyramid_version		1u
+
+// largest tile edge, so a tile's bytes fit in an unsigned int
+#define a3pyramid_tileMax		4096u
+
+// fewest and most index slots
+#define a3pyramid_slotsMin		16u
+#define a3pyramid_slotsMax		(1u << 28)
+
+// least the file grows by when it runs out of room
+#define a3pyramid_grow			(1ull << 22)
+
+// offset marking an empty index or share slot; data never starts at 0
+#define a3pyramid_none			0ull
+
+
+// file header, at offset 0
+typedef struct a3_PyramidHeader
+{
+	unsigned int magic, version;
+	unsigned int tileSize, data;
+	unsigned int slots, tiles;
+	unsigned int unique, reserved;
+	unsigned long long index, end;
+	double root[4];
+} a3_PyramidHeader;
+
+// index entry: key, data offset and content hash
+typedef struct a3_PyramidEntry
+{
+	unsigned int formula, level, x, y;
+	unsigned int iterations, reserved;
+	unsigned long long offset;
+	unsigned long long hash;
+} a3_PyramidEntry;
+
+
+struct a3_FractalPyramid
+{
+	a3_FractalPyramidDesc desc;
+	a3_PyramidFile file[1];
+	unsigned char *map;
+	unsigned long long mapSize;
+	unsigned int tileBytes;
+	int readOnly;
+
+	// content hash to data offset, open-addressed
+	unsigned long long *shareHash, *shareOffset;
+	unsigned int shareSlots, shareCount;
+
+	// render target for tiles not stored
+	void *scratch;
+};
+
+
+#define a3pyramidHeader(pyramid)	((a3_PyramidHeader *)(pyramid)->map)
+#define a3pyramidIndex(pyramid)		((a3_PyramidEntry *)((pyramid)->map + a3pyramidHeader(pyramid)->index))
+
+
+//-----------------------------------------------------------------------------
+// hashing and tables
+
+// round an offset up to a page
+static unsigned long long a3pyramidAlign(const unsigned long long offset)
+{
+	return (offset + (a3fractal_pyramidPage - 1)) & ~(unsigned long long)(a3fractal_pyramidPage - 1);
+}
+
+// FNV-1a over words, finished with a multiply-shift mix so the low bits
+//	that pick slots depend on every word
+static unsigned long long a3pyramidHash(const unsigned int *words, unsigned int count)
+{
+	unsigned long long h = 0xcbf29ce484222325ull;
+	while (count--)
+		h = (h ^ *(words++)) * 0x100000001b3ull;
+	h ^= h >> 33;
+	h *= 0xff51afd7ed558ccdull;
+	h ^= h >> 33;
+	return h;
+}
+
+static unsigned long long a3pyramidKeyHash(const a3_FractalTileKey *key)
+{
+	unsigned int words[5];
+	words[0] = key->formula;
+	words[1] = key->level;
+	words[2] = key->x;
+	words[3] = key->y;
+	words[4] = key->iterations;
+	return a3pyramidHash(words, 5);
+}
+
+static int a3pyramidKeyValid(const a3_FractalTileKey *key)
+{
+	return (key->level <= a3fractal_pyramidLevelMax && key->x < (1u << key->level) && key->y < (1u << key->level));
+}
+
+// slot holding a key, or the empty slot it would go in; the index is
+//	never full
+static a3_PyramidEntry *a3pyramidFind(const a3_FractalPyramid *pyramid, const a3_FractalTileKey *key)
+{
+	a3_PyramidEntry *const index = a3pyramidIndex(pyramid), *entry;
+	const unsigned int mask = a3pyramidHeader(pyramid)->slots - 1;
+	unsigned int slot = (unsigned int)a3pyramidKeyHash(key) & mask;
+	for (;; slot = (slot + 1) & mask)
+	{
+		entry = index + slot;
+		if (entry->offset == a3pyramid_none ||
+			(entry->formula == key->formula && entry->level == key->level && entry->x == key->x &&
+				entry->y == key->y && entry->iterations == key->iterations))
+			return entry;
+	}
+}
+
+// data offset of a content hash, or none
+static unsigned long long a3pyramidShareFind(const a3_FractalPyramid *pyramid, const unsigned long long hash)
+{
+	const unsigned int mask = pyramid->shareSlots - 1;
+	unsigned int slot = (unsigned int)hash & mask;
+	if (pyramid->shareSlots)
+		for (; pyramid->shareOffset[slot] != a3pyramid_none; slot = (slot + 1) & mask)
+			if (pyramid->shareHash[slot] == hash)
+				return pyramid->shareOffset[slot];
+	return a3pyramid_none;
+}
+
+// add a content hash, doubling the table at half full
+static int a3pyramidShareInsert(a3_FractalPyramid *pyramid, const unsigned long long hash, const unsigned long long offset)
+{
+	unsigned long long *hashes, *offsets;
+	unsigned int slots, mask, slot, i;
+	if ((pyramid->shareCount + 1) * 2 > pyramid->shareSlots)
+	{
+		slots = a3maximum(pyramid->shareSlots * 2, a3pyramid_slotsMin);
+		hashes = (unsigned long long *)malloc(slots * sizeof(unsigned long long));
+		offsets = (unsigned long long *)calloc(slots, sizeof(unsigned long long));
+		if (!hashes || !offsets)
+		{
+			free(hashes);
+			free(offsets);
+			return 0;
+		}
+		for (i = 0, mask = slots - 1; i < pyramid->shareSlots; ++i)
+			if (pyramid->shareOffset[i] != a3pyramid_none)
+			{
+				for (slot = (unsigned int)pyramid->shareHash[i] & mask; offsets[slot] != a3pyramid_none; slot = (slot + 1) & mask);
+				hashes[slot] = pyramid->shareHash[i];
+				offsets[slot] = pyramid->shareOffset[i];
+			}
+		free(pyramid->shareHash);
+		free(pyramid->shareOffset);
+		pyramid->shareHash = hashes;
+		pyramid->shareOffset = offsets;
+		pyramid->shareSlots = slots;
+	}
+	mask = pyramid->shareSlots - 1;
+	for (slot = (unsigned int)hash & mask; pyramid->shareOffset[slot] != a3pyramid_none; slot = (slot + 1) & mask);
+	pyramid->shareHash[slot] = hash;
+	pyramid->shareOffset[slot] = offset;
+	++pyramid->shareCount;
+	return 1;
+}
+
+
+//-----------------------------------------------------------------------------
+// file layout
+
+// grow the file and its mapping to at least a size; on failure the old
+//	size stays mapped
+static int a3pyramidReserve(a3_FractalPyramid *pyramid, const unsigned long long size)
+{
+	unsigned long long grown;
+	if (size <= pyramid->mapSize)
+		return 1;
+	grown = pyramid->mapSize + a3maximum(pyramid->mapSize / 2, a3pyramid_grow);
+	grown = a3pyramidAlign(a3maximum(grown, size));
+	a3pyramidFileUnmap(pyramid->file, pyramid->map, pyramid->mapSize);
+	if (a3pyramidFileResize(pyramid->file, grown))
+	{
+		pyramid->map = a3pyramidFileMap(pyramid->file, grown, 0);
+		if (pyramid->map)
+		{
+			pyramid->mapSize = grown;
+			return 1;
+		}
+	}
+	pyramid->map = a3pyramidFileMap(pyramid->file, pyramid->mapSize, 0);
+	return 0;
+}
+
+// append an index twice the size and move the entries into it
+static int a3pyramidGrowIndex(a3_FractalPyramid *pyramid)
+{
+	a3_PyramidHeader *header = a3pyramidHeader(pyramid);
+	a3_PyramidEntry *index, *entry;
+	const unsigned int slots = header->slots * 2, mask = slots - 1;
+	const unsigned long long offset = a3pyramidAlign(header->end), bytes = (unsigned long long)slots * sizeof(a3_PyramidEntry);
+	unsigned int i, slot;
+
+	if (slots > a3pyramid_slotsMax || !a3pyramidReserve(pyramid, offset + bytes))
+		return 0;
+	header = a3pyramidHeader(pyramid);
+	index = (a3_PyramidEntry *)(pyramid->map + offset);
+	memset(index, 0, (size_t)bytes);
+	for (i = 0, entry = a3pyramidIndex(pyramid); i < header->slots; ++i, ++entry)
+		if (entry->offset != a3pyramid_none)
+		{
+			// the key's words are the entry's first five
+			for (slot = (unsigned int)a3pyramidHash(&entry->formula, 5) & mask; index[slot].offset != a3pyramid_none; slot = (slot + 1) & mask);
+			index[slot] = *entry;
+		}
+	header->index = offset;
+	header->slots = slots;
+	header->end = offset + bytes;
+	return 1;
+}
+
+// check a mapped header and index against the file
+static int a3pyramidCheck(const a3_FractalPyramid *pyramid)
+{
+	const a3_PyramidHeader *header = a3pyramidHeader(pyramid);
+	const a3_PyramidEntry *entry;
+	unsigned long long tileBytes;
+	unsigned int i, tiles;
+
+	if (header->magic != a3pyramid_magic || header->version != a3pyramid_version ||
+		!header->tileSize || header->tileSize > a3pyramid_tileMax || header->data > a3fractal_tileIter ||
+		header->slots < a3pyramid_slotsMin || header->slots > a3pyramid_slotsMax || (header->slots & (header->slots - 1)) ||
+		header->tiles >= header->slots || header->end > pyramid->mapSize ||
+		header->index < sizeof(a3_PyramidHeader) || header->index + (unsigned long long)header->slots * sizeof(a3_PyramidEntry) > header->end ||
+		!(header->root[2] > 0.0) || !(header->root[3] > 0.0))
+		return 0;
+	tileBytes = (unsigned long long)header->tileSize * header->tileSize * 4;
+	for (i = tiles = 0, entry = a3pyramidIndex(pyramid); i < header->slots; ++i, ++entry)
+		if (entry->offset != a3pyramid_none)
+		{
+			if (entry->offset + tileBytes > header->end)
+				return 0;
+			++tiles;
+		}
+	return (tiles == header->tiles);
+}
+
+// set sizes from the header and build the share table from the index
+static int a3pyramidLoad(a3_FractalPyramid *pyramid)
+{
+	const a3_PyramidHeader *header = a3pyramidHeader(pyramid);
+	const a3_PyramidEntry *entry;
+	unsigned int i;
+
+	pyramid->desc.root.centerX = header->root[0];
+	pyramid->desc.root.centerY = header->root[1];
+	pyramid->desc.root.width = header->root[2];
+	pyramid->desc.root.height = header->root[3];
+	pyramid->desc.tileSize = header->tileSize;
+	pyramid->desc.data = (a3_FractalTileData)header->data;
+	pyramid->tileBytes = header->tileSize * header->tileSize * 4;
+	for (i = 0, entry = a3pyramidIndex(pyramid); i < header->slots; ++i, ++entry)
+		if (entry->offset != a3pyramid_none && a3pyramidShareFind(pyramid, entry->hash) == a3pyramid_none &&
+			!a3pyramidShareInsert(pyramid, entry->hash, entry->offset))
+			return 0;
+	return 1;
+}
+
+static void a3pyramidFree(a3_FractalPyramid *pyramid)
+{
+	free(pyramid->shareHash);
+	free(pyramid->shareOffset);
+	free(pyramid->scratch);
+	free(pyramid);
+}
+
+
+//-----------------------------------------------------------------------------
+// rendering
+
+// fill a tile as interior if every pixel center is in the cardioid or
+//	period-2 bulb; the engine would iterate each of them to the cap
+static int a3pyramidFill(const a3_FractalPyramid *pyramid, const a3_FractalView *view, const unsigned int iterations)
+{
+	const unsigned int n = pyramid->desc.tileSize, count = n * n;
+	unsigned int x, y, i;
+	double cx, cy;
+
+	// the tile's edges first: most tiles that fail, fail there
+	for (i = 0; i < n; ++i)
+	{
+		a3fractalViewPixelCoord(view, n, n, (double)i, 0.0, &cx, &cy);
+		if (!a3fractalInBulb(cx, cy))
+			return 0;
+		a3fractalViewPixelCoord(view, n, n, (double)i, (double)(n - 1), &cx, &cy);
+		if (!a3fractalInBulb(cx, cy))
+			return 0;
+	}
+	for (y = 1; y + 1 < n; ++y)
+		for (x = 0; x < n; ++x)
+		{
+			a3fractalViewPixelCoord(view, n, n, (double)x, (double)y, &cx, &cy);
+			if (!a3fractalInBulb(cx, cy))
+				return 0;
+		}
+
+	if (pyramid->desc.data == a3fractal_tileSmooth)
+		for (i = 0; i < count; ++i)
+			((float *)pyramid->scratch)[i] = a3fractal_interior;
+	else
+		for (i = 0; i < count; ++i)
+			((unsigned int *)pyramid->scratch)[i] = iterations;
+	return 1;
+}
+
+
+//-----------------------------------------------------------------------------
+
+int a3fractalPyramidCreate(a3_FractalPyramid **pyramid_out, const char *filePath, const a3_FractalPyramidDesc *desc)
+{
+	a3_FractalPyramid *pyramid;
+	a3_PyramidHeader *header;
+	unsigned int slots, tileSize;
+	unsigned long long size;
+
+	if (pyramid_out && filePath && *filePath && desc && desc->root.width > 0.0 && desc->root.height > 0.0 &&
+		desc->tileSize <= a3pyramid_tileMax && desc->data <= a3fractal_tileIter && desc->indexSlots <= a3pyramid_slotsMax)
+	{
+		if (*pyramid_out)
+			return 0;
+		tileSize = desc->tileSize ? desc->tileSize : a3fractal_pyramidTileSize;
+		slots = desc->indexSlots ? desc->indexSlots : a3fractal_pyramidIndex;
+		for (slots = slots - 1, slots |= slots >> 1, slots |= slots >> 2, slots |= slots >> 4, slots |= slots >> 8, slots |= slots >> 16, ++slots;
+			slots < a3pyramid_slotsMin; slots *= 2);
+
+		pyramid = (a3_FractalPyramid *)calloc(1, sizeof(a3_FractalPyramid));
+		if (!pyramid)
+			return 0;
+		if (a3pyramidFileOpen(pyramid->file, filePath, 1, 0))
+		{
+			size = a3pyramidAlign(a3fractal_pyramidPage + (unsigned long long)slots * sizeof(a3_PyramidEntry));
+			if (a3pyramidFileResize(pyramid->file, size))
+			{
+				pyramid->map = a3pyramidFileMap(pyramid->file, size, 0);
+				if (pyramid->map)
+				{
+					pyramid->mapSize = size;
+					header = a3pyramidHeader(pyramid);
+					memset(pyramid->map, 0, (size_t)size);
+					header->magic = a3pyramid_magic;
+					header->version = a3pyramid_version;
+					header->tileSize = tileSize;
+					header->data = desc->data;
+					header->slots = slots;
+					header->index = a3fractal_pyramidPage;
+					header->end = a3fractal_pyramidPage + (unsigned long long)slots * sizeof(a3_PyramidEntry);
+					header->root[0] = desc->root.centerX;
+					header->root[1] = desc->root.centerY;
+					header->root[2] = desc->root.width;
+					header->root[3] = desc->root.height;
+					a3pyramidLoad(pyramid);
+					*pyramid_out = pyramid;
+					return (int)slots;
+				}
+			}
+			a3pyramidFileClose(pyramid->file);
+		}
+		a3pyramidFree(pyramid);
+		return 0;
+	}
+	return -1;
+}
+
+int a3fractalPyramidOpen(a3_FractalPyramid **pyramid_out, const char *filePath, int readOnly)
+{
+	a3_FractalPyramid *pyramid;
+	unsigned long long size;
+
+	if (pyramid_out && filePath && *filePath)
+	{
+		if (*pyramid_out)
+			return 0;
+		pyramid = (a3_FractalPyramid *)calloc(1, sizeof(a3_FractalPyramid));
+		if (!pyramid)
+			return 0;
+		pyramid->readOnly = readOnly != 0;
+		if (a3pyramidFileOpen(pyramid->file, filePath, 0, pyramid->readOnly))
+		{
+			size = a3pyramidFileSize(pyramid->file);
+			if (size >= sizeof(a3_PyramidHeader))
+			{
+				pyramid->map = a3pyramidFileMap(pyramid->file, size, pyramid->readOnly);
+				if (pyramid->map)
+				{
+					pyramid->mapSize = size;
+					if (a3pyramidCheck(pyramid) && a3pyramidLoad(pyramid))
+					{
+						*pyramid_out = pyramid;
+						return (int)a3maximum(a3pyramidHeader(pyramid)->tiles, 1u);
+					}
+					a3pyramidFileUnmap(pyramid->file, pyramid->map, pyramid->mapSize);
+				}
+			}
+			a3pyramidFileClose(pyramid->file);
+		}
+		a3pyramidFree(pyramid);
+		return 0;
+	}
+	return -1;
+}
+
+int a3fractalPyramidRelease(a3_FractalPyramid **pyramid)
+{
+	a3_FractalPyramid *p;
+	unsigned long long end;
+
+	if (pyramid)
+	{
+		p = *pyramid;
+		if (p)
+		{
+			if (p->map)
+			{
+				end = a3pyramidHeader(p)->end;
+				a3pyramidFileUnmap(p->file, p->map, p->mapSize);
+				if (!p->readOnly && end < p->mapSize)
+					a3pyramidFileResize(p->file, end);
+			}
+			a3pyramidFileClose(p->file);
+			a3pyramidFree(p);
+			*pyramid = 0;
+		}
+		return 1;
+	}
+	return -1;
+}
+
+int a3fractalPyramidGetDesc(const a3_FractalPyramid *pyramid, a3_FractalPyramidDesc *desc_out)
+{
+	if (pyramid && pyramid->map && desc_out)
+	{
+		*desc_out = pyramid->desc;
+		desc_out->indexSlots = a3pyramidHeader(pyramid)->slots;
+		return 1;
+	}
+	return -1;
+}
+
+int a3fractalPyramidGetView(const a3_FractalPyramid *pyramid, unsigned int level, unsigned int x, unsigned int y, a3_FractalView *view_out)
+{
+	const a3_FractalView *root;
+	double n;
+
+	if (pyramid && view_out && level <= a3fractal_pyramidLevelMax && x < (1u << level) && y < (1u << level))
+	{
+		root = &pyramid->desc.root;
+		n = (double)(1u << level);
+		view_out->width = root->width / n;
+		view_out->height = root->height / n;
+		view_out->centerX = root->centerX + root->width * (((double)x + 0.5) / n - 0.5);
+		view_out->centerY = root->centerY + root->height * (((double)y + 0.5) / n - 0.5);
+		return 1;
+	}
+	return -1;
+}
+
+int a3fractalPyramidGetRange(const a3_FractalPyramid *pyramid, const a3_FractalView *view, unsigned int width, unsigned int *level_out, unsigned int *x0_out, unsigned int *y0_out, unsigned int *x1_out, unsigned int *y1_out)
+{
+	const a3_FractalView *root;
+	double pixel, n, tileW, tileH, left, bottom;
+	unsigned int level;
+
+	if (pyramid && view && width && view->width > 0.0 && view->height > 0.0 && level_out && x0_out && y0_out && x1_out && y1_out)
+	{
+		root = &pyramid->desc.root;
+		pixel = view->width / (double)width;
+		for (level = 0; level < a3fractal_pyramidLevelMax &&
+			root->width / ((double)(1u << level) * (double)pyramid->desc.tileSize) > pixel; ++level);
+
+		n = (double)(1u << level);
+		tileW = root->width / n;
+		tileH = root->height / n;
+		left = (view->centerX - 0.5 * view->width) - (root->centerX - 0.5 * root->width);
+		bottom = (view->centerY - 0.5 * view->height) - (root->centerY - 0.5 * root->height);
+		*level_out = level;
+		*x0_out = (unsigned int)a3clamp(0.0, n, floor(left / tileW));
+		*y0_out = (unsigned int)a3clamp(0.0, n, floor(bottom / tileH));
+		*x1_out = (unsigned int)a3clamp(0.0, n, ceil((left + view->width) / tileW));
+		*y1_out = (unsigned int)a3clamp(0.0, n, ceil((bottom + view->height) / tileH));
+		*x1_out = a3maximum(*x1_out, *x0_out);
+		*y1_out = a3maximum(*y1_out, *y0_out);
+		return (int)((*x1_out - *x0_out) * (*y1_out - *y0_out));
+	}
+	return -1;
+}
+
+int a3fractalPyramidGet(const a3_FractalPyramid *pyramid, const a3_FractalTileKey *key, const void **tile_out, a3_FractalPyramidStats *stats_opt)
+{
+	const a3_PyramidEntry *entry;
+
+	if (pyramid && pyramid->map && key && tile_out && a3pyramidKeyValid(key))
+	{
+		entry = a3pyramidFind(pyramid, key);
+		if (stats_opt)
+		{
+			++stats_opt->lookups;
+			stats_opt->hits += entry->offset != a3pyramid_none;
+		}
+		if (entry->offset != a3pyramid_none)
+		{
+			*tile_out = pyramid->map + entry->offset;
+			return 1;
+		}
+		return 0;
+	}
+	return -1;
+}
+
+int a3fractalPyramidPut(a3_FractalPyramid *pyramid, const a3_FractalTileKey *key, const void *tile, a3_FractalPyramidStats *stats_opt)
+{
+	a3_PyramidHeader *header;
+	a3_PyramidEntry *entry;
+	unsigned long long hash, offset;
+
+	if (pyramid && pyramid->map && key && tile && a3pyramidKeyValid(key))
+	{
+		if (pyramid->readOnly)
+			return 0;
+
+		// a tile from a lookup lies in the mapping, which moves if the
+		//	file grows; copy it out first
+		if ((const unsigned char *)tile >= pyramid->map && (const unsigned char *)tile < pyramid->map + pyramid->mapSize)
+		{
+			if (!pyramid->scratch)
+			{
+				pyramid->scratch = malloc(pyramid->tileBytes);
+				if (!pyramid->scratch)
+					return 0;
+			}
+			memcpy(pyramid->scratch, tile, pyramid->tileBytes);
+			tile = pyramid->scratch;
+		}
+
+		// data equal to a stored tile's is shared; data whose hash is
+		//	taken by different data is stored but not shared
+		hash = a3pyramidHash((const unsigned int *)tile, pyramid->tileBytes / 4);
+		offset = a3pyramidShareFind(pyramid, hash);
+		if (offset != a3pyramid_none && memcmp(pyramid->map + offset, tile, pyramid->tileBytes) == 0)
+		{
+			if (stats_opt)
+				++stats_opt->shared;
+		}
+		else
+		{
+			const int collision = offset != a3pyramid_none;
+			offset = a3pyramidAlign(a3pyramidHeader(pyramid)->end);
+			if (!a3pyramidReserve(pyramid, offset + pyramid->tileBytes))
+				return 0;
+			memcpy(pyramid->map + offset, tile, pyramid->tileBytes);
+			header = a3pyramidHeader(pyramid);
+			header->end = offset + pyramid->tileBytes;
+			++header->unique;
+			if (!collision)
+				a3pyramidShareInsert(pyramid, hash, offset);
+		}
+
+		// the index doubles at three quarters full
+		entry = a3pyramidFind(pyramid, key);
+		if (entry->offset == a3pyramid_none)
+		{
+			header = a3pyramidHeader(pyramid);
+			if ((header->tiles + 1) * 4 > header->slots * 3)
+			{
+				if (!a3pyramidGrowIndex(pyramid))
+					return 0;
+				entry = a3pyramidFind(pyramid, key);
+			}
+			++a3pyramidHeader(pyramid)->tiles;
+		}
+		entry->formula = key->formula;
+		entry->level = key->level;
+		entry->x = key->x;
+		entry->y = key->y;
+		entry->iterations = key->iterations;
+		entry->hash = hash;
+		entry->offset = offset;
+		return 1;
+	}
+	return -1;
+}
+
+int a3fractalPyramidRender(a3_FractalPyramid *pyramid, const a3_FractalTileKey *key, a3_FractalISA isa, a3_ThreadPool *pool_opt, const void **tile_out, a3_FractalPyramidStats *stats_opt)
+{
+	a3_FractalEscapeDesc desc;
+
+	if (pyramid && pyramid->map && key && tile_out && key->formula < a3fractal_tileFormulaCount && key->iterations && a3pyramidKeyValid(key))
+	{
+		if (a3fractalPyramidGet(pyramid, key, tile_out, stats_opt) == 1)
+			return 1;
+		if (!pyramid->scratch)
+		{
+			pyramid->scratch = malloc(pyramid->tileBytes);
+			if (!pyramid->scratch)
+				return 0;
+		}
+
+		memset(&desc, 0, sizeof(desc));
+		a3fractalPyramidGetView(pyramid, key->level, key->x, key->y, &desc.view);
+		if (a3pyramidFill(pyramid, &desc.view, key->iterations))
+		{
+			if (stats_opt)
+				++stats_opt->filled;
+		}
+		else
+		{
+			desc.width = desc.height = pyramid->desc.tileSize;
+			desc.iterations = key->iterations;
+			desc.isa = isa;
+			desc.precision = key->formula == a3fractal_tileEscapeDouble ? a3fractal_precisionDouble : a3fractal_precisionSingle;
+			if (pyramid->desc.data == a3fractal_tileSmooth)
+				desc.smooth_out_opt = (float *)pyramid->scratch;
+			else
+				desc.iter_out_opt = (unsigned int *)pyramid->scratch;
+			if (a3fractalEscapeRenderTiled(&desc, pool_opt, 0) < 0)
+				return 0;
+			if (stats_opt)
+				++stats_opt->rendered;
+		}
+
+		if (pyramid->readOnly)
+			*tile_out = pyramid->scratch;
+		else if (a3fractalPyramidPut(pyramid, key, pyramid->scratch, stats_opt) == 1)
+			*tile_out = pyramid->map + a3pyramidFind(pyramid, key)->offset;
+		else
+			return 0;
+		return 2;
+	}
+	return -1;
+}
+
+int a3fractalPyramidGetUsage(const a3_FractalPyramid *pyramid, unsigned int *tiles_out_opt, unsigned int *unique_out_opt, unsigned long long *bytes_out_opt)
+{
+	const a3_PyramidHeader *header;
+
+	if (pyramid && pyramid->map)
+	{
+		header = a3pyramidHeader(pyramid);
+		if (tiles_out_opt)
+			*tiles_out_opt = header->tiles;
+		if (unique_out_opt)
+			*unique_out_opt = header->unique;
+		if (bytes_out_opt)
+			*bytes_out_opt = header->end;
+		return 1;
+	}
+	return -1;
+}
+
+int a3fractalPyramidFlush(a3_FractalPyramid *pyramid)
+{
+	if (pyramid && pyramid->map)
+	{
+		if (pyramid->readOnly)
+			return 1;
+		return a3pyramidFileFlush(pyramid->file, pyramid->map, pyramid->mapSize);
+	}
+	return -1;
+}
+
+
+//-----------------------------------------------------------------------------
@@ -0,0 +1,257 @@
+/*
+	animal3D SDK: Minimal 3D Animation Framework
+	Fractals Midterm: CPU fractal engines
+
+	a3_DemoFractalPyramid.h
+	Memory-mapped tile pyramid of escape-time results.
+
+	Zooming back out to a place already seen renders it again, although
+	the iteration counts there have not changed. The pyramid keeps them
+	in a file instead: a root window is cut into a quadtree, level L
+	holding 2^L by 2^L square tiles of a fixed number of pixels each, and
+	every tile rendered is stored under its formula, level, position and
+	iteration cap, as smooth counts or escape iterations, four bytes per
+	pixel, exactly as the escape-time engine wrote them.
+
+	The file starts with a hash index of those keys and appends tile data
+	on page boundaries. It is mapped into memory whole, so a lookup hands
+	out a pointer into the mapping and the operating system pages the
+	tile in on first touch; a tile seen before costs a page fault, not a
+	render, at any level and in any later run. Tiles are hashed by
+	content and a tile equal to one already stored points at the same
+	data, so the many tiles that lie wholly inside the set, and those
+	that escape on the first iteration, take one tile of the file each.
+	Tiles whose every pixel passes the closed-form cardioid and bulb test
+	are filled without iterating.
+*/
+
+#ifndef __ANIMAL3D_DEMOFRACTALPYRAMID_H
+#define __ANIMAL3D_DEMOFRACTALPYRAMID_H
+
+
+#include "a3_DemoFractalEscape.h"
+
+
+//-----------------------------------------------------------------------------
+
+#ifdef __cplusplus
+extern "C"
+{
+#else	// !__cplusplus
+	typedef struct a3_FractalPyramid			a3_FractalPyramid;
+	typedef struct a3_FractalPyramidDesc		a3_FractalPyramidDesc;
+	typedef struct a3_FractalTileKey			a3_FractalTileKey;
+	typedef struct a3_FractalPyramidStats		a3_FractalPyramidStats;
+	typedef enum a3_FractalTileFormula			a3_FractalTileFormula;
+	typedef enum a3_FractalTileData				a3_FractalTileData;
+#endif	// __cplusplus
+
+
+//-----------------------------------------------------------------------------
+
+	// default tile edge in pixels and index slots of a new pyramid
+#define a3fractal_pyramidTileSize		256
+#define a3fractal_pyramidIndex			4096
+
+	// deepest level; level L is 2^L tiles across
+#define a3fractal_pyramidLevelMax		31
+
+	// alignment of tile data in the file
+#define a3fractal_pyramidPage			4096
+
+
+	// formulas the pyramid renders itself; tiles of other formulas can be
+	//	stored and looked up, but not rendered
+	enum a3_FractalTileFormula
+	{
+		a3fractal_tileEscapeSingle,		// escape-time engine, single precision
+		a3fractal_tileEscapeDouble,		// escape-time engine, double precision
+		a3fractal_tileFormulaCount
+	};
+
+
+	// per-pixel data a pyramid holds
+	enum a3_FractalTileData
+	{
+		a3fractal_tileSmooth,		// float smooth count, as 'smooth_out_opt'
+		a3fractal_tileIter,			// unsigned escape iteration, as 'iter_out_opt'
+	};
+
+
+	// new pyramid description
+	//	member root: window covered by level 0, a single tile; should be
+	//		square in the plane for square pixels
+	//	member tileSize: tile edge in pixels; 0 uses default
+	//	member data: per-pixel data stored
+	//	member indexSlots: initial index slots, rounded up to a power of
+	//		two; the index doubles when three quarters full; 0 uses default
+	struct a3_FractalPyramidDesc
+	{
+		a3_FractalView root;
+		unsigned int tileSize;
+		a3_FractalTileData data;
+		unsigned int indexSlots;
+	};
+
+
+	// tile key
+	//	member formula: formula the tile was rendered with, usually an
+	//		'a3_FractalTileFormula'
+	//	member level: quadtree level, up to 'a3fractal_pyramidLevelMax'
+	//	members x, y: tile position in its level, under 2^level; tile
+	//		(0, 0) is at the bottom left
+	//	member iterations: iteration cap, same meaning as 'uIter'
+	struct a3_FractalTileKey
+	{
+		unsigned int formula;
+		unsigned int level;
+		unsigned int x, y;
+		unsigned int iterations;
+	};
+
+
+	// lookup counters, kept by the caller, added to
+	//	member lookups: tiles asked for
+	//	member hits: of those, tiles found in the pyramid
+	//	member rendered: tiles rendered with the escape-time engine
+	//	member filled: tiles filled as interior without iterating
+	//	member shared: tiles stored as a reference to equal data
+	struct a3_FractalPyramidStats
+	{
+		unsigned long long lookups;
+		unsigned long long hits;
+		unsigned long long rendered;
+		unsigned long long filled;
+		unsigned long long shared;
+	};
+
+
+//-----------------------------------------------------------------------------
+
+	// Create an empty pyramid file and map it; not safe to use from
+	//	several threads at once.
+	//	param pyramid_out: non-null pointer to pyramid pointer; must be null
+	//	param filePath: non-null, non-empty path; overwritten
+	//	param desc: non-null pointer to description
+	//	return: number of index slots if success
+	//	return: 0 if fail (already created, file could not be created or
+	//		mapped, or out of memory)
+	//	return: -1 if invalid params
+	int a3fractalPyramidCreate(a3_FractalPyramid **pyramid_out, const char *filePath, const a3_FractalPyramidDesc *desc);
+
+	// Map an existing pyramid file.
+	//	param pyramid_out: non-null pointer to pyramid pointer; must be null
+	//	param filePath: non-null, non-empty path
+	//	param readOnly: non-zero maps the file read-only: tiles can be
+	//		looked up and rendered, but are not stored
+	//	return: number of tiles in the file if success, or 1 if empty
+	//	return: 0 if fail (already created, file missing, truncated or not
+	//		a pyramid, or out of memory)
+	//	return: -1 if invalid params
+	int a3fractalPyramidOpen(a3_FractalPyramid **pyramid_out, const char *filePath, int readOnly);
+
+	// Unmap and close a pyramid; a writable file is trimmed to its
+	//	contents.
+	//	param pyramid: non-null pointer to pyramid pointer; reset to null
+	//	return: 1 if success
+	//	return: -1 if invalid params
+	int a3fractalPyramidRelease(a3_FractalPyramid **pyramid);
+
+	// Get the description a pyramid was created with.
+	//	param pyramid: non-null pointer to pyramid
+	//	param desc_out: non-null pointer to description; index slots are
+	//		the current count
+	//	return: 1 if success
+	//	return: -1 if invalid params
+	int a3fractalPyramidGetDesc(const a3_FractalPyramid *pyramid, a3_FractalPyramidDesc *desc_out);
+
+	// Get the window a tile covers.
+	//	param pyramid: non-null pointer to pyramid
+	//	params level, x, y: tile position
+	//	param view_out: non-null pointer to view
+	//	return: 1 if success
+	//	return: -1 if invalid params
+	int a3fractalPyramidGetView(const a3_FractalPyramid *pyramid, unsigned int level, unsigned int x, unsigned int y, a3_FractalView *view_out);
+
+	// Get the tiles covering a view at the shallowest level whose pixels
+	//	are no larger than the view's.
+	//	param pyramid: non-null pointer to pyramid
+	//	param view: non-null pointer to view
+	//	param width: view width in pixels
+	//	param level_out: non-null pointer to level, capped at the deepest
+	//	params x0_out, y0_out: non-null pointers to first tile
+	//	params x1_out, y1_out: non-null pointers to one past last tile;
+	//		the range is clamped to the level, and empty if the view is
+	//		outside the root
+	//	return: number of tiles in range if success
+	//	return: -1 if invalid params
+	int a3fractalPyramidGetRange(const a3_FractalPyramid *pyramid, const a3_FractalView *view, unsigned int width, unsigned int *level_out, unsigned int *x0_out, unsigned int *y0_out, unsigned int *x1_out, unsigned int *y1_out);
+
+	// Look up a tile.
+	//	param pyramid: non-null pointer to pyramid
+	//	param key: non-null pointer to key
+	//	param tile_out: non-null pointer to tile data pointer, into the
+	//		mapping; tileSize squared floats or unsigned ints, row-major,
+	//		row 0 at the bottom; valid until the pyramid grows or is
+	//		released
+	//	param stats_opt: optional pointer to counters, added to
+	//	return: 1 if found
+	//	return: 0 if not stored
+	//	return: -1 if invalid params
+	int a3fractalPyramidGet(const a3_FractalPyramid *pyramid, const a3_FractalTileKey *key, const void **tile_out, a3_FractalPyramidStats *stats_opt);
+
+	// Store a tile, or replace it; data equal to a stored tile's is not
+	//	written again. Pointers from earlier lookups are invalid after.
+	//	param pyramid: non-null pointer to writable pyramid
+	//	param key: non-null pointer to key
+	//	param tile: non-null pointer to tile data, laid out as lookups;
+	//		may be a pointer from a lookup
+	//	param stats_opt: optional pointer to counters, added to
+	//	return: 1 if success
+	//	return: 0 if fail (read-only, out of memory, or the file could not
+	//		grow)
+	//	return: -1 if invalid params
+	int a3fractalPyramidPut(a3_FractalPyramid *pyramid, const a3_FractalTileKey *key, const void *tile, a3_FractalPyramidStats *stats_opt);
+
+	// Look up a tile, rendering and storing it if it is not stored.
+	//	Pointers from earlier lookups are invalid after.
+	//	param pyramid: non-null pointer to pyramid
+	//	param key: non-null pointer to key of a formula the pyramid renders
+	//	param isa: instruction set to render with; auto picks at runtime
+	//	param pool_opt: optional pool; renders on this thread if null
+	//	param tile_out: non-null pointer to tile data pointer, as lookups;
+	//		for a read-only pyramid a rendered tile is held in a buffer
+	//		the next render reuses
+	//	param stats_opt: optional pointer to counters, added to
+	//	return: 1 if found
+	//	return: 2 if rendered
+	//	return: 0 if fail (out of memory, or the file could not grow)
+	//	return: -1 if invalid params
+	int a3fractalPyramidRender(a3_FractalPyramid *pyramid, const a3_FractalTileKey *key, a3_FractalISA isa, a3_ThreadPool *pool_opt, const void **tile_out, a3_FractalPyramidStats *stats_opt);
+
+	// Get a pyramid's contents.
+	//	param pyramid: non-null pointer to pyramid
+	//	param tiles_out_opt: optional pointer to tiles stored
+	//	param unique_out_opt: optional pointer to distinct tile data stored
+	//	param bytes_out_opt: optional pointer to bytes of file in use
+	//	return: 1 if success
+	//	return: -1 if invalid params
+	int a3fractalPyramidGetUsage(const a3_FractalPyramid *pyramid, unsigned int *tiles_out_opt, unsigned int *unique_out_opt, unsigned long long *bytes_out_opt);
+
+	// Write changed pages of the mapping back to the file.
+	//	param pyramid: non-null pointer to pyramid
+	//	return: 1 if success
+	//	return: 0 if fail
+	//	return: -1 if invalid params
+	int a3fractalPyramidFlush(a3_FractalPyramid *pyramid);
+
+
+//-----------------------------------------------------------------------------
+
+
+#ifdef __cplusplus
+}
+#endif	// __cplusplus
+
+
+#endif	// !__ANIMAL3D_DEMOFRACTALPYRAMID_H
@@ -0,0 +1,255 @@
+/*
+	animal3D SDK: Minimal 3D Animation Framework
+	Fractals Midterm: CPU fractal engines
+
+	a3_DemoFractalResume.c
+	Resumable escape-time renderer implementation.
+
+	A pixel that has not escaped after 'computed' iterations is exactly
+	where a fresh run would be at that loop index, so continuing it gives
+	the same result as starting over. Single precision stores its orbit in
+	doubles, which hold floats exactly, and iterates in floats, so its
+	counts match the shader and the single-precision kernels.
+*/
+
+#include "a3_DemoFractalResume.h"
+
+#include "animal3D/a3/a3macros.h"
+
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+
+//-----------------------------------------------------------------------------
+
+// one frame; counters are per thread, merged after the frame
+typedef struct a3_ResumePass
+{
+	a3_FractalResume *state;
+	const a3_FractalEscapeDesc *desc;
+	a3_FractalResumeStats *counters;
+} a3_ResumePass;
+
+
+// continue one pixel from iteration 'begin' to 'end' in single precision
+static unsigned int a3fractalResumePixel_single(double *z, float *mag_out, const float cx, const float cy, const unsigned int begin, const unsigned int end)
+{
+	float zx = (float)z[0], zy = (float)z[1], nzx, mag;
+	unsigned int iter;
+	for (iter = begin; iter < end; ++iter)
+	{
+		nzx = 3.0f * zx * zx - zy * zy + cx;
+		zy = 6.0f * zx * zy + cy;
+		zx = nzx;
+		mag = zx * zx + zy * zy;
+		if (mag > a3fractal_bailout)
+		{
+			*mag_out = mag;
+			break;
+		}
+	}
+	z[0] = zx;
+	z[1] = zy;
+	return iter;
+}
+
+// continue one pixel from iteration 'begin' to 'end' in double precision
+static unsigned int a3fractalResumePixel_double(double *z, float *mag_out, const double cx, const double cy, const unsigned int begin, const unsigned int end)
+{
+	double zx = z[0], zy = z[1], nzx, mag;
+	unsigned int iter;
+	for (iter = begin; iter < end; ++iter)
+	{
+		nzx = 3.0 * zx * zx - zy * zy + cx;
+		zy = 6.0 * zx * zy + cy;
+		zx = nzx;
+		mag = zx * zx + zy * zy;
+		if (mag > a3fractal_bailout)
+		{
+			*mag_out = (float)mag;
+			break;
+		}
+	}
+	z[0] = zx;
+	z[1] = zy;
+	return iter;
+}
+
+
+static void a3fractalResumeTask(void *args, unsigned int x0, unsigned int y0, unsigned int x1, unsigned int y1, unsigned int workerIndex)
+{
+	const a3_ResumePass *pass = (const a3_ResumePass *)args;
+	const a3_FractalEscapeDesc *desc = pass->desc;
+	a3_FractalResume *state = pass->state;
+	const unsigned int cap = desc->iterations, computed = state->computed;
+	const double dx = desc->view.width / (double)desc->width;
+	const double dy = desc->view.height / (double)desc->height;
+	const double left = desc->view.centerX - 0.5 * desc->view.width;
+	const double bottom = desc->view.centerY - 0.5 * desc->view.height;
+	a3_FractalResumeStats stats = { 0 };
+	double cx, cy;
+	unsigned int x, y, iter, index;
+	float smooth;
+
+	for (y = y0; y < y1; ++y)
+	{
+		cy = bottom + ((double)((int)y + desc->offsetY) + 0.5) * dy;
+		for (x = x0, index = y * desc->width + x0; x < x1; ++x, ++index)
+		{
+			// escaped, or the cap is not above what was already run
+			if (state->escaped[index] || cap <= computed)
+				++stats.answered;
+			else
+			{
+				cx = left + ((double)((int)x + desc->offsetX) + 0.5) * dx;
+				if (desc->precision == a3fractal_precisionDouble)
+					iter = a3fractalResumePixel_double(state->z + index * 2, state->mag + index, cx, cy, computed, cap);
+				else
+					iter = a3fractalResumePixel_single(state->z + index * 2, state->mag + index, (float)cx, (float)cy, computed, cap);
+				stats.iterations += iter < cap ? iter + 1 - computed : cap - computed;
+				++stats.resumed;
+				state->escaped[index] = (iter < cap);
+				state->iter[index] = iter;
+			}
+
+			// answer for this cap
+			iter = a3minimum(state->iter[index], cap);
+			smooth = iter < cap
+				? (float)iter - 1.0f - log2f(log2f(state->mag[index]))
+				: a3fractal_interior;
+			if (desc->smooth_out_opt)
+				desc->smooth_out_opt[index] = smooth;
+			if (desc->iter_out_opt)
+				desc->iter_out_opt[index] = iter;
+			if (desc->rgba_out_opt)
+				a3fractalShade(smooth, desc->rgba_out_opt + index * 4);
+		}
+	}
+
+	pass->counters[workerIndex].resumed += stats.resumed;
+	pass->counters[workerIndex].answered += stats.answered;
+	pass->counters[workerIndex].iterations += stats.iterations;
+}
+
+// start over for a new view, size or precision
+static int a3fractalResumeStart(a3_FractalResume *state, const a3_FractalEscapeDesc *desc)
+{
+	const unsigned int pixels = desc->width * desc->height;
+	const double dx = desc->view.width / (double)desc->width;
+	const double dy = desc->view.height / (double)desc->height;
+	const double left = desc->view.centerX - 0.5 * desc->view.width;
+	const double bottom = desc->view.centerY - 0.5 * desc->view.height;
+	unsigned int x, y, index;
+
+	if (!state->z || state->width * state->height != pixels)
+	{
+		a3fractalResumeRelease(state);
+		state->z = (double *)malloc(pixels * 2 * sizeof(double));
+		state->iter = (unsigned int *)malloc(pixels * sizeof(unsigned int));
+		state->mag = (float *)malloc(pixels * sizeof(float));
+		state->escaped = (unsigned char *)malloc(pixels);
+		if (!state->z || !state->iter || !state->mag || !state->escaped)
+		{
+			a3fractalResumeRelease(state);
+			return 0;
+		}
+	}
+
+	// z = c, rounded the way the kernels round it
+	for (y = 0, index = 0; y < desc->height; ++y)
+		for (x = 0; x < desc->width; ++x, ++index)
+		{
+			state->z[index * 2] = left + ((double)((int)x + desc->offsetX) + 0.5) * dx;
+			state->z[index * 2 + 1] = bottom + ((double)((int)y + desc->offsetY) + 0.5) * dy;
+			if (desc->precision != a3fractal_precisionDouble)
+			{
+				state->z[index * 2] = (float)state->z[index * 2];
+				state->z[index * 2 + 1] = (float)state->z[index * 2 + 1];
+			}
+		}
+	memset(state->iter, 0, pixels * sizeof(unsigned int));
+	memset(state->mag, 0, pixels * sizeof(float));
+	memset(state->escaped, 0, pixels);
+
+	state->view = desc->view;
+	state->width = desc->width;
+	state->height = desc->height;
+	state->precision = desc->precision;
+	state->offsetX = desc->offsetX;
+	state->offsetY = desc->offsetY;
+	state->computed = 0;
+	return 1;
+}
+
+
+//-----------------------------------------------------------------------------
+
+int a3fractalResumeRender(a3_FractalResume *state, const a3_FractalEscapeDesc *desc, a3_ThreadPool *pool_opt, a3_FractalResumeStats *stats_out_opt)
+{
+	a3_FractalResumeStats stats = { 0 };
+	a3_ResumePass pass[1];
+	unsigned int workers, i;
+
+	if (state && desc && desc->width && desc->height)
+	{
+		if (!state->z || state->width != desc->width || state->height != desc->height || state->precision != desc->precision ||
+			state->offsetX != desc->offsetX || state->offsetY != desc->offsetY || memcmp(&state->view, &desc->view, sizeof(a3_FractalView)))
+			if (!a3fractalResumeStart(state, desc))
+				return 0;
+
+		workers = a3threadPoolGetWorkerCount(pool_opt) + 1;
+		pass->counters = (a3_FractalResumeStats *)calloc(workers, sizeof(a3_FractalResumeStats));
+		if (!pass->counters)
+			return 0;
+		pass->state = state;
+		pass->desc = desc;
+		if (a3threadPoolParallelFor2D(pool_opt, 0, a3fractalResumeTask, pass, desc->width, desc->height, 32, 32) < 0)
+		{
+			free(pass->counters);
+			return 0;
+		}
+		state->computed = a3maximum(state->computed, desc->iterations);
+
+		for (i = 0; i < workers; ++i)
+		{
+			stats.resumed += pass->counters[i].resumed;
+			stats.answered += pass->counters[i].answered;
+			stats.iterations += pass->counters[i].iterations;
+		}
+		if (stats_out_opt)
+			*stats_out_opt = stats;
+
+		free(pass->counters);
+		return (int)(desc->width * desc->height);
+	}
+	return -1;
+}
+
+int a3fractalResumeReset(a3_FractalResume *state)
+{
+	if (state)
+	{
+		// a zero width forces a restart on the next frame
+		state->width = state->height = 0;
+		return 1;
+	}
+	return -1;
+}
+
+int a3fractalResumeRelease(a3_FractalResume *state)
+{
+	if (state)
+	{
+		free(state->z);
+		free(state->iter);
+		free(state->mag);
+		free(state->escaped);
+		memset(state, 0, sizeof(a3_FractalResume));
+		return 1;
+	}
+	return -1;
+}
+
+
+//-----------------------------------------------------------------------------
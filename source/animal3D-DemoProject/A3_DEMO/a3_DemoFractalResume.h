@@ -0,0 +1,107 @@
+/*
+	animal3D SDK: Minimal 3D Animation Framework
+	Fractals Midterm: CPU fractal engines
+
+	a3_DemoFractalResume.h
+	Resumable escape-time rendering for stepping the iteration cap.
+
+	The demo's 'k' and 'l' keys step 'fract_iter' by one, which changes
+	nothing about a pixel except how long it may run. Each pixel's state
+	is kept between frames: where its orbit stopped, how far it got and
+	whether it escaped. Raising the cap continues only the pixels that
+	had not escaped; lowering it is answered from the stored escape
+	iterations without iterating at all. A frame therefore costs the
+	iterations added since the highest cap seen, not the full count.
+*/
+
+#ifndef __ANIMAL3D_DEMOFRACTALRESUME_H
+#define __ANIMAL3D_DEMOFRACTALRESUME_H
+
+
+#include "a3_DemoFractalEscape.h"
+
+
+//-----------------------------------------------------------------------------
+
+#ifdef __cplusplus
+extern "C"
+{
+#else	// !__cplusplus
+	typedef struct a3_FractalResume				a3_FractalResume;
+	typedef struct a3_FractalResumeStats		a3_FractalResumeStats;
+#endif	// __cplusplus
+
+
+//-----------------------------------------------------------------------------
+
+	// per-pixel state kept between frames, zero-initialize before first use
+	//	members view, width, height, precision, offsetX, offsetY: what the
+	//		state describes; any change starts over
+	//	member computed: highest cap any frame has iterated to
+	//	member z: last orbit point (x, y) of every pixel that has not
+	//		escaped
+	//	member iter: escape iteration, or iterations run if not escaped
+	//	member mag: squared magnitude at escape
+	//	member escaped: escape flag
+	struct a3_FractalResume
+	{
+		a3_FractalView view;
+		unsigned int width, height;
+		a3_FractalEscapePrecision precision;
+		int offsetX, offsetY;
+		unsigned int computed;
+		double *z;
+		unsigned int *iter;
+		float *mag;
+		unsigned char *escaped;
+	};
+
+
+	// per-frame counters
+	//	member resumed: pixels iterated further this frame
+	//	member answered: pixels output from stored state alone
+	//	member iterations: pixel iterations performed
+	struct a3_FractalResumeStats
+	{
+		unsigned int resumed;
+		unsigned int answered;
+		unsigned long long iterations;
+	};
+
+
+//-----------------------------------------------------------------------------
+
+	// Render an image, continuing from the state of earlier frames.
+	//	param state: non-null pointer to state kept between frames
+	//	param desc: non-null pointer to render description; the view,
+	//		size and precision are compared with the state, the instruction
+	//		set is not used
+	//	param pool_opt: optional pool; renders on this thread if null
+	//	param stats_out_opt: optional pointer to frame counters
+	//	return: number of pixels rendered if success
+	//	return: 0 if fail (out of memory)
+	//	return: -1 if invalid params
+	int a3fractalResumeRender(a3_FractalResume *state, const a3_FractalEscapeDesc *desc, a3_ThreadPool *pool_opt, a3_FractalResumeStats *stats_out_opt);
+
+	// Forget all stored progress; the next frame starts from iteration 0.
+	//	param state: non-null pointer to state
+	//	return: 1 if success
+	//	return: -1 if invalid params
+	int a3fractalResumeReset(a3_FractalResume *state);
+
+	// Release state buffers.
+	//	param state: non-null pointer to state
+	//	return: 1 if success
+	//	return: -1 if invalid params
+	int a3fractalResumeRelease(a3_FractalResume *state);
+
+
+//-----------------------------------------------------------------------------
+
+
+#ifdef __cplusplus
+}
+#endif	// __cplusplus
+
+
+#endif	// !__ANIMAL3D_DEMOFRACTALRESUME_H
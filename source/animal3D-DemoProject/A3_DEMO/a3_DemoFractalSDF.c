@@ -0,0 +1,1255 @@
+/*
+	animal3D SDK: Minimal 3D Animation Framework
+	Fractals Midterm: CPU fractal engines
+
+	a3_DemoFractalSDF.c
+	Distance field scene compiler and evaluator implementation.
+
+	Compiling a node into value register 'dst' may use every register
+	above it and none below, so a parent compiles its first child into
+	'dst', its second into 'dst + 1', and combines them into 'dst'. The
+	child needing more registers goes first (Sethi-Ullman), so a chain of
+	combinations of any length needs two; a union instead puts its
+	smaller branch first, for pruning, while the registers left allow it,
+	so a chain of unions takes one more register per link until they run
+	out and only then falls back to two. Point
+	registers are pushed by the nodes that change space and popped when
+	their subtree is done. The pending change of space passed down the
+	walk is
+		node point = (p - t) inv,	node distance = distance s
+	for the point register 'p' it is compiled against; translations and
+	scales only update it, primitives and planes absorb it into their
+	constants, and every other change of space first writes it out as one
+	instruction and scales the subtree's distance back after.
+*/
+
+#include "a3_DemoFractalSDF.h"
+#include "_utilities/a3_DemoSIMD.h"
+
+#include "animal3D/a3/a3macros.h"
+
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+
+//-----------------------------------------------------------------------------
+
+// most lanes run at once
+#define a3sdf_lanes			16
+
+// subtree sizes saturate here
+#define a3sdf_sizeMax		0x40000000u
+
+
+// node kinds
+typedef enum a3_SDFKind
+{
+	a3sdf_box,
+	a3sdf_sphere,
+	a3sdf_plane,
+	a3sdf_union,
+	a3sdf_intersect,
+	a3sdf_subtract,
+	a3sdf_offset,
+	a3sdf_translate,
+	a3sdf_scale,
+	a3sdf_repeat,
+	a3sdf_mirror,
+	a3sdf_warp,
+} a3_SDFKind;
+
+// scene node: children, parameters, and a box its surface lies in if
+//	'bounded'; 'size' counts the nodes below it, shared ones once per use,
+//	and 'registers' is the most value registers compiling it needs
+typedef struct a3_SDFNode
+{
+	a3_SDFKind kind;
+	int a, b;
+	float param[4];
+	unsigned int id;
+	float boundMin[3], boundMax[3];
+	int bounded;
+	unsigned int size;
+	unsigned int registers;
+} a3_SDFNode;
+
+struct a3_FractalSDFScene
+{
+	a3_SDFNode *node;
+	unsigned int count, capacity;
+};
+
+
+// instructions; 'k' is the instruction's constants, p point registers
+//	and v value registers
+typedef enum a3_SDFOp
+{
+	a3sdf_opAffine,		// p[dst] = (p[a] - k0..2) k3
+	a3sdf_opRepeat,		// p[dst] = p[a] - k0 floor(p[a] k1) - k2
+	a3sdf_opMirror,		// p[dst] = |p[a]|
+	a3sdf_opWarp,		// p[dst] = p[a] k0 + k1..3
+	a3sdf_opBox,		// v[dst] = box of half size k3..5 at k0..2 from p[a], id k6
+	a3sdf_opSphere,		// v[dst] = |p[a] - k0..2| - k3, id k4
+	a3sdf_opPlane,		// v[dst] = k0..2 . p[a] - k3, id k4
+	a3sdf_opUnion,		// v[dst] = min(v[a], v[b]), ties to b
+	a3sdf_opIntersect,	// v[dst] = max(v[a], v[b]), ties to b
+	a3sdf_opSubtract,	// v[dst] = max(v[a], -v[b]), ties to b
+	a3sdf_opScale,		// v[dst] = v[a] k0
+	a3sdf_opAdd,		// v[dst] = v[a] + k0
+	a3sdf_opBound,		// v[dst] = largest axis distance outside box k3..5 at k0..2
+						//	from p[a], id of v[b]; jump if above v[b] and 0 in
+						//	every lane
+} a3_SDFOp;
+
+typedef struct a3_SDFInstruction
+{
+	unsigned char op, dst, a, b;
+	unsigned int constant;
+	unsigned int jump;
+} a3_SDFInstruction;
+
+struct a3_FractalSDFProgram
+{
+	a3_SDFInstruction *code;
+	float *constant;
+	unsigned int count, constants;
+};
+
+
+// pending change of space
+typedef struct a3_SDFFrame
+{
+	float t[3], inv, s;
+} a3_SDFFrame;
+
+typedef struct a3_SDFCompiler
+{
+	const a3_FractalSDFScene *scene;
+	a3_SDFInstruction *code;
+	float *constant;
+	unsigned int count, capacity, constants, constantCapacity;
+	unsigned int pointTop;
+	a3_FractalSDFProgramInfo info;
+	int failed;
+} a3_SDFCompiler;
+
+
+// kernel: run a program on one group of lanes, points read and distances
+//	and ids written contiguously; returns instructions run
+typedef unsigned int(*a3_FractalSDFRunFunc)(const a3_FractalSDFProgram *program, const float *x, const float *y, const float *z, float *dist_out, float *id_out, unsigned int *pruned);
+
+
+//-----------------------------------------------------------------------------
+// scene
+
+int a3fractalSDFSceneCreate(a3_FractalSDFScene **scene_out, unsigned int capacity)
+{
+	a3_FractalSDFScene *scene;
+	if (scene_out && capacity)
+	{
+		if (!*scene_out)
+		{
+			scene = (a3_FractalSDFScene *)malloc(sizeof(a3_FractalSDFScene) + capacity * sizeof(a3_SDFNode));
+			if (scene)
+			{
+				scene->node = (a3_SDFNode *)(scene + 1);
+				scene->count = 0;
+				scene->capacity = capacity;
+				*scene_out = scene;
+				return (int)capacity;
+			}
+		}
+		return 0;
+	}
+	return -1;
+}
+
+int a3fractalSDFSceneRelease(a3_FractalSDFScene **scene)
+{
+	if (scene)
+	{
+		free(*scene);
+		*scene = 0;
+		return 1;
+	}
+	return -1;
+}
+
+// claim a node; children must already exist, so the graph has no cycles
+static a3_SDFNode *a3fractalSDFAdd(a3_FractalSDFScene *scene, const a3_SDFKind kind, const int a, const int b)
+{
+	a3_SDFNode *node;
+	unsigned int size = 1, ra = 1, rb = 0;
+	if (!scene || scene->count >= scene->capacity)
+		return 0;
+	if (a >= 0)
+	{
+		if ((unsigned int)a >= scene->count)
+			return 0;
+		size += scene->node[a].size;
+		ra = scene->node[a].registers;
+	}
+	if (b >= 0)
+	{
+		if ((unsigned int)b >= scene->count)
+			return 0;
+		size += scene->node[b].size;
+		rb = scene->node[b].registers;
+	}
+	node = scene->node + scene->count;
+	memset(node, 0, sizeof(a3_SDFNode));
+	node->kind = kind;
+	node->a = a;
+	node->b = b;
+	node->size = a3minimum(size, a3sdf_sizeMax);
+
+	// two children needing as many registers need one more between them
+	node->registers = (ra == rb ? ra + 1 : a3maximum(ra, rb));
+	return node;
+}
+
+static void a3fractalSDFSetBound(a3_SDFNode *node, const float *center, const float *half)
+{
+	unsigned int i;
+	for (i = 0; i < 3; ++i)
+	{
+		node->boundMin[i] = center[i] - half[i];
+		node->boundMax[i] = center[i] + half[i];
+	}
+	node->bounded = 1;
+}
+
+static int a3fractalSDFPrimitive(a3_FractalSDFScene *scene, const a3_SDFKind kind, const float *param, const float *half, const unsigned int id)
+{
+	const float origin[3] = { 0.0f };
+	a3_SDFNode *node = a3fractalSDFAdd(scene, kind, -1, -1);
+	if (!node)
+		return -1;
+	memcpy(node->param, param, sizeof(node->param));
+	node->id = id;
+	if (half)
+		a3fractalSDFSetBound(node, origin, half);
+	return (int)(scene->count++);
+}
+
+int a3fractalSDFBox(a3_FractalSDFScene *scene, float hx, float hy, float hz, unsigned int id)
+{
+	const float param[4] = { hx, hy, hz }, half[3] = { hx, hy, hz };
+	if (hx > 0.0f && hy > 0.0f && hz > 0.0f)
+		return a3fractalSDFPrimitive(scene, a3sdf_box, param, half, id);
+	return -1;
+}
+
+int a3fractalSDFSphere(a3_FractalSDFScene *scene, float radius, unsigned int id)
+{
+	const float param[4] = { radius }, half[3] = { radius, radius, radius };
+	if (radius > 0.0f)
+		return a3fractalSDFPrimitive(scene, a3sdf_sphere, param, half, id);
+	return -1;
+}
+
+int a3fractalSDFPlane(a3_FractalSDFScene *scene, float nx, float ny, float nz, float height, unsigned int id)
+{
+	const float param[4] = { nx, ny, nz, height };
+	if (nx != 0.0f || ny != 0.0f || nz != 0.0f)
+		return a3fractalSDFPrimitive(scene, a3sdf_plane, param, 0, id);
+	return -1;
+}
+
+static int a3fractalSDFCombine(a3_FractalSDFScene *scene, const a3_SDFKind kind, const int a, const int b)
+{
+	const a3_SDFNode *na, *nb;
+	a3_SDFNode *node;
+	unsigned int i;
+	if (a < 0 || b < 0)
+		return -1;
+	node = a3fractalSDFAdd(scene, kind, a, b);
+	if (!node)
+		return -1;
+	na = scene->node + a;
+	nb = scene->node + b;
+
+	// a union is in both boxes together, an intersection in their
+	//	overlap, a difference in its first node's box
+	if (kind == a3sdf_union)
+	{
+		node->bounded = na->bounded && nb->bounded;
+		for (i = 0; node->bounded && i < 3; ++i)
+		{
+			node->boundMin[i] = a3minimum(na->boundMin[i], nb->boundMin[i]);
+			node->boundMax[i] = a3maximum(na->boundMax[i], nb->boundMax[i]);
+		}
+	}
+	else if (kind == a3sdf_intersect && na->bounded && nb->bounded)
+	{
+		node->bounded = 1;
+		for (i = 0; i < 3; ++i)
+		{
+			node->boundMin[i] = a3maximum(na->boundMin[i], nb->boundMin[i]);
+			node->boundMax[i] = a3minimum(na->boundMax[i], nb->boundMax[i]);
+			node->boundMax[i] = a3maximum(node->boundMin[i], node->boundMax[i]);
+		}
+	}
+	else if (kind == a3sdf_intersect && nb->bounded)
+	{
+		memcpy(node->boundMin, nb->boundMin, sizeof(node->boundMin));
+		memcpy(node->boundMax, nb->boundMax, sizeof(node->boundMax));
+		node->bounded = 1;
+	}
+	else
+	{
+		memcpy(node->boundMin, na->boundMin, sizeof(node->boundMin));
+		memcpy(node->boundMax, na->boundMax, sizeof(node->boundMax));
+		node->bounded = na->bounded;
+	}
+	return (int)(scene->count++);
+}
+
+int a3fractalSDFUnion(a3_FractalSDFScene *scene, int a, int b)
+{
+	return a3fractalSDFCombine(scene, a3sdf_union, a, b);
+}
+
+int a3fractalSDFIntersect(a3_FractalSDFScene *scene, int a, int b)
+{
+	return a3fractalSDFCombine(scene, a3sdf_intersect, a, b);
+}
+
+int a3fractalSDFSubtract(a3_FractalSDFScene *scene, int a, int b)
+{
+	return a3fractalSDFCombine(scene, a3sdf_subtract, a, b);
+}
+
+// add a node over one child, bounded by the child's box mapped through
+//	p -> p scale + offset from the child's space to its own
+static int a3fractalSDFModify(a3_FractalSDFScene *scene, const a3_SDFKind kind, const int child, const float *param, const float scale, const float *offset)
+{
+	const a3_SDFNode *nc;
+	a3_SDFNode *node;
+	float lo, hi;
+	unsigned int i;
+	if (child < 0)
+		return -1;
+	node = a3fractalSDFAdd(scene, kind, child, -1);
+	if (!node)
+		return -1;
+	nc = scene->node + child;
+	memcpy(node->param, param, sizeof(node->param));
+	node->bounded = nc->bounded;
+	for (i = 0; node->bounded && i < 3; ++i)
+	{
+		lo = nc->boundMin[i] * scale + offset[i];
+		hi = nc->boundMax[i] * scale + offset[i];
+		node->boundMin[i] = a3minimum(lo, hi);
+		node->boundMax[i] = a3maximum(lo, hi);
+	}
+	return (int)(scene->count++);
+}
+
+int a3fractalSDFOffset(a3_FractalSDFScene *scene, int child, float radius)
+{
+	const float param[4] = { radius }, grow = a3maximum(radius, 0.0f);
+	const int node = a3fractalSDFModify(scene, a3sdf_offset, child, param, 1.0f, param + 1);
+	unsigned int i;
+	for (i = 0; node >= 0 && i < 3; ++i)
+	{
+		scene->node[node].boundMin[i] -= grow;
+		scene->node[node].boundMax[i] += grow;
+	}
+	return node;
+}
+
+int a3fractalSDFTranslate(a3_FractalSDFScene *scene, int child, float tx, float ty, float tz)
+{
+	const float param[4] = { tx, ty, tz };
+	return a3fractalSDFModify(scene, a3sdf_translate, child, param, 1.0f, param);
+}
+
+int a3fractalSDFScale(a3_FractalSDFScene *scene, int child, float scale)
+{
+	const float param[4] = { scale }, offset[3] = { 0.0f };
+	if (scale > 0.0f)
+		return a3fractalSDFModify(scene, a3sdf_scale, child, param, scale, offset);
+	return -1;
+}
+
+int a3fractalSDFRepeat(a3_FractalSDFScene *scene, int child, float period)
+{
+	const float param[4] = { period }, offset[3] = { 0.0f };
+	int node = -1;
+	if (period > 0.0f)
+	{
+		// every cell holds a copy: unbounded
+		node = a3fractalSDFModify(scene, a3sdf_repeat, child, param, 1.0f, offset);
+		if (node >= 0)
+			scene->node[node].bounded = 0;
+	}
+	return node;
+}
+
+int a3fractalSDFMirror(a3_FractalSDFScene *scene, int child)
+{
+	const float param[4] = { 0.0f }, offset[3] = { 0.0f };
+	const int node = a3fractalSDFModify(scene, a3sdf_mirror, child, param, 1.0f, offset);
+	a3_SDFNode *n;
+	float m;
+	unsigned int i;
+	if (node >= 0)
+	{
+		// |p| in the box: p in the box symmetric about the origin
+		n = scene->node + node;
+		for (i = 0; i < 3; ++i)
+		{
+			m = a3maximum(fabsf(n->boundMin[i]), fabsf(n->boundMax[i]));
+			n->boundMin[i] = -m;
+			n->boundMax[i] = m;
+		}
+	}
+	return node;
+}
+
+int a3fractalSDFWarp(a3_FractalSDFScene *scene, int child, float scale, float ox, float oy, float oz)
+{
+	const float param[4] = { scale, ox, oy, oz }, offset[3] = { -ox / scale, -oy / scale, -oz / scale };
+	if (scale != 0.0f)
+		return a3fractalSDFModify(scene, a3sdf_warp, child, param, 1.0f / scale, offset);
+	return -1;
+}
+
+
+//-----------------------------------------------------------------------------
+// compiler
+
+static void a3fractalSDFEmit(a3_SDFCompiler *c, const a3_SDFOp op, const unsigned int dst, const unsigned int a, const unsigned int b, const float *constant, const unsigned int constants)
+{
+	a3_SDFInstruction *ins;
+	void *grown;
+	unsigned int capacity;
+	if (c->failed)
+		return;
+	if (c->count == c->capacity)
+	{
+		capacity = c->capacity * 2;
+		grown = realloc(c->code, capacity * sizeof(a3_SDFInstruction));
+		if (!grown)
+		{
+			c->failed = 1;
+			return;
+		}
+		c->code = (a3_SDFInstruction *)grown;
+		c->capacity = capacity;
+	}
+	if (c->constants + constants > c->constantCapacity)
+	{
+		capacity = c->constantCapacity * 2 + constants;
+		grown = realloc(c->constant, capacity * sizeof(float));
+		if (!grown)
+		{
+			c->failed = 1;
+			return;
+		}
+		c->constant = (float *)grown;
+		c->constantCapacity = capacity;
+	}
+	ins = c->code + c->count++;
+	ins->op = (unsigned char)op;
+	ins->dst = (unsigned char)dst;
+	ins->a = (unsigned char)a;
+	ins->b = (unsigned char)b;
+	ins->constant = c->constants;
+	ins->jump = 0;
+	memcpy(c->constant + c->constants, constant, constants * sizeof(float));
+	c->constants += constants;
+}
+
+static void a3fractalSDFCompileNode(a3_SDFCompiler *c, int index, const unsigned int p, const a3_SDFFrame *frame, const unsigned int dst)
+{
+	const a3_SDFNode *node;
+	const a3_SDFFrame identity = { { 0.0f, 0.0f, 0.0f }, 1.0f, 1.0f };
+	a3_SDFFrame next;
+	float k[7];
+	unsigned int first, second, small, large, test, q, i;
+
+	if (c->failed)
+		return;
+	node = c->scene->node + index;
+	if (dst + node->registers > a3fractal_sdfRegisters)
+	{
+		c->failed = 1;
+		return;
+	}
+	c->info.valueRegisters = a3maximum(c->info.valueRegisters, dst + 1);
+	++c->info.nodes;
+
+	switch (node->kind)
+	{
+	case a3sdf_box:
+	case a3sdf_sphere:
+		// centered at t, sized by s
+		k[0] = frame->t[0];
+		k[1] = frame->t[1];
+		k[2] = frame->t[2];
+		k[3] = node->param[0] * frame->s;
+		if (node->kind == a3sdf_box)
+		{
+			k[4] = node->param[1] * frame->s;
+			k[5] = node->param[2] * frame->s;
+			k[6] = (float)node->id;
+			a3fractalSDFEmit(c, a3sdf_opBox, dst, p, 0, k, 7);
+		}
+		else
+		{
+			k[4] = (float)node->id;
+			a3fractalSDFEmit(c, a3sdf_opSphere, dst, p, 0, k, 5);
+		}
+		break;
+	case a3sdf_plane:
+		// s (n.(p - t) inv - h) = n.p - (n.t + h s)
+		k[0] = node->param[0];
+		k[1] = node->param[1];
+		k[2] = node->param[2];
+		k[3] = k[0] * frame->t[0] + k[1] * frame->t[1] + k[2] * frame->t[2] + node->param[3] * frame->s;
+		k[4] = (float)node->id;
+		a3fractalSDFEmit(c, a3sdf_opPlane, dst, p, 0, k, 5);
+		break;
+	case a3sdf_union:
+	case a3sdf_intersect:
+	case a3sdf_subtract:
+		// the branch needing more registers goes first, leaving the other
+		//	all but one of them; a union evaluates its smaller branch first
+		//	if that still fits, so the larger one can be skipped when its
+		//	box is farther than the smaller one's result
+		first = (unsigned int)node->a;
+		second = (unsigned int)node->b;
+		if (c->scene->node[second].registers > c->scene->node[first].registers)
+		{
+			first = (unsigned int)node->b;
+			second = (unsigned int)node->a;
+		}
+		if (node->kind == a3sdf_union)
+		{
+			small = (unsigned int)node->a;
+			large = (unsigned int)node->b;
+			if (c->scene->node[small].size > c->scene->node[large].size)
+			{
+				small = (unsigned int)node->b;
+				large = (unsigned int)node->a;
+			}
+			if (dst + a3maximum(c->scene->node[small].registers, c->scene->node[large].registers + 1) <= a3fractal_sdfRegisters)
+			{
+				first = small;
+				second = large;
+			}
+		}
+		a3fractalSDFCompileNode(c, (int)first, p, frame, dst);
+		test = c->count;
+		if (node->kind == a3sdf_union && c->scene->node[second].bounded && c->scene->node[second].size >= a3fractal_sdfPruneNodes)
+		{
+			for (i = 0; i < 3; ++i)
+			{
+				k[i] = frame->t[i] + 0.5f * (c->scene->node[second].boundMin[i] + c->scene->node[second].boundMax[i]) * frame->s;
+				k[3 + i] = 0.5f * (c->scene->node[second].boundMax[i] - c->scene->node[second].boundMin[i]) * frame->s;
+			}
+			a3fractalSDFEmit(c, a3sdf_opBound, dst + 1, p, dst, k, 6);
+			++c->info.bounds;
+		}
+		a3fractalSDFCompileNode(c, (int)second, p, frame, dst + 1);
+		if (!c->failed && test < c->count && c->code[test].op == a3sdf_opBound)
+			c->code[test].jump = c->count;
+		k[0] = 0.0f;
+		if (first == (unsigned int)node->a)
+			a3fractalSDFEmit(c, (a3_SDFOp)(a3sdf_opUnion + node->kind - a3sdf_union), dst, dst, dst + 1, k, 0);
+		else
+			a3fractalSDFEmit(c, (a3_SDFOp)(a3sdf_opUnion + node->kind - a3sdf_union), dst, dst + 1, dst, k, 0);
+		break;
+	case a3sdf_offset:
+		a3fractalSDFCompileNode(c, node->a, p, frame, dst);
+		if (node->param[0] != 0.0f)
+		{
+			k[0] = -node->param[0] * frame->s;
+			a3fractalSDFEmit(c, a3sdf_opAdd, dst, dst, 0, k, 1);
+		}
+		else
+			++c->info.folded;
+		break;
+	case a3sdf_translate:
+		// (p - t) inv - o = (p - (t + o s)) inv
+		next = *frame;
+		next.t[0] += node->param[0] * frame->s;
+		next.t[1] += node->param[1] * frame->s;
+		next.t[2] += node->param[2] * frame->s;
+		++c->info.folded;
+		a3fractalSDFCompileNode(c, node->a, p, &next, dst);
+		break;
+	case a3sdf_scale:
+		next = *frame;
+		next.inv = frame->inv / node->param[0];
+		next.s = frame->s * node->param[0];
+		++c->info.folded;
+		a3fractalSDFCompileNode(c, node->a, p, &next, dst);
+		break;
+	case a3sdf_repeat:
+	case a3sdf_mirror:
+	case a3sdf_warp:
+		// write out the pending change, then this one, in place
+		q = c->pointTop++;
+		if (q >= a3fractal_sdfRegisters)
+		{
+			c->failed = 1;
+			return;
+		}
+		c->info.pointRegisters = a3maximum(c->info.pointRegisters, q + 1);
+		i = p;
+		if (frame->t[0] != 0.0f || frame->t[1] != 0.0f || frame->t[2] != 0.0f || frame->inv != 1.0f)
+		{
+			k[0] = frame->t[0];
+			k[1] = frame->t[1];
+			k[2] = frame->t[2];
+			k[3] = frame->inv;
+			a3fractalSDFEmit(c, a3sdf_opAffine, q, i, 0, k, 4);
+			i = q;
+		}
+		if (node->kind == a3sdf_repeat)
+		{
+			k[0] = node->param[0];
+			k[1] = 1.0f / node->param[0];
+			k[2] = 0.5f * node->param[0];
+			a3fractalSDFEmit(c, a3sdf_opRepeat, q, i, 0, k, 3);
+		}
+		else if (node->kind == a3sdf_warp)
+			a3fractalSDFEmit(c, a3sdf_opWarp, q, i, 0, node->param, 4);
+		else
+		{
+			// mirroring twice is mirroring once
+			while (c->scene->node[node->a].kind == a3sdf_mirror)
+			{
+				node = c->scene->node + node->a;
+				++c->info.folded;
+			}
+			a3fractalSDFEmit(c, a3sdf_opMirror, q, i, 0, k, 0);
+		}
+		a3fractalSDFCompileNode(c, node->a, q, &identity, dst);
+		--c->pointTop;
+		if (frame->s != 1.0f)
+		{
+			k[0] = frame->s;
+			a3fractalSDFEmit(c, a3sdf_opScale, dst, dst, 0, k, 1);
+		}
+		break;
+	}
+}
+
+int a3fractalSDFCompile(a3_FractalSDFProgram **program_out, const a3_FractalSDFScene *scene, int root, a3_FractalSDFProgramInfo *info_out_opt)
+{
+	const a3_SDFFrame identity = { { 0.0f, 0.0f, 0.0f }, 1.0f, 1.0f };
+	a3_FractalSDFProgram *program;
+	a3_SDFCompiler c[1] = { 0 };
+	int result = 0;
+
+	if (program_out && scene && root >= 0 && (unsigned int)root < scene->count)
+	{
+		if (!*program_out)
+		{
+			c->scene = scene;
+			c->capacity = 64;
+			c->constantCapacity = 256;
+			c->code = (a3_SDFInstruction *)malloc(c->capacity * sizeof(a3_SDFInstruction));
+			c->constant = (float *)malloc(c->constantCapacity * sizeof(float));
+			c->failed = !c->code || !c->constant;
+
+			// point register 0 is the input
+			c->pointTop = 1;
+			c->info.pointRegisters = 1;
+			a3fractalSDFCompileNode(c, root, 0, &identity, 0);
+
+			if (!c->failed)
+			{
+				program = (a3_FractalSDFProgram *)malloc(sizeof(a3_FractalSDFProgram) + c->count * sizeof(a3_SDFInstruction) + (c->constants + 1) * sizeof(float));
+				if (program)
+				{
+					program->code = (a3_SDFInstruction *)(program + 1);
+					program->constant = (float *)(program->code + c->count);
+					program->count = c->count;
+					program->constants = c->constants;
+					memcpy(program->code, c->code, c->count * sizeof(a3_SDFInstruction));
+					memcpy(program->constant, c->constant, c->constants * sizeof(float));
+					*program_out = program;
+					c->info.instructions = c->count;
+					if (info_out_opt)
+						*info_out_opt = c->info;
+					result = (int)c->count;
+				}
+			}
+			free(c->code);
+			free(c->constant);
+		}
+		return result;
+	}
+	return -1;
+}
+
+int a3fractalSDFProgramRelease(a3_FractalSDFProgram **program)
+{
+	if (program)
+	{
+		free(*program);
+		*program = 0;
+		return 1;
+	}
+	return -1;
+}
+
+
+//-----------------------------------------------------------------------------
+// kernels
+
+// scalar fallback
+static unsigned int a3fractalSDFRun_scalar(const a3_FractalSDFProgram *program, const float *x, const float *y, const float *z, float *dist_out, float *id_out, unsigned int *pruned)
+{
+	float px[a3fractal_sdfRegisters], py[a3fractal_sdfRegisters], pz[a3fractal_sdfRegisters];
+	float vd[a3fractal_sdfRegisters], vi[a3fractal_sdfRegisters];
+	const a3_SDFInstruction *ins = program->code, *end = ins + program->count;
+	const float *k;
+	float dx, dy, dz, ex, ey, ez, d, i;
+	unsigned int run = 0;
+	px[0] = *x;
+	py[0] = *y;
+	pz[0] = *z;
+	for (; ins < end; ++ins, ++run)
+	{
+		k = program->constant + ins->constant;
+		switch (ins->op)
+		{
+		case a3sdf_opAffine:
+			px[ins->dst] = (px[ins->a] - k[0]) * k[3];
+			py[ins->dst] = (py[ins->a] - k[1]) * k[3];
+			pz[ins->dst] = (pz[ins->a] - k[2]) * k[3];
+			break;
+		case a3sdf_opRepeat:
+			px[ins->dst] = px[ins->a] - k[0] * floorf(px[ins->a] * k[1]) - k[2];
+			py[ins->dst] = py[ins->a] - k[0] * floorf(py[ins->a] * k[1]) - k[2];
+			pz[ins->dst] = pz[ins->a] - k[0] * floorf(pz[ins->a] * k[1]) - k[2];
+			break;
+		case a3sdf_opMirror:
+			px[ins->dst] = fabsf(px[ins->a]);
+			py[ins->dst] = fabsf(py[ins->a]);
+			pz[ins->dst] = fabsf(pz[ins->a]);
+			break;
+		case a3sdf_opWarp:
+			px[ins->dst] = px[ins->a] * k[0] + k[1];
+			py[ins->dst] = py[ins->a] * k[0] + k[2];
+			pz[ins->dst] = pz[ins->a] * k[0] + k[3];
+			break;
+		case a3sdf_opBox:
+			// 'objBoxS'
+			dx = fabsf(px[ins->a] - k[0]) - k[3];
+			dy = fabsf(py[ins->a] - k[1]) - k[4];
+			dz = fabsf(pz[ins->a] - k[2]) - k[5];
+			ex = a3maximum(dx, 0.0f);
+			ey = a3maximum(dy, 0.0f);
+			ez = a3maximum(dz, 0.0f);
+			vd[ins->dst] = a3minimum(a3maximum(a3maximum(dx, dy), dz), sqrtf(ex * ex + ey * ey + ez * ez));
+			vi[ins->dst] = k[6];
+			break;
+		case a3sdf_opSphere:
+			dx = px[ins->a] - k[0];
+			dy = py[ins->a] - k[1];
+			dz = pz[ins->a] - k[2];
+			vd[ins->dst] = sqrtf(dx * dx + dy * dy + dz * dz) - k[3];
+			vi[ins->dst] = k[4];
+			break;
+		case a3sdf_opPlane:
+			vd[ins->dst] = k[0] * px[ins->a] + k[1] * py[ins->a] + k[2] * pz[ins->a] - k[3];
+			vi[ins->dst] = k[4];
+			break;
+		case a3sdf_opUnion:
+			i = vd[ins->a] < vd[ins->b] ? vi[ins->a] : vi[ins->b];
+			vd[ins->dst] = a3minimum(vd[ins->a], vd[ins->b]);
+			vi[ins->dst] = i;
+			break;
+		case a3sdf_opIntersect:
+			i = vd[ins->a] > vd[ins->b] ? vi[ins->a] : vi[ins->b];
+			vd[ins->dst] = a3maximum(vd[ins->a], vd[ins->b]);
+			vi[ins->dst] = i;
+			break;
+		case a3sdf_opSubtract:
+			d = -vd[ins->b];
+			i = vd[ins->a] > d ? vi[ins->a] : vi[ins->b];
+			vd[ins->dst] = a3maximum(vd[ins->a], d);
+			vi[ins->dst] = i;
+			break;
+		case a3sdf_opScale:
+			vd[ins->dst] = vd[ins->a] * k[0];
+			break;
+		case a3sdf_opAdd:
+			vd[ins->dst] = vd[ins->a] + k[0];
+			break;
+		case a3sdf_opBound:
+			// the largest axis distance, no more than any field's that
+			//	is at least 'objBoxS'
+			dx = fabsf(px[ins->a] - k[0]) - k[3];
+			dy = fabsf(py[ins->a] - k[1]) - k[4];
+			dz = fabsf(pz[ins->a] - k[2]) - k[5];
+			d = a3maximum(a3maximum(a3maximum(dx, dy), dz), 0.0f);
+			vi[ins->dst] = vi[ins->b];
+			vd[ins->dst] = d;
+			if (d > a3maximum(vd[ins->b], 0.0f))
+			{
+				ins = program->code + ins->jump - 1;
+				++*pruned;
+			}
+			break;
+		}
+	}
+	*dist_out = vd[0];
+	*id_out = vi[0];
+	return run;
+}
+
+
+#if A3_FRACTAL_X86
+
+// SSE2: 4 points per instruction
+
+A3_FRACTAL_TARGET("sse2")
+static unsigned int a3fractalSDFRun_sse2(const a3_FractalSDFProgram *program, const float *x, const float *y, const float *z, float *dist_out, float *id_out, unsigned int *pruned)
+{
+	__m128 px[a3fractal_sdfRegisters], py[a3fractal_sdfRegisters], pz[a3fractal_sdfRegisters];
+	__m128 vd[a3fractal_sdfRegisters], vi[a3fractal_sdfRegisters];
+	const __m128 sign = _mm_set1_ps(-0.0f), zero = _mm_setzero_ps(), one = _mm_set1_ps(1.0f);
+	const a3_SDFInstruction *ins = program->code, *end = ins + program->count;
+	const float *k;
+	__m128 dx, dy, dz, ex, ey, ez, d, m, t;
+	unsigned int run = 0;
+	px[0] = _mm_loadu_ps(x);
+	py[0] = _mm_loadu_ps(y);
+	pz[0] = _mm_loadu_ps(z);
+	for (; ins < end; ++ins, ++run)
+	{
+		k = program->constant + ins->constant;
+		switch (ins->op)
+		{
+		case a3sdf_opAffine:
+			px[ins->dst] = _mm_mul_ps(_mm_sub_ps(px[ins->a], _mm_set1_ps(k[0])), _mm_set1_ps(k[3]));
+			py[ins->dst] = _mm_mul_ps(_mm_sub_ps(py[ins->a], _mm_set1_ps(k[1])), _mm_set1_ps(k[3]));
+			pz[ins->dst] = _mm_mul_ps(_mm_sub_ps(pz[ins->a], _mm_set1_ps(k[2])), _mm_set1_ps(k[3]));
+			break;
+		case a3sdf_opRepeat:
+			// SSE2 has no floor, so truncate and correct the negatives,
+			//	exact while |p / period| < 2^31
+#define a3sdf_repeat_sse2(v)	\
+			d = _mm_mul_ps(v, _mm_set1_ps(k[1]));	\
+			t = _mm_cvtepi32_ps(_mm_cvttps_epi32(d));	\
+			t = _mm_sub_ps(t, _mm_and_ps(_mm_cmpgt_ps(t, d), one));	\
+			v = _mm_sub_ps(_mm_sub_ps(v, _mm_mul_ps(_mm_set1_ps(k[0]), t)), _mm_set1_ps(k[2]))
+			px[ins->dst] = px[ins->a];
+			py[ins->dst] = py[ins->a];
+			pz[ins->dst] = pz[ins->a];
+			a3sdf_repeat_sse2(px[ins->dst]);
+			a3sdf_repeat_sse2(py[ins->dst]);
+			a3sdf_repeat_sse2(pz[ins->dst]);
+#undef a3sdf_repeat_sse2
+			break;
+		case a3sdf_opMirror:
+			px[ins->dst] = _mm_andnot_ps(sign, px[ins->a]);
+			py[ins->dst] = _mm_andnot_ps(sign, py[ins->a]);
+			pz[ins->dst] = _mm_andnot_ps(sign, pz[ins->a]);
+			break;
+		case a3sdf_opWarp:
+			px[ins->dst] = _mm_add_ps(_mm_mul_ps(px[ins->a], _mm_set1_ps(k[0])), _mm_set1_ps(k[1]));
+			py[ins->dst] = _mm_add_ps(_mm_mul_ps(py[ins->a], _mm_set1_ps(k[0])), _mm_set1_ps(k[2]));
+			pz[ins->dst] = _mm_add_ps(_mm_mul_ps(pz[ins->a], _mm_set1_ps(k[0])), _mm_set1_ps(k[3]));
+			break;
+		case a3sdf_opBox:
+			dx = _mm_sub_ps(_mm_andnot_ps(sign, _mm_sub_ps(px[ins->a], _mm_set1_ps(k[0]))), _mm_set1_ps(k[3]));
+			dy = _mm_sub_ps(_mm_andnot_ps(sign, _mm_sub_ps(py[ins->a], _mm_set1_ps(k[1]))), _mm_set1_ps(k[4]));
+			dz = _mm_sub_ps(_mm_andnot_ps(sign, _mm_sub_ps(pz[ins->a], _mm_set1_ps(k[2]))), _mm_set1_ps(k[5]));
+			ex = _mm_max_ps(dx, zero);
+			ey = _mm_max_ps(dy, zero);
+			ez = _mm_max_ps(dz, zero);
+			d = _mm_sqrt_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(ex, ex), _mm_mul_ps(ey, ey)), _mm_mul_ps(ez, ez)));
+			vd[ins->dst] = _mm_min_ps(_mm_max_ps(_mm_max_ps(dx, dy), dz), d);
+			vi[ins->dst] = _mm_set1_ps(k[6]);
+			break;
+		case a3sdf_opSphere:
+			dx = _mm_sub_ps(px[ins->a], _mm_set1_ps(k[0]));
+			dy = _mm_sub_ps(py[ins->a], _mm_set1_ps(k[1]));
+			dz = _mm_sub_ps(pz[ins->a], _mm_set1_ps(k[2]));
+			d = _mm_sqrt_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(dx, dx), _mm_mul_ps(dy, dy)), _mm_mul_ps(dz, dz)));
+			vd[ins->dst] = _mm_sub_ps(d, _mm_set1_ps(k[3]));
+			vi[ins->dst] = _mm_set1_ps(k[4]);
+			break;
+		case a3sdf_opPlane:
+			d = _mm_add_ps(_mm_add_ps(_mm_mul_ps(_mm_set1_ps(k[0]), px[ins->a]), _mm_mul_ps(_mm_set1_ps(k[1]), py[ins->a])), _mm_mul_ps(_mm_set1_ps(k[2]), pz[ins->a]));
+			vd[ins->dst] = _mm_sub_ps(d, _mm_set1_ps(k[3]));
+			vi[ins->dst] = _mm_set1_ps(k[4]);
+			break;
+		case a3sdf_opUnion:
+			m = _mm_cmplt_ps(vd[ins->a], vd[ins->b]);
+			t = _mm_or_ps(_mm_and_ps(m, vi[ins->a]), _mm_andnot_ps(m, vi[ins->b]));
+			vd[ins->dst] = _mm_min_ps(vd[ins->a], vd[ins->b]);
+			vi[ins->dst] = t;
+			break;
+		case a3sdf_opIntersect:
+			m = _mm_cmpgt_ps(vd[ins->a], vd[ins->b]);
+			t = _mm_or_ps(_mm_and_ps(m, vi[ins->a]), _mm_andnot_ps(m, vi[ins->b]));
+			vd[ins->dst] = _mm_max_ps(vd[ins->a], vd[ins->b]);
+			vi[ins->dst] = t;
+			break;
+		case a3sdf_opSubtract:
+			d = _mm_xor_ps(vd[ins->b], sign);
+			m = _mm_cmpgt_ps(vd[ins->a], d);
+			t = _mm_or_ps(_mm_and_ps(m, vi[ins->a]), _mm_andnot_ps(m, vi[ins->b]));
+			vd[ins->dst] = _mm_max_ps(vd[ins->a], d);
+			vi[ins->dst] = t;
+			break;
+		case a3sdf_opScale:
+			vd[ins->dst] = _mm_mul_ps(vd[ins->a], _mm_set1_ps(k[0]));
+			break;
+		case a3sdf_opAdd:
+			vd[ins->dst] = _mm_add_ps(vd[ins->a], _mm_set1_ps(k[0]));
+			break;
+		case a3sdf_opBound:
+			dx = _mm_sub_ps(_mm_andnot_ps(sign, _mm_sub_ps(px[ins->a], _mm_set1_ps(k[0]))), _mm_set1_ps(k[3]));
+			dy = _mm_sub_ps(_mm_andnot_ps(sign, _mm_sub_ps(py[ins->a], _mm_set1_ps(k[1]))), _mm_set1_ps(k[4]));
+			dz = _mm_sub_ps(_mm_andnot_ps(sign, _mm_sub_ps(pz[ins->a], _mm_set1_ps(k[2]))), _mm_set1_ps(k[5]));
+			d = _mm_max_ps(_mm_max_ps(_mm_max_ps(dx, dy), dz), zero);
+			vi[ins->dst] = vi[ins->b];
+			vd[ins->dst] = d;
+			if (_mm_movemask_ps(_mm_cmpgt_ps(d, _mm_max_ps(vd[ins->b], zero))) == 0xf)
+			{
+				ins = program->code + ins->jump - 1;
+				++*pruned;
+			}
+			break;
+		}
+	}
+	_mm_storeu_ps(dist_out, vd[0]);
+	_mm_storeu_ps(id_out, vi[0]);
+	return run;
+}
+
+
+// AVX2: 8 points per instruction
+
+A3_FRACTAL_TARGET("avx2")
+static unsigned int a3fractalSDFRun_avx2(const a3_FractalSDFProgram *program, const float *x, const float *y, const float *z, float *dist_out, float *id_out, unsigned int *pruned)
+{
+	__m256 px[a3fractal_sdfRegisters], py[a3fractal_sdfRegisters], pz[a3fractal_sdfRegisters];
+	__m256 vd[a3fractal_sdfRegisters], vi[a3fractal_sdfRegisters];
+	const __m256 sign = _mm256_set1_ps(-0.0f), zero = _mm256_setzero_ps();
+	const a3_SDFInstruction *ins = program->code, *end = ins + program->count;
+	const float *k;
+	__m256 dx, dy, dz, ex, ey, ez, d, m, t;
+	unsigned int run = 0;
+	px[0] = _mm256_loadu_ps(x);
+	py[0] = _mm256_loadu_ps(y);
+	pz[0] = _mm256_loadu_ps(z);
+	for (; ins < end; ++ins, ++run)
+	{
+		k = program->constant + ins->constant;
+		switch (ins->op)
+		{
+		case a3sdf_opAffine:
+			px[ins->dst] = _mm256_mul_ps(_mm256_sub_ps(px[ins->a], _mm256_set1_ps(k[0])), _mm256_set1_ps(k[3]));
+			py[ins->dst] = _mm256_mul_ps(_mm256_sub_ps(py[ins->a], _mm256_set1_ps(k[1])), _mm256_set1_ps(k[3]));
+			pz[ins->dst] = _mm256_mul_ps(_mm256_sub_ps(pz[ins->a], _mm256_set1_ps(k[2])), _mm256_set1_ps(k[3]));
+			break;
+		case a3sdf_opRepeat:
+#define a3sdf_repeat_avx2(v)	\
+			t = _mm256_floor_ps(_mm256_mul_ps(v, _mm256_set1_ps(k[1])));	\
+			v = _mm256_sub_ps(_mm256_sub_ps(v, _mm256_mul_ps(_mm256_set1_ps(k[0]), t)), _mm256_set1_ps(k[2]))
+			px[ins->dst] = px[ins->a];
+			py[ins->dst] = py[ins->a];
+			pz[ins->dst] = pz[ins->a];
+			a3sdf_repeat_avx2(px[ins->dst]);
+			a3sdf_repeat_avx2(py[ins->dst]);
+			a3sdf_repeat_avx2(pz[ins->dst]);
+#undef a3sdf_repeat_avx2
+			break;
+		case a3sdf_opMirror:
+			px[ins->dst] = _mm256_andnot_ps(sign, px[ins->a]);
+			py[ins->dst] = _mm256_andnot_ps(sign, py[ins->a]);
+			pz[ins->dst] = _mm256_andnot_ps(sign, pz[ins->a]);
+			break;
+		case a3sdf_opWarp:
+			px[ins->dst] = _mm256_add_ps(_mm256_mul_ps(px[ins->a], _mm256_set1_ps(k[0])), _mm256_set1_ps(k[1]));
+			py[ins->dst] = _mm256_add_ps(_mm256_mul_ps(py[ins->a], _mm256_set1_ps(k[0])), _mm256_set1_ps(k[2]));
+			pz[ins->dst] = _mm256_add_ps(_mm256_mul_ps(pz[ins->a], _mm256_set1_ps(k[0])), _mm256_set1_ps(k[3]));
+			break;
+		case a3sdf_opBox:
+			dx = _mm256_sub_ps(_mm256_andnot_ps(sign, _mm256_sub_ps(px[ins->a], _mm256_set1_ps(k[0]))), _mm256_set1_ps(k[3]));
+			dy = _mm256_sub_ps(_mm256_andnot_ps(sign, _mm256_sub_ps(py[ins->a], _mm256_set1_ps(k[1]))), _mm256_set1_ps(k[4]));
+			dz = _mm256_sub_ps(_mm256_andnot_ps(sign, _mm256_sub_ps(pz[ins->a], _mm256_set1_ps(k[2]))), _mm256_set1_ps(k[5]));
+			ex = _mm256_max_ps(dx, zero);
+			ey = _mm256_max_ps(dy, zero);
+			ez = _mm256_max_ps(dz, zero);
+			d = _mm256_sqrt_ps(_mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(ex, ex), _mm256_mul_ps(ey, ey)), _mm256_mul_ps(ez, ez)));
+			vd[ins->dst] = _mm256_min_ps(_mm256_max_ps(_mm256_max_ps(dx, dy), dz), d);
+			vi[ins->dst] = _mm256_set1_ps(k[6]);
+			break;
+		case a3sdf_opSphere:
+			dx = _mm256_sub_ps(px[ins->a], _mm256_set1_ps(k[0]));
+			dy = _mm256_sub_ps(py[ins->a], _mm256_set1_ps(k[1]));
+			dz = _mm256_sub_ps(pz[ins->a], _mm256_set1_ps(k[2]));
+			d = _mm256_sqrt_ps(_mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(dx, dx), _mm256_mul_ps(dy, dy)), _mm256_mul_ps(dz, dz)));
+			vd[ins->dst] = _mm256_sub_ps(d, _mm256_set1_ps(k[3]));
+			vi[ins->dst] = _mm256_set1_ps(k[4]);
+			break;
+		case a3sdf_opPlane:
+			d = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(_mm256_set1_ps(k[0]), px[ins->a]), _mm256_mul_ps(_mm256_set1_ps(k[1]), py[ins->a])), _mm256_mul_ps(_mm256_set1_ps(k[2]), pz[ins->a]));
+			vd[ins->dst] = _mm256_sub_ps(d, _mm256_set1_ps(k[3]));
+			vi[ins->dst] = _mm256_set1_ps(k[4]);
+			break;
+		case a3sdf_opUnion:
+			m = _mm256_cmp_ps(vd[ins->a], vd[ins->b], _CMP_LT_OQ);
+			t = _mm256_blendv_ps(vi[ins->b], vi[ins->a], m);
+			vd[ins->dst] = _mm256_min_ps(vd[ins->a], vd[ins->b]);
+			vi[ins->dst] = t;
+			break;
+		case a3sdf_opIntersect:
+			m = _mm256_cmp_ps(vd[ins->a], vd[ins->b], _CMP_GT_OQ);
+			t = _mm256_blendv_ps(vi[ins->b], vi[ins->a], m);
+			vd[ins->dst] = _mm256_max_ps(vd[ins->a], vd[ins->b]);
+			vi[ins->dst] = t;
+			break;
+		case a3sdf_opSubtract:
+			d = _mm256_xor_ps(vd[ins->b], sign);
+			m = _mm256_cmp_ps(vd[ins->a], d, _CMP_GT_OQ);
+			t = _mm256_blendv_ps(vi[ins->b], vi[ins->a], m);
+			vd[ins->dst] = _mm256_max_ps(vd[ins->a], d);
+			vi[ins->dst] = t;
+			break;
+		case a3sdf_opScale:
+			vd[ins->dst] = _mm256_mul_ps(vd[ins->a], _mm256_set1_ps(k[0]));
+			break;
+		case a3sdf_opAdd:
+			vd[ins->dst] = _mm256_add_ps(vd[ins->a], _mm256_set1_ps(k[0]));
+			break;
+		case a3sdf_opBound:
+			dx = _mm256_sub_ps(_mm256_andnot_ps(sign, _mm256_sub_ps(px[ins->a], _mm256_set1_ps(k[0]))), _mm256_set1_ps(k[3]));
+			dy = _mm256_sub_ps(_mm256_andnot_ps(sign, _mm256_sub_ps(py[ins->a], _mm256_set1_ps(k[1]))), _mm256_set1_ps(k[4]));
+			dz = _mm256_sub_ps(_mm256_andnot_ps(sign, _mm256_sub_ps(pz[ins->a], _mm256_set1_ps(k[2]))), _mm256_set1_ps(k[5]));
+			d = _mm256_max_ps(_mm256_max_ps(_mm256_max_ps(dx, dy), dz), zero);
+			vi[ins->dst] = vi[ins->b];
+			vd[ins->dst] = d;
+			if (_mm256_movemask_ps(_mm256_cmp_ps(d, _mm256_max_ps(vd[ins->b], zero), _CMP_GT_OQ)) == 0xff)
+			{
+				ins = program->code + ins->jump - 1;
+				++*pruned;
+			}
+			break;
+		}
+	}
+	_mm256_storeu_ps(dist_out, vd[0]);
+	_mm256_storeu_ps(id_out, vi[0]);
+	return run;
+}
+
+
+#if A3_FRACTAL_AVX512
+
+// AVX-512: 16 points per instruction
+
+A3_FRACTAL_TARGET("avx512f")
+static unsigned int a3fractalSDFRun_avx512(const a3_FractalSDFProgram *program, const float *x, const float *y, const float *z, float *dist_out, float *id_out, unsigned int *pruned)
+{
+	__m512 px[a3fractal_sdfRegisters], py[a3fractal_sdfRegisters], pz[a3fractal_sdfRegisters];
+	__m512 vd[a3fractal_sdfRegisters], vi[a3fractal_sdfRegisters];
+	const __m512 zero = _mm512_setzero_ps();
+	const a3_SDFInstruction *ins = program->code, *end = ins + program->count;
+	const float *k;
+	__m512 dx, dy, dz, ex, ey, ez, d, t;
+	__mmask16 m;
+	unsigned int run = 0;
+	px[0] = _mm512_loadu_ps(x);
+	py[0] = _mm512_loadu_ps(y);
+	pz[0] = _mm512_loadu_ps(z);
+	for (; ins < end; ++ins, ++run)
+	{
+		k = program->constant + ins->constant;
+		switch (ins->op)
+		{
+		case a3sdf_opAffine:
+			px[ins->dst] = _mm512_mul_ps(_mm512_sub_ps(px[ins->a], _mm512_set1_ps(k[0])), _mm512_set1_ps(k[3]));
+			py[ins->dst] = _mm512_mul_ps(_mm512_sub_ps(py[ins->a], _mm512_set1_ps(k[1])), _mm512_set1_ps(k[3]));
+			pz[ins->dst] = _mm512_mul_ps(_mm512_sub_ps(pz[ins->a], _mm512_set1_ps(k[2])), _mm512_set1_ps(k[3]));
+			break;
+		case a3sdf_opRepeat:
+#define a3sdf_repeat_avx512(v)	\
+			t = _mm512_roundscale_ps(_mm512_mul_ps(v, _mm512_set1_ps(k[1])), _MM_FROUND_TO_NEG_INF | _MM_FROUND_NO_EXC);	\
+			v = _mm512_sub_ps(_mm512_sub_ps(v, _mm512_mul_ps(_mm512_set1_ps(k[0]), t)), _mm512_set1_ps(k[2]))
+			px[ins->dst] = px[ins->a];
+			py[ins->dst] = py[ins->a];
+			pz[ins->dst] = pz[ins->a];
+			a3sdf_repeat_avx512(px[ins->dst]);
+			a3sdf_repeat_avx512(py[ins->dst]);
+			a3sdf_repeat_avx512(pz[ins->dst]);
+#undef a3sdf_repeat_avx512
+			break;
+		case a3sdf_opMirror:
+			px[ins->dst] = _mm512_abs_ps(px[ins->a]);
+			py[ins->dst] = _mm512_abs_ps(py[ins->a]);
+			pz[ins->dst] = _mm512_abs_ps(pz[ins->a]);
+			break;
+		case a3sdf_opWarp:
+			px[ins->dst] = _mm512_add_ps(_mm512_mul_ps(px[ins->a], _mm512_set1_ps(k[0])), _mm512_set1_ps(k[1]));
+			py[ins->dst] = _mm512_add_ps(_mm512_mul_ps(py[ins->a], _mm512_set1_ps(k[0])), _mm512_set1_ps(k[2]));
+			pz[ins->dst] = _mm512_add_ps(_mm512_mul_ps(pz[ins->a], _mm512_set1_ps(k[0])), _mm512_set1_ps(k[3]));
+			break;
+		case a3sdf_opBox:
+			dx = _mm512_sub_ps(_mm512_abs_ps(_mm512_sub_ps(px[ins->a], _mm512_set1_ps(k[0]))), _mm512_set1_ps(k[3]));
+			dy = _mm512_sub_ps(_mm512_abs_ps(_mm512_sub_ps(py[ins->a], _mm512_set1_ps(k[1]))), _mm512_set1_ps(k[4]));
+			dz = _mm512_sub_ps(_mm512_abs_ps(_mm512_sub_ps(pz[ins->a], _mm512_set1_ps(k[2]))), _mm512_set1_ps(k[5]));
+			ex = _mm512_max_ps(dx, zero);
+			ey = _mm512_max_ps(dy, zero);
+			ez = _mm512_max_ps(dz, zero);
+			d = _mm512_sqrt_ps(_mm512_add_ps(_mm512_add_ps(_mm512_mul_ps(ex, ex), _mm512_mul_ps(ey, ey)), _mm512_mul_ps(ez, ez)));
+			vd[ins->dst] = _mm512_min_ps(_mm512_max_ps(_mm512_max_ps(dx, dy), dz), d);
+			vi[ins->dst] = _mm512_set1_ps(k[6]);
+			break;
+		case a3sdf_opSphere:
+			dx = _mm512_sub_ps(px[ins->a], _mm512_set1_ps(k[0]));
+			dy = _mm512_sub_ps(py[ins->a], _mm512_set1_ps(k[1]));
+			dz = _mm512_sub_ps(pz[ins->a], _mm512_set1_ps(k[2]));
+			d = _mm512_sqrt_ps(_mm512_add_ps(_mm512_add_ps(_mm512_mul_ps(dx, dx), _mm512_mul_ps(dy, dy)), _mm512_mul_ps(dz, dz)));
+			vd[ins->dst] = _mm512_sub_ps(d, _mm512_set1_ps(k[3]));
+			vi[ins->dst] = _mm512_set1_ps(k[4]);
+			break;
+		case a3sdf_opPlane:
+			d = _mm512_add_ps(_mm512_add_ps(_mm512_mul_ps(_mm512_set1_ps(k[0]), px[ins->a]), _mm512_mul_ps(_mm512_set1_ps(k[1]), py[ins->a])), _mm512_mul_ps(_mm512_set1_ps(k[2]), pz[ins->a]));
+			vd[ins->dst] = _mm512_sub_ps(d, _mm512_set1_ps(k[3]));
+			vi[ins->dst] = _mm512_set1_ps(k[4]);
+			break;
+		case a3sdf_opUnion:
+			m = _mm512_cmp_ps_mask(vd[ins->a], vd[ins->b], _CMP_LT_OQ);
+			t = _mm512_mask_blend_ps(m, vi[ins->b], vi[ins->a]);
+			vd[ins->dst] = _mm512_min_ps(vd[ins->a], vd[ins->b]);
+			vi[ins->dst] = t;
+			break;
+		case a3sdf_opIntersect:
+			m = _mm512_cmp_ps_mask(vd[ins->a], vd[ins->b], _CMP_GT_OQ);
+			t = _mm512_mask_blend_ps(m, vi[ins->b], vi[ins->a]);
+			vd[ins->dst] = _mm512_max_ps(vd[ins->a], vd[ins->b]);
+			vi[ins->dst] = t;
+			break;
+		case a3sdf_opSubtract:
+			d = _mm512_sub_ps(zero, vd[ins->b]);
+			m = _mm512_cmp_ps_mask(vd[ins->a], d, _CMP_GT_OQ);
+			t = _mm512_mask_blend_ps(m, vi[ins->b], vi[ins->a]);
+			vd[ins->dst] = _mm512_max_ps(vd[ins->a], d);
+			vi[ins->dst] = t;
+			break;
+		case a3sdf_opScale:
+			vd[ins->dst] = _mm512_mul_ps(vd[ins->a], _mm512_set1_ps(k[0]));
+			break;
+		case a3sdf_opAdd:
+			vd[ins->dst] = _mm512_add_ps(vd[ins->a], _mm512_set1_ps(k[0]));
+			break;
+		case a3sdf_opBound:
+			dx = _mm512_sub_ps(_mm512_abs_ps(_mm512_sub_ps(px[ins->a], _mm512_set1_ps(k[0]))), _mm512_set1_ps(k[3]));
+			dy = _mm512_sub_ps(_mm512_abs_ps(_mm512_sub_ps(py[ins->a], _mm512_set1_ps(k[1]))), _mm512_set1_ps(k[4]));
+			dz = _mm512_sub_ps(_mm512_abs_ps(_mm512_sub_ps(pz[ins->a], _mm512_set1_ps(k[2]))), _mm512_set1_ps(k[5]));
+			d = _mm512_max_ps(_mm512_max_ps(_mm512_max_ps(dx, dy), dz), zero);
+			vi[ins->dst] = vi[ins->b];
+			vd[ins->dst] = d;
+			if (_mm512_cmp_ps_mask(d, _mm512_max_ps(vd[ins->b], zero), _CMP_GT_OQ) == 0xffff)
+			{
+				ins = program->code + ins->jump - 1;
+				++*pruned;
+			}
+			break;
+		}
+	}
+	_mm512_storeu_ps(dist_out, vd[0]);
+	_mm512_storeu_ps(id_out, vi[0]);
+	return run;
+}
+
+#endif	// A3_FRACTAL_AVX512
+
+#endif	// A3_FRACTAL_X86
+
+
+// kernel table and lanes per group, indexed by instruction set
+static const a3_FractalSDFRunFunc a3fractalSDFRuns[a3fractal_isaCount] = {
+	a3fractalSDFRun_scalar,
+#if A3_FRACTAL_X86
+	a3fractalSDFRun_sse2,
+	a3fractalSDFRun_avx2,
+#if A3_FRACTAL_AVX512
+	a3fractalSDFRun_avx512,
+#else	// !A3_FRACTAL_AVX512
+	a3fractalSDFRun_avx2,
+#endif	// A3_FRACTAL_AVX512
+#else	// !A3_FRACTAL_X86
+	a3fractalSDFRun_scalar,
+	a3fractalSDFRun_scalar,
+	a3fractalSDFRun_scalar,
+#endif	// A3_FRACTAL_X86
+};
+static const unsigned int a3sdfLanes[a3fractal_isaCount] = {
+#if A3_FRACTAL_X86
+	1, 4, 8, A3_FRACTAL_AVX512 ? 16 : 8,
+#else	// !A3_FRACTAL_X86
+	1, 1, 1, 1,
+#endif	// A3_FRACTAL_X86
+};
+
+
+//-----------------------------------------------------------------------------
+// evaluation
+
+int a3fractalSDFEvaluate(const a3_FractalSDFProgram *program, const float *x, const float *y, const float *z, unsigned int count, float *dist_out, unsigned int *id_out_opt, a3_FractalISA isa, a3_FractalSDFStats *stats_opt)
+{
+	float gx[a3sdf_lanes], gy[a3sdf_lanes], gz[a3sdf_lanes], gd[a3sdf_lanes], gi[a3sdf_lanes];
+	unsigned long long run = 0, groups = 0;
+	unsigned int lanes, i, j, n, pruned = 0;
+	a3_FractalSDFRunFunc kernel;
+	a3_FractalISA best;
+
+	if (program && x && y && z && dist_out)
+	{
+		best = a3fractalDetectISA();
+		if (isa == a3fractal_isaAuto || isa > best)
+			isa = best;
+		kernel = a3fractalSDFRuns[isa];
+		lanes = a3sdfLanes[isa];
+
+		for (i = 0; i < count; i += lanes, ++groups)
+		{
+			// the last group repeats its last point in the lanes past the end
+			n = a3minimum(lanes, count - i);
+			if (n == lanes)
+				run += kernel(program, x + i, y + i, z + i, gd, gi, &pruned);
+			else
+			{
+				for (j = 0; j < lanes; ++j)
+				{
+					gx[j] = x[i + a3minimum(j, n - 1)];
+					gy[j] = y[i + a3minimum(j, n - 1)];
+					gz[j] = z[i + a3minimum(j, n - 1)];
+				}
+				run += kernel(program, gx, gy, gz, gd, gi, &pruned);
+			}
+			for (j = 0; j < n; ++j)
+				dist_out[i + j] = gd[j];
+			if (id_out_opt)
+				for (j = 0; j < n; ++j)
+					id_out_opt[i + j] = (unsigned int)gi[j];
+		}
+
+		if (stats_opt)
+		{
+			stats_opt->groups += groups;
+			stats_opt->instructions += run;
+			stats_opt->pruned += pruned;
+		}
+		return (int)count;
+	}
+	return -1;
+}
+
+
+//-----------------------------------------------------------------------------
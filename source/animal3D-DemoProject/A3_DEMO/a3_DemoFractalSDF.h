@@ -0,0 +1,257 @@
+/*
+	animal3D SDK: Minimal 3D Animation Framework
+	Fractals Midterm: CPU fractal engines
+
+	a3_DemoFractalSDF.h
+	Distance field scenes compiled to register bytecode.
+
+	The Menger shader writes its scene as nested calls: boxes and a cross,
+	unions and intersections, each level folding space into cells. Here a
+	scene is written as a graph of the same pieces instead: primitives
+	(box, sphere, plane), combinations (union, intersection, difference,
+	offset) and changes of space (translate, scale, repeat, mirror, warp),
+	each node naming the nodes below it. A new scene is a few calls that
+	build nodes, not a new kernel.
+
+	Compiling walks the graph from its root once and writes a flat program
+	for a small register machine: point registers hold positions, value
+	registers hold a distance and the id of the surface it is to. The walk
+	carries translations and scales down to the nodes below instead of
+	emitting them, so chains of them fold into one, and into primitives
+	they fold into the primitive's own center and size, costing nothing.
+	Registers are allocated as a stack, the branch needing more going
+	first, so intersections and differences need value registers only
+	for the depth of a balanced tree of them, two for a chain of any
+	length. Unions trade registers for pruning, below: each one puts its
+	smaller branch first while the registers left allow it, which costs
+	one more register per link of a union chain, so a long chain of
+	unions fills all 'a3fractal_sdfRegisters' before the rest of it
+	falls back to two. Point registers grow with how deeply changes of
+	space nest.
+
+	Every node also gets a bounding box when it is built. A union branch
+	that is big enough to be worth it is guarded by a test of the largest
+	axis distance to its box: when that is more than what the other
+	branch already found, in every lane, the program jumps over the
+	branch and the union keeps the other's result. A ray far from a part
+	of the scene skips its whole subtree. Primitives, their unions and
+	anything intersected with one are never nearer than that distance, so
+	for them the result is the same as evaluating the branch; for any
+	field it is still no more than the distance to the branch's surface.
+	Only the larger branch of a union is guarded, against the smaller
+	one's result; in a chain of unions, left- or right-deep, that is the
+	rest of the chain, whose box spans nearly all of it, so chains prune
+	little. A balanced tree of unions puts small boxes under each guard.
+
+	A program is run over arrays of points, 1, 4, 8 or 16 at a time with
+	scalar code, SSE2, AVX2 or AVX-512; every instruction is decoded once
+	per group of lanes, so the decoding costs a sixteenth per point on
+	AVX-512. No instruction set uses fused multiply-add, so all of them
+	give the same distances.
+*/
+
+#ifndef __ANIMAL3D_DEMOFRACTALSDF_H
+#define __ANIMAL3D_DEMOFRACTALSDF_H
+
+
+#include "a3_DemoFractalEscape.h"
+
+
+//-----------------------------------------------------------------------------
+
+#ifdef __cplusplus
+extern "C"
+{
+#else	// !__cplusplus
+	typedef struct a3_FractalSDFScene			a3_FractalSDFScene;
+	typedef struct a3_FractalSDFProgram			a3_FractalSDFProgram;
+	typedef struct a3_FractalSDFProgramInfo		a3_FractalSDFProgramInfo;
+	typedef struct a3_FractalSDFStats			a3_FractalSDFStats;
+#endif	// __cplusplus
+
+
+//-----------------------------------------------------------------------------
+
+	// registers of each kind a program may use; a scene whose changes of
+	//	space nest deeper than this, or whose combinations would hold more
+	//	values at once, does not compile; chains of intersections and
+	//	differences hold two, chains of unions up to all of them
+#define a3fractal_sdfRegisters			32
+
+	// nodes a union branch needs for its bounding box to be tested
+#define a3fractal_sdfPruneNodes			4
+
+
+	// compiled program description
+	//	member nodes: nodes compiled, counting a node once per use
+	//	member instructions: program length
+	//	member folded: translations and scales folded into other nodes
+	//	member bounds: bounding box tests
+	//	members pointRegisters, valueRegisters: registers used
+	struct a3_FractalSDFProgramInfo
+	{
+		unsigned int nodes;
+		unsigned int instructions;
+		unsigned int folded;
+		unsigned int bounds;
+		unsigned int pointRegisters, valueRegisters;
+	};
+
+
+	// evaluation counters, kept by the caller, added to
+	//	member groups: groups of lanes run
+	//	member instructions: instructions run, once per group
+	//	member pruned: subtrees skipped, once per group
+	struct a3_FractalSDFStats
+	{
+		unsigned long long groups;
+		unsigned long long instructions;
+		unsigned long long pruned;
+	};
+
+
+//-----------------------------------------------------------------------------
+
+	// Create an empty scene.
+	//	param scene_out: non-null pointer to scene pointer; must be null
+	//	param capacity: most nodes the scene will hold
+	//	return: capacity if success
+	//	return: 0 if fail (already created or out of memory)
+	//	return: -1 if invalid params
+	int a3fractalSDFSceneCreate(a3_FractalSDFScene **scene_out, unsigned int capacity);
+
+	// Release a scene; programs compiled from it stay valid.
+	//	param scene: non-null pointer to scene pointer; reset to null
+	//	return: 1 if success
+	//	return: -1 if invalid params
+	int a3fractalSDFSceneRelease(a3_FractalSDFScene **scene);
+
+	// Add a box centered at the origin, with 'objBoxS' distance.
+	//	param scene: non-null pointer to scene
+	//	params hx, hy, hz: positive half extents
+	//	param id: surface id reported for points nearest it
+	//	return: node index if success
+	//	return: -1 if invalid params or scene full
+	int a3fractalSDFBox(a3_FractalSDFScene *scene, float hx, float hy, float hz, unsigned int id);
+
+	// Add a sphere centered at the origin.
+	//	param scene: non-null pointer to scene
+	//	param radius: positive radius
+	//	param id: surface id
+	//	return: node index if success
+	//	return: -1 if invalid params or scene full
+	int a3fractalSDFSphere(a3_FractalSDFScene *scene, float radius, unsigned int id);
+
+	// Add a plane, solid below: distance n.p - height.
+	//	param scene: non-null pointer to scene
+	//	params nx, ny, nz: unit normal
+	//	param height: distance of the plane from the origin along it
+	//	param id: surface id
+	//	return: node index if success
+	//	return: -1 if invalid params or scene full
+	int a3fractalSDFPlane(a3_FractalSDFScene *scene, float nx, float ny, float nz, float height, unsigned int id);
+
+	// Add a union, intersection or difference of two nodes: the least or
+	//	the greatest distance, or the first node with the second carved
+	//	out of it; the id is the one of the node whose distance is taken,
+	//	the second node's on ties.
+	//	param scene: non-null pointer to scene
+	//	params a, b: nodes
+	//	return: node index if success
+	//	return: -1 if invalid params or scene full
+	int a3fractalSDFUnion(a3_FractalSDFScene *scene, int a, int b);
+	int a3fractalSDFIntersect(a3_FractalSDFScene *scene, int a, int b);
+	int a3fractalSDFSubtract(a3_FractalSDFScene *scene, int a, int b);
+
+	// Add a node grown by a radius: its distance less the radius.
+	//	param scene: non-null pointer to scene
+	//	param child: node to grow
+	//	param radius: amount to grow by; negative shrinks
+	//	return: node index if success
+	//	return: -1 if invalid params or scene full
+	int a3fractalSDFOffset(a3_FractalSDFScene *scene, int child, float radius);
+
+	// Add a node moved by an offset.
+	//	param scene: non-null pointer to scene
+	//	param child: node to move
+	//	params tx, ty, tz: offset
+	//	return: node index if success
+	//	return: -1 if invalid params or scene full
+	int a3fractalSDFTranslate(a3_FractalSDFScene *scene, int child, float tx, float ty, float tz);
+
+	// Add a node scaled about the origin; distances scale with it.
+	//	param scene: non-null pointer to scene
+	//	param child: node to scale
+	//	param scale: positive scale
+	//	return: node index if success
+	//	return: -1 if invalid params or scene full
+	int a3fractalSDFScale(a3_FractalSDFScene *scene, int child, float scale);
+
+	// Add a node repeated on a lattice: space is folded into cells
+	//	'period' across, bounded by multiples of it, with the child's origin
+	//	at each cell's center, as the shader's 'mod(p, period) - period / 2'.
+	//	param scene: non-null pointer to scene
+	//	param child: node in one cell
+	//	param period: positive cell size
+	//	return: node index if success
+	//	return: -1 if invalid params or scene full
+	int a3fractalSDFRepeat(a3_FractalSDFScene *scene, int child, float period);
+
+	// Add a node mirrored into every octant: evaluated at |p|.
+	//	param scene: non-null pointer to scene
+	//	param child: node to mirror
+	//	return: node index if success
+	//	return: -1 if invalid params or scene full
+	int a3fractalSDFMirror(a3_FractalSDFScene *scene, int child);
+
+	// Add a node evaluated at p scale + offset, its distance not scaled
+	//	back; for fields written in stretched space, like the shader's
+	//	cross at 1 - 4|a|.
+	//	param scene: non-null pointer to scene
+	//	param child: node to warp
+	//	param scale: nonzero scale, may be negative
+	//	params ox, oy, oz: offset added after scaling
+	//	return: node index if success
+	//	return: -1 if invalid params or scene full
+	int a3fractalSDFWarp(a3_FractalSDFScene *scene, int child, float scale, float ox, float oy, float oz);
+
+	// Compile a scene from one of its nodes down.
+	//	param program_out: non-null pointer to program pointer; must be null
+	//	param scene: non-null pointer to scene
+	//	param root: node whose distance the program evaluates
+	//	param info_out_opt: optional pointer to program description
+	//	return: number of instructions if success
+	//	return: 0 if fail (already created, out of memory or the scene
+	//		nests too deep for the registers)
+	//	return: -1 if invalid params
+	int a3fractalSDFCompile(a3_FractalSDFProgram **program_out, const a3_FractalSDFScene *scene, int root, a3_FractalSDFProgramInfo *info_out_opt);
+
+	// Release a program.
+	//	param program: non-null pointer to program pointer; reset to null
+	//	return: 1 if success
+	//	return: -1 if invalid params
+	int a3fractalSDFProgramRelease(a3_FractalSDFProgram **program);
+
+	// Evaluate a program at many points; safe to call from several
+	//	threads on the same program.
+	//	param program: non-null pointer to program
+	//	params x, y, z: non-null pointers to 'count' coordinates each
+	//	param count: number of points
+	//	param dist_out: non-null pointer to 'count' distances
+	//	param id_out_opt: optional pointer to 'count' surface ids
+	//	param isa: instruction set to use; auto picks at runtime
+	//	param stats_opt: optional pointer to counters, added to
+	//	return: number of points evaluated if success
+	//	return: -1 if invalid params
+	int a3fractalSDFEvaluate(const a3_FractalSDFProgram *program, const float *x, const float *y, const float *z, unsigned int count, float *dist_out, unsigned int *id_out_opt, a3_FractalISA isa, a3_FractalSDFStats *stats_opt);
+
+
+//-----------------------------------------------------------------------------
+
+
+#ifdef __cplusplus
+}
+#endif	// __cplusplus
+
+
+#endif	// !__ANIMAL3D_DEMOFRACTALSDF_H
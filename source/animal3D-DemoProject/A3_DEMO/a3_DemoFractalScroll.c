@@ -0,0 +1,329 @@
+/*
+	animal3D SDK: Minimal 3D Animation Framework
+	Fractals Midterm: CPU fractal engines
+
+	a3_DemoFractalScroll.c
+	Pan-scroll pixel reuse implementation.
+
+	An image rectangle maps to at most four ring rectangles, one for each
+	side of the wrap on each axis. Within each one, ring cells and lattice
+	pixels differ by a constant, which is exactly the escape-time engine's
+	pixel offset, so the strips are rendered by the engine itself straight
+	into the ring; every pixel is evaluated at its lattice coordinate and
+	matches a full render of the same lattice.
+*/
+
+#include "a3_DemoFractalScroll.h"
+
+#include "animal3D/a3/a3macros.h"
+
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+
+//-----------------------------------------------------------------------------
+
+// a pan exposes at most two image rectangles, each wrapping into four
+#define a3scroll_pieceMax	8
+
+
+// one ring rectangle and the lattice offset it is rendered with
+typedef struct a3_ScrollPiece
+{
+	a3_FractalEscapeDesc desc;
+	unsigned int x, y, w, h;
+} a3_ScrollPiece;
+
+// one resolve
+typedef struct a3_ScrollResolve
+{
+	const a3_FractalScroll *scroll;
+	float *smooth_out_opt;
+	unsigned int *iter_out_opt;
+	unsigned char *rgba_out_opt;
+} a3_ScrollResolve;
+
+
+// wrap a lattice coordinate into the ring
+static unsigned int a3fractalScrollWrap(const int i, const unsigned int n)
+{
+	const int r = i % (int)n;
+	return (unsigned int)(r < 0 ? r + (int)n : r);
+}
+
+
+static void a3fractalScrollTask(void *args, unsigned int x0, unsigned int y0, unsigned int x1, unsigned int y1, unsigned int workerIndex)
+{
+	const a3_ScrollPiece *piece = (const a3_ScrollPiece *)args;
+	a3fractalEscapeRenderRect(&piece->desc, piece->x + x0, piece->y + y0, piece->x + x1, piece->y + y1);
+}
+
+// split an image rectangle into ring rectangles
+static unsigned int a3fractalScrollSplit(a3_ScrollPiece *piece, const a3_FractalScroll *scroll, unsigned int x0, unsigned int y0, unsigned int x1, unsigned int y1)
+{
+	const unsigned int w = scroll->lattice.width, h = scroll->lattice.height;
+	const int lx = scroll->panX + (int)x0, ly = scroll->panY + (int)y0;
+	unsigned int startX[2], startY[2], runX[2], runY[2], nx = 1, ny = 1, i, j, n = 0;
+	int offsetX[2], offsetY[2];
+
+	startX[0] = a3fractalScrollWrap(lx, w);
+	runX[0] = a3minimum(x1 - x0, w - startX[0]);
+	offsetX[0] = lx - (int)startX[0];
+	if (runX[0] < x1 - x0)
+	{
+		startX[1] = 0;
+		runX[1] = x1 - x0 - runX[0];
+		offsetX[1] = lx + (int)runX[0];
+		nx = 2;
+	}
+
+	startY[0] = a3fractalScrollWrap(ly, h);
+	runY[0] = a3minimum(y1 - y0, h - startY[0]);
+	offsetY[0] = ly - (int)startY[0];
+	if (runY[0] < y1 - y0)
+	{
+		startY[1] = 0;
+		runY[1] = y1 - y0 - runY[0];
+		offsetY[1] = ly + (int)runY[0];
+		ny = 2;
+	}
+
+	for (j = 0; j < ny; ++j)
+		for (i = 0; i < nx; ++i, ++n)
+		{
+			// the desc keeps the ring's size and outputs
+			piece[n].desc = scroll->lattice;
+			piece[n].desc.offsetX = offsetX[i];
+			piece[n].desc.offsetY = offsetY[j];
+			piece[n].x = startX[i];
+			piece[n].y = startY[j];
+			piece[n].w = runX[i];
+			piece[n].h = runY[j];
+		}
+	return n;
+}
+
+// render image rectangles into the ring, all at once; if any could not
+//	be queued the ring is left partly stale and the field is released
+static int a3fractalScrollCompute(a3_FractalScroll *scroll, const unsigned int *rect, const unsigned int rects, a3_ThreadPool *pool_opt)
+{
+	a3_ScrollPiece piece[a3scroll_pieceMax];
+	a3_ThreadPoolGroup group[1];
+	unsigned int pieces = 0, pixels = 0, i;
+	int queued = 1;
+
+	for (i = 0; i < rects; ++i, rect += 4)
+		if (rect[0] < rect[2] && rect[1] < rect[3])
+			pieces += a3fractalScrollSplit(piece + pieces, scroll, rect[0], rect[1], rect[2], rect[3]);
+
+	a3threadPoolGroupInit(group);
+	for (i = 0; i < pieces && queued; ++i)
+	{
+		queued = a3threadPoolParallelFor2D(pool_opt, group, a3fractalScrollTask, piece + i, piece[i].w, piece[i].h, 32, 32) >= 0;
+		pixels += piece[i].w * piece[i].h;
+	}
+	a3threadPoolWait(pool_opt, group);
+	if (!queued)
+	{
+		a3fractalScrollRelease(scroll);
+		return -1;
+	}
+	return (int)pixels;
+}
+
+
+static void a3fractalScrollResolveTask(void *args, unsigned int x0, unsigned int y0, unsigned int x1, unsigned int y1, unsigned int workerIndex)
+{
+	const a3_ScrollResolve *resolve = (const a3_ScrollResolve *)args;
+	const a3_FractalScroll *scroll = resolve->scroll;
+	const unsigned int w = scroll->lattice.width, h = scroll->lattice.height;
+	const unsigned int rx = a3fractalScrollWrap(scroll->panX, w);
+	unsigned int y, x, ry, index, cell;
+
+	for (y = y0; y < y1; ++y)
+	{
+		// the row is two runs: ring columns [rx, w), then [0, rx)
+		ry = a3fractalScrollWrap(scroll->panY + (int)y, h);
+		index = y * w;
+		cell = ry * w;
+		if (resolve->smooth_out_opt)
+		{
+			memcpy(resolve->smooth_out_opt + index, scroll->smooth + cell + rx, (w - rx) * sizeof(float));
+			memcpy(resolve->smooth_out_opt + index + w - rx, scroll->smooth + cell, rx * sizeof(float));
+		}
+		if (resolve->iter_out_opt)
+		{
+			memcpy(resolve->iter_out_opt + index, scroll->iter + cell + rx, (w - rx) * sizeof(unsigned int));
+			memcpy(resolve->iter_out_opt + index + w - rx, scroll->iter + cell, rx * sizeof(unsigned int));
+		}
+		if (resolve->rgba_out_opt)
+			for (x = 0; x < w; ++x)
+				a3fractalShade(scroll->smooth[cell + (rx + x) % w], resolve->rgba_out_opt + (index + x) * 4);
+	}
+}
+
+
+//-----------------------------------------------------------------------------
+
+int a3fractalScrollRender(a3_FractalScroll *scroll, const a3_FractalEscapeDesc *desc, a3_ThreadPool *pool_opt, a3_FractalScrollStats *stats_out_opt)
+{
+	a3_FractalScrollStats stats = { 0 };
+	const a3_FractalEscapeDesc *lattice;
+	unsigned int rect[4], pixels;
+	double shiftX, shiftY, panX = 0.0, panY = 0.0;
+	int pan = 0, computed;
+
+	if (scroll && desc && desc->width && desc->height)
+	{
+		pixels = desc->width * desc->height;
+		lattice = &scroll->lattice;
+
+		// how far the view moved from the anchor, in lattice pixels
+		if (scroll->smooth && lattice->width == desc->width && lattice->height == desc->height &&
+			lattice->iterations == desc->iterations && lattice->isa == desc->isa && lattice->precision == desc->precision &&
+			lattice->view.width == desc->view.width && lattice->view.height == desc->view.height)
+		{
+			shiftX = (desc->view.centerX - lattice->view.centerX) * (double)desc->width / desc->view.width;
+			shiftY = (desc->view.centerY - lattice->view.centerY) * (double)desc->height / desc->view.height;
+			panX = floor(shiftX + 0.5);
+			panY = floor(shiftY + 0.5);
+			pan = (fabs(shiftX - panX) <= a3fractal_scrollSnap && fabs(shiftY - panY) <= a3fractal_scrollSnap &&
+				fabs(panX) < 1.0e9 && fabs(panY) < 1.0e9);
+		}
+
+		if (pan)
+		{
+			// a failed pan releases the field
+			a3fractalScrollPan(scroll, (int)panX - scroll->panX, (int)panY - scroll->panY, pool_opt, &stats);
+			if (!scroll->smooth)
+				return 0;
+		}
+		else
+		{
+			// new lattice anchored at this view
+			if (!scroll->smooth || lattice->width * lattice->height != pixels)
+			{
+				a3fractalScrollRelease(scroll);
+				scroll->smooth = (float *)malloc(pixels * sizeof(float));
+				scroll->iter = (unsigned int *)malloc(pixels * sizeof(unsigned int));
+				if (!scroll->smooth || !scroll->iter)
+				{
+					a3fractalScrollRelease(scroll);
+					return 0;
+				}
+			}
+			scroll->lattice = *desc;
+			scroll->lattice.offsetX = scroll->lattice.offsetY = 0;
+			scroll->lattice.smooth_out_opt = scroll->smooth;
+			scroll->lattice.iter_out_opt = scroll->iter;
+			scroll->lattice.rgba_out_opt = 0;
+			scroll->panX = scroll->panY = 0;
+			rect[0] = rect[1] = 0;
+			rect[2] = desc->width;
+			rect[3] = desc->height;
+			computed = a3fractalScrollCompute(scroll, rect, 1, pool_opt);
+			if (computed < 0)
+				return 0;
+			stats.computed = (unsigned int)computed;
+			stats.reused = 0;
+		}
+		if (stats_out_opt)
+			*stats_out_opt = stats;
+
+		return a3fractalScrollResolve(scroll, desc->smooth_out_opt, desc->iter_out_opt, desc->rgba_out_opt, pool_opt);
+	}
+	return -1;
+}
+
+int a3fractalScrollPan(a3_FractalScroll *scroll, int dx, int dy, a3_ThreadPool *pool_opt, a3_FractalScrollStats *stats_out_opt)
+{
+	a3_FractalScrollStats stats = { 0 };
+	unsigned int rect[8], w, h, ax, ay;
+	int computed;
+
+	if (scroll && scroll->smooth)
+	{
+		w = scroll->lattice.width;
+		h = scroll->lattice.height;
+		ax = (unsigned int)(dx < 0 ? -dx : dx);
+		ay = (unsigned int)(dy < 0 ? -dy : dy);
+		scroll->panX += dx;
+		scroll->panY += dy;
+
+		if (ax >= w || ay >= h)
+		{
+			// nothing left on screen
+			rect[0] = rect[1] = 0;
+			rect[2] = w;
+			rect[3] = h;
+			computed = a3fractalScrollCompute(scroll, rect, 1, pool_opt);
+		}
+		else
+		{
+			// exposed rows across the whole image, then exposed columns
+			//	over the rows that are left
+			rect[0] = 0;
+			rect[2] = w;
+			rect[1] = dy > 0 ? h - ay : 0;
+			rect[3] = dy > 0 ? h : ay;
+			rect[4] = dx > 0 ? w - ax : 0;
+			rect[6] = dx > 0 ? w : ax;
+			rect[5] = dy > 0 ? 0 : ay;
+			rect[7] = dy > 0 ? h - ay : h;
+			computed = a3fractalScrollCompute(scroll, rect, 2, pool_opt);
+		}
+		if (computed < 0)
+			return 0;
+		stats.computed = (unsigned int)computed;
+		stats.reused = w * h - stats.computed;
+		if (stats_out_opt)
+			*stats_out_opt = stats;
+		return (int)stats.computed;
+	}
+	return -1;
+}
+
+int a3fractalScrollResolve(const a3_FractalScroll *scroll, float *smooth_out_opt, unsigned int *iter_out_opt, unsigned char *rgba_out_opt, a3_ThreadPool *pool_opt)
+{
+	a3_ScrollResolve resolve[1];
+	if (scroll && scroll->smooth)
+	{
+		resolve->scroll = scroll;
+		resolve->smooth_out_opt = smooth_out_opt;
+		resolve->iter_out_opt = iter_out_opt;
+		resolve->rgba_out_opt = rgba_out_opt;
+		if ((smooth_out_opt || iter_out_opt || rgba_out_opt) &&
+			a3threadPoolParallelFor2D(pool_opt, 0, a3fractalScrollResolveTask, resolve, 1, scroll->lattice.height, 0, 32) < 0)
+			return 0;
+		return (int)(scroll->lattice.width * scroll->lattice.height);
+	}
+	return -1;
+}
+
+int a3fractalScrollGetView(const a3_FractalScroll *scroll, a3_FractalView *view_out)
+{
+	if (scroll && scroll->smooth && view_out)
+	{
+		*view_out = scroll->lattice.view;
+		view_out->centerX += (double)scroll->panX * view_out->width / (double)scroll->lattice.width;
+		view_out->centerY += (double)scroll->panY * view_out->height / (double)scroll->lattice.height;
+		return 1;
+	}
+	return -1;
+}
+
+int a3fractalScrollRelease(a3_FractalScroll *scroll)
+{
+	if (scroll)
+	{
+		free(scroll->smooth);
+		free(scroll->iter);
+		memset(scroll, 0, sizeof(a3_FractalScroll));
+		return 1;
+	}
+	return -1;
+}
+
+
+//-----------------------------------------------------------------------------
@@ -0,0 +1,130 @@
+/*
+	animal3D SDK: Minimal 3D Animation Framework
+	Fractals Midterm: CPU fractal engines
+
+	a3_DemoFractalScroll.h
+	Pan-scroll pixel reuse for the escape-time engine.
+
+	Translating the view by a whole number of pixels leaves every pixel
+	that stays on screen with the same plane coordinate, so its iteration
+	result is still valid. The field is kept in a ring-addressed buffer
+	over a fixed pixel lattice: lattice pixel (i, j) lives at ring cell
+	(i mod width, j mod height), so a pan only moves the window and the
+	cells that scrolled off are overwritten by the newly exposed strips.
+	A pan costs the exposed strips, computed in parallel, not a frame.
+*/
+
+#ifndef __ANIMAL3D_DEMOFRACTALSCROLL_H
+#define __ANIMAL3D_DEMOFRACTALSCROLL_H
+
+
+#include "a3_DemoFractalEscape.h"
+
+
+//-----------------------------------------------------------------------------
+
+#ifdef __cplusplus
+extern "C"
+{
+#else	// !__cplusplus
+	typedef struct a3_FractalScroll				a3_FractalScroll;
+	typedef struct a3_FractalScrollStats		a3_FractalScrollStats;
+#endif	// __cplusplus
+
+
+//-----------------------------------------------------------------------------
+
+	// largest distance from a whole pixel, in pixels, at which a view
+	//	change still counts as a pan; the view is snapped to the lattice
+#define a3fractal_scrollSnap		1.0e-3
+
+
+	// scrolling field kept between frames, zero-initialize before first use
+	//	member lattice: description of the lattice and ring; its view is
+	//		the anchor the lattice was set up at, its size is the ring's,
+	//		its outputs point into the ring
+	//	members panX, panY: lattice pixel shown at image pixel (0, 0);
+	//		image pixel (x, y) is ring cell ((panX + x) mod width,
+	//		(panY + y) mod height)
+	//	member smooth: ring of smooth iteration values
+	//	member iter: ring of escape iterations
+	struct a3_FractalScroll
+	{
+		a3_FractalEscapeDesc lattice;
+		int panX, panY;
+		float *smooth;
+		unsigned int *iter;
+	};
+
+
+	// per-frame counters
+	//	member computed: pixels iterated this frame
+	//	member reused: pixels kept from earlier frames
+	struct a3_FractalScrollStats
+	{
+		unsigned int computed;
+		unsigned int reused;
+	};
+
+
+//-----------------------------------------------------------------------------
+
+	// Render an image, reusing the field if the view only moved by whole
+	//	pixels since the last frame.
+	//	param scroll: non-null pointer to field kept between frames
+	//	param desc: non-null pointer to render description; a change of
+	//		extent, size, cap, instruction set or precision, or a move that
+	//		is not a whole number of pixels, recomputes the whole field;
+	//		the offsets are not used
+	//	param pool_opt: optional pool; renders on this thread if null
+	//	param stats_out_opt: optional pointer to frame counters
+	//	return: number of pixels rendered if success
+	//	return: 0 if fail (out of memory)
+	//	return: -1 if invalid params
+	int a3fractalScrollRender(a3_FractalScroll *scroll, const a3_FractalEscapeDesc *desc, a3_ThreadPool *pool_opt, a3_FractalScrollStats *stats_out_opt);
+
+	// Move the view by whole pixels, computing only the exposed strips.
+	//	param scroll: non-null pointer to field set up by a render
+	//	params dx, dy: pixels to move the view by; positive moves right
+	//		and up, so the image content moves left and down
+	//	param pool_opt: optional pool; renders on this thread if null
+	//	param stats_out_opt: optional pointer to frame counters
+	//	return: number of pixels computed if success, 0 if no move
+	//	return: 0 if fail (out of memory); the field is released and the
+	//		next render recomputes it
+	//	return: -1 if invalid params
+	int a3fractalScrollPan(a3_FractalScroll *scroll, int dx, int dy, a3_ThreadPool *pool_opt, a3_FractalScrollStats *stats_out_opt);
+
+	// Copy the field out of the ring into row-major image buffers.
+	//	param scroll: non-null pointer to field set up by a render
+	//	params smooth_out_opt, iter_out_opt, rgba_out_opt: optional
+	//		outputs, same layout and meaning as the escape-time engine
+	//	param pool_opt: optional pool; copies on this thread if null
+	//	return: number of pixels copied if success
+	//	return: 0 if fail (out of memory)
+	//	return: -1 if invalid params
+	int a3fractalScrollResolve(const a3_FractalScroll *scroll, float *smooth_out_opt, unsigned int *iter_out_opt, unsigned char *rgba_out_opt, a3_ThreadPool *pool_opt);
+
+	// Get the view currently shown, snapped to the lattice.
+	//	param scroll: non-null pointer to field set up by a render
+	//	param view_out: non-null pointer to view
+	//	return: 1 if success
+	//	return: -1 if invalid params
+	int a3fractalScrollGetView(const a3_FractalScroll *scroll, a3_FractalView *view_out);
+
+	// Release ring buffers.
+	//	param scroll: non-null pointer to field
+	//	return: 1 if success
+	//	return: -1 if invalid params
+	int a3fractalScrollRelease(a3_FractalScroll *scroll);
+
+
+//-----------------------------------------------------------------------------
+
+
+#ifdef __cplusplus
+}
+#endif	// __cplusplus
+
+
+#endif	// !__ANIMAL3D_DEMOFRACTALSCROLL_H
@@ -0,0 +1,307 @@
+/*
+	animal3D SDK: Minimal 3D Animation Framework
+	Fractals Midterm: CPU fractal engines
+
+	a3_DemoFractalSubdiv.c
+	Mariani-Silver rectangle subdivision implementation.
+
+	Rectangles are inclusive of their border and neighbors share the line
+	between them, so every split computes only the two midlines. A pixel
+	is computed at most once per frame: a per-pixel key records its value
+	and doubles as the done flag, so midlines checked by strict mode are
+	reused as borders when the fill is refused.
+
+	The Julia formula is the shader's as written, z - (z^3 - 1) / (2 z^2);
+	its fixed points are still the cube roots of unity, reached at a linear
+	rate. The orbit is classified against the true roots rather than the
+	shader's constants, whose third root has sqrt(7) in place of sqrt(3).
+*/
+
+#include "a3_DemoFractalSubdiv.h"
+
+#include "animal3D/a3/a3macros.h"
+
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+
+//-----------------------------------------------------------------------------
+
+// key of a pixel not computed yet
+#define a3subdiv_pending	0xffffffff
+
+// imaginary part of the complex cube roots of unity
+#define a3subdiv_root3y		0.86602540378443865
+
+
+// one frame; counters are per thread, merged after the frame
+typedef struct a3_SubdivPass
+{
+	const a3_FractalSubdivDesc *desc;
+	double left, bottom, dx, dy;
+	unsigned int *key;
+	float *smooth;
+	a3_FractalSubdivStats *counters;
+} a3_SubdivPass;
+
+
+// write a pixel's outputs from its key and smooth value
+static void a3fractalSubdivStore(const a3_SubdivPass *pass, const unsigned int index, const unsigned int key, const float smooth)
+{
+	const a3_FractalSubdivDesc *desc = pass->desc;
+	const unsigned int root = key & 0x3, steps = key >> 2;
+
+	pass->key[index] = key;
+	pass->smooth[index] = smooth;
+	if (desc->formula == a3fractal_formulaJulia)
+	{
+		if (desc->iter_out_opt)
+			desc->iter_out_opt[index] = steps;
+		if (desc->root_out_opt)
+			desc->root_out_opt[index] = root < 3 ? (unsigned char)root : a3fractal_newtonNoRoot;
+		if (desc->rgba_out_opt)
+			a3fractalShadeRoot(root, 3, smooth, desc->rgba_out_opt + index * 4);
+	}
+	else
+	{
+		if (desc->iter_out_opt)
+			desc->iter_out_opt[index] = key;
+		if (desc->rgba_out_opt)
+			a3fractalShade(smooth, desc->rgba_out_opt + index * 4);
+	}
+}
+
+// compute a pixel unless it is already done; returns its key
+static unsigned int a3fractalSubdivPixel(const a3_SubdivPass *pass, const unsigned int x, const unsigned int y, a3_FractalSubdivStats *stats)
+{
+	const a3_FractalSubdivDesc *desc = pass->desc;
+	const unsigned int index = y * desc->width + x, cap = desc->iterations;
+	const double cx = pass->left + ((double)x + 0.5) * pass->dx;
+	const double cy = pass->bottom + ((double)y + 0.5) * pass->dy;
+	double zx = cx, zy = cy, nzx, mag = 0.0, x2, y2, d, fx, fy, gx, gy;
+	unsigned int iter, root = 3, key;
+	float smooth;
+
+	if (pass->key[index] != a3subdiv_pending)
+		return pass->key[index];
+
+	if (desc->formula == a3fractal_formulaJulia)
+	{
+		for (iter = 0; iter < cap; ++iter)
+		{
+			// closest root, checked before the step so a start on a
+			//	root takes 0 steps
+			if ((zx - 1.0) * (zx - 1.0) + zy * zy < a3fractal_subdivNewtonEpsilon)
+				root = 0;
+			else if ((zx + 0.5) * (zx + 0.5) + (zy - a3subdiv_root3y) * (zy - a3subdiv_root3y) < a3fractal_subdivNewtonEpsilon)
+				root = 1;
+			else if ((zx + 0.5) * (zx + 0.5) + (zy + a3subdiv_root3y) * (zy + a3subdiv_root3y) < a3fractal_subdivNewtonEpsilon)
+				root = 2;
+			if (root < 3)
+				break;
+
+			// z -= (z^3 - 1) / (2 z^2)
+			x2 = zx * zx - zy * zy;
+			y2 = 2.0 * zx * zy;
+			fx = x2 * zx - y2 * zy - 1.0;
+			fy = x2 * zy + y2 * zx;
+			gx = 2.0 * x2;
+			gy = 2.0 * y2;
+			d = gx * gx + gy * gy;
+			zx -= (fx * gx + fy * gy) / d;
+			zy -= (fy * gx - fx * gy) / d;
+		}
+		stats->iterations += iter;
+		key = (iter << 2) | root;
+		smooth = (float)iter;
+	}
+	else
+	{
+		for (iter = 0; iter < cap; ++iter)
+		{
+			// z' = (3x^2 - y^2, 6xy) + c
+			nzx = 3.0 * zx * zx - zy * zy + cx;
+			zy = 6.0 * zx * zy + cy;
+			zx = nzx;
+			mag = zx * zx + zy * zy;
+			if (mag > a3fractal_bailout)
+				break;
+		}
+		stats->iterations += iter < cap ? iter + 1 : cap;
+		key = iter;
+		smooth = iter < cap
+			? (float)((double)iter - 1.0 - log2(log2(mag)))
+			: a3fractal_interior;
+	}
+
+	++stats->computed;
+	a3fractalSubdivStore(pass, index, key, smooth);
+	return key;
+}
+
+// give the inside of a rectangle its border's value
+static void a3fractalSubdivFill(const a3_SubdivPass *pass, const unsigned int x0, const unsigned int y0, const unsigned int x1, const unsigned int y1, const unsigned int key, a3_FractalSubdivStats *stats)
+{
+	const unsigned int w = pass->desc->width;
+	const float s00 = pass->smooth[y0 * w + x0], s10 = pass->smooth[y0 * w + x1];
+	const float s01 = pass->smooth[y1 * w + x0], s11 = pass->smooth[y1 * w + x1];
+	const int interpolate = (pass->desc->formula == a3fractal_formulaMandelbrot && !a3fractalIsInterior(s00));
+	float u, v, smooth = s00;
+	unsigned int x, y, index;
+
+	for (y = y0 + 1; y < y1; ++y)
+		for (x = x0 + 1, index = y * w + x; x < x1; ++x, ++index)
+			if (pass->key[index] == a3subdiv_pending)
+			{
+				// one band: the iteration count is exact, but the smooth
+				//	value is only estimated, bilinearly from the corners;
+				//	computing it would cost the iterations the fill saves
+				if (interpolate)
+				{
+					u = (float)(x - x0) / (float)(x1 - x0);
+					v = (float)(y - y0) / (float)(y1 - y0);
+					smooth = (s00 + (s10 - s00) * u) * (1.0f - v) + (s01 + (s11 - s01) * u) * v;
+				}
+				a3fractalSubdivStore(pass, index, key, smooth);
+				++stats->filled;
+			}
+}
+
+// compute the midlines of a rectangle; returns 1 if they all have 'key'
+static int a3fractalSubdivMidlines(const a3_SubdivPass *pass, const unsigned int x0, const unsigned int y0, const unsigned int x1, const unsigned int y1, const unsigned int key, a3_FractalSubdivStats *stats)
+{
+	const unsigned int xm = (x0 + x1) / 2, ym = (y0 + y1) / 2;
+	unsigned int x, y;
+	int uniform = 1;
+	for (y = y0 + 1; y < y1; ++y)
+		uniform &= (a3fractalSubdivPixel(pass, xm, y, stats) == key);
+	for (x = x0 + 1; x < x1; ++x)
+		uniform &= (a3fractalSubdivPixel(pass, x, ym, stats) == key);
+	return uniform;
+}
+
+// subdivide a rectangle whose border is computed
+static void a3fractalSubdivRect(const a3_SubdivPass *pass, const unsigned int x0, const unsigned int y0, const unsigned int x1, const unsigned int y1, a3_FractalSubdivStats *stats)
+{
+	const unsigned int *key = pass->key, w = pass->desc->width;
+	const unsigned int xm = (x0 + x1) / 2, ym = (y0 + y1) / 2;
+	const unsigned int k = key[y0 * w + x0];
+	unsigned int x, y;
+	int uniform = 1;
+
+	// no inside
+	if (x1 - x0 < 2 || y1 - y0 < 2)
+		return;
+
+	for (x = x0; x <= x1 && uniform; ++x)
+		uniform = (key[y0 * w + x] == k && key[y1 * w + x] == k);
+	for (y = y0 + 1; y < y1 && uniform; ++y)
+		uniform = (key[y * w + x0] == k && key[y * w + x1] == k);
+	if (uniform && pass->desc->strict && !a3fractalSubdivMidlines(pass, x0, y0, x1, y1, k, stats))
+	{
+		++stats->rejected;
+		uniform = 0;
+	}
+	if (uniform)
+	{
+		a3fractalSubdivFill(pass, x0, y0, x1, y1, k, stats);
+		return;
+	}
+
+	// small enough to compute outright
+	if (x1 - x0 - 1 <= a3fractal_subdivMin || y1 - y0 - 1 <= a3fractal_subdivMin)
+	{
+		for (y = y0 + 1; y < y1; ++y)
+			for (x = x0 + 1; x < x1; ++x)
+				a3fractalSubdivPixel(pass, x, y, stats);
+		return;
+	}
+
+	// quarters share the midlines
+	a3fractalSubdivMidlines(pass, x0, y0, x1, y1, k, stats);
+	a3fractalSubdivRect(pass, x0, y0, xm, ym, stats);
+	a3fractalSubdivRect(pass, xm, y0, x1, ym, stats);
+	a3fractalSubdivRect(pass, x0, ym, xm, y1, stats);
+	a3fractalSubdivRect(pass, xm, ym, x1, y1, stats);
+}
+
+
+static void a3fractalSubdivTask(void *args, unsigned int x0, unsigned int y0, unsigned int x1, unsigned int y1, unsigned int workerIndex)
+{
+	const a3_SubdivPass *pass = (const a3_SubdivPass *)args;
+	a3_FractalSubdivStats stats = { 0 };
+	unsigned int x, y;
+
+	// tile border, then the inside; ranges are exclusive, rectangles not
+	--x1;
+	--y1;
+	for (x = x0; x <= x1; ++x)
+	{
+		a3fractalSubdivPixel(pass, x, y0, &stats);
+		a3fractalSubdivPixel(pass, x, y1, &stats);
+	}
+	for (y = y0 + 1; y < y1; ++y)
+	{
+		a3fractalSubdivPixel(pass, x0, y, &stats);
+		a3fractalSubdivPixel(pass, x1, y, &stats);
+	}
+	a3fractalSubdivRect(pass, x0, y0, x1, y1, &stats);
+
+	pass->counters[workerIndex].computed += stats.computed;
+	pass->counters[workerIndex].filled += stats.filled;
+	pass->counters[workerIndex].rejected += stats.rejected;
+	pass->counters[workerIndex].iterations += stats.iterations;
+}
+
+
+//-----------------------------------------------------------------------------
+
+int a3fractalSubdivRender(const a3_FractalSubdivDesc *desc, a3_ThreadPool *pool_opt, a3_FractalSubdivStats *stats_out_opt)
+{
+	a3_FractalSubdivStats stats = { 0 };
+	a3_SubdivPass pass[1];
+	unsigned int workers, pixels, tile, i;
+
+	if (desc && desc->width && desc->height)
+	{
+		pixels = desc->width * desc->height;
+		workers = a3threadPoolGetWorkerCount(pool_opt) + 1;
+		pass->counters = (a3_FractalSubdivStats *)calloc(workers, sizeof(a3_FractalSubdivStats));
+		pass->key = (unsigned int *)malloc(pixels * sizeof(unsigned int));
+		pass->smooth = desc->smooth_out_opt ? desc->smooth_out_opt : (float *)malloc(pixels * sizeof(float));
+		if (pass->counters && pass->key && pass->smooth)
+		{
+			memset(pass->key, 0xff, pixels * sizeof(unsigned int));
+			pass->desc = desc;
+			pass->dx = desc->view.width / (double)desc->width;
+			pass->dy = desc->view.height / (double)desc->height;
+			pass->left = desc->view.centerX - 0.5 * desc->view.width;
+			pass->bottom = desc->view.centerY - 0.5 * desc->view.height;
+			tile = desc->tileSize ? desc->tileSize : a3fractal_subdivTile;
+			if (a3threadPoolParallelFor2D(pool_opt, 0, a3fractalSubdivTask, pass, desc->width, desc->height, tile, tile) < 0)
+				pixels = 0;
+			for (i = 0; i < workers && pixels; ++i)
+			{
+				stats.computed += pass->counters[i].computed;
+				stats.filled += pass->counters[i].filled;
+				stats.rejected += pass->counters[i].rejected;
+				stats.iterations += pass->counters[i].iterations;
+			}
+			if (stats_out_opt && pixels)
+				*stats_out_opt = stats;
+		}
+		else
+			pixels = 0;
+
+		if (pass->smooth != desc->smooth_out_opt)
+			free(pass->smooth);
+		free(pass->key);
+		free(pass->counters);
+		return (int)pixels;
+	}
+	return -1;
+}
+
+
+//-----------------------------------------------------------------------------
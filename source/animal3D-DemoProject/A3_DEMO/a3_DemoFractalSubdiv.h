@@ -0,0 +1,137 @@
+/*
+	animal3D SDK: Minimal 3D Animation Framework
+	Fractals Midterm: CPU fractal engines
+
+	a3_DemoFractalSubdiv.h
+	Mariani-Silver rectangle subdivision for both fractal shaders.
+
+	The image is cut into tiles; each tile computes its border first. If
+	every border pixel has the same value, the whole tile takes that value
+	without iterating; otherwise the tile is split in four along its
+	midlines, which become borders of the quarters, and each quarter is
+	treated the same way down to a minimum size. Large uniform regions,
+	inside the set or deep in one escape band, cost only their outline.
+
+	A pixel's value is its escape iteration for "drawMandlebrot_fs4x.glsl"
+	and its convergence step and root for "drawJulia_fs4x.glsl". Filling is
+	exact for interior regions of the Mandelbrot formula (the set has no
+	holes), but any formula can have a feature smaller than the border
+	spacing entirely inside a tile, or a band that wraps around one; strict
+	mode also requires both midlines to match before it fills.
+
+	Only the value tested is filled exactly. A filled Mandelbrot escape
+	pixel has its band's iteration count, but its smooth count is not
+	computed: it is interpolated from the tile's corners, so it can be off
+	by up to the band's width, one iteration. Where exact smooth counts
+	matter, use the escape-time engine.
+*/
+
+#ifndef __ANIMAL3D_DEMOFRACTALSUBDIV_H
+#define __ANIMAL3D_DEMOFRACTALSUBDIV_H
+
+
+#include "a3_DemoFractalNewton.h"
+
+
+//-----------------------------------------------------------------------------
+
+#ifdef __cplusplus
+extern "C"
+{
+#else	// !__cplusplus
+	typedef struct a3_FractalSubdivDesc			a3_FractalSubdivDesc;
+	typedef struct a3_FractalSubdivStats		a3_FractalSubdivStats;
+	typedef enum a3_FractalFormula				a3_FractalFormula;
+#endif	// __cplusplus
+
+
+//-----------------------------------------------------------------------------
+
+	// default top-level tile edge in pixels
+#define a3fractal_subdivTile			64
+
+	// rectangles with no more than this many pixels across their inside,
+	//	on either axis, are computed pixel by pixel instead of split
+#define a3fractal_subdivMin				4
+
+	// squared distance to a root at which a Newton orbit counts as
+	//	converged
+#define a3fractal_subdivNewtonEpsilon	1.0e-12
+
+
+	// formula a renderer evaluates
+	enum a3_FractalFormula
+	{
+		a3fractal_formulaMandelbrot,	// "drawMandlebrot_fs4x.glsl" escape time
+		a3fractal_formulaJulia,			// "drawJulia_fs4x.glsl" Newton map
+	};
+
+
+	// subdivision render description
+	//	member view: window into the complex plane
+	//	members width, height: image dimensions in pixels
+	//	member iterations: iteration cap; the Julia shader uses 512
+	//	member formula: formula to evaluate
+	//	member tileSize: top-level tile edge in pixels; 0 picks a default
+	//	member strict: nonzero to check both midlines before filling
+	//	member smooth_out_opt: optional smooth value per pixel; Mandelbrot
+	//		as the escape-time engine for computed pixels, but filled escape
+	//		pixels are only approximated, interpolated between the tile's
+	//		corners; Julia stores the convergence step
+	//	member iter_out_opt: optional escape iteration or convergence step
+	//		per pixel; pixels that never finish store 'iterations'
+	//	member root_out_opt: optional root index per pixel, Julia only;
+	//		'a3fractal_newtonNoRoot' if the orbit never converged
+	//	member rgba_out_opt: optional 8-bit RGBA color per pixel
+	// all buffers are row-major, row 0 at the bottom (texcoord v = 0)
+	struct a3_FractalSubdivDesc
+	{
+		a3_FractalView view;
+		unsigned int width, height;
+		unsigned int iterations;
+		a3_FractalFormula formula;
+		unsigned int tileSize;
+		int strict;
+		float *smooth_out_opt;
+		unsigned int *iter_out_opt;
+		unsigned char *root_out_opt;
+		unsigned char *rgba_out_opt;
+	};
+
+
+	// per-frame counters
+	//	member computed: pixels iterated
+	//	member filled: pixels given their value by a fill
+	//	member rejected: fills strict mode refused because a midline did
+	//		not match the border
+	//	member iterations: pixel iterations performed
+	struct a3_FractalSubdivStats
+	{
+		unsigned int computed;
+		unsigned int filled;
+		unsigned int rejected;
+		unsigned long long iterations;
+	};
+
+
+//-----------------------------------------------------------------------------
+
+	// Render an image by rectangle subdivision.
+	//	param desc: non-null pointer to render description
+	//	param pool_opt: optional pool; tiles render on this thread if null
+	//	param stats_out_opt: optional pointer to frame counters
+	//	return: number of pixels rendered if success
+	//	return: 0 if fail (out of memory)
+	//	return: -1 if invalid params
+	int a3fractalSubdivRender(const a3_FractalSubdivDesc *desc, a3_ThreadPool *pool_opt, a3_FractalSubdivStats *stats_out_opt);
+
+
+//-----------------------------------------------------------------------------
+
+
+#ifdef __cplusplus
+}
+#endif	// __cplusplus
+
+
+#endif	// !__ANIMAL3D_DEMOFRACTALSUBDIV_H